@@ -52,6 +52,8 @@ params = {
     "saddle":{                # Iteration for the pressure field 
         "max_iter" :100,      # Maximum number of iterations
         "tolerance":1e-4,     # Tolerance of incompressibility 
+        "compressor":"am",    # "am": Anderson mixing, "lr": linear response (RPA) of the melt,
+                              # "lram": Anderson mixing of linear-response steps (only for cpu-mkl)
     },
 
     "am":{
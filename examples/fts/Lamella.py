@@ -52,6 +52,8 @@ params = {
     "saddle":{                # Iteration for the pressure field 
         "max_iter" :100,      # Maximum number of iterations
         "tolerance":1e-4,     # Tolerance of incompressibility 
+        "compressor":"am",    # "am": Anderson mixing, "lr": linear response (RPA) of the melt,
+                              # "lram": Anderson mixing of linear-response steps (only for cpu-mkl)
     },
 
     "am":{
@@ -61,6 +63,8 @@ params = {
         "mix_init":0.01,            # Initial mixing rate of simple mixing
     },
 
+    # "driver":"cpp",       # "cpp": Langevin steps are run in C++ between recordings (only for cpu-mkl)
+
     "verbose_level":1,      # 1 : Print at each Langevin step.
                             # 2 : Print at each saddle point iteration.
 }
@@ -0,0 +1,94 @@
+import os
+import time
+import numpy as np
+import lfts
+
+# OpenMP environment variables
+os.environ["OMP_MAX_ACTIVE_LEVELS"] = "1"  # 0, 1
+os.environ["OMP_NUM_THREADS"] = "1"  # 1 ~ 4, for each replica
+
+f = 0.5         # A-fraction of major BCP chain, f
+eps = 1.0       # a_A/a_B, conformational asymmetry
+
+params = {
+    "platform":"cpu-mkl",       # Parallel tempering runs Langevin steps of each replica in C++ (only for cpu-mkl)
+
+    "nx":[32, 32, 32],          # Simulation grid numbers
+    "lx":[8.0, 8.0, 8.0],       # Simulation box size as a_Ref * N_Ref^(1/2) unit,
+                                # where "a_Ref" is reference statistical segment length
+                                # and "N_Ref" is the number of segments of reference linear homopolymer chain.
+
+    "chain_model":"continuous", # "discrete" or "continuous" chain model
+    "ds":1/16,                  # Contour step interval, which is equal to 1/N_Ref.
+
+    "segment_lengths":{         # Relative statistical segment length compared to "a_Ref.
+        "A":np.sqrt(eps*eps/(eps*eps*f + (1-f))), 
+        "B":np.sqrt(    1.0/(eps*eps*f + (1-f))), },
+
+    "chi_n": {"A,B": 14.0},     # Bare interaction parameter. This is replaced by χN of each replica.
+
+    "distinct_polymers":[{      # Distinct Polymers
+        "volume_fraction":1.0,  # Volume fraction of polymer chain
+        "blocks":[              # AB diBlock Copolymer
+            {"type":"A", "length":f, }, # A-block
+            {"type":"B", "length":1-f}, # B-block
+        ],},],
+        
+    "langevin":{                # Langevin Dynamics
+        "max_step":200000,      # Langevin steps for simulation
+        "dt":8.0,               # Langevin step interval, delta tau*N_Ref
+        "nbar":1024,            # Invariant polymerization index, nbar of N_Ref
+    },
+    
+    "recording":{                       # Recording Simulation Data
+        "dir":"data_simulation",        # Directory name. Data of each replica are saved in "chi_n_00", "chi_n_01", ...
+        "recording_period":1000,        # Period for recording concentrations and fields
+        "sf_computing_period":10,       # Period for computing structure function
+        "sf_recording_period":10000,    # Period for recording structure function
+    },
+
+    "saddle":{                # Iteration for the pressure field 
+        "max_iter" :100,      # Maximum number of iterations
+        "tolerance":1e-4,     # Tolerance of incompressibility 
+    },
+
+    "am":{
+        "max_hist":20,              # Maximum number of history
+        "start_error":5e-1,         # When switch to AM from simple mixing
+        "mix_min":0.01,             # Minimum mixing rate of simple mixing
+        "mix_init":0.01,            # Initial mixing rate of simple mixing
+    },
+
+    "verbose_level":0,      # 0 : No output for Langevin steps
+                            # 1 : Print at each Langevin step.
+}
+
+# χN of replicas near the order-disorder transition, and the number of Langevin steps between replica exchanges
+chi_n_list = [{"A,B": 13.5}, {"A,B": 14.0}, {"A,B": 14.5}, {"A,B": 15.0}]
+exchange_period = 100
+
+if __name__ == "__main__":
+    # Set random seed
+    # If you want to obtain different results for each execution, set random_seed=None
+    random_seed = 12345
+    np.random.seed(random_seed)
+
+    # Set initial fields
+    print("w_A and w_B are initialized to random Gaussian.")
+    w_A = np.random.normal(0.0, 1.0, params["nx"])
+    w_B = np.random.normal(0.0, 1.0, params["nx"])
+
+    # Initialize calculation
+    simulation = lfts.ParallelTempering(params=params, chi_n_list=chi_n_list,
+        exchange_period=exchange_period, random_seed=random_seed)
+
+    # Set a timer
+    time_start = time.time()
+
+    # Run. Acceptance ratios are recorded in "data_simulation/replica_exchange.txt".
+    simulation.run(initial_fields={"A": w_A, "B": w_B})
+
+    # Estimate execution time
+    time_duration = time.time() - time_start
+    print("total time: %f, time per step: %f" %
+        (time_duration, time_duration/params["langevin"]["max_step"]) )
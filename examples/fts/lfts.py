@@ -3,6 +3,8 @@ import time
 import re
 import pathlib
 import copy
+import multiprocessing
+from multiprocessing import shared_memory
 import numpy as np
 import itertools
 import networkx as nx
@@ -215,15 +217,21 @@ class SymmetricPolymerTheory:
 
         return h_const, h_coef_mu1, h_coef_mu2
 
-    # Compute total Hamiltonian
-    def compute_hamiltonian(self, molecules, w_aux, total_partitions):
+    # Compute Hamiltonian part that is related to fields, including the reference energy
+    def compute_hamiltonian_fields(self, w_aux):
         S = len(self.monomer_types)
 
-        # Compute Hamiltonian part that is related to fields
         hamiltonian_fields = -np.mean(w_aux[S-1])
         for i in range(S-1):
             hamiltonian_fields += self.h_coef_mu2[i]*np.mean(w_aux[i]**2)
             hamiltonian_fields += self.h_coef_mu1[i]*np.mean(w_aux[i])
+        return hamiltonian_fields + self.h_const
+
+    # Compute total Hamiltonian
+    def compute_hamiltonian(self, molecules, w_aux, total_partitions):
+
+        # Compute Hamiltonian part that is related to fields
+        hamiltonian_fields = self.compute_hamiltonian_fields(w_aux)
         
         # Compute Hamiltonian part that total partition functions
         hamiltonian_partition = 0.0
@@ -232,7 +240,7 @@ class SymmetricPolymerTheory:
                             molecules.get_polymer(p).get_alpha() * \
                             np.log(total_partitions[p])
 
-        return hamiltonian_partition + hamiltonian_fields + self.h_const
+        return hamiltonian_partition + hamiltonian_fields
 
     # Compute functional derivatives of Hamiltonian w.r.t. fields of selected indices
     def compute_func_deriv(self, w_aux, phi, indices):
@@ -298,6 +306,8 @@ class LFTS:
         # (C++ class) Create a factory for given platform and chain_model
         if "reduce_gpu_memory_usage" in params and platform == "cuda":
             factory = PlatformSelector.create_factory(platform, params["reduce_gpu_memory_usage"])
+        elif "reduce_memory_usage" in params:
+            factory = PlatformSelector.create_factory(platform, params["reduce_memory_usage"])
         else:
             factory = PlatformSelector.create_factory(platform, False)
         factory.display_info()
@@ -447,7 +457,13 @@ class LFTS:
             molecules.add_polymer(polymer["volume_fraction"], polymer["blocks_input"])
 
         # (C++ class) Propagator Analyzer
-        if "aggregate_propagator_computation" in params:
+        if "aggregate_propagator_computation" in params and params["aggregate_propagator_computation"] == "auto":
+            # Choose the aggregation plan with the smallest predicted cost for the number of threads
+            n_streams = int(os.environ.get("OMP_NUM_THREADS", 4))
+            max_live_segments = int(os.environ.get("LFTS_MAX_LIVE_SEGMENTS", 0))
+            propagator_analyzer = factory.create_propagator_analyzer(molecules, n_streams, max_live_segments)
+            print("Aggregation plan: %s" % (propagator_analyzer.get_aggregation_plan()))
+        elif "aggregate_propagator_computation" in params:
             propagator_analyzer = factory.create_propagator_analyzer(molecules, params["aggregate_propagator_computation"])
         else:
             propagator_analyzer = factory.create_propagator_analyzer(molecules, True)
@@ -456,18 +472,38 @@ class LFTS:
         solver = factory.create_pseudospectral_solver(cb, molecules, propagator_analyzer)
 
         # (C++ class) Fields Relaxation using Anderson Mixing
-        am = factory.create_anderson_mixing(
-            len(self.mpt.aux_fields_imag_idx)*np.prod(params["nx"]),   # the number of variables
-            params["am"]["max_hist"],                                   # maximum number of history
-            params["am"]["start_error"],                                # when switch to AM from simple mixing
-            params["am"]["mix_min"],                                    # minimum mixing rate of simple mixing
-            params["am"]["mix_init"])                                   # initial mixing rate of simple mixing
+        S = len(self.monomer_types)
+        compressor = params["saddle"].get("compressor", "am")
+        if compressor == "am":
+            am = factory.create_anderson_mixing(
+                len(self.mpt.aux_fields_imag_idx)*np.prod(params["nx"]),   # the number of variables
+                params["am"]["max_hist"],                                   # maximum number of history
+                params["am"]["start_error"],                                # when switch to AM from simple mixing
+                params["am"]["mix_min"],                                    # minimum mixing rate of simple mixing
+                params["am"]["mix_init"],                                   # initial mixing rate of simple mixing
+                params["am"].get("history_precision", "double"))            # "single" halves memory for histories (only for CPU)
+            self.am_lr = None
+        elif compressor in ["lr", "lram"]:
+            # (C++ class) Linear-response compressor using RPA of the melt
+            # "lram": Anderson mixing is applied to the linear-response step, so the step is not damped by simple mixing
+            self.am_lr = None
+            if compressor == "lram":
+                self.am_lr = factory.create_anderson_mixing(
+                    len(self.mpt.aux_fields_imag_idx)*np.prod(params["nx"]),
+                    params["am"]["max_hist"], params["am"]["start_error"], 1.0, 1.0,
+                    params["am"].get("history_precision", "double"))
+            vector_d = [2*self.mpt.h_coef_mu2[i] if i != S-1 else 0.0 for i in self.mpt.aux_fields_imag_idx]
+            am = factory.create_linear_response_compressor(
+                cb, molecules, self.monomer_types,
+                self.mpt.matrix_a[:,self.mpt.aux_fields_imag_idx].tolist(), vector_d,
+                self.am_lr, self.random_fraction)
+        else:
+            raise ValueError("Unknown saddle point compressor '%s'. Choose among 'am', 'lr' and 'lram'." % (compressor))
 
         # Standard deviation of normal noise of Langevin dynamics
         langevin_sigma = calculate_sigma(params["langevin"]["nbar"], params["langevin"]["dt"], np.prod(params["nx"]), np.prod(params["lx"]))
 
         # dH/dw_aux[i] is scaled by dt_scaling[i]
-        S = len(self.monomer_types)
         self.dt_scaling = np.ones(S)
         for i in range(S-1):
             self.dt_scaling[i] = np.abs(self.mpt.eigenvalues[i])/np.max(np.abs(self.mpt.eigenvalues))
@@ -529,6 +565,22 @@ class LFTS:
         self.solver = solver 
         self.am = am
 
+        # (C++ class) Langevin steps are run in C++ between recordings if "driver" is "cpp".
+        # Its random number generator is std::mt19937_64 instead of PCG64.
+        self.langevin_fts = None
+        if params.get("driver", "python") == "cpp":
+            self.langevin_fts = factory.create_langevin_fts(
+                cb, molecules, solver, am, self.monomer_types,
+                self.mpt.matrix_a.tolist(), self.mpt.matrix_a_inv.tolist(), self.mpt.eigenvalues.tolist(),
+                self.mpt.aux_fields_real_idx, self.mpt.aux_fields_imag_idx,
+                self.mpt.h_const, self.mpt.h_coef_mu1.tolist(), self.mpt.h_coef_mu2.tolist(), self.dt_scaling.tolist(),
+                self.langevin["dt"], self.langevin["sigma"], self.saddle["max_iter"], self.saddle["tolerance"],
+                self.recording["sf_computing_period"], self.verbose_level, self.random_fraction,
+                -1 if random_seed is None else random_seed)
+            for key in self.chi_n:
+                self.langevin_fts.add_chi_n_derivative(key, self.mpt.h_const_deriv_chin[key],
+                    self.mpt.h_coef_mu1_deriv_chin[key].tolist(), self.mpt.h_coef_mu2_deriv_chin[key].tolist())
+
     def compute_concentrations(self, w_aux):
         S = len(self.monomer_types)
         elapsed_time = {}
@@ -588,6 +640,8 @@ class LFTS:
             "random_state_state":str(self.random_bg.state["state"]["state"]),
             "random_state_inc":str(self.random_bg.state["state"]["inc"]),
             "normal_noise_prev":normal_noise_prev}
+        if self.langevin_fts is not None:
+            mdic["random_state_cpp"] = self.langevin_fts.get_random_state()
 
         # Add w fields to the dictionary
         for i, name in enumerate(self.monomer_types):
@@ -617,6 +671,8 @@ class LFTS:
                       'inc':   int(load_data["random_state_inc"])},
                       'has_uint32': 0, 'uinteger': 0}
         print("Restored Random Number Generator: ", self.random_bg.state)
+        if self.langevin_fts is not None and "random_state_cpp" in load_data:
+            self.langevin_fts.set_random_state(str(load_data["random_state_cpp"]))
 
         # Make initial_fields
         initial_fields = {}
@@ -650,6 +706,10 @@ class LFTS:
         # Convert monomer chemical potential fields into auxiliary fields
         w_aux = self.mpt.to_aux_fields(w)
 
+        # Run Langevin steps in C++
+        if self.langevin_fts is not None:
+            return self.run_cpp(w_aux, normal_noise_prev, start_langevin_step)
+
         # Find saddle point
         print("iterations, mass error, total partitions, Hamiltonian, incompressibility error (or saddle point error)")
         phi, _, _, _, = self.find_saddle_point(w_aux=w_aux)
@@ -804,6 +864,95 @@ class LFTS:
                 time_duration/(self.langevin["max_step"]+1-start_langevin_step), \
                 total_error_level/(self.langevin["max_step"]+1-start_langevin_step)
 
+    def run_cpp(self, w_aux, normal_noise_prev, start_langevin_step):
+
+        lfts = self.langevin_fts
+        if start_langevin_step is None :
+            start_langevin_step = 1
+
+        # Find saddle point
+        lfts.set_fields(w_aux)
+        if normal_noise_prev is not None:
+            lfts.set_normal_noise_prev(normal_noise_prev)
+        print("iterations, mass error, total partitions, Hamiltonian, incompressibility error (or saddle point error)")
+        lfts.find_saddle_point()
+        lfts.clear_history()
+        lfts.reset_structure_function()
+
+        # Statistics of this run
+        saddle_iter_start = lfts.get_total_saddle_iter()
+        error_level_start = lfts.get_total_error_level()
+        saddle_fail_start = lfts.get_saddle_fail_count()
+        time_start = time.time()
+
+        self.run_cpp_steps(start_langevin_step, self.langevin["max_step"])
+
+        print( "The number of times that tolerance of saddle point was not met and Langevin random noise was regenerated: %d times" % 
+            (lfts.get_saddle_fail_count() - saddle_fail_start))
+
+        # Estimate execution time
+        time_duration = time.time() - time_start
+        total_saddle_iter = lfts.get_total_saddle_iter() - saddle_iter_start
+        total_error_level = lfts.get_total_error_level() - error_level_start
+        return total_saddle_iter, \
+                total_saddle_iter/(self.langevin["max_step"]+1-start_langevin_step), \
+                time_duration/(self.langevin["max_step"]+1-start_langevin_step), \
+                total_error_level/(self.langevin["max_step"]+1-start_langevin_step)
+
+    # Run Langevin steps in C++ from the current fields of self.langevin_fts, and save data at the recording periods.
+    # Return False if the simulation is aborted.
+    def run_cpp_steps(self, start_langevin_step, end_langevin_step):
+
+        lfts = self.langevin_fts
+        S = len(self.monomer_types)
+
+        # Run Langevin steps until the next recording
+        langevin_step = start_langevin_step
+        while langevin_step <= end_langevin_step:
+            end_step = end_langevin_step
+            for period in [self.recording["sf_recording_period"], self.recording["recording_period"]]:
+                end_step = min(end_step, (langevin_step + period - 1)//period*period)
+            if not lfts.run(langevin_step, end_step):
+                return False
+            langevin_step = end_step + 1
+
+            # Save H and dH/dχN, and structure function
+            if end_step % self.recording["sf_recording_period"] == 0:
+                mdic = {"H_history": np.array(lfts.get_hamiltonian_history())}
+                dH_history = lfts.get_dh_history()
+                for key in self.chi_n:
+                    monomer_pair = sorted(key.split(","))
+                    mdic["dH_history_" + monomer_pair[0] + "_" + monomer_pair[1]] = np.array(dH_history[key])
+                savemat(os.path.join(self.recording["dir"], "dH_%06d.mat" % (end_step)), mdic, long_field_names=True, do_compression=True)
+
+                chi_n_mat = {}
+                for key in self.chi_n:
+                    monomer_pair = sorted(key.split(","))
+                    chi_n_mat[monomer_pair[0] + "," + monomer_pair[1]] = self.chi_n[key]
+                mdic = {"dim":self.cb.get_dim(), "nx":self.cb.get_nx(), "lx":self.cb.get_lx(),
+                        "chi_n":chi_n_mat, "chain_model":self.chain_model, "ds":self.ds,
+                        "dt":self.langevin["dt"], "nbar":self.langevin["nbar"], "initial_params":self.params}
+                for i, j in itertools.combinations_with_replacement(list(range(S)),2):
+                    sf_average = lfts.get_structure_function(i, j)*self.recording["sf_computing_period"]/self.recording["sf_recording_period"]* \
+                            self.cb.get_volume()*np.sqrt(self.langevin["nbar"])
+                    mdic["structure_function_" + self.monomer_types[i] + "_" + self.monomer_types[j]] = sf_average
+                savemat(os.path.join(self.recording["dir"], "structure_function_%06d.mat" % (end_step)), mdic, long_field_names=True, do_compression=True)
+
+                lfts.clear_history()
+                lfts.reset_structure_function()
+
+            # Save simulation data
+            if end_step % self.recording["recording_period"] == 0:
+                phi_array = lfts.get_concentrations()
+                phi = {}
+                for i in range(S):
+                    phi[self.monomer_types[i]] = phi_array[i]
+                self.save_simulation_data(
+                    path=os.path.join(self.recording["dir"], "fields_%06d.mat" % (end_step)),
+                    w=self.mpt.to_monomer_fields(lfts.get_fields()), phi=phi, langevin_step=end_step,
+                    normal_noise_prev=lfts.get_normal_noise_prev())
+        return True
+
     def find_saddle_point(self, w_aux):
 
         # The number of components
@@ -819,6 +968,9 @@ class LFTS:
         # Reset Anderson mixing module
         self.am.reset_count()
 
+        # Output buffer of Anderson mixing, reused by all iterations
+        w_imag_new = np.zeros(I*self.cb.get_n_grid(), dtype=np.float64)
+
         # Saddle point iteration begins here
         for saddle_iter in range(1,self.saddle["max_iter"]+1):
             
@@ -855,14 +1007,237 @@ class LFTS:
             if error_level < self.saddle["tolerance"]:
                 break
 
-            # Scaling h_deriv
-            for count, i in enumerate(self.mpt.aux_fields_imag_idx):
-                h_deriv[count] *= self.dt_scaling[i]
+            # Scaling h_deriv, except for the linear-response compressor that computes the Newton step
+            if self.saddle.get("compressor", "am") == "am":
+                for count, i in enumerate(self.mpt.aux_fields_imag_idx):
+                    h_deriv[count] *= self.dt_scaling[i]
 
             # Calculate new fields using simple and Anderson mixing
-            w_aux[self.mpt.aux_fields_imag_idx] = np.reshape(self.am.calculate_new_fields(w_aux[self.mpt.aux_fields_imag_idx], -h_deriv, old_error_level, error_level), [I, self.cb.get_n_grid()])
+            self.am.calculate_new_fields(w_aux[self.mpt.aux_fields_imag_idx], -h_deriv, old_error_level, error_level, out=w_imag_new)
+            w_aux[self.mpt.aux_fields_imag_idx] = np.reshape(w_imag_new, [I, self.cb.get_n_grid()])
         
         # Set mean of pressure field to zero
         w_aux[S-1] -= np.mean(w_aux[S-1])
         
-        return phi, hamiltonian, saddle_iter, error_level
\ No newline at end of file
+        return phi, hamiltonian, saddle_iter, error_level
+
+# Worker process of ParallelTempering. The replica at params["chi_n"] runs Langevin steps in C++,
+# and its auxiliary fields and normal noise are exchanged with other replicas through shared memory.
+def run_replica(params, random_seed, replica_idx, shm_names, shape_w_aux, shape_noise, conn):
+
+    shm_w_aux = shared_memory.SharedMemory(name=shm_names[0])
+    shm_noise = shared_memory.SharedMemory(name=shm_names[1])
+    w_aux_buffer = np.ndarray(shape_w_aux, dtype=np.float64, buffer=shm_w_aux.buf)[replica_idx]
+    noise_buffer = np.ndarray(shape_noise, dtype=np.float64, buffer=shm_noise.buf)[replica_idx]
+    try:
+        simulation = LFTS(params=params, random_seed=random_seed)
+        lfts = simulation.langevin_fts
+        pathlib.Path(simulation.recording["dir"]).mkdir(parents=True, exist_ok=True)
+        conn.send(True)
+
+        while True:
+            command = conn.recv()
+            if command[0] == "load":
+                # Fields are replaced by the coordinator. The saddle point is found again to update the concentrations.
+                lfts.set_fields(w_aux_buffer)
+                lfts.set_normal_noise_prev(noise_buffer)
+                lfts.find_saddle_point()
+                w_aux_buffer[:] = lfts.get_fields()
+                conn.send(True)
+            elif command[0] == "run":
+                is_success = simulation.run_cpp_steps(command[1], command[2])
+                w_aux_buffer[:] = lfts.get_fields()
+                noise_buffer[:] = lfts.get_normal_noise_prev()
+                conn.send(is_success)
+            elif command[0] == "stop":
+                conn.send((lfts.get_total_saddle_iter(), lfts.get_saddle_fail_count()))
+                break
+    except Exception as exc:
+        conn.send(exc)
+    finally:
+        # Views of shared memory must be released before closing it
+        del w_aux_buffer, noise_buffer
+        shm_w_aux.close()
+        shm_noise.close()
+
+class ParallelTempering:
+    def __init__(self, params, chi_n_list, exchange_period, random_seed=None):
+
+        # Replicas at different χN are run by worker processes on one node. After every 'exchange_period' Langevin steps,
+        # the configurations of neighboring replicas are swapped by the Metropolis criterion. Since the probability
+        # of a configuration is proportional to exp(-sqrt(nbar)*V*H), and the total partition functions
+        # do not depend on χN for the given fields, the criterion only needs the field part of the Hamiltonian.
+        assert(len(chi_n_list) >= 2), \
+            "At least two replicas are required for parallel tempering."
+
+        self.monomer_types = sorted(list(params["segment_lengths"].keys()))
+        S = len(self.monomer_types)
+
+        # Multimonomer polymer field theory of each replica
+        self.mpt_list = []
+        for chi_n in chi_n_list:
+            chi_n_sorted = {}
+            for monomer_pair_str, chin_value in chi_n.items():
+                monomer_pair = sorted(re.split(',| |_|/', monomer_pair_str))
+                chi_n_sorted[monomer_pair[0] + "," + monomer_pair[1]] = chin_value
+            for monomer_pair in itertools.combinations(self.monomer_types, 2):
+                monomer_pair = sorted(monomer_pair)
+                chi_n_sorted.setdefault(monomer_pair[0] + "," + monomer_pair[1], 0.0)
+            self.mpt_list.append(SymmetricPolymerTheory(self.monomer_types, chi_n_sorted))
+
+        # Configurations can be exchanged only if all replicas share the same auxiliary fields
+        for mpt in self.mpt_list:
+            assert(np.allclose(mpt.matrix_a, self.mpt_list[0].matrix_a)), \
+                "Matrix A must be the same for all χN. Change χN by a common factor, for example."
+            assert(mpt.aux_fields_real_idx == self.mpt_list[0].aux_fields_real_idx), \
+                "Real auxiliary fields must be the same for all χN."
+            assert(mpt.aux_fields_imag_idx == [S-1]), \
+                "Parallel tempering does not support imaginary auxiliary fields other than the pressure field."
+
+        # Parameters of each replica
+        self.params_list = []
+        for k, chi_n in enumerate(chi_n_list):
+            params_replica = copy.deepcopy(params)
+            params_replica["chi_n"] = copy.deepcopy(chi_n)
+            params_replica["driver"] = "cpp"
+            params_replica["recording"]["dir"] = os.path.join(params["recording"]["dir"], "chi_n_%02d" % (k))
+            self.params_list.append(params_replica)
+
+        # Random seeds of replicas, and random generator for the Metropolis criterion
+        if random_seed is None:
+            self.random_seeds = [None]*len(chi_n_list)
+            self.random = np.random.Generator(np.random.PCG64())
+        else:
+            self.random_seeds = [random_seed + k for k in range(len(chi_n_list))]
+            self.random = np.random.Generator(np.random.PCG64(random_seed + len(chi_n_list)))
+
+        self.chi_n_list = copy.deepcopy(chi_n_list)
+        self.exchange_period = exchange_period
+        self.max_step = params["langevin"]["max_step"]
+        self.n_grid = np.prod(params["nx"])
+        self.recording_dir = params["recording"]["dir"]
+        self.beta = np.sqrt(params["langevin"]["nbar"])*np.prod(params["lx"])
+
+        print("---------- Parallel Tempering ----------")
+        print("Number of replicas: %d" % (len(chi_n_list)))
+        for k, chi_n in enumerate(chi_n_list):
+            print("\tReplica %d: " % (k), chi_n)
+        print("Exchange period: %d" % (exchange_period))
+
+    def run(self, initial_fields):
+
+        print("---------- Run Parallel Tempering ----------")
+
+        K = len(self.mpt_list)
+        S = len(self.monomer_types)
+        R = len(self.mpt_list[0].aux_fields_real_idx)
+        M = self.n_grid
+        pathlib.Path(self.recording_dir).mkdir(parents=True, exist_ok=True)
+
+        # Shared memory for auxiliary fields and normal noise of all replicas
+        shape_w_aux = (K, S, M)
+        shape_noise = (K, R, M)
+        shm_w_aux = shared_memory.SharedMemory(create=True, size=max(K*S*M*8, 1))
+        shm_noise = shared_memory.SharedMemory(create=True, size=max(K*R*M*8, 1))
+        w_aux_all = np.ndarray(shape_w_aux, dtype=np.float64, buffer=shm_w_aux.buf)
+        noise_all = np.ndarray(shape_noise, dtype=np.float64, buffer=shm_noise.buf)
+
+        # Initial fields of all replicas
+        w = np.zeros([S, M], dtype=np.float64)
+        for i in range(S):
+            w[i] = np.reshape(initial_fields[self.monomer_types[i]], M)
+        w_aux_all[:] = self.mpt_list[0].to_aux_fields(w)
+        noise_all[:] = 0.0
+
+        # Worker processes. 'spawn' is used since the parent process can have OpenMP threads.
+        context = multiprocessing.get_context("spawn")
+        workers = []
+        connections = []
+        def receive(indices):
+            results = []
+            for k in indices:
+                result = connections[k].recv()
+                if isinstance(result, Exception):
+                    raise RuntimeError("Replica %d failed: %s" % (k, str(result)))
+                results.append(result)
+            return results
+        def send_and_receive(command, indices):
+            for k in indices:
+                connections[k].send(command)
+            return receive(indices)
+
+        # labels[k]: the replica index where the configuration at chi_n_list[k] started
+        labels = list(range(K))
+        n_attempts = np.zeros(K-1, dtype=np.int64)
+        n_accepts = np.zeros(K-1, dtype=np.int64)
+        time_start = time.time()
+        is_stopped = False
+        try:
+            for k in range(K):
+                conn_parent, conn_child = context.Pipe()
+                worker = context.Process(target=run_replica, args=(self.params_list[k], self.random_seeds[k], k,
+                    (shm_w_aux.name, shm_noise.name), shape_w_aux, shape_noise, conn_child))
+                worker.start()
+                workers.append(worker)
+                connections.append(conn_parent)
+            receive(range(K))
+            send_and_receive(("load",), range(K))
+
+            with open(os.path.join(self.recording_dir, "replica_exchange.txt"), "w") as log_file:
+                log_file.write("# langevin_step, labels of configurations at each χN, acceptance ratios of neighboring pairs\n")
+                for n_exchange, start_step in enumerate(range(1, self.max_step+1, self.exchange_period)):
+                    end_step = min(start_step + self.exchange_period - 1, self.max_step)
+                    if not all(send_and_receive(("run", start_step, end_step), range(K))):
+                        print("The saddle point of one of the replicas was not found. Parallel tempering is aborted.")
+                        break
+                    if end_step == self.max_step:
+                        break
+
+                    # Attempt to exchange even or odd neighboring pairs in turn
+                    exchanged = []
+                    for i in range(n_exchange % 2, K-1, 2):
+                        j = i+1
+                        delta = self.beta*(self.mpt_list[i].compute_hamiltonian_fields(w_aux_all[j]) +
+                                           self.mpt_list[j].compute_hamiltonian_fields(w_aux_all[i]) -
+                                           self.mpt_list[i].compute_hamiltonian_fields(w_aux_all[i]) -
+                                           self.mpt_list[j].compute_hamiltonian_fields(w_aux_all[j]))
+                        n_attempts[i] += 1
+                        if delta <= 0.0 or self.random.random() < np.exp(-delta):
+                            n_accepts[i] += 1
+                            w_aux_all[[i,j]] = w_aux_all[[j,i]]
+                            noise_all[[i,j]] = noise_all[[j,i]]
+                            labels[i], labels[j] = labels[j], labels[i]
+                            exchanged += [i, j]
+                    send_and_receive(("load",), exchanged)
+
+                    acceptance_ratios = n_accepts/np.maximum(n_attempts, 1)
+                    print("Replica exchange at Langevin step %d, labels: %s, acceptance ratios: %s" % (end_step, str(labels), str(acceptance_ratios)))
+                    log_file.write("%d %s %s\n" % (end_step, " ".join(str(label) for label in labels), " ".join("%.4f" % (ratio) for ratio in acceptance_ratios)))
+                    log_file.flush()
+
+            stats = send_and_receive(("stop",), range(K))
+            is_stopped = True
+        finally:
+            if not is_stopped:
+                for conn in connections:
+                    try:
+                        conn.send(("stop",))
+                    except OSError:
+                        pass
+            for worker in workers:
+                worker.join(timeout=60)
+                if worker.is_alive():
+                    worker.terminate()
+            del w_aux_all, noise_all
+            shm_w_aux.close()
+            shm_w_aux.unlink()
+            shm_noise.close()
+            shm_noise.unlink()
+
+        time_duration = time.time() - time_start
+        for k in range(K):
+            print("Replica %d: total saddle point iterations: %d, the number of saddle point failures: %d" % (k, stats[k][0], stats[k][1]))
+        acceptance_ratios = n_accepts/np.maximum(n_attempts, 1)
+        print("Acceptance ratios of neighboring pairs: ", acceptance_ratios)
+        print("Total time (s): %f" % (time_duration))
+        return acceptance_ratios
@@ -246,6 +246,8 @@ class SCFT:
         # (C++ class) Create a factory for given platform and chain_model
         if "reduce_gpu_memory_usage" in params and platform == "cuda":
             factory = PlatformSelector.create_factory(platform, params["reduce_gpu_memory_usage"])
+        elif "reduce_memory_usage" in params:
+            factory = PlatformSelector.create_factory(platform, params["reduce_memory_usage"])
         else:
             factory = PlatformSelector.create_factory(platform, False)
         factory.display_info()
@@ -428,7 +430,13 @@ class SCFT:
                 molecules.add_polymer(polymer["volume_fraction"], polymer["blocks_input"])
 
         # (C++ class) Propagator Analyzer
-        if "aggregate_propagator_computation" in params:
+        if "aggregate_propagator_computation" in params and params["aggregate_propagator_computation"] == "auto":
+            # Choose the aggregation plan with the smallest predicted cost for the number of threads
+            n_streams = int(os.environ.get("OMP_NUM_THREADS", 4))
+            max_live_segments = int(os.environ.get("LFTS_MAX_LIVE_SEGMENTS", 0))
+            propagator_analyzer = factory.create_propagator_analyzer(molecules, n_streams, max_live_segments)
+            print("Aggregation plan: %s" % (propagator_analyzer.get_aggregation_plan()))
+        elif "aggregate_propagator_computation" in params:
             propagator_analyzer = factory.create_propagator_analyzer(molecules, params["aggregate_propagator_computation"])
         else:
             propagator_analyzer = factory.create_propagator_analyzer(molecules, True)
@@ -457,13 +465,47 @@ class SCFT:
                 params["optimizer"]["mix_min"],      # minimum mixing rate of simple mixing
                 params["optimizer"]["mix_init"])     # initial mixing rate of simple mixing
 
+        # (C++ class) Anderson Mixing using QR factorization. Ill-conditioned histories are dropped.
+        elif params["optimizer"]["name"] == "am_qr":
+            self.field_optimizer = factory.create_anderson_mixing_qr(n_var,
+                params["optimizer"]["max_hist"],     # maximum number of history
+                params["optimizer"]["start_error"],  # when switch to AM from simple mixing
+                params["optimizer"]["mix_min"],      # minimum mixing rate of simple mixing
+                params["optimizer"]["mix_init"],     # initial mixing rate of simple mixing
+                params["optimizer"].get("type", "II"),              # "I" or "II"
+                params["optimizer"].get("max_condition", 1e10))     # maximum condition number of R
+
+        # (C++ class) Jacobian-free Newton-Krylov method. Each call returns the next fields at which w_diff is evaluated.
+        elif params["optimizer"]["name"] == "jfnk":
+            self.field_optimizer = factory.create_newton_krylov(n_var,
+                params["optimizer"]["max_krylov"],   # maximum dimension of Krylov subspace
+                params["optimizer"]["start_error"],  # when switch to Newton iterations from simple mixing
+                params["optimizer"]["mix_min"],      # minimum mixing rate of simple mixing
+                params["optimizer"]["mix_init"],     # initial mixing rate of simple mixing
+                params["optimizer"].get("forcing_term", 0.1))  # maximum relative tolerance of GMRES
+
+        # (C++ class) Semi-implicit update preconditioned by RPA. If "max_hist" is given, Anderson mixing is used
+        # after error level becomes less than "start_error".
+        elif params["optimizer"]["name"] == "sis":
+            self.anderson_mixing = None
+            if params["optimizer"].get("max_hist", 0) > 0:
+                self.anderson_mixing = factory.create_anderson_mixing(n_var,
+                    params["optimizer"]["max_hist"],     # maximum number of history
+                    params["optimizer"]["start_error"],  # when switch to AM from semi-implicit update
+                    params["optimizer"]["mix_min"],      # minimum mixing rate of simple mixing
+                    params["optimizer"]["mix_init"])     # initial mixing rate of simple mixing
+            self.field_optimizer = factory.create_semi_implicit_mixing(cb, molecules,
+                self.monomer_types, self.matrix_chi.tolist(), self.matrix_p.tolist(), n_var,
+                params["optimizer"].get("lambda", 1.0),  # maximum step size of semi-implicit update
+                self.anderson_mixing)
+
         # (Python class) ADAM optimizer for finding saddle point
         elif params["optimizer"]["name"] == "adam":
             self.field_optimizer = Adam(M = n_var,
                 lr = params["optimizer"]["lr"],
                 gamma = params["optimizer"]["gamma"])
         else:
-            print("Invalid optimizer name: ", params["optimizer"], '. Choose among "am" and "adam".')
+            print("Invalid optimizer name: ", params["optimizer"], '. Choose among "am", "am_qr", "jfnk", "sis" and "adam".')
 
        # The maximum iteration steps
         if "max_iter" in params :
@@ -516,6 +558,16 @@ class SCFT:
         self.max_iter = max_iter
         self.tolerance = tolerance
 
+        # (C++ class) SCFT iterations are run in C++ if "driver" is "cpp". ADAM is only available in the Python loop.
+        self.scft_solver = None
+        if params.get("driver", "python") == "cpp":
+            if params["optimizer"]["name"] == "adam":
+                raise ValueError('The "cpp" driver does not support the "adam" optimizer.')
+            self.scft_solver = ScftSolver(cb, molecules, solver, self.field_optimizer,
+                self.monomer_types, self.matrix_chi.tolist(), self.matrix_p.tolist(),
+                params["box_is_altering"], max_iter, tolerance, self.scale_stress,
+                random_fractions=self.random_fraction)
+
         self.cb = cb
         self.molecules = molecules
         self.propagator_analyzer = propagator_analyzer
@@ -642,108 +694,120 @@ class SCFT:
         # Keep the level of field value
         for i in range(S):
             w[i] -= self.cb.integral(w[i])/self.cb.get_volume()
-            
-        # Iteration begins here
-        for scft_iter in range(1, self.max_iter+1):
-
-            # Compute total concentration for each monomer type
-            phi, _ = self.compute_concentrations(w)
-
-            # # Scaling phi
-            # for monomer_type in self.monomer_types:
-            #     phi[monomer_type] *= self.phi_rescaling
 
-            # Convert monomer fields to auxiliary fields
-            w_aux = self.mpt.to_aux_fields(w)
-
-            # Calculate the total energy
-            # energy_total = - self.cb.integral(self.phi_target*w_exchange[S-1])/self.cb.get_volume()
-            total_partitions = [self.solver.get_total_partition(p) for p in range(self.molecules.get_n_polymer_types())]
-            energy_total = self.mpt.compute_hamiltonian(self.molecules, w_aux, total_partitions)
-
-            # Calculate difference between current total density and target density
-            phi_total = np.zeros(self.cb.get_n_grid())
+        # Run all iterations in C++
+        if self.scft_solver is not None and q_init is None:
+            self.scft_solver.set_fields(w)
+            self.scft_solver.run()
+            w = self.scft_solver.get_fields()
+            phi_array = self.scft_solver.get_concentrations()
+            phi = {}
             for i in range(S):
-                phi_total += phi[self.monomer_types[i]]
-            # phi_diff = phi_total-self.phi_target
-            phi_diff = phi_total-1.0
+                phi[self.monomer_types[i]] = phi_array[i]
+            energy_total = self.scft_solver.get_free_energy()
 
-            # Calculate self-consistency error
-            w_diff = np.zeros([S, self.cb.get_n_grid()], dtype=np.float64) # array for output fields
-            for i in range(S):
-                for j in range(S):
-                    w_diff[i,:] += self.matrix_chi[i,j]*phi[self.monomer_types[j]] - self.matrix_p[i,j]*w[j,:]
-                # w_diff[i,:] -= self.phi_target_pressure
-
-            # Keep the level of functional derivatives
-            for i in range(S):
-                # w_diff[i] *= self.mask
-                w_diff[i] -= self.cb.integral(w_diff[i])/self.cb.get_volume()
-
-            # error_level measures the "relative distance" between the input and output fields
-            old_error_level = error_level
-            error_level = 0.0
-            error_normal = 1.0  # add 1.0 to prevent divergence
-            for i in range(S):
-                error_level += self.cb.inner_product(w_diff[i],w_diff[i])
-                error_normal += self.cb.inner_product(w[i],w[i])
-            error_level = np.sqrt(error_level/error_normal)
-
-            # Print iteration # and error levels and check the mass conservation
-            mass_error = self.cb.integral(phi_diff)/self.cb.get_volume()
+        else:
+            # Iteration begins here
+            for scft_iter in range(1, self.max_iter+1):
+
+                # Compute total concentration for each monomer type
+                phi, _ = self.compute_concentrations(w)
+
+                # # Scaling phi
+                # for monomer_type in self.monomer_types:
+                #     phi[monomer_type] *= self.phi_rescaling
+
+                # Convert monomer fields to auxiliary fields
+                w_aux = self.mpt.to_aux_fields(w)
+
+                # Calculate the total energy
+                # energy_total = - self.cb.integral(self.phi_target*w_exchange[S-1])/self.cb.get_volume()
+                total_partitions = [self.solver.get_total_partition(p) for p in range(self.molecules.get_n_polymer_types())]
+                energy_total = self.mpt.compute_hamiltonian(self.molecules, w_aux, total_partitions)
+
+                # Calculate difference between current total density and target density
+                phi_total = np.zeros(self.cb.get_n_grid())
+                for i in range(S):
+                    phi_total += phi[self.monomer_types[i]]
+                # phi_diff = phi_total-self.phi_target
+                phi_diff = phi_total-1.0
+
+                # Calculate self-consistency error
+                w_diff = np.zeros([S, self.cb.get_n_grid()], dtype=np.float64) # array for output fields
+                for i in range(S):
+                    for j in range(S):
+                        w_diff[i,:] += self.matrix_chi[i,j]*phi[self.monomer_types[j]] - self.matrix_p[i,j]*w[j,:]
+                    # w_diff[i,:] -= self.phi_target_pressure
+
+                # Keep the level of functional derivatives
+                for i in range(S):
+                    # w_diff[i] *= self.mask
+                    w_diff[i] -= self.cb.integral(w_diff[i])/self.cb.get_volume()
+
+                # error_level measures the "relative distance" between the input and output fields
+                old_error_level = error_level
+                error_level = 0.0
+                error_normal = 1.0  # add 1.0 to prevent divergence
+                for i in range(S):
+                    error_level += self.cb.inner_product(w_diff[i],w_diff[i])
+                    error_normal += self.cb.inner_product(w[i],w[i])
+                error_level = np.sqrt(error_level/error_normal)
+
+                # Print iteration # and error levels and check the mass conservation
+                mass_error = self.cb.integral(phi_diff)/self.cb.get_volume()
             
-            if (self.box_is_altering):
-                # Calculate stress
-                self.solver.compute_stress()
-                stress_array = np.array(self.solver.get_stress())
-                error_level += np.sqrt(np.sum(stress_array**2))
-
-                print("%8d %12.3E " %
-                (scft_iter, mass_error), end=" [ ")
-                for p in range(self.molecules.get_n_polymer_types()):
-                    print("%13.7E " % (self.solver.get_total_partition(p)), end=" ")
-                print("] %15.9f %15.7E " % (energy_total, error_level), end=" ")
-                print("[", ",".join(["%10.7f" % (x) for x in self.cb.get_lx()]), "]")
-            else:
-                print("%8d %12.3E " % (scft_iter, mass_error), end=" [ ")
-                for p in range(self.molecules.get_n_polymer_types()):
-                    print("%13.7E " % (self.solver.get_total_partition(p)), end=" ")
-                print("] %15.9f %15.7E " % (energy_total, error_level))
-
-            # Conditions to end the iteration
-            if error_level < self.tolerance:
-                break
-
-            # Calculate new fields using simple and Anderson mixing
-            if (self.box_is_altering):
-                dlx = -stress_array
-                am_current  = np.concatenate((np.reshape(w,      S*self.cb.get_n_grid()), self.cb.get_lx()))
-                am_diff     = np.concatenate((np.reshape(w_diff, S*self.cb.get_n_grid()), self.scale_stress*dlx))
-                am_new = self.field_optimizer.calculate_new_fields(am_current, am_diff, old_error_level, error_level)
-
-                # Copy fields
-                w = np.reshape(am_new[0:S*self.cb.get_n_grid()], (S, self.cb.get_n_grid()))
-
-                # Set box size
-                # Restricting |dLx| to be less than 10 % of Lx
-                old_lx = np.array(self.cb.get_lx())
-                new_lx = np.array(am_new[-self.cb.get_dim():])
-                new_dlx = np.clip((new_lx-old_lx)/old_lx, -0.1, 0.1)
-                new_lx = (1 + new_dlx)*old_lx
-                self.cb.set_lx(new_lx)
-
-                # Update bond parameters using new lx
-                self.solver.update_laplacian_operator()
-            else:
-                w = self.field_optimizer.calculate_new_fields(
-                np.reshape(w,      S*self.cb.get_n_grid()),
-                np.reshape(w_diff, S*self.cb.get_n_grid()), old_error_level, error_level)
-                w = np.reshape(w, (S, self.cb.get_n_grid()))
+                if (self.box_is_altering):
+                    # Calculate stress
+                    self.solver.compute_stress()
+                    stress_array = np.array(self.solver.get_stress())
+                    error_level += np.sqrt(np.sum(stress_array**2))
+
+                    print("%8d %12.3E " %
+                    (scft_iter, mass_error), end=" [ ")
+                    for p in range(self.molecules.get_n_polymer_types()):
+                        print("%13.7E " % (self.solver.get_total_partition(p)), end=" ")
+                    print("] %15.9f %15.7E " % (energy_total, error_level), end=" ")
+                    print("[", ",".join(["%10.7f" % (x) for x in self.cb.get_lx()]), "]")
+                else:
+                    print("%8d %12.3E " % (scft_iter, mass_error), end=" [ ")
+                    for p in range(self.molecules.get_n_polymer_types()):
+                        print("%13.7E " % (self.solver.get_total_partition(p)), end=" ")
+                    print("] %15.9f %15.7E " % (energy_total, error_level))
+
+                # Conditions to end the iteration
+                if error_level < self.tolerance:
+                    break
+
+                # Calculate new fields using simple and Anderson mixing
+                if (self.box_is_altering):
+                    dlx = -stress_array
+                    am_current  = np.concatenate((np.reshape(w,      S*self.cb.get_n_grid()), self.cb.get_lx()))
+                    am_diff     = np.concatenate((np.reshape(w_diff, S*self.cb.get_n_grid()), self.scale_stress*dlx))
+                    am_new = self.field_optimizer.calculate_new_fields(am_current, am_diff, old_error_level, error_level)
+
+                    # Copy fields
+                    w = np.reshape(am_new[0:S*self.cb.get_n_grid()], (S, self.cb.get_n_grid()))
+
+                    # Set box size
+                    # Restricting |dLx| to be less than 10 % of Lx
+                    old_lx = np.array(self.cb.get_lx())
+                    new_lx = np.array(am_new[-self.cb.get_dim():])
+                    new_dlx = np.clip((new_lx-old_lx)/old_lx, -0.1, 0.1)
+                    new_lx = (1 + new_dlx)*old_lx
+                    self.cb.set_lx(new_lx)
+
+                    # Update bond parameters using new lx
+                    self.solver.update_laplacian_operator()
+                else:
+                    w = self.field_optimizer.calculate_new_fields(
+                    np.reshape(w,      S*self.cb.get_n_grid()),
+                    np.reshape(w_diff, S*self.cb.get_n_grid()), old_error_level, error_level)
+                    w = np.reshape(w, (S, self.cb.get_n_grid()))
                         
-            # Keep the level of field value
-            for i in range(S):
-                # w[i] *= self.mask
-                w[i] -= self.cb.integral(w[i])/self.cb.get_volume()
+                # Keep the level of field value
+                for i in range(S):
+                    # w[i] *= self.mask
+                    w[i] -= self.cb.integral(w[i])/self.cb.get_volume()
         
         # Print free energy as per chain expression
         print("Free energy per chain (for each chain type):")
@@ -13,7 +13,12 @@
 #include "Molecules.h"
 #include "PropagatorAnalyzer.h"
 #include "PropagatorComputation.h"
+#include "PropagatorComputationBatch.h"
 #include "AndersonMixing.h" 
+#include "NewtonKrylov.h"
+#include "SemiImplicitMixing.h"
+#include "LinearResponseCompressor.h"
+#include "LangevinFts.h"
 #include "Array.h" 
 
 // Design Pattern : Abstract Factory
@@ -42,10 +47,17 @@ public :
     virtual Molecules* create_molecules_information(
         std::string chain_model, double ds, std::map<std::string, double> bond_lengths) = 0;
 
-    PropagatorAnalyzer* create_propagator_analyzer(Molecules* molecules, bool aggregate_propagator_computation)
+    PropagatorAnalyzer* create_propagator_analyzer(Molecules* molecules, bool aggregate_propagator_computation, bool is_sorted_merge=false)
     {
-        return new PropagatorAnalyzer(molecules, aggregate_propagator_computation);
+        return new PropagatorAnalyzer(molecules, aggregate_propagator_computation, is_sorted_merge);
     };
+    // Choose the aggregation plan by the cost model (see PropagatorAnalyzer)
+    PropagatorAnalyzer* create_propagator_analyzer(Molecules* molecules, int n_streams, int max_live_segments)
+    {
+        return new PropagatorAnalyzer(molecules, n_streams, max_live_segments, is_memory_aware_scheduling());
+    };
+    // Whether solvers of this platform use the memory-aware 'Scheduler'
+    virtual bool is_memory_aware_scheduling() = 0;
 
     virtual PropagatorComputation* create_pseudospectral_solver(
         ComputationBox *cb, Molecules *molecules, PropagatorAnalyzer* propagator_analyzer) = 0; 
@@ -53,9 +65,69 @@ public :
     virtual PropagatorComputation* create_realspace_solver(
         ComputationBox *cb, Molecules *molecules, PropagatorAnalyzer* propagator_analyzer) = 0; 
 
+    // Pseudo-spectral solver of n_replicas replicas that share operators and FFT plans (see PropagatorComputationBatch).
+    // Replicas are advanced in n_replica_groups groups in parallel. If it is 0, it is chosen from the number of threads.
+    virtual PropagatorComputationBatch* create_pseudospectral_solver_batch(
+        ComputationBox *cb, Molecules *molecules, PropagatorAnalyzer* propagator_analyzer, int n_replicas, int n_replica_groups=0) = 0;
+
+    // history_precision: "double" or "single", the precision of stored histories
     virtual AndersonMixing* create_anderson_mixing(
         int n_var, int max_hist, double start_error,
-        double mix_min, double mix_init) = 0;
+        double mix_min, double mix_init,
+        std::string history_precision="double") = 0;
+
+    // Anderson mixing using incrementally updated QR factorization (see CpuAndersonMixingQR)
+    // type: "II" or "I", max_condition: the maximum condition number of the least squares problem
+    virtual AndersonMixing* create_anderson_mixing_qr(
+        int n_var, int max_hist, double start_error,
+        double mix_min, double mix_init,
+        std::string type, double max_condition) = 0;
+
+    // Jacobian-free Newton-Krylov method (see NewtonKrylov)
+    // max_krylov: the maximum dimension of Krylov subspace, forcing_term: relative tolerance of GMRES
+    virtual NewtonKrylov* create_newton_krylov(
+        int n_var, int max_krylov, double start_error,
+        double mix_min, double mix_init, double forcing_term) = 0;
+
+    // Semi-implicit field update preconditioned by RPA (see SemiImplicitMixing)
+    // lambda: step size, anderson_mixing: Anderson mixing that uses the preconditioned residual, or nullptr
+    virtual SemiImplicitMixing* create_semi_implicit_mixing(
+        ComputationBox *cb, Molecules *molecules,
+        std::vector<std::string> monomer_types,
+        std::vector<std::vector<double>> matrix_chi,
+        std::vector<std::vector<double>> matrix_p,
+        int n_var, double lambda, AndersonMixing *anderson_mixing=nullptr) = 0;
+
+    // Linear-response compressor of the imaginary fields in L-FTS (see LinearResponseCompressor)
+    // matrix_a: S x I, vector_d: I, anderson_mixing: Anderson mixing that uses the preconditioned residual, or nullptr
+    virtual LinearResponseCompressor* create_linear_response_compressor(
+        ComputationBox *cb, Molecules *molecules,
+        std::vector<std::string> monomer_types,
+        std::vector<std::vector<double>> matrix_a,
+        std::vector<double> vector_d,
+        AndersonMixing *anderson_mixing=nullptr,
+        std::map<std::string, std::map<std::string, double>> random_fractions={}) = 0;
+
+    // Langevin FTS engine that runs Langevin steps in C++ (see LangevinFts)
+    // compressor: Anderson mixing or linear-response compressor for the imaginary fields, random_seed: negative for a random seed
+    virtual LangevinFts* create_langevin_fts(
+        ComputationBox *cb, Molecules *molecules, PropagatorComputation *solver,
+        AndersonMixing *compressor,
+        std::vector<std::string> monomer_types,
+        std::vector<std::vector<double>> matrix_a,
+        std::vector<std::vector<double>> matrix_a_inv,
+        std::vector<double> eigenvalues,
+        std::vector<int> aux_fields_real_idx,
+        std::vector<int> aux_fields_imag_idx,
+        double h_const,
+        std::vector<double> h_coef_mu1,
+        std::vector<double> h_coef_mu2,
+        std::vector<double> dt_scaling,
+        double langevin_dt, double langevin_sigma,
+        int saddle_max_iter, double saddle_tolerance,
+        int sf_computing_period, int verbose_level=1,
+        std::map<std::string, std::map<std::string, double>> random_fractions={},
+        long random_seed=-1) = 0;
 
     std::string get_model_name() {return chain_model;};
     virtual void display_info() = 0;
@@ -1,3 +1,6 @@
+#include <cmath>
+#include <algorithm>
+
 #include "AndersonMixing.h"
 
 AndersonMixing::AndersonMixing(int n_var, int max_hist,
@@ -16,13 +19,32 @@ AndersonMixing::AndersonMixing(int n_var, int max_hist,
     this->mix_init = mix_init;
 }
 
+void AndersonMixing::display_info()
+{
+    std::cout << "--------------- Anderson Mixing ---------------" << std::endl;
+    std::cout << "The number of variables: " << n_var << std::endl;
+    std::cout << "The maximum number of histories: " << max_hist << std::endl;
+    std::cout << "Memory usage for histories (MB): " << get_memory_usage()/(1024.0*1024.0) << std::endl;
+}
 void AndersonMixing::find_an(double **u, double *v, double *a, int n)
 {
     int i,j,k;
     double factor, temp_sum;
-    // Elimination process
+    // Elimination process with partial pivoting
     for(i=0; i<n; i++)
     {
+        // Swap rows so that the pivot has the largest magnitude
+        int i_max = i;
+        for(j=i+1; j<n; j++)
+        {
+            if (std::abs(u[j][i]) > std::abs(u[i_max][i]))
+                i_max = j;
+        }
+        if (i_max != i)
+        {
+            std::swap(u[i], u[i_max]);
+            std::swap(v[i], v[i_max]);
+        }
         for(j=i+1; j<n; j++)
         {
             factor = u[j][i]/u[i][i];
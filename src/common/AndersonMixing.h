@@ -7,6 +7,7 @@
 
 #include <cassert>
 #include <iostream>
+#include <cstddef>
 
 #include "Exception.h"
 
@@ -23,6 +24,11 @@ public:
 
     virtual void reset_count(){};
     int get_n_var(){ return n_var;};
+    double get_start_error(){ return start_error;};
+    // Memory usage for histories in bytes
+    virtual std::size_t get_memory_usage()=0;
+    // Display the number of variables, the number of histories and memory usage
+    void display_info();
     virtual void calculate_new_fields(
         double *w_new, double *w_current, double *w_deriv,
         double old_error_level, double error_level)=0;
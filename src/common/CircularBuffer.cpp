@@ -1,54 +1,73 @@
 #include <algorithm>
+#include <memory>
 #include "CircularBuffer.h"
 
-CircularBuffer::CircularBuffer(int length, int width)
+template <typename T>
+CircularBufferT<T>::CircularBufferT(int length, int width)
 {
     this->length = length;
     this->width = width;
     this->start = 0;
     this->n_items = 0;
 
-    elems = new double*[length];
-    for(int i=0; i<length; i++)
-    {
-        elems[i] = new double[width];
-        for(int j=0; j<width; j++)
-            elems[i][j] = 0.0;
-    }
+    // Pad each element, so that all elements are aligned
+    const std::size_t n_align = ALIGNMENT/sizeof(T);
+    stride = (width+n_align-1)/n_align*n_align;
+
+    std::size_t n_allocated = length*stride + n_align;
+    data_allocated = new T[n_allocated];
+    void* ptr = data_allocated;
+    std::size_t space = n_allocated*sizeof(T);
+    data = static_cast<T*>(std::align(ALIGNMENT, length*stride*sizeof(T), ptr, space));
+    for(std::size_t i=0; i<length*stride; i++)
+        data[i] = 0.0;
 }
-CircularBuffer::~CircularBuffer()
+template <typename T>
+CircularBufferT<T>::~CircularBufferT()
 {
-    for(int i=0; i<length; i++)
-        delete[] elems[i];
-    delete[] elems;
+    delete[] data_allocated;
 }
-void CircularBuffer::reset()
+template <typename T>
+void CircularBufferT<T>::reset()
 {
     start = 0;
     n_items = 0;
 }
-void CircularBuffer::insert(double* new_arr)
+template <typename T>
+void CircularBufferT<T>::insert(const double* new_arr)
 {
-    int i = (start+n_items)%length;
+    T* elem = &data[((start+n_items)%length)*stride];
     for(int m=0; m<width; m++){
-        elems[i][m] = new_arr[m];
+        elem[m] = new_arr[m];
     }
     if (n_items == length)
         start = (start+1)%length;
     n_items = std::min(n_items+1, length);
 }
-double* CircularBuffer::get_array(int n)
+template <typename T>
+T* CircularBufferT<T>::get_array(int n)
 {
     int i = (start+n_items-n-1+length)%length;
-    return elems[i];
+    return &data[i*stride];
 }
-double* CircularBuffer::operator[] (int n)
+template <typename T>
+T* CircularBufferT<T>::operator[] (int n)
 {
     int i = (start+n_items-n-1+length)%length;
-    return elems[i];
+    return &data[i*stride];
 }
-double CircularBuffer::get(int n, int m)
+template <typename T>
+T CircularBufferT<T>::get(int n, int m)
 {
     int i = (start+n_items-n-1+length)%length;
-    return elems[i][m];
+    return data[i*stride+m];
 }
+template <typename T>
+std::size_t CircularBufferT<T>::get_memory_usage()
+{
+    return length*stride*sizeof(T);
+}
+
+// Explicit template instantiation
+template class CircularBufferT<double>;
+template class CircularBufferT<float>;
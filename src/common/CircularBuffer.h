@@ -2,27 +2,42 @@
 ! A circular buffer is a data structure that uses a single,
 ! fixed-size buffer as if it were connected end-to-end.
 ! Each elements are 1-dimensional real array.
+! All elements are stored in one contiguous block of memory. Each element
+! starts at a 64-byte aligned address, so that it can be vectorized.
+! The type of elements can be 'float' to reduce memory usage.
 !-----------------------------------------------------------------*/
 
 #ifndef CIRCULAR_BUFFER_H_
 #define CIRCULAR_BUFFER_H_
 
-class CircularBuffer
+#include <cstddef>
+
+template <typename T>
+class CircularBufferT
 {
 private:
     int length; // maximum number of elements
     int width;  // size of each elements
     int start;  // index of oldest elements
     int n_items;   // index at which to write new element
-    double** elems;
+    std::size_t stride; // distance between elements, width padded to a multiple of the alignment
+    T* data;    // aligned pointer to the memory block
+    T* data_allocated;
 
 public:
-    CircularBuffer(int length, int width);
-    ~CircularBuffer();
+    // Alignment of each element in bytes
+    static const std::size_t ALIGNMENT = 64;
+
+    CircularBufferT(int length, int width);
+    ~CircularBufferT();
     void reset();
-    void insert(double* new_arr);
-    double* get_array(int n);
-    double* operator[] (int n);
-    double get(int n, int m);
+    void insert(const double* new_arr);
+    T* get_array(int n);
+    T* operator[] (int n);
+    T get(int n, int m);
+    // Memory usage in bytes
+    std::size_t get_memory_usage();
 };
+
+typedef CircularBufferT<double> CircularBuffer;
 #endif
@@ -0,0 +1,95 @@
+#include <sstream>
+#include <iomanip>
+#include <unistd.h>
+
+#include "ComputationCache.h"
+
+std::uint64_t ComputationCache::get_hash(const std::string& str)
+{
+    std::uint64_t hash = 14695981039346656037ULL;
+    for(unsigned char c: str)
+    {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+bool ComputationCache::is_enabled()
+{
+    const char *ENV_CACHE_DIR = getenv("LFTS_CACHE_DIR");
+    return ENV_CACHE_DIR != nullptr && ENV_CACHE_DIR[0] != '\0';
+}
+std::string ComputationCache::get_file_name(const std::string& prefix, const std::string& signature)
+{
+    const char *ENV_CACHE_DIR = getenv("LFTS_CACHE_DIR");
+    std::string env_cache_dir(ENV_CACHE_DIR ? ENV_CACHE_DIR : "");
+    if (env_cache_dir.empty())
+        return "";
+
+    std::stringstream ss;
+    ss << env_cache_dir << "/" << prefix << "_" << std::hex << std::setw(16) << std::setfill('0') << get_hash(signature) << ".bin";
+    return ss.str();
+}
+std::string ComputationCache::get_temporary_file_name(const std::string& file_name)
+{
+    return file_name + ".tmp" + std::to_string(getpid());
+}
+bool ComputationCache::open(std::ifstream& in, const std::string& file_name, const std::string& signature)
+{
+    in.open(file_name, std::ios::binary);
+    if (!in.is_open())
+        return false;
+
+    // Files of other versions, or hash collisions are ignored
+    int version = 0;
+    std::string file_signature;
+    read(in, version);
+    if (!in || version != VERSION)
+        return false;
+    read(in, file_signature);
+    return in && file_signature == signature;
+}
+void ComputationCache::write(std::ostream& out, const int& value)
+{
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+void ComputationCache::write(std::ostream& out, const double& value)
+{
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+void ComputationCache::write(std::ostream& out, const bool& value)
+{
+    char c = value ? 1 : 0;
+    out.write(&c, 1);
+}
+void ComputationCache::write(std::ostream& out, const std::string& value)
+{
+    write(out, static_cast<int>(value.size()));
+    out.write(value.data(), value.size());
+}
+void ComputationCache::read(std::istream& in, int& value)
+{
+    in.read(reinterpret_cast<char*>(&value), sizeof(value));
+}
+void ComputationCache::read(std::istream& in, double& value)
+{
+    in.read(reinterpret_cast<char*>(&value), sizeof(value));
+}
+void ComputationCache::read(std::istream& in, bool& value)
+{
+    char c = 0;
+    in.read(&c, 1);
+    value = (c != 0);
+}
+void ComputationCache::read(std::istream& in, std::string& value)
+{
+    int size = 0;
+    read(in, size);
+    if (!in || size < 0)
+    {
+        in.setstate(std::ios::failbit);
+        return;
+    }
+    value.resize(size);
+    in.read(&value[0], size);
+}
@@ -0,0 +1,169 @@
+/*----------------------------------------------------------
+* This class stores results of propagator analysis and scheduling in binary files,
+* so that later runs with the same molecules and options load them instead of recomputing.
+* The cache is enabled if the environment variable LFTS_CACHE_DIR is set.
+*-----------------------------------------------------------*/
+
+#ifndef COMPUTATION_CACHE_H_
+#define COMPUTATION_CACHE_H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <tuple>
+#include <utility>
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstdint>
+
+#include "Exception.h"
+
+class ComputationCache
+{
+private:
+    // Temporary file name that is unique for each process
+    static std::string get_temporary_file_name(const std::string& file_name);
+
+    template <typename Tuple, std::size_t... I>
+    static void write_tuple(std::ostream& out, const Tuple& value, std::index_sequence<I...>)
+    {
+        int unused[] = {0, (write(out, std::get<I>(value)), 0)...};
+        (void) unused;
+    };
+    template <typename Tuple, std::size_t... I>
+    static void read_tuple(std::istream& in, Tuple& value, std::index_sequence<I...>)
+    {
+        int unused[] = {0, (read(in, std::get<I>(value)), 0)...};
+        (void) unused;
+    };
+public:
+    // Increase this if the format of cache files is changed
+    static const int VERSION = 3;
+
+    // 64-bit FNV-1a hash
+    static std::uint64_t get_hash(const std::string& str);
+
+    // Whether LFTS_CACHE_DIR is set
+    static bool is_enabled();
+
+    // Path of the cache file for the signature, e.g., "LFTS_CACHE_DIR/analyzer_<hash>.bin".
+    // It returns an empty string if the cache is disabled.
+    static std::string get_file_name(const std::string& prefix, const std::string& signature);
+
+    // Open a cache file and check its version and signature. It returns false if the file is not valid.
+    static bool open(std::ifstream& in, const std::string& file_name, const std::string& signature);
+
+    // Write a cache file. 'writer' is invoked with a stream after the header is written.
+    // The file is written to a temporary file first and renamed, so that concurrent runs do not read a partial file.
+    template <typename Writer>
+    static void save(const std::string& file_name, const std::string& signature, Writer writer);
+
+    // Serialization of primitive types and standard containers
+    static void write(std::ostream& out, const int& value);
+    static void write(std::ostream& out, const double& value);
+    static void write(std::ostream& out, const bool& value);
+    static void write(std::ostream& out, const std::string& value);
+    static void read(std::istream& in, int& value);
+    static void read(std::istream& in, double& value);
+    static void read(std::istream& in, bool& value);
+    static void read(std::istream& in, std::string& value);
+
+    template <typename T>
+    static void write(std::ostream& out, const std::vector<T>& value)
+    {
+        write(out, static_cast<int>(value.size()));
+        for(const auto& item: value)
+            write(out, item);
+    };
+    template <typename T>
+    static void read(std::istream& in, std::vector<T>& value)
+    {
+        int size;
+        read(in, size);
+        if (!in || size < 0)
+            return;
+        value.resize(size);
+        for(auto& item: value)
+            read(in, item);
+    };
+    template <typename T, typename C>
+    static void write(std::ostream& out, const std::set<T, C>& value)
+    {
+        write(out, static_cast<int>(value.size()));
+        for(const auto& item: value)
+            write(out, item);
+    };
+    template <typename T, typename C>
+    static void read(std::istream& in, std::set<T, C>& value)
+    {
+        int size;
+        read(in, size);
+        value.clear();
+        for(int i=0; i<size && in; i++)
+        {
+            T item;
+            read(in, item);
+            value.insert(item);
+        }
+    };
+    template <typename K, typename V, typename C>
+    static void write(std::ostream& out, const std::map<K, V, C>& value)
+    {
+        write(out, static_cast<int>(value.size()));
+        for(const auto& item: value)
+        {
+            write(out, item.first);
+            write(out, item.second);
+        }
+    };
+    template <typename K, typename V, typename C>
+    static void read(std::istream& in, std::map<K, V, C>& value)
+    {
+        int size;
+        read(in, size);
+        value.clear();
+        for(int i=0; i<size && in; i++)
+        {
+            K key;
+            read(in, key);
+            read(in, value[key]);
+        }
+    };
+    template <typename... T>
+    static void write(std::ostream& out, const std::tuple<T...>& value)
+    {
+        write_tuple(out, value, std::index_sequence_for<T...>{});
+    };
+    template <typename... T>
+    static void read(std::istream& in, std::tuple<T...>& value)
+    {
+        read_tuple(in, value, std::index_sequence_for<T...>{});
+    };
+};
+
+template <typename Writer>
+void ComputationCache::save(const std::string& file_name, const std::string& signature, Writer writer)
+{
+    // The cache is only for speed-up. If it could not be written, just print a warning.
+    std::ofstream out;
+    std::string temporary_file_name = get_temporary_file_name(file_name);
+    out.open(temporary_file_name, std::ios::binary);
+    if (!out.is_open())
+    {
+        std::cout << "Warning: could not write the cache file '" << file_name << "'." << std::endl;
+        return;
+    }
+    int version = VERSION;
+    write(out, version);
+    write(out, signature);
+    writer(out);
+    out.close();
+    if (!out || std::rename(temporary_file_name.c_str(), file_name.c_str()) != 0)
+    {
+        std::remove(temporary_file_name.c_str());
+        std::cout << "Warning: could not write the cache file '" << file_name << "'." << std::endl;
+    }
+}
+#endif
@@ -0,0 +1,583 @@
+#include <iostream>
+#include <cstdio>
+#include <cmath>
+#include <sstream>
+#include <algorithm>
+
+#include "Exception.h"
+#include "LangevinFts.h"
+#include "LinearResponseCompressor.h"
+#include "Pseudo.h"
+
+LangevinFts::LangevinFts(ComputationBox *cb, Molecules *molecules, PropagatorComputation *solver,
+    AndersonMixing *compressor,
+    std::vector<std::string> monomer_types,
+    std::vector<std::vector<double>> matrix_a,
+    std::vector<std::vector<double>> matrix_a_inv,
+    std::vector<double> eigenvalues,
+    std::vector<int> aux_fields_real_idx,
+    std::vector<int> aux_fields_imag_idx,
+    double h_const,
+    std::vector<double> h_coef_mu1,
+    std::vector<double> h_coef_mu2,
+    std::vector<double> dt_scaling,
+    double langevin_dt, double langevin_sigma,
+    int saddle_max_iter, double saddle_tolerance,
+    int sf_computing_period, int verbose_level,
+    std::map<std::string, std::map<std::string, double>> random_fractions,
+    long random_seed)
+{
+    try
+    {
+        const int S = monomer_types.size();
+        const int M = cb->get_n_grid();
+        const int R = aux_fields_real_idx.size();
+        const int I = aux_fields_imag_idx.size();
+
+        if (matrix_a.size() != static_cast<size_t>(S) || matrix_a_inv.size() != static_cast<size_t>(S))
+            throw_with_line_number("The sizes of matrix_a and matrix_a_inv must be the number of monomer types (" + std::to_string(S) + ").");
+        for(int i=0; i<S; i++)
+        {
+            if (matrix_a[i].size() != static_cast<size_t>(S) || matrix_a_inv[i].size() != static_cast<size_t>(S))
+                throw_with_line_number("The sizes of matrix_a and matrix_a_inv must be the number of monomer types (" + std::to_string(S) + ").");
+        }
+        if (eigenvalues.size() != static_cast<size_t>(S) || dt_scaling.size() != static_cast<size_t>(S))
+            throw_with_line_number("The sizes of eigenvalues and dt_scaling must be the number of monomer types (" + std::to_string(S) + ").");
+        if (h_coef_mu1.size() != static_cast<size_t>(S-1) || h_coef_mu2.size() != static_cast<size_t>(S-1))
+            throw_with_line_number("The sizes of h_coef_mu1 and h_coef_mu2 must be the number of monomer types minus one (" + std::to_string(S-1) + ").");
+        if (I == 0 || aux_fields_imag_idx.back() != S-1)
+            throw_with_line_number("The last index of aux_fields_imag_idx must be the pressure field (" + std::to_string(S-1) + ").");
+        for(int idx : aux_fields_real_idx)
+        {
+            if (idx < 0 || idx >= S-1 || std::find(aux_fields_imag_idx.begin(), aux_fields_imag_idx.end(), idx) != aux_fields_imag_idx.end())
+                throw_with_line_number("Invalid index of real auxiliary field (" + std::to_string(idx) + ").");
+        }
+        for(int idx : aux_fields_imag_idx)
+        {
+            if (idx < 0 || idx >= S)
+                throw_with_line_number("Invalid index of imaginary auxiliary field (" + std::to_string(idx) + ").");
+        }
+        for(const auto& item : random_fractions)
+        {
+            for(const auto& fraction : item.second)
+            {
+                if (std::find(monomer_types.begin(), monomer_types.end(), fraction.first) == monomer_types.end())
+                    throw_with_line_number("Monomer type '" + fraction.first + "' of random copolymer '" + item.first + "' is not in the list of monomer types.");
+            }
+        }
+        if (compressor->get_n_var() != I*M)
+            throw_with_line_number("The number of variables of the compressor (" + std::to_string(compressor->get_n_var()) + ") must be " + std::to_string(I*M) + ".");
+        if (sf_computing_period <= 0)
+            throw_with_line_number("sf_computing_period (" + std::to_string(sf_computing_period) + ") must be a positive integer.");
+
+        this->cb = cb;
+        this->molecules = molecules;
+        this->solver = solver;
+        this->compressor = compressor;
+        this->monomer_types = monomer_types;
+        this->random_fractions = random_fractions;
+        this->matrix_a = matrix_a;
+        this->matrix_a_inv = matrix_a_inv;
+        this->eigenvalues = eigenvalues;
+        this->aux_fields_real_idx = aux_fields_real_idx;
+        this->aux_fields_imag_idx = aux_fields_imag_idx;
+        this->h_const = h_const;
+        this->h_coef_mu1 = h_coef_mu1;
+        this->h_coef_mu2 = h_coef_mu2;
+        this->dt_scaling = dt_scaling;
+        this->langevin_dt = langevin_dt;
+        this->langevin_sigma = langevin_sigma;
+        this->saddle_max_iter = saddle_max_iter;
+        this->saddle_tolerance = saddle_tolerance;
+        this->sf_computing_period = sf_computing_period;
+        this->verbose_level = verbose_level;
+
+        // The linear-response compressor computes the Newton step, so the residual is not scaled
+        is_residual_scaled = (dynamic_cast<LinearResponseCompressor*>(compressor) == nullptr);
+
+        if (random_seed < 0)
+            random_generator.seed(std::random_device{}());
+        else
+            random_generator.seed(random_seed);
+        normal_distribution = std::normal_distribution<double>(0.0, langevin_sigma);
+
+        w_aux.resize(S*M, 0.0);
+        w_aux_next.resize(S*M, 0.0);
+        phi.resize(S*M, 0.0);
+        phi_next.resize(S*M, 0.0);
+        normal_noise_prev.resize(R*M, 0.0);
+        normal_noise_current.resize(R*M, 0.0);
+        w_monomer.resize(S*M, 0.0);
+        w_lambda.resize(R*M, 0.0);
+        h_deriv.resize(I*M, 0.0);
+        w_imag.resize(I*M, 0.0);
+
+        n_complex_grid = Pseudo::get_n_complex_grid(cb->get_nx());
+        sf_average.resize(S*(S+1)/2*n_complex_grid, 0.0);
+        mu_fourier.resize(S*n_complex_grid);
+        phi_fourier.resize(S*n_complex_grid);
+        work_fourier.resize(n_complex_grid);
+
+        total_saddle_iter = 0;
+        total_error_level = 0.0;
+        saddle_fail_count = 0;
+        successive_fail_count = 0;
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+void LangevinFts::add_chi_n_derivative(std::string key, double h_const_deriv,
+    std::vector<double> h_coef_mu1_deriv, std::vector<double> h_coef_mu2_deriv)
+{
+    const int S = monomer_types.size();
+    if (h_coef_mu1_deriv.size() != static_cast<size_t>(S-1) || h_coef_mu2_deriv.size() != static_cast<size_t>(S-1))
+        throw_with_line_number("The sizes of h_coef_mu1_deriv and h_coef_mu2_deriv must be the number of monomer types minus one (" + std::to_string(S-1) + ").");
+    h_const_deriv_chin[key] = h_const_deriv;
+    h_coef_mu1_deriv_chin[key] = h_coef_mu1_deriv;
+    h_coef_mu2_deriv_chin[key] = h_coef_mu2_deriv;
+    dh_history[key];
+}
+void LangevinFts::set_fields(const double *w_aux_input)
+{
+    const int S = monomer_types.size();
+    const int M = cb->get_n_grid();
+    for(int i=0; i<S*M; i++)
+        w_aux[i] = w_aux_input[i];
+}
+void LangevinFts::get_fields(double *w_aux_output)
+{
+    const int S = monomer_types.size();
+    const int M = cb->get_n_grid();
+    for(int i=0; i<S*M; i++)
+        w_aux_output[i] = w_aux[i];
+}
+void LangevinFts::get_concentrations(double *phi_output)
+{
+    const int S = monomer_types.size();
+    const int M = cb->get_n_grid();
+    for(int i=0; i<S*M; i++)
+        phi_output[i] = phi[i];
+}
+void LangevinFts::set_normal_noise_prev(const double *noise_input)
+{
+    for(size_t i=0; i<normal_noise_prev.size(); i++)
+        normal_noise_prev[i] = noise_input[i];
+}
+void LangevinFts::get_normal_noise_prev(double *noise_output)
+{
+    for(size_t i=0; i<normal_noise_prev.size(); i++)
+        noise_output[i] = normal_noise_prev[i];
+}
+std::string LangevinFts::get_random_state()
+{
+    std::stringstream ss;
+    ss << random_generator << " " << normal_distribution;
+    return ss.str();
+}
+void LangevinFts::set_random_state(std::string state)
+{
+    std::stringstream ss(state);
+    ss >> random_generator >> normal_distribution;
+    if (ss.fail())
+        throw_with_line_number("Invalid state of random number generator.");
+}
+void LangevinFts::compute_concentrations(const double *w_aux_in, double *phi_out)
+{
+    try
+    {
+        const int S = monomer_types.size();
+        const int M = cb->get_n_grid();
+
+        // Monomer fields, w_i = sum_j A_ij*w_aux_j
+        std::map<std::string, const double*> w_input;
+        for(int i=0; i<S; i++)
+        {
+            double *_w = &w_monomer[i*M];
+            for(int r=0; r<M; r++)
+                _w[r] = 0.0;
+            for(int j=0; j<S; j++)
+            {
+                const double a_ij = matrix_a[i][j];
+                const double *_w_aux = &w_aux_in[j*M];
+                for(int r=0; r<M; r++)
+                    _w[r] += a_ij*_w_aux[r];
+            }
+            w_input[monomer_types[i]] = _w;
+        }
+
+        // Fields of random copolymers, w_R = sum_i f_Ri*w_i
+        std::vector<std::vector<double>> w_random;
+        w_random.reserve(random_fractions.size());
+        for(const auto& item : random_fractions)
+        {
+            w_random.push_back(std::vector<double>(M, 0.0));
+            for(const auto& fraction : item.second)
+            {
+                const double *_w = w_input[fraction.first];
+                for(int r=0; r<M; r++)
+                    w_random.back()[r] += fraction.second*_w[r];
+            }
+            w_input[item.first] = w_random.back().data();
+        }
+
+        solver->compute_propagators(w_input, {});
+        solver->compute_concentrations();
+        for(int i=0; i<S; i++)
+            solver->get_total_concentration(monomer_types[i], &phi_out[i*M]);
+
+        // Add concentrations of random copolymers to each monomer type
+        std::vector<double> phi_random(M);
+        for(const auto& item : random_fractions)
+        {
+            solver->get_total_concentration(item.first, phi_random.data());
+            for(const auto& fraction : item.second)
+            {
+                const int i = std::find(monomer_types.begin(), monomer_types.end(), fraction.first) - monomer_types.begin();
+                for(int r=0; r<M; r++)
+                    phi_out[i*M+r] += fraction.second*phi_random[r];
+            }
+        }
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+void LangevinFts::compute_func_deriv(const double *w_aux_in, const double *phi_in, const std::vector<int>& indices, double *h_deriv_out)
+{
+    const int S = monomer_types.size();
+    const int M = cb->get_n_grid();
+    for(size_t count=0; count<indices.size(); count++)
+    {
+        const int i = indices[count];
+        double *_h_deriv = &h_deriv_out[count*M];
+        if (i != S-1)
+        {
+            // dH/dw_i = 2*mu2_i*w_i + mu1_i + sum_j A_ji*phi_j
+            const double mu2 = 2.0*h_coef_mu2[i];
+            const double mu1 = h_coef_mu1[i];
+            const double *_w_aux = &w_aux_in[i*M];
+            for(int r=0; r<M; r++)
+                _h_deriv[r] = mu2*_w_aux[r] + mu1;
+            for(int j=0; j<S; j++)
+            {
+                const double a_ji = matrix_a[j][i];
+                const double *_phi = &phi_in[j*M];
+                for(int r=0; r<M; r++)
+                    _h_deriv[r] += a_ji*_phi[r];
+            }
+        }
+        else
+        {
+            // dH/dw_{S-1} = sum_j phi_j - 1
+            for(int r=0; r<M; r++)
+                _h_deriv[r] = -1.0;
+            for(int j=0; j<S; j++)
+            {
+                const double *_phi = &phi_in[j*M];
+                for(int r=0; r<M; r++)
+                    _h_deriv[r] += _phi[r];
+            }
+        }
+
+        // Change the sign for the imaginary fields
+        if (std::find(aux_fields_imag_idx.begin(), aux_fields_imag_idx.end(), i) != aux_fields_imag_idx.end())
+        {
+            for(int r=0; r<M; r++)
+                _h_deriv[r] = -_h_deriv[r];
+        }
+    }
+}
+double LangevinFts::compute_hamiltonian(const double *w_aux_in)
+{
+    const int S = monomer_types.size();
+    const int M = cb->get_n_grid();
+
+    // Field part of the Hamiltonian
+    double hamiltonian = h_const;
+    for(int r=0; r<M; r++)
+        hamiltonian -= w_aux_in[(S-1)*M+r]/M;
+    for(int i=0; i<S-1; i++)
+    {
+        const double *_w_aux = &w_aux_in[i*M];
+        double mean_w = 0.0, mean_w2 = 0.0;
+        for(int r=0; r<M; r++)
+        {
+            mean_w  += _w_aux[r];
+            mean_w2 += _w_aux[r]*_w_aux[r];
+        }
+        hamiltonian += h_coef_mu2[i]*mean_w2/M + h_coef_mu1[i]*mean_w/M;
+    }
+
+    // Partition function part of the Hamiltonian
+    for(int p=0; p<molecules->get_n_polymer_types(); p++)
+    {
+        Polymer& pc = molecules->get_polymer(p);
+        hamiltonian -= pc.get_volume_fraction()/pc.get_alpha()*log(solver->get_total_partition(p));
+    }
+    return hamiltonian;
+}
+int LangevinFts::find_saddle_point(double *w_aux_in, double *phi_out, double& error_level, double& hamiltonian)
+{
+    try
+    {
+        const int S = monomer_types.size();
+        const int M = cb->get_n_grid();
+        const int I = aux_fields_imag_idx.size();
+        std::vector<double> error_level_array(I);
+        double old_error_level;
+        int saddle_iter;
+
+        // Assign large initial value for error
+        error_level = 1.0e20;
+        compressor->reset_count();
+
+        for(saddle_iter=1; saddle_iter<=saddle_max_iter; saddle_iter++)
+        {
+            // Compute total concentrations with noised w_aux
+            compute_concentrations(w_aux_in, phi_out);
+
+            // Compute functional derivatives of Hamiltonian w.r.t. imaginary fields
+            compute_func_deriv(w_aux_in, phi_out, aux_fields_imag_idx, h_deriv.data());
+
+            // Compute total error, the maximum of the standard deviations
+            old_error_level = error_level;
+            error_level = 0.0;
+            for(int count=0; count<I; count++)
+            {
+                const double *_h_deriv = &h_deriv[count*M];
+                double mean = 0.0, variance = 0.0;
+                for(int r=0; r<M; r++)
+                    mean += _h_deriv[r]/M;
+                for(int r=0; r<M; r++)
+                    variance += (_h_deriv[r]-mean)*(_h_deriv[r]-mean)/M;
+                error_level_array[count] = std::sqrt(variance);
+                // NaN is propagated
+                if (!(error_level_array[count] <= error_level))
+                    error_level = error_level_array[count];
+            }
+
+            // Print iteration # and error levels
+            const bool is_finished = error_level < saddle_tolerance || saddle_iter == saddle_max_iter;
+            if (verbose_level >= 2 || (verbose_level == 1 && is_finished))
+            {
+                // Check the mass conservation
+                double mass_error = 0.0;
+                for(int r=0; r<M; r++)
+                    mass_error += h_deriv[(I-1)*M+r]/M;
+                printf("%8d %12.3E  [ ", saddle_iter, mass_error);
+                for(int p=0; p<molecules->get_n_polymer_types(); p++)
+                    printf("%13.7E  ", solver->get_total_partition(p));
+                printf("] %15.9f   [", compute_hamiltonian(w_aux_in));
+                for(int count=0; count<I; count++)
+                    printf("%13.7E ", error_level_array[count]);
+                printf("]\n");
+                fflush(stdout);
+            }
+
+            // Conditions to end the iteration
+            if (error_level < saddle_tolerance)
+                break;
+
+            // Scaling h_deriv, except for the linear-response compressor that computes the Newton step
+            for(int count=0; count<I; count++)
+            {
+                const int i = aux_fields_imag_idx[count];
+                const double scaling = is_residual_scaled ? dt_scaling[i] : 1.0;
+                double *_h_deriv = &h_deriv[count*M];
+                const double *_w_aux = &w_aux_in[i*M];
+                double *_w_imag = &w_imag[count*M];
+                for(int r=0; r<M; r++)
+                {
+                    _h_deriv[r] *= -scaling;
+                    _w_imag[r] = _w_aux[r];
+                }
+            }
+
+            // Calculate new fields using simple and Anderson mixing
+            compressor->calculate_new_fields(w_imag.data(), w_imag.data(), h_deriv.data(), old_error_level, error_level);
+            for(int count=0; count<I; count++)
+            {
+                const int i = aux_fields_imag_idx[count];
+                for(int r=0; r<M; r++)
+                    w_aux_in[i*M+r] = w_imag[count*M+r];
+            }
+        }
+
+        // Set mean of pressure field to zero. The Hamiltonian does not depend on the mean, but it is
+        // computed before the shift to be consistent with the partition functions of the solver.
+        hamiltonian = compute_hamiltonian(w_aux_in);
+        cb->zero_mean(&w_aux_in[(S-1)*M]);
+
+        return std::min(saddle_iter, saddle_max_iter);
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+int LangevinFts::find_saddle_point()
+{
+    double error_level, hamiltonian;
+    return find_saddle_point(w_aux.data(), phi.data(), error_level, hamiltonian);
+}
+bool LangevinFts::run(int start_langevin_step, int end_langevin_step)
+{
+    try
+    {
+        const int S = monomer_types.size();
+        const int M = cb->get_n_grid();
+        const int R = aux_fields_real_idx.size();
+
+        for(int langevin_step=start_langevin_step; langevin_step<=end_langevin_step; langevin_step++)
+        {
+            if (verbose_level >= 1)
+                printf("Langevin step:  %d\n", langevin_step);
+
+            // Compute functional derivatives of Hamiltonian w.r.t. real-valued fields
+            compute_func_deriv(w_aux.data(), phi.data(), aux_fields_real_idx, w_lambda.data());
+
+            // Update w_aux using Leimkuhler-Matthews method. The imaginary fields of
+            // the current step are the initial guess of the saddle point iteration.
+            for(int i=0; i<R*M; i++)
+                normal_noise_current[i] = normal_distribution(random_generator);
+            for(int i=0; i<S*M; i++)
+                w_aux_next[i] = w_aux[i];
+            for(int count=0; count<R; count++)
+            {
+                const int i = aux_fields_real_idx[count];
+                const double scaling = dt_scaling[i];
+                const double sqrt_scaling = std::sqrt(scaling);
+                const double *_w_lambda = &w_lambda[count*M];
+                const double *_noise_prev = &normal_noise_prev[count*M];
+                const double *_noise_current = &normal_noise_current[count*M];
+                double *_w_aux_next = &w_aux_next[i*M];
+                for(int r=0; r<M; r++)
+                    _w_aux_next[r] += -_w_lambda[r]*langevin_dt*scaling + 0.5*(_noise_prev[r] + _noise_current[r])*sqrt_scaling;
+            }
+
+            // Find saddle point of the imaginary fields
+            double error_level, hamiltonian;
+            total_saddle_iter += find_saddle_point(w_aux_next.data(), phi_next.data(), error_level, hamiltonian);
+            total_error_level += error_level;
+
+            // If the tolerance of the saddle point was not met, discard the new fields and regenerate Langevin random noise
+            if (std::isnan(error_level) || error_level >= saddle_tolerance)
+            {
+                if (successive_fail_count < 5)
+                {
+                    printf("The tolerance of the saddle point was not met. Langevin random noise is regenerated.\n");
+                    successive_fail_count++;
+                    saddle_fail_count++;
+                    continue;
+                }
+                else
+                {
+                    printf("The tolerance of the saddle point was not met %d times in a row. Simulation is aborted.\n", successive_fail_count);
+                    return false;
+                }
+            }
+            successive_fail_count = 0;
+
+            // Accept the new fields
+            w_aux.swap(w_aux_next);
+            phi.swap(phi_next);
+            normal_noise_prev.swap(normal_noise_current);
+
+            // Compute H, dH/dχN and structure function
+            if (langevin_step % sf_computing_period == 0)
+            {
+                hamiltonian_history.push_back(hamiltonian);
+                accumulate_observables();
+            }
+        }
+        return true;
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+void LangevinFts::accumulate_observables()
+{
+    const int S = monomer_types.size();
+    const int M = cb->get_n_grid();
+
+    // Compute dH/dχN
+    std::vector<double> mean_w(S-1, 0.0), mean_w2(S-1, 0.0);
+    for(int i=0; i<S-1; i++)
+    {
+        for(int r=0; r<M; r++)
+        {
+            mean_w[i]  += w_aux[i*M+r]/M;
+            mean_w2[i] += w_aux[i*M+r]*w_aux[i*M+r]/M;
+        }
+    }
+    for(const auto& item : h_const_deriv_chin)
+    {
+        const std::string& key = item.first;
+        double dh = item.second;
+        for(int i=0; i<S-1; i++)
+            dh += h_coef_mu2_deriv_chin[key][i]*mean_w2[i] + h_coef_mu1_deriv_chin[key][i]*mean_w[i];
+        dh_history[key].push_back(dh);
+    }
+
+    // Perform Fourier transforms
+    for(int i=0; i<S*n_complex_grid; i++)
+        mu_fourier[i] = 0.0;
+    for(int i=0; i<S; i++)
+        forward_fft(&phi[i*M], &phi_fourier[i*n_complex_grid]);
+    for(int k=0; k<S-1; k++)
+    {
+        if (eigenvalues[k] == 0.0)
+            continue;
+        forward_fft(&w_aux[k*M], work_fourier.data());
+        for(int i=0; i<S; i++)
+        {
+            const double coef = matrix_a_inv[k][i]/eigenvalues[k]/M;
+            std::complex<double> *_mu_fourier = &mu_fourier[i*n_complex_grid];
+            for(int n=0; n<n_complex_grid; n++)
+                _mu_fourier[n] += work_fourier[n]*coef;
+        }
+    }
+    for(int i=0; i<S*n_complex_grid; i++)
+        phi_fourier[i] /= static_cast<double>(M);
+
+    // Accumulate S_ij(K), assuming that <u(k)>*<phi(-k)> is zero
+    int pair = 0;
+    for(int i=0; i<S; i++)
+    {
+        for(int j=i; j<S; j++)
+        {
+            std::complex<double> *_sf = &sf_average[pair*n_complex_grid];
+            const std::complex<double> *_mu_fourier = &mu_fourier[i*n_complex_grid];
+            const std::complex<double> *_phi_fourier = &phi_fourier[j*n_complex_grid];
+            for(int n=0; n<n_complex_grid; n++)
+                _sf[n] += _mu_fourier[n]*std::conj(_phi_fourier[n]);
+            pair++;
+        }
+    }
+}
+void LangevinFts::clear_history()
+{
+    hamiltonian_history.clear();
+    for(auto& item : dh_history)
+        item.second.clear();
+}
+void LangevinFts::get_structure_function(int i, int j, std::complex<double> *sf)
+{
+    const int S = monomer_types.size();
+    if (i < 0 || j < i || j >= S)
+        throw_with_line_number("Invalid pair of monomer types (" + std::to_string(i) + ", " + std::to_string(j) + "). 0 <= i <= j < " + std::to_string(S) + " is required.");
+    // Index of the pair (i, j) in the upper triangle
+    const int pair = i*S - i*(i-1)/2 + (j-i);
+    for(int n=0; n<n_complex_grid; n++)
+        sf[n] = sf_average[pair*n_complex_grid+n];
+}
+void LangevinFts::reset_structure_function()
+{
+    for(size_t n=0; n<sf_average.size(); n++)
+        sf_average[n] = 0.0;
+}
@@ -0,0 +1,151 @@
+/*----------------------------------------------------------
+* This is an abstract LangevinFts class.
+* Langevin field-theoretic simulation (L-FTS) of the multimonomer polymer field theory.
+* The auxiliary fields, the normal noise, the saddle point iteration of the imaginary fields
+* and the observables (Hamiltonian, dH/dχN and structure functions) are stored in C++, so
+* that each call of 'run' performs many Langevin steps without returning to Python.
+* The real fields are updated by the Leimkuhler-Matthews method, and the imaginary fields are
+* found by 'compressor' (e.g., Anderson mixing, or LinearResponseCompressor).
+* When the saddle point is not found, the new fields are discarded by swapping buffers,
+* and the Langevin step is retried with new random noise.
+* The coefficients of the Hamiltonian follow 'SymmetricPolymerTheory' in lfts.py, i.e.,
+*     H = -sum_p phi_p/alpha_p*ln(Q_p) - <w_{S-1}> + sum_{i<S-1} (mu2_i*<w_i^2> + mu1_i*<w_i>) + h_const,
+* where w_i are the auxiliary fields, and monomer fields are matrix_a*w.
+* Fields and concentrations are ordered as w[i*n_grid + r].
+*-----------------------------------------------------------*/
+
+#ifndef LANGEVIN_FTS_H_
+#define LANGEVIN_FTS_H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <random>
+#include <complex>
+
+#include "ComputationBox.h"
+#include "Molecules.h"
+#include "PropagatorComputation.h"
+#include "AndersonMixing.h"
+
+class LangevinFts
+{
+private:
+    // Compute concentrations of monomer types for the auxiliary fields
+    void compute_concentrations(const double *w_aux_in, double *phi_out);
+    // Functional derivatives of the Hamiltonian w.r.t. the auxiliary fields of the given indices.
+    // The sign is changed for the imaginary fields, as in lfts.py.
+    void compute_func_deriv(const double *w_aux_in, const double *phi_in, const std::vector<int>& indices, double *h_deriv_out);
+    double compute_hamiltonian(const double *w_aux_in);
+    // Find the imaginary fields of w_aux_in. Return the number of iterations.
+    int find_saddle_point(double *w_aux_in, double *phi_out, double& error_level, double& hamiltonian);
+    void accumulate_observables();
+
+protected:
+    ComputationBox *cb;
+    Molecules *molecules;
+    PropagatorComputation *solver;
+    // Saddle point iteration of imaginary fields (not owned)
+    AndersonMixing *compressor;
+    // Whether the residuals are scaled by dt_scaling before 'compressor'
+    bool is_residual_scaled;
+
+    std::vector<std::string> monomer_types;
+    std::map<std::string, std::map<std::string, double>> random_fractions;
+    std::vector<std::vector<double>> matrix_a, matrix_a_inv;
+    std::vector<double> eigenvalues;
+    std::vector<int> aux_fields_real_idx, aux_fields_imag_idx;
+    double h_const;
+    std::vector<double> h_coef_mu1, h_coef_mu2, dt_scaling;
+    // Derivatives of the coefficients of the Hamiltonian w.r.t. χN
+    std::map<std::string, double> h_const_deriv_chin;
+    std::map<std::string, std::vector<double>> h_coef_mu1_deriv_chin, h_coef_mu2_deriv_chin;
+
+    double langevin_dt, langevin_sigma;
+    int saddle_max_iter;
+    double saddle_tolerance;
+    int sf_computing_period;
+    // 0: no output, 1: print each Langevin step, 2: print each saddle point iteration
+    int verbose_level;
+
+    std::mt19937_64 random_generator;
+    std::normal_distribution<double> normal_distribution;
+
+    // Current and trial auxiliary fields and concentrations. They are swapped when a Langevin step is accepted.
+    std::vector<double> w_aux, w_aux_next, phi, phi_next;
+    // Normal noise of the previous and current Langevin steps
+    std::vector<double> normal_noise_prev, normal_noise_current;
+    // Work arrays
+    std::vector<double> w_monomer, w_lambda, h_deriv, w_imag;
+
+    // Statistics
+    int total_saddle_iter, saddle_fail_count, successive_fail_count;
+    double total_error_level;
+
+    // Observables recorded every sf_computing_period steps
+    std::vector<double> hamiltonian_history;
+    std::map<std::string, std::vector<double>> dh_history;
+    // Accumulated <u(k) phi(-k)> for pairs (i <= j) of monomer types
+    int n_complex_grid;
+    std::vector<std::complex<double>> sf_average;
+    std::vector<std::complex<double>> mu_fourier, phi_fourier, work_fourier;
+
+    // Unnormalized forward FFT of real data, the same layout as numpy.fft.rfftn
+    virtual void forward_fft(double *rdata, std::complex<double> *cdata)=0;
+
+public:
+    LangevinFts(ComputationBox *cb, Molecules *molecules, PropagatorComputation *solver,
+        AndersonMixing *compressor,
+        std::vector<std::string> monomer_types,
+        std::vector<std::vector<double>> matrix_a,
+        std::vector<std::vector<double>> matrix_a_inv,
+        std::vector<double> eigenvalues,
+        std::vector<int> aux_fields_real_idx,
+        std::vector<int> aux_fields_imag_idx,
+        double h_const,
+        std::vector<double> h_coef_mu1,
+        std::vector<double> h_coef_mu2,
+        std::vector<double> dt_scaling,
+        double langevin_dt, double langevin_sigma,
+        int saddle_max_iter, double saddle_tolerance,
+        int sf_computing_period, int verbose_level,
+        std::map<std::string, std::map<std::string, double>> random_fractions,
+        long random_seed);
+    virtual ~LangevinFts(){};
+
+    // dH/dχN = h_const_deriv + sum_{i<S-1} (mu2_deriv_i*<w_i^2> + mu1_deriv_i*<w_i>)
+    void add_chi_n_derivative(std::string key, double h_const_deriv,
+        std::vector<double> h_coef_mu1_deriv, std::vector<double> h_coef_mu2_deriv);
+
+    std::vector<std::string> get_monomer_types(){ return monomer_types;};
+    int get_n_grid(){ return cb->get_n_grid();};
+    std::vector<int> get_nx(){ return cb->get_nx();};
+    int get_n_real_fields(){ return aux_fields_real_idx.size();};
+    int get_n_complex_grid(){ return n_complex_grid;};
+
+    void set_fields(const double *w_aux_input);
+    void get_fields(double *w_aux_output);
+    void get_concentrations(double *phi_output);
+    void set_normal_noise_prev(const double *noise_input);
+    void get_normal_noise_prev(double *noise_output);
+    std::string get_random_state();
+    void set_random_state(std::string state);
+
+    // Find the saddle point of the current fields. Return the number of iterations.
+    int find_saddle_point();
+    // Run Langevin steps from start_langevin_step to end_langevin_step. Return false if
+    // the saddle point is not found 5 times in a row and the simulation is aborted.
+    bool run(int start_langevin_step, int end_langevin_step);
+
+    int get_total_saddle_iter(){ return total_saddle_iter;};
+    double get_total_error_level(){ return total_error_level;};
+    int get_saddle_fail_count(){ return saddle_fail_count;};
+
+    std::vector<double> get_hamiltonian_history(){ return hamiltonian_history;};
+    std::map<std::string, std::vector<double>> get_dh_history(){ return dh_history;};
+    void clear_history();
+    // Accumulated <u(k) phi(-k)> of monomer types i and j (i <= j)
+    void get_structure_function(int i, int j, std::complex<double> *sf);
+    void reset_structure_function();
+};
+#endif
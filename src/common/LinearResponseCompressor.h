@@ -0,0 +1,82 @@
+/*-------------------------------------------------------------
+* This is an abstract LinearResponseCompressor class.
+* Saddle point iteration of the imaginary auxiliary fields (e.g., the pressure field w_+) in L-FTS.
+* The residual of the m-th imaginary field is g_m = dH/dw_m = d_m*w_m + c_m + sum_i A_im*phi_i,
+* where w_i = sum_m A_im*w_m are monomer fields, and d_m is zero for the pressure field.
+* For small changes of fields, phi_i changes by -sum_j S_ij(k)*delta_w_j(k), where S is the
+* correlation function matrix of the current 'Molecules' (see Rpa). Thus, the Newton step
+* is computed from the linear response of the disordered melt in Fourier space,
+*     delta_w(k) = (A^T*S(k)*A - D)^{-1} g(k),
+* where D = diag(d_m). For the pressure field only, this is delta_w_+(k) = g(k)/sum_ij S_ij(k).
+* If 'anderson_mixing' is given, the linear-response step replaces the residual of Anderson mixing,
+* i.e., Anderson mixing is applied to the preconditioned residual.
+* The residual passed to 'calculate_new_fields' must not be scaled.
+* Random copolymers are treated as mixtures of monomer types using 'random_fractions'.
+* (Beardsley, Spencer and Matsen, Macromolecules 52, 8840 (2019))
+*------------------------------------------------------------*/
+
+#ifndef LINEAR_RESPONSE_COMPRESSOR_H_
+#define LINEAR_RESPONSE_COMPRESSOR_H_
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include "Exception.h"
+#include "ComputationBox.h"
+#include "Molecules.h"
+#include "AndersonMixing.h"
+
+class LinearResponseCompressor : public AndersonMixing
+{
+protected:
+    ComputationBox *cb;
+    Molecules *molecules;
+    std::vector<std::string> monomer_types;
+    // A_im, derivatives of monomer fields w.r.t. imaginary auxiliary fields (S x I)
+    std::vector<std::vector<double>> matrix_a;
+    // d_m, second derivatives of the Hamiltonian w.r.t. imaginary auxiliary fields (I)
+    std::vector<double> vector_d;
+    // Fractions of monomer types of each random copolymer
+    std::map<std::string, std::map<std::string, double>> random_fractions;
+    // Anderson mixing applied to the preconditioned residual (not owned)
+    AndersonMixing *anderson_mixing;
+public:
+    LinearResponseCompressor(ComputationBox *cb, Molecules *molecules,
+        std::vector<std::string> monomer_types,
+        std::vector<std::vector<double>> matrix_a,
+        std::vector<double> vector_d,
+        AndersonMixing *anderson_mixing,
+        std::map<std::string, std::map<std::string, double>> random_fractions)
+        : AndersonMixing(vector_d.size()*cb->get_n_grid(), 0, 0.0, 1.0, 1.0)
+    {
+        const int S = monomer_types.size();
+        const int I = vector_d.size();
+        if (I < 1)
+            throw_with_line_number("There must be at least one imaginary field.");
+        if (matrix_a.size() != static_cast<size_t>(S))
+            throw_with_line_number("The number of rows of matrix_a must be the number of monomer types (" + std::to_string(S) + ").");
+        for(int i=0; i<S; i++)
+        {
+            if (matrix_a[i].size() != static_cast<size_t>(I))
+                throw_with_line_number("The number of columns of matrix_a must be the number of imaginary fields (" + std::to_string(I) + ").");
+        }
+        if (anderson_mixing != nullptr && anderson_mixing->get_n_var() != n_var)
+            throw_with_line_number("The number of variables of Anderson mixing (" + std::to_string(anderson_mixing->get_n_var()) + ") must be n_imaginary_fields*n_grid (" + std::to_string(n_var) + ").");
+
+        this->cb = cb;
+        this->molecules = molecules;
+        this->monomer_types = monomer_types;
+        this->matrix_a = matrix_a;
+        this->vector_d = vector_d;
+        this->anderson_mixing = anderson_mixing;
+        this->random_fractions = random_fractions;
+    };
+    virtual ~LinearResponseCompressor(){};
+
+    // Build the linear response kernels for the current box. Since the kernels
+    // depend on box lengths, they are rebuilt in 'calculate_new_fields' whenever
+    // the box lengths have been changed.
+    virtual void update_kernels()=0;
+};
+#endif
@@ -48,6 +48,53 @@ void Molecules::add_polymer(
     polymer_types.push_back(Polymer(ds, bond_lengths, 
         volume_fraction, block_inputs, chain_end_to_q_init));
 }
+int Molecules::add_polymer_length_distribution(
+    double volume_fraction,
+    std::vector<BlockInput> block_inputs,
+    int block_index,
+    std::vector<double> contour_lengths,
+    std::vector<double> weights,
+    std::map<int, std::string> chain_end_to_q_init)
+{
+    try
+    {
+        if (block_index < 0 || block_index >= static_cast<int>(block_inputs.size()))
+            throw_with_line_number("block_index (" + std::to_string(block_index) + ") must be in range [0, " + std::to_string(block_inputs.size()-1) + "].");
+        if (contour_lengths.size() != weights.size())
+            throw_with_line_number("The sizes of contour_lengths (" + std::to_string(contour_lengths.size()) + ") and weights (" + std::to_string(weights.size()) + ") must be the same.");
+
+        // Discretize contour lengths, and merge weights of the same number of segments
+        std::map<int, double> n_segment_to_weight;
+        double total_weight = 0.0;
+        for(size_t i=0; i<contour_lengths.size(); i++)
+        {
+            int n_segment = std::lround(contour_lengths[i]/ds);
+            if (n_segment < 1)
+                throw_with_line_number("contour_lengths[" + std::to_string(i) + "] (" + std::to_string(contour_lengths[i]) + ") must be larger than or equal to ds.");
+            if (weights[i] < 0.0)
+                throw_with_line_number("weights[" + std::to_string(i) + "] (" + std::to_string(weights[i]) + ") must be a non-negative number.");
+            n_segment_to_weight[n_segment] += weights[i];
+            total_weight += weights[i];
+        }
+        if (total_weight <= 0.0)
+            throw_with_line_number("The sum of weights must be a positive number.");
+
+        int n_added = 0;
+        for(const auto& item: n_segment_to_weight)
+        {
+            if (item.second == 0.0)
+                continue;
+            block_inputs[block_index].contour_length = item.first*ds;
+            add_polymer(volume_fraction*item.second/total_weight, block_inputs, chain_end_to_q_init);
+            n_added++;
+        }
+        return n_added;
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
 void Molecules::add_solvent(
     double volume_fraction, std::string monomer_type)
 {
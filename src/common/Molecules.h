@@ -55,6 +55,19 @@ public:
         add_polymer(volume_fraction, block_inputs, {});
     }
 
+    // Add a polymer species whose block 'block_index' has a distribution of contour lengths, e.g., for polydisperse polymers.
+    // Each contour length is rounded to a multiple of ds, and added as a polymer type whose volume fraction is
+    // volume_fraction*weights[i]/sum(weights). Weights of the same number of segments are merged.
+    // Propagators of the common parts, e.g., from the free ends, are shared and computed once up to the longest chain.
+    // It returns the number of added polymer types.
+    int add_polymer_length_distribution(
+        double volume_fraction,
+        std::vector<BlockInput> block_inputs,
+        int block_index,
+        std::vector<double> contour_lengths,
+        std::vector<double> weights,
+        std::map<int, std::string> chain_end_to_q_init={});
+
     // Add solvent
     void add_solvent(double volume_fraction, std::string monomer_type);
 
@@ -0,0 +1,56 @@
+/*-------------------------------------------------------------
+* This is an abstract NewtonKrylov class.
+* Jacobian-free Newton-Krylov (JFNK) method for finding saddle points, w_deriv(w) = 0.
+* It has the same calling convention as AndersonMixing, so it can replace Anderson mixing
+* in the iteration loop without changes. Since the Jacobian-vector products are computed
+* by finite differences of w_deriv, each call of 'calculate_new_fields' returns the next
+* point at which w_deriv has to be evaluated: either a perturbed field for a GMRES
+* iteration or a Newton update. Therefore, the caller must compute w_deriv at 'w_new'
+* and pass it in the next call, which is what the usual iteration loop does.
+* (Knoll and Keyes, J. Comput. Phys. 193, 357 (2004))
+*------------------------------------------------------------*/
+
+#ifndef NEWTON_KRYLOV_H_
+#define NEWTON_KRYLOV_H_
+
+#include <string>
+#include <vector>
+
+#include "Exception.h"
+#include "AndersonMixing.h"
+
+class NewtonKrylov : public AndersonMixing
+{
+protected:
+    // Maximum dimension of Krylov subspace
+    int max_krylov;
+    // GMRES stops when |w_deriv + J*dw| < forcing_term*|w_deriv|
+    double forcing_term;
+    // The number of w_deriv evaluations and Newton steps
+    int n_evaluations, n_newton_steps;
+public:
+    NewtonKrylov(int n_var, int max_krylov, double start_error, double mix_min, double mix_init, double forcing_term)
+        : AndersonMixing(n_var, max_krylov, start_error, mix_min, mix_init)
+    {
+        if (max_krylov < 1)
+            throw_with_line_number("max_krylov (" + std::to_string(max_krylov) + ") must be a positive integer.");
+        if (forcing_term <= 0.0 || forcing_term >= 1.0)
+            throw_with_line_number("forcing_term (" + std::to_string(forcing_term) + ") must be in (0, 1).");
+        this->max_krylov = max_krylov;
+        this->forcing_term = forcing_term;
+        this->n_evaluations = 0;
+        this->n_newton_steps = 0;
+    };
+    virtual ~NewtonKrylov(){};
+
+    int get_n_evaluations(){ return n_evaluations;};
+    int get_n_newton_steps(){ return n_newton_steps;};
+
+    // Right preconditioner applied in Fourier space. The first n_comp*prod(nx) variables are
+    // n_comp fields on the grid 'nx', and the other variables are not preconditioned.
+    // For each wavevector k, the preconditioned fields are sum_j kernel[i][j](k)*w_j(k), where
+    // kernel[i][j](k) is stored at kernel[(i*n_comp+j)*n_complex_grid + k], and approximates
+    // the inverse of the Jacobian of w_deriv.
+    virtual void set_fourier_preconditioner(std::vector<int> nx, int n_comp, std::vector<double> kernel)=0;
+};
+#endif
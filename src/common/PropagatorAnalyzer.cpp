@@ -5,38 +5,264 @@
 #include <algorithm>
 #include <stack>
 #include <set>
+#include <sstream>
 
 #include "PropagatorAnalyzer.h"
+#include "ComputationCache.h"
+#include "Scheduler.h"
 #include "Molecules.h"
 #include "Polymer.h"
 #include "Exception.h"
 
-bool ComparePropagatorKey::operator()(const std::string& str1, const std::string& str2)
+bool ComparePropagatorKey::operator()(const std::string& str1, const std::string& str2) const
 {
-    // First compare heights
-    int height_str1 = PropagatorCode::get_height_from_key(str1);
-    int height_str2 = PropagatorCode::get_height_from_key(str2);
-
-    if (height_str1 < height_str2)
-        return true;
-    else if(height_str1 > height_str2)
-        return false;
+    // First compare heights, i.e., the numbers of leading '[' or '(', in a single scan
+    for(size_t i=0; ; i++)
+    {
+        bool is_open_1 = i < str1.size() && (str1[i] == '[' || str1[i] == '(');
+        bool is_open_2 = i < str2.size() && (str2[i] == '[' || str2[i] == '(');
+        if (is_open_1 != is_open_2)
+            return is_open_2;
+        if (!is_open_1)
+            break;
+    }
 
     // Second compare their strings
     return str1 > str2;
 }
 
-PropagatorAnalyzer::PropagatorAnalyzer(Molecules* molecules, bool aggregate_propagator_computation)
+PropagatorAnalyzer::PropagatorAnalyzer(Molecules* molecules, bool aggregate_propagator_computation, bool is_sorted_merge)
 {
     if(molecules->get_n_polymer_types() == 0)
         throw_with_line_number("There is no chain. Add polymers first.");
 
     this->aggregate_propagator_computation = aggregate_propagator_computation;
+    if (!aggregate_propagator_computation)
+        this->aggregation_plan = "none";
+    else
+        this->aggregation_plan = is_sorted_merge ? "sorted_merge" : "equal_length";
     this->model_name = molecules->get_model_name();
+
+    analyze(molecules);
+}
+PropagatorAnalyzer::PropagatorAnalyzer(Molecules* molecules, int n_streams, int max_live_segments, bool is_memory_aware_scheduling)
+{
+    if(molecules->get_n_polymer_types() == 0)
+        throw_with_line_number("There is no chain. Add polymers first.");
+    if(n_streams < 1)
+        throw_with_line_number("The number of streams (" + std::to_string(n_streams) + ") must be a positive integer.");
+
+    this->model_name = molecules->get_model_name();
+
+    // Evaluate each plan
+    const std::vector<std::string> plans = {"none", "equal_length", "sorted_merge"};
+    for(const std::string& plan: plans)
+    {
+        computation_propagators.clear();
+        computation_blocks.clear();
+        original_propagators.clear();
+        original_blocks.clear();
+        total_segment_numbers.clear();
+
+        this->aggregation_plan = plan;
+        this->aggregate_propagator_computation = (plan != "none");
+        analyze(molecules);
+        aggregation_costs[plan] = evaluate_cost(n_streams, max_live_segments, is_memory_aware_scheduling);
+    }
+
+    // Choose the cheapest plan. If costs are equal, the plan without aggregation is preferred,
+    // since block concentrations and chain propagators are available.
+    auto is_cheaper = [max_live_segments](const AggregationCost& cost_1, const AggregationCost& cost_2)
+    {
+        bool is_over_1 = max_live_segments > 0 && cost_1.peak_live_segments > max_live_segments;
+        bool is_over_2 = max_live_segments > 0 && cost_2.peak_live_segments > max_live_segments;
+        return std::make_tuple(is_over_1, cost_1.makespan, cost_1.n_steps, cost_1.peak_live_segments) <
+               std::make_tuple(is_over_2, cost_2.makespan, cost_2.n_steps, cost_2.peak_live_segments);
+    };
+    std::string best_plan = plans[0];
+    for(const std::string& plan: plans)
+    {
+        if (is_cheaper(aggregation_costs[plan], aggregation_costs[best_plan]))
+            best_plan = plan;
+    }
+
+    #ifndef NDEBUG
+    for(const auto& item: aggregation_costs)
+    {
+        std::cout << "Aggregation plan '" << item.first << "': steps, makespan, peak live segments: "
+            << item.second.n_steps << ", " << item.second.makespan << ", " << item.second.peak_live_segments << std::endl;
+    }
+    std::cout << "The chosen aggregation plan: " << best_plan << std::endl;
+    #endif
+
+    if (best_plan != aggregation_plan)
+    {
+        computation_propagators.clear();
+        computation_blocks.clear();
+        original_propagators.clear();
+        original_blocks.clear();
+        total_segment_numbers.clear();
+
+        this->aggregation_plan = best_plan;
+        this->aggregate_propagator_computation = (best_plan != "none");
+        analyze(molecules);
+    }
+}
+void PropagatorAnalyzer::analyze(Molecules* molecules)
+{
+    // Load the result of analysis if it is cached
+    std::string signature, cache_file_name;
+    if (ComputationCache::is_enabled())
+    {
+        signature = get_signature(molecules);
+        cache_file_name = ComputationCache::get_file_name("analyzer", signature);
+        if (load(cache_file_name, signature))
+            return;
+    }
+
     for(int p=0; p<molecules->get_n_polymer_types();p++)
     {
         add_polymer(molecules->get_polymer(p), p);
     }
+
+    if (!cache_file_name.empty())
+        save(cache_file_name, signature);
+}
+AggregationCost PropagatorAnalyzer::evaluate_cost(const int n_streams, const int max_live_segments, const bool is_memory_aware_scheduling)
+{
+    // Use the same scheduler as the solver
+    Scheduler *sc;
+    if (is_memory_aware_scheduling)
+        sc = new Scheduler(computation_propagators, computation_blocks, n_streams, max_live_segments);
+    else
+        sc = new Scheduler(computation_propagators, n_streams);
+
+    AggregationCost cost;
+    cost.n_steps = get_n_segment_steps();
+    cost.makespan = sc->get_planned_makespan();
+    cost.peak_live_segments = sc->get_peak_live_segments();
+    delete sc;
+    return cost;
+}
+std::string PropagatorAnalyzer::get_signature(Molecules* molecules)
+{
+    // Molecules and options that determine the result of analysis
+    std::stringstream ss;
+    ss.precision(17);
+    ss << "model: " << model_name << ", ds: " << molecules->get_ds() << ", aggregation: " << aggregation_plan << "\n";
+    for(const auto& item: molecules->get_bond_lengths())
+        ss << "bond length " << item.first << ": " << item.second << "\n";
+    for(int p=0; p<molecules->get_n_polymer_types();p++)
+    {
+        Polymer& pc = molecules->get_polymer(p);
+        ss << "polymer " << p << "\n";
+        for(const auto& block: pc.get_blocks())
+        {
+            ss << block.monomer_type << ", " << block.n_segment << ", " << block.v << ", " << block.u << ", ";
+            ss << pc.get_propagator_key(block.v, block.u) << ", " << pc.get_propagator_key(block.u, block.v) << "\n";
+        }
+    }
+    return ss.str();
+}
+// Serialization of propagators and blocks for the cache
+static void write_propagators(std::ostream& out, const std::map<std::string, ComputationEdge, ComparePropagatorKey>& propagators)
+{
+    ComputationCache::write(out, static_cast<int>(propagators.size()));
+    for(const auto& item: propagators)
+    {
+        ComputationCache::write(out, item.first);
+        ComputationCache::write(out, item.second.max_n_segment);
+        ComputationCache::write(out, item.second.monomer_type);
+        ComputationCache::write(out, item.second.deps);
+        ComputationCache::write(out, item.second.height);
+        ComputationCache::write(out, item.second.junction_ends);
+    }
+}
+static void read_propagators(std::istream& in, std::map<std::string, ComputationEdge, ComparePropagatorKey>& propagators)
+{
+    int n_propagators;
+    ComputationCache::read(in, n_propagators);
+    for(int i=0; i<n_propagators && in; i++)
+    {
+        std::string key;
+        ComputationEdge edge;
+        ComputationCache::read(in, key);
+        ComputationCache::read(in, edge.max_n_segment);
+        ComputationCache::read(in, edge.monomer_type);
+        ComputationCache::read(in, edge.deps);
+        ComputationCache::read(in, edge.height);
+        ComputationCache::read(in, edge.junction_ends);
+        propagators[key] = edge;
+    }
+}
+static void write_blocks(std::ostream& out, const std::map<std::tuple<int, std::string, std::string>, ComputationBlock>& blocks)
+{
+    ComputationCache::write(out, static_cast<int>(blocks.size()));
+    for(const auto& item: blocks)
+    {
+        ComputationCache::write(out, item.first);
+        ComputationCache::write(out, item.second.monomer_type);
+        ComputationCache::write(out, item.second.n_segment_left);
+        ComputationCache::write(out, item.second.n_segment_right);
+        ComputationCache::write(out, item.second.n_repeated);
+        ComputationCache::write(out, item.second.v_u);
+    }
+}
+static void read_blocks(std::istream& in, std::map<std::tuple<int, std::string, std::string>, ComputationBlock>& blocks)
+{
+    int n_blocks;
+    ComputationCache::read(in, n_blocks);
+    for(int i=0; i<n_blocks && in; i++)
+    {
+        std::tuple<int, std::string, std::string> key;
+        ComputationBlock block;
+        ComputationCache::read(in, key);
+        ComputationCache::read(in, block.monomer_type);
+        ComputationCache::read(in, block.n_segment_left);
+        ComputationCache::read(in, block.n_segment_right);
+        ComputationCache::read(in, block.n_repeated);
+        ComputationCache::read(in, block.v_u);
+        blocks[key] = block;
+    }
+}
+bool PropagatorAnalyzer::load(const std::string& file_name, const std::string& signature)
+{
+    std::ifstream in;
+    if (!ComputationCache::open(in, file_name, signature))
+        return false;
+
+    read_propagators(in, computation_propagators);
+    read_blocks(in, computation_blocks);
+    read_propagators(in, original_propagators);
+    read_blocks(in, original_blocks);
+    ComputationCache::read(in, total_segment_numbers);
+
+    // Discard the partially loaded result
+    if (!in)
+    {
+        computation_propagators.clear();
+        computation_blocks.clear();
+        original_propagators.clear();
+        original_blocks.clear();
+        total_segment_numbers.clear();
+        return false;
+    }
+    intern_propagator_keys();
+    #ifndef NDEBUG
+    std::cout << "Propagator analysis is loaded from '" << file_name << "'." << std::endl;
+    #endif
+    return true;
+}
+void PropagatorAnalyzer::save(const std::string& file_name, const std::string& signature)
+{
+    ComputationCache::save(file_name, signature, [this](std::ostream& out)
+    {
+        write_propagators(out, computation_propagators);
+        write_blocks(out, computation_blocks);
+        write_propagators(out, original_propagators);
+        write_blocks(out, original_blocks);
+        ComputationCache::write(out, total_segment_numbers);
+    });
 }
 void PropagatorAnalyzer::add_polymer(Polymer& pc, int polymer_id)
 {
@@ -87,6 +313,22 @@ void PropagatorAnalyzer::add_polymer(Polymer& pc, int polymer_id)
     }
     this->total_segment_numbers.push_back(total_segment_number);
 
+    // Keep the blocks before aggregation, so that concentrations of each block can be recovered
+    if (this->aggregate_propagator_computation)
+    {
+        for(const auto& v_item : computation_blocks_new_polymer)
+        {
+            for(const auto& u_item : v_item.second)
+            {
+                original_blocks[std::make_tuple(polymer_id, v_item.first, u_item.first)] = u_item.second;
+                update_computation_propagator_map(original_propagators, v_item.first, u_item.second.n_segment_left,
+                    PropagatorCode::get_height_from_key(u_item.first) > 0);
+                update_computation_propagator_map(original_propagators, u_item.first, u_item.second.n_segment_right,
+                    PropagatorCode::get_height_from_key(v_item.first) > 0);
+            }
+        }
+    }
+
     // Aggregation
     if (this->aggregate_propagator_computation)
     {
@@ -104,10 +346,11 @@ void PropagatorAnalyzer::add_polymer(Polymer& pc, int polymer_id)
 
             // Aggregate propagators for given left key
             std::map<std::string, ComputationBlock> set_I;
+            const bool is_sorted_merge = (aggregation_plan == "sorted_merge");
             if (model_name == "continuous")
-                set_I = PropagatorAnalyzer::aggregate_propagator_continuous_chain(right_keys);
+                set_I = PropagatorAnalyzer::aggregate_propagator_continuous_chain(right_keys, is_sorted_merge);
             else if (model_name == "discrete")
-                set_I = PropagatorAnalyzer::aggregate_propagator_discrete_chain(right_keys);
+                set_I = PropagatorAnalyzer::aggregate_propagator_discrete_chain(right_keys, is_sorted_merge);
             else if (model_name == "")
                 std::cout << "Chain model name is not set!" << std::endl;
             else
@@ -165,8 +408,41 @@ void PropagatorAnalyzer::add_polymer(Polymer& pc, int polymer_id)
             update_computation_propagator_map(computation_propagators, key_u, n_segment_right, is_junction_left);
         }
     }
+
+    intern_propagator_keys();
 }
-std::map<std::string, ComputationBlock> PropagatorAnalyzer::aggregate_propagator_continuous_chain(std::map<std::string, ComputationBlock> not_aggregated_right_keys)
+void PropagatorAnalyzer::intern_propagator_keys()
+{
+    propagator_keys.clear();
+    propagator_ids.clear();
+    propagator_edges.clear();
+    for(auto& item: computation_propagators)
+    {
+        propagator_ids[item.first] = propagator_keys.size();
+        propagator_keys.push_back(item.first);
+        propagator_edges.push_back(&item.second);
+    }
+    for(auto& item: computation_propagators)
+    {
+        item.second.dep_ids.clear();
+        for(const auto& dep: item.second.deps)
+            item.second.dep_ids.push_back(std::make_tuple(propagator_ids[std::get<0>(dep)], std::get<1>(dep), std::get<2>(dep)));
+    }
+    for(auto& item: computation_blocks)
+    {
+        item.second.id_left  = propagator_ids[std::get<1>(item.first)];
+        item.second.id_right = propagator_ids[std::get<2>(item.first)];
+    }
+    // Propagators of original blocks are not computed if they are aggregated
+    for(auto& item: original_blocks)
+    {
+        auto it_left  = propagator_ids.find(std::get<1>(item.first));
+        auto it_right = propagator_ids.find(std::get<2>(item.first));
+        item.second.id_left  = (it_left  != propagator_ids.end()) ? it_left->second  : -1;
+        item.second.id_right = (it_right != propagator_ids.end()) ? it_right->second : -1;
+    }
+}
+std::map<std::string, ComputationBlock> PropagatorAnalyzer::aggregate_propagator_continuous_chain(std::map<std::string, ComputationBlock> not_aggregated_right_keys, bool is_sorted_merge)
 {
     // Example)
     // 0, B:
@@ -178,16 +454,18 @@ std::map<std::string, ComputationBlock> PropagatorAnalyzer::aggregate_propagator
     //
     //      ↓   Aggregation
     //  
-    //   6, 6, 1, (C)B, 
+    //   6, 2, 1, (C)B, 
     //   4, 0, 3, (D)B, 
     //   4, 0, 2, (E)B, 
-    //   4, 4, 1, [(D)B0:3,(E)B0:2]B, 
-    //   2, 2, 1, (F)B, 
+    //   4, 2, 1, [(C)B2,(D)B0:3,(E)B0:2]B, 
+    //   2, 0, 1, (F)B, 
+    //   2, 2, 1, [[(C)B2,(D)B0:3,(E)B0:2]B2,(F)B0]B, 
 
-    return aggregate_propagator_common(not_aggregated_right_keys, 0);
+    // Slices are integrated by Simpson's rule, so their offsets should be even numbers.
+    return aggregate_propagator_common(not_aggregated_right_keys, 0, 2, is_sorted_merge);
 
 }
-std::map<std::string, ComputationBlock> PropagatorAnalyzer::aggregate_propagator_discrete_chain(std::map<std::string, ComputationBlock> not_aggregated_right_keys)
+std::map<std::string, ComputationBlock> PropagatorAnalyzer::aggregate_propagator_discrete_chain(std::map<std::string, ComputationBlock> not_aggregated_right_keys, bool is_sorted_merge)
 {
     // Example)
     // 0, B:
@@ -199,16 +477,18 @@ std::map<std::string, ComputationBlock> PropagatorAnalyzer::aggregate_propagator
     //
     //      ↓   Aggregation
     //  
-    //   6, 6, 1, (C)B, 
+    //   6, 3, 1, (C)B, 
     //   4, 1, 3, (D)B, 
     //   4, 1, 2, (E)B, 
-    //   3, 3, 1, [(D)B1:3,(E)B1:2]B, 
-    //   2, 2, 1, (F)B, 
+    //   3, 2, 1, [(C)B3,(D)B1:3,(E)B1:2]B, 
+    //   2, 1, 1, (F)B, 
+    //   1, 1, 1, [[(C)B3,(D)B1:3,(E)B1:2]B2,(F)B1]B, 
 
-    return aggregate_propagator_common(not_aggregated_right_keys, 1);
+    // Aggregated propagators start from q(r,1/2) of deps only if all deps start from their junctions.
+    return aggregate_propagator_common(not_aggregated_right_keys, 1, 1, is_sorted_merge);
 }
 
-std::map<std::string, ComputationBlock> PropagatorAnalyzer::aggregate_propagator_common(std::map<std::string, ComputationBlock> set_I, int minimum_n_segment)
+std::map<std::string, ComputationBlock> PropagatorAnalyzer::aggregate_propagator_common(std::map<std::string, ComputationBlock> set_I, int minimum_n_segment, int offset_multiple, bool is_sorted_merge)
 {
     #ifndef NDEBUG
     std::cout << "--------- PropagatorAnalyzer::aggregate_propagator (before) -----------" << std::endl;
@@ -229,103 +509,149 @@ std::map<std::string, ComputationBlock> PropagatorAnalyzer::aggregate_propagator
     std::cout << "-----------------------" << std::endl;
     #endif
 
-    // Make a set of n_compute
-    std::set<int> set_n_compute;
-    for(const auto& item: set_I)
-        set_n_compute.insert(item.second.n_segment_right);
+    // Right keys are merged in descending order of n_segment_right (sorted merge).
+    // At each length threshold, the aggregated key of longer propagators (carry) is sliced,
+    // so that its remainder has the same length as the propagators of the threshold.
+    // Offsets of the slices must be multiples of 'offset_multiple', so right keys are merged within each class of n_segment_right % offset_multiple.
+    const std::map<std::string, ComputationBlock> set_I_original = set_I;
+    std::map<int, std::set<int>> set_n_compute;
+    for(const auto& item: set_I_original)
+        set_n_compute[item.second.n_segment_right % offset_multiple].insert(item.second.n_segment_right);
 
     // Aggregate right keys
-    for(const int n_segment_current: set_n_compute)
+    for(const auto& n_compute_class: set_n_compute)
     {
-        // Add elements into set_S
-        std::map<std::string, ComputationBlock, ComparePropagatorKey> set_S;
-        for(const auto& item: set_I)
+        std::string carry_key;
+        for(auto it_n = n_compute_class.second.rbegin(); it_n != n_compute_class.second.rend(); it_n++)
         {
-            if (item.second.n_segment_right == n_segment_current)
-                set_S[item.first] = item.second;
-        }
+            const int n_segment_current = *it_n;
 
-        // Skip if nothing to aggregate
-        if (set_S.size() == 1 || n_segment_current < 2*minimum_n_segment)
-            continue;
+            // Add elements into set_S
+            std::map<std::string, ComputationBlock, ComparePropagatorKey> set_S;
+            for(const auto& item: set_I_original)
+            {
+                if (item.second.n_segment_right == n_segment_current)
+                    set_S[item.first] = item.second;
+            }
 
-        // If all monomer types are same, set minimum_n_segment = 0
-        bool is_same_monomer_type = true;
-        std::string monomer_type = PropagatorCode::get_monomer_type_from_key(set_S.begin()->second.monomer_type);
-        for(auto it = set_S.rbegin(); it != set_S.rend(); it++)
-        {
-            if (it->second.monomer_type != monomer_type)
-                is_same_monomer_type = false;
-        }
-        if (is_same_monomer_type)
-            minimum_n_segment = 0;
+            // The remainder of the carry should have at least two segments
+            bool is_merged_with_carry = is_sorted_merge && !carry_key.empty() && n_segment_current >= 2;
+            if (is_merged_with_carry)
+                set_S[carry_key] = set_I[carry_key];
+
+            // Skip if nothing to aggregate
+            if (set_S.size() == 1)
+            {
+                carry_key = set_S.begin()->first;
+                continue;
+            }
+
+            // Propagators of the same length are aggregated from their first segments.
+            // Slices merged with the carry have at least 'minimum_n_segment' segments.
+            int n_segment_offset = is_merged_with_carry ? minimum_n_segment : 0;
+            std::string monomer_type = set_S.begin()->second.monomer_type;
 
-        // Update 'n_segment_right'
-        for(const auto& item: set_S)
-            set_I[item.first].n_segment_right = minimum_n_segment;
+            // Update 'n_segment_right'
+            for(const auto& item: set_S)
+                set_I[item.first].n_segment_right = item.second.n_segment_right - n_segment_current + n_segment_offset;
         
-        // New 'n_segment_right' and 'n_segment_left'
-        int n_segment_right = n_segment_current - minimum_n_segment;
-        int n_segment_left  = n_segment_current - minimum_n_segment;
+            // New 'n_segment_right' and 'n_segment_left'
+            int n_segment_right = n_segment_current - n_segment_offset;
+            int n_segment_left  = n_segment_current - n_segment_offset;
            
-        // New 'v_u' and propagator key
-        std::vector<std::tuple<int ,int>> v_u;
-        std::string propagator_code = "[";
-        bool is_first_sub_propagator = true;
-        std::string dep_key;
-        for(auto it = set_S.rbegin(); it != set_S.rend(); it++)
-        {
-            dep_key = it->first;
+            // New 'v_u' and propagator key
+            std::vector<std::tuple<int ,int>> v_u;
+            std::string propagator_code = "[";
+            bool is_first_sub_propagator = true;
+            std::string dep_key;
+            for(auto it = set_S.rbegin(); it != set_S.rend(); it++)
+            {
+                dep_key = it->first;
 
-            // Update propagator key
-            if(!is_first_sub_propagator)
-                propagator_code += ",";
-            else
-                is_first_sub_propagator = false;
-            propagator_code += dep_key + std::to_string(set_I[dep_key].n_segment_right);
+                // Update propagator key
+                if(!is_first_sub_propagator)
+                    propagator_code += ",";
+                else
+                    is_first_sub_propagator = false;
+                propagator_code += dep_key + std::to_string(set_I[dep_key].n_segment_right);
 
-            // The number of repeats
-            if (set_I[dep_key].n_repeated > 1)
-                propagator_code += ":" + std::to_string(set_I[dep_key].n_repeated);
+                // The number of repeats
+                if (set_I[dep_key].n_repeated > 1)
+                    propagator_code += ":" + std::to_string(set_I[dep_key].n_repeated);
 
-            // Compute the union of v_u
-            std::vector<std::tuple<int ,int>> dep_v_u = set_I[dep_key].v_u;
-            v_u.insert(v_u.end(), dep_v_u.begin(), dep_v_u.end());
-        }
-        propagator_code += "]" + monomer_type;
-
-        // Add new aggregated key to set_I
-        set_I[propagator_code].monomer_type = monomer_type;
-        set_I[propagator_code].n_segment_right = n_segment_right;
-        set_I[propagator_code].n_segment_left = n_segment_left;
-        set_I[propagator_code].v_u = v_u;
-        set_I[propagator_code].n_repeated = 1;
-
-        #ifndef NDEBUG
-        std::cout << "---------- PropagatorAnalyzer::aggregate_propagator (in progress) -----------" << std::endl;
-        std::cout << "--------- map (" + std::to_string(set_I.size()) + ") -----------" << std::endl;
-        for(const auto& item : set_I)
-        {
-            std::cout << item.second.n_segment_right << ", " <<
-                        item.first << ", " <<
-                        item.second.n_segment_left << ", ";
-            for(const auto& v_u : item.second.v_u)
+                // Compute the union of v_u
+                std::vector<std::tuple<int ,int>> dep_v_u = set_I[dep_key].v_u;
+                v_u.insert(v_u.end(), dep_v_u.begin(), dep_v_u.end());
+            }
+            propagator_code += "]" + monomer_type;
+
+            // Add new aggregated key to set_I
+            set_I[propagator_code].monomer_type = monomer_type;
+            set_I[propagator_code].n_segment_right = n_segment_right;
+            set_I[propagator_code].n_segment_left = n_segment_left;
+            set_I[propagator_code].v_u = v_u;
+            set_I[propagator_code].n_repeated = 1;
+            carry_key = propagator_code;
+
+            #ifndef NDEBUG
+            std::cout << "---------- PropagatorAnalyzer::aggregate_propagator (in progress) -----------" << std::endl;
+            std::cout << "--------- map (" + std::to_string(set_I.size()) + ") -----------" << std::endl;
+            for(const auto& item : set_I)
             {
-                std::cout << "("
-                + std::to_string(std::get<0>(v_u)) + ","
-                + std::to_string(std::get<1>(v_u)) + ")" + ", ";
+                std::cout << item.second.n_segment_right << ", " <<
+                            item.first << ", " <<
+                            item.second.n_segment_left << ", ";
+                for(const auto& v_u : item.second.v_u)
+                {
+                    std::cout << "("
+                    + std::to_string(std::get<0>(v_u)) + ","
+                    + std::to_string(std::get<1>(v_u)) + ")" + ", ";
+                }
+                std::cout << std::endl;
             }
-            std::cout << std::endl;
+            std::cout << "-----------------------" << std::endl;
+            #endif
         }
-        std::cout << "-----------------------" << std::endl;
-        #endif
     }
     return set_I;
 }
+std::map<std::string, ComputationEdge, ComparePropagatorKey>& PropagatorAnalyzer::get_original_propagators()
+{
+    return original_propagators;
+}
+std::map<std::tuple<int, std::string, std::string>, ComputationBlock>& PropagatorAnalyzer::get_original_blocks()
+{
+    return original_blocks;
+}
 bool PropagatorAnalyzer::is_aggregated() const
 {
     return aggregate_propagator_computation;
 }
+const std::string& PropagatorAnalyzer::get_aggregation_plan() const
+{
+    return aggregation_plan;
+}
+const std::map<std::string, AggregationCost>& PropagatorAnalyzer::get_aggregation_costs() const
+{
+    return aggregation_costs;
+}
+int PropagatorAnalyzer::get_n_segment_steps() const
+{
+    int n_steps = 0;
+    for(const auto& item : computation_propagators)
+    {
+        if (this->model_name == "continuous")
+            n_steps += item.second.max_n_segment;
+        else if (this->model_name == "discrete")
+        {
+            n_steps += item.second.max_n_segment-1;
+            n_steps += item.second.junction_ends.size();
+            if (item.second.deps.size() > 0)
+                n_steps++;
+        }
+    }
+    return n_steps;
+}
 
 void PropagatorAnalyzer::substitute_right_keys(
     Polymer& pc, 
@@ -451,6 +777,36 @@ ComputationEdge& PropagatorAnalyzer::get_computation_propagator(std::string key)
 
     return computation_propagators[key];
 }
+bool PropagatorAnalyzer::is_junction_start(const std::string& key)
+{
+    return is_junction_start(get_propagator_id(key));
+}
+bool PropagatorAnalyzer::is_junction_start(int id)
+{
+    const auto& dep_ids = propagator_edges[id]->dep_ids;
+    if (dep_ids.size() == 0)
+        return false;
+
+    // Aggregated propagators of slices start from q(r,n) of deps
+    if (propagator_keys[id][0] == '[' && std::get<1>(dep_ids[0]) > 0)
+        return false;
+    return true;
+}
+int PropagatorAnalyzer::get_propagator_id(const std::string& key) const
+{
+    auto it = propagator_ids.find(key);
+    if (it == propagator_ids.end())
+        throw_with_line_number("There is no such key (" + key + ").");
+    return it->second;
+}
+const std::string& PropagatorAnalyzer::get_propagator_key(int id) const
+{
+    return propagator_keys[id];
+}
+ComputationEdge& PropagatorAnalyzer::get_computation_propagator(int id)
+{
+    return *propagator_edges[id];
+}
 std::map<std::tuple<int, std::string, std::string>, ComputationBlock>& PropagatorAnalyzer::get_computation_blocks()
 {
     return computation_blocks;
@@ -535,7 +891,7 @@ void PropagatorAnalyzer::display_propagators() const
     // Print propagators
     std::vector<std::tuple<std::string, int, int>> sub_deps;
     int total_mde_steps_without_reduction = 0;
-    int reduced_mde_steps = 0;
+    int reduced_mde_steps = get_n_segment_steps();
 
     std::cout << "--------------- Propagators ---------------" << std::endl;
     std::cout << "Key:\n\theight, aggregated, max_n_segment, # dependencies, junction_ends" << std::endl;
@@ -547,15 +903,6 @@ void PropagatorAnalyzer::display_propagators() const
 
     for(const auto& item : computation_propagators)
     {
-        if (this->model_name == "continuous")
-            reduced_mde_steps += item.second.max_n_segment;
-        else if (this->model_name == "discrete")
-        {
-            reduced_mde_steps += item.second.max_n_segment-1;
-            reduced_mde_steps += item.second.junction_ends.size();
-            if (item.second.deps.size() > 0)
-                reduced_mde_steps++;
-        }
         const int MAX_PRINT_LENGTH = 500;
 
         if (item.first.size() <= MAX_PRINT_LENGTH)
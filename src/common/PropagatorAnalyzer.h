@@ -19,6 +19,7 @@ struct ComputationEdge{
     std::vector<std::tuple<std::string, int, int>> deps;  // Tuple <key, n_segment, n_repeated>
     int height;                                           // Height of propagator (height of tree data Structure)
     std::set<int> junction_ends;                          // Indices where additional half bond step computation is required.
+    std::vector<std::tuple<int, int, int>> dep_ids;       // Tuple <id, n_segment, n_repeated>, interned deps
 };
 struct ComputationBlock{
     std::string monomer_type;  // monomer_type
@@ -34,12 +35,21 @@ struct ComputationBlock{
     int n_segment_right;
     int n_repeated;
     std::vector<std::tuple<int ,int>> v_u; // node pair <polymer id, v, u>
+    int id_left;               // Interned IDs of key_left and key_right (see PropagatorAnalyzer::get_propagator_id), -1 if not computed
+    int id_right;
+};
+
+// Predicted cost of an aggregation plan
+struct AggregationCost{
+    int n_steps;             // Total number of segment steps to compute propagators
+    int makespan;            // Planned makespan with the given number of streams, in units of segment steps
+    int peak_live_segments;  // The maximum number of segments stored at the same time
 };
 
 /* This stucture defines comparison function for branched key */
 struct ComparePropagatorKey
 {
-    bool operator()(const std::string& str1, const std::string& str2);
+    bool operator()(const std::string& str1, const std::string& str2) const;
 };
 
 class PropagatorAnalyzer
@@ -49,15 +59,37 @@ private:
                             // "discrete": discrete bead-spring model
     bool aggregate_propagator_computation; // compute multiple propagators using property of linearity of the diffusion equation.
 
+    // Aggregation plan. "none": propagators are not aggregated.
+    // "equal_length": only propagators of the same length are aggregated.
+    // "sorted_merge": propagators of different lengths are also aggregated (see aggregate_propagator_common).
+    std::string aggregation_plan;
+
+    // Predicted costs of the plans that are evaluated by the planner
+    std::map<std::string, AggregationCost> aggregation_costs;
+
     // set{key: (polymer id, key_left, key_right) (assert(key_left <= key_right))}
     std::map<std::tuple<int, std::string, std::string>, ComputationBlock> computation_blocks;
 
     // dictionary{key:non-duplicated unique propagator_codes, value: ComputationEdge}
     std::map<std::string, ComputationEdge, ComparePropagatorKey> computation_propagators; 
 
+    // Blocks and propagators before aggregation. They are kept only if propagators are aggregated,
+    // and used to recover concentrations of each block from the aggregated propagators.
+    std::map<std::tuple<int, std::string, std::string>, ComputationBlock> original_blocks;
+    std::map<std::string, ComputationEdge, ComparePropagatorKey> original_propagators;
+
     // Total segment number
     std::vector<int> total_segment_numbers;
 
+    // Interned propagator keys. The ID of a propagator is its position in 'computation_propagators',
+    // so dependencies always have smaller IDs. Keys are kept for display and debugging.
+    std::vector<std::string> propagator_keys;
+    std::map<std::string, int> propagator_ids;
+    std::vector<ComputationEdge *> propagator_edges;
+
+    // Assign IDs to propagators and resolve their deps and the propagators of blocks
+    void intern_propagator_keys();
+
     // Substitute right keys of lower left key with aggregated keys
     void substitute_right_keys(
         Polymer& pc, 
@@ -73,26 +105,70 @@ private:
 
     bool is_junction(Polymer& pc, int node);
 
+    // Analyze propagators of all polymers with the current aggregation plan
+    void analyze(Molecules* molecules);
+
+    // Cost of the current plan, which is estimated by 'Scheduler'
+    AggregationCost evaluate_cost(const int n_streams, const int max_live_segments, const bool is_memory_aware_scheduling);
+
+    // Cache of the analysis (see ComputationCache)
+    std::string get_signature(Molecules* molecules);
+    bool load(const std::string& file_name, const std::string& signature);
+    void save(const std::string& file_name, const std::string& signature);
+
 public:
-    PropagatorAnalyzer(Molecules* molecules, bool aggregate_propagator_computation);
+    // If 'is_sorted_merge' is true, propagators of different lengths are also aggregated ("sorted_merge").
+    // Otherwise, only propagators of the same length are aggregated ("equal_length").
+    PropagatorAnalyzer(Molecules* molecules, bool aggregate_propagator_computation, bool is_sorted_merge=false);
+
+    // Cost-based planner. Every aggregation plan is evaluated, and the plan with the smallest makespan for 'n_streams'
+    // is chosen. Ties are broken by the total number of steps and the peak memory. Plans whose peak number of live
+    // segments exceeds 'max_live_segments' are chosen only if all plans exceed it (0 means no limit).
+    // Plans are scheduled in the same way as the solver, i.e., with the memory-aware 'Scheduler'
+    // if 'is_memory_aware_scheduling' is true, and with the height-based 'Scheduler' otherwise.
+    PropagatorAnalyzer(Molecules* molecules, int n_streams, int max_live_segments, bool is_memory_aware_scheduling);
+    // Not copyable, since 'propagator_edges' points to its own 'computation_propagators'
+    PropagatorAnalyzer(const PropagatorAnalyzer&) = delete;
+    PropagatorAnalyzer& operator=(const PropagatorAnalyzer&) = delete;
     // ~PropagatorAnalyzer() {};
 
     // Add new polymers
     void add_polymer(Polymer& pc, int polymer_count);
 
-    // Aggregate propagators
-    static std::map<std::string, ComputationBlock> aggregate_propagator_common          (std::map<std::string, ComputationBlock> remaining_keys, int minimum_n_segment);
-    static std::map<std::string, ComputationBlock> aggregate_propagator_continuous_chain(std::map<std::string, ComputationBlock> u_map);
-    static std::map<std::string, ComputationBlock> aggregate_propagator_discrete_chain  (std::map<std::string, ComputationBlock> u_map);
+    // Aggregate propagators. Right keys of different lengths are merged at each length threshold in descending order.
+    // Slices merged with longer propagators have at least 'minimum_n_segment' segments, and their offsets are multiples of 'offset_multiple'.
+    // If 'is_sorted_merge' is false, only right keys of the same length are aggregated.
+    static std::map<std::string, ComputationBlock> aggregate_propagator_common          (std::map<std::string, ComputationBlock> remaining_keys, int minimum_n_segment, int offset_multiple, bool is_sorted_merge=false);
+    static std::map<std::string, ComputationBlock> aggregate_propagator_continuous_chain(std::map<std::string, ComputationBlock> u_map, bool is_sorted_merge=false);
+    static std::map<std::string, ComputationBlock> aggregate_propagator_discrete_chain  (std::map<std::string, ComputationBlock> u_map, bool is_sorted_merge=false);
 
     // Get information of computation propagators and blocks
     bool is_aggregated() const;
+    const std::string& get_aggregation_plan() const;
+    // Costs of evaluated plans. It is empty if the planner is not used.
+    const std::map<std::string, AggregationCost>& get_aggregation_costs() const;
+    // Total number of segment steps to compute propagators
+    int get_n_segment_steps() const;
     int get_n_computation_propagator_codes() const;
     std::map<std::string, ComputationEdge, ComparePropagatorKey>& get_computation_propagators(); 
     ComputationEdge& get_computation_propagator(std::string key);
+
+    // Whether the propagator starts from a junction, where the half bond step is required.
+    // Leaf propagators, and aggregated propagators that start from slices of other propagators do not.
+    bool is_junction_start(const std::string& key);
+    bool is_junction_start(int id);
+
+    // Interned propagator keys
+    int get_propagator_id(const std::string& key) const;
+    const std::string& get_propagator_key(int id) const;
+    ComputationEdge& get_computation_propagator(int id);
     std::map<std::tuple<int, std::string, std::string>, ComputationBlock>& get_computation_blocks(); 
     ComputationBlock& get_computation_block(std::tuple<int, std::string, std::string> key);
 
+    // Blocks and propagators that would be computed without aggregation. They are empty if propagators are not aggregated.
+    std::map<std::tuple<int, std::string, std::string>, ComputationBlock>& get_original_blocks();
+    std::map<std::string, ComputationEdge, ComparePropagatorKey>& get_original_propagators();
+
     // Display
     void display_propagators() const;
     void display_blocks() const;
@@ -114,7 +114,7 @@ std::string PropagatorCode::generate_edge_code(
     return code;
 }
 
-std::string PropagatorCode::get_key_from_code(std::string code)
+std::string PropagatorCode::get_key_from_code(const std::string& code)
 {
     int pos;
     for(int i=code.size()-1; i>=0;i--)
@@ -129,7 +129,7 @@ std::string PropagatorCode::get_key_from_code(std::string code)
     return code.substr(0, pos);
 }
 
-std::vector<std::tuple<std::string, int, int>> PropagatorCode::get_deps_from_key(std::string key)
+std::vector<std::tuple<std::string, int, int>> PropagatorCode::get_deps_from_key(const std::string& key)
 {
     // sub_key, sub_n_segment, sub_n_repeated
     std::vector<std::tuple<std::string, int, int>> sub_deps;
@@ -213,7 +213,7 @@ std::vector<std::tuple<std::string, int, int>> PropagatorCode::get_deps_from_key
     return sub_deps;
 }
 
-std::string PropagatorCode::remove_monomer_type_from_key(std::string key)
+std::string PropagatorCode::remove_monomer_type_from_key(const std::string& key)
 {
     if (key[0] != '[' && key[0] != '(' && key[0] != '{')
     {
@@ -244,7 +244,7 @@ std::string PropagatorCode::remove_monomer_type_from_key(std::string key)
     }
 }
 
-std::string PropagatorCode::get_monomer_type_from_key(std::string key)
+std::string PropagatorCode::get_monomer_type_from_key(const std::string& key)
 {
     int pos_start = 0;
     for(int i=key.size()-1; i>=0;i--)
@@ -259,7 +259,7 @@ std::string PropagatorCode::get_monomer_type_from_key(std::string key)
     //std::cout << key.substr(pos_start, key.size()-pos_start) << std::endl;
     return key.substr(pos_start, key.size()-pos_start);
 }
-std::string PropagatorCode::get_q_input_idx_from_key(std::string key)
+std::string PropagatorCode::get_q_input_idx_from_key(const std::string& key)
 {
     if (key[0] != '{')
         throw_with_line_number("There is no related initial condition in key (" + key + ").");
@@ -276,7 +276,7 @@ std::string PropagatorCode::get_q_input_idx_from_key(std::string key)
     // std::cout << key.substr(1, pos_start-1) << std::endl;
     return key.substr(1, pos_start-1);
 }
-int PropagatorCode::get_height_from_key(std::string key)
+int PropagatorCode::get_height_from_key(const std::string& key)
 {
     int height_count = 0;
     for(size_t i=0; i<key.size();i++)
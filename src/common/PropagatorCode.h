@@ -31,12 +31,12 @@ public:
     static std::vector<std::tuple<int, int, std::string>> generate_codes(Polymer& pc, std::map<int, std::string>& chain_end_to_q_init);
 
     // Get information from key or code
-    static std::string get_key_from_code(std::string code);
-    static std::vector<std::tuple<std::string, int, int>> get_deps_from_key(std::string key);
-    static std::string remove_monomer_type_from_key(std::string key);
-    static std::string get_monomer_type_from_key(std::string key);
-    static std::string get_q_input_idx_from_key(std::string key);
-    static int get_height_from_key(std::string key);
+    static std::string get_key_from_code(const std::string& code);
+    static std::vector<std::tuple<std::string, int, int>> get_deps_from_key(const std::string& key);
+    static std::string remove_monomer_type_from_key(const std::string& key);
+    static std::string get_monomer_type_from_key(const std::string& key);
+    static std::string get_q_input_idx_from_key(const std::string& key);
+    static int get_height_from_key(const std::string& key);
     
 };
 #endif
@@ -32,6 +32,44 @@ PropagatorComputation::~PropagatorComputation()
     delete[] single_solvent_partitions;
 }
 
+void PropagatorComputation::compute_statistics_batch(
+    std::vector<std::map<std::string, const double*>> w_inputs,
+    std::vector<std::string> monomer_types,
+    double *partitions, double *phi, int batch_size,
+    std::map<std::string, const double*> q_init)
+{
+    try
+    {
+        const int M = cb->get_n_grid();
+        const int P = molecules->get_n_polymer_types();
+        const int S = monomer_types.size();
+
+        if (batch_size < 1)
+            throw_with_line_number("The batch size (" + std::to_string(batch_size) + ") must be positive.");
+
+        // Compute field sets one by one
+        for(size_t k=0; k<w_inputs.size(); k++)
+        {
+            compute_statistics(w_inputs[k], q_init);
+            for(int p=0; p<P; p++)
+                partitions[k*P+p] = get_total_partition(p);
+            for(int i=0; i<S; i++)
+                get_total_concentration(monomer_types[i], &phi[(k*S+i)*M]);
+        }
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+std::map<std::tuple<int, std::string, std::string>, const double*> PropagatorComputation::get_block_concentration_ptrs()
+{
+    throw_with_line_number("Concentrations in host memory are not accessible for this solver. Use get_block_concentration instead.");
+}
+const double* PropagatorComputation::get_solvent_concentration_ptr(int)
+{
+    throw_with_line_number("Concentrations in host memory are not accessible for this solver. Use get_solvent_concentration instead.");
+}
 std::vector<double> PropagatorComputation::get_stress()
 { 
     const int DIM  = cb->get_dim();
@@ -10,6 +10,8 @@
 #include <cstdio>
 #include <tuple>
 #include <map>
+#include <vector>
+#include <string>
 
 #include "ComputationBox.h"
 #include "Molecules.h"
@@ -38,6 +40,7 @@ public:
     virtual ~PropagatorComputation();
 
     int get_n_grid() {return cb->get_n_grid();};
+    int get_n_polymer_types() {return molecules->get_n_polymer_types();};
     int get_n_blocks(int polymer) { Polymer& pc = molecules->get_polymer(polymer); return pc.get_n_blocks();};
     virtual void update_laplacian_operator() = 0;
 
@@ -51,6 +54,15 @@ public:
         std::map<std::string, const double*> w_block,
         std::map<std::string, const double*> q_init = {}) = 0;
 
+    // Compute statistics of K sets of fields for the same q_init, processing up to 'batch_size' sets at once.
+    // The outputs are partitions[k*n_polymer_types + p] and phi[(k*n_monomer_types + i)*n_grid + r], where i is
+    // the index of 'monomer_types'. Propagators and concentrations of this object are not preserved.
+    virtual void compute_statistics_batch(
+        std::vector<std::map<std::string, const double*>> w_inputs,
+        std::vector<std::string> monomer_types,
+        double *partitions, double *phi, int batch_size=1,
+        std::map<std::string, const double*> q_init = {});
+
     virtual void compute_stress() = 0;
     virtual double get_total_partition(int polymer) = 0;
     virtual void get_chain_propagator(double *q_out, int polymer, int v, int u, int n) = 0;
@@ -63,6 +75,11 @@ public:
     virtual double get_solvent_partition(int s) = 0;
     virtual void get_solvent_concentration(int s, double *phi) = 0;
 
+    // Concentrations owned by the solver in host memory, normalized after compute_concentrations().
+    // The keys are (polymer id, key_left, key_right) of computation blocks. Not every solver supports them.
+    virtual std::map<std::tuple<int, std::string, std::string>, const double*> get_block_concentration_ptrs();
+    virtual const double* get_solvent_concentration_ptr(int s);
+
     virtual std::vector<double> get_stress();
 
     // Grand canonical ensemble
@@ -0,0 +1,42 @@
+#include <iostream>
+#include "PropagatorComputationBatch.h"
+
+PropagatorComputationBatch::PropagatorComputationBatch(
+    ComputationBox *cb,
+    Molecules *molecules,
+    PropagatorAnalyzer *propagator_analyzer,
+    int n_replicas)
+{
+    if (cb == nullptr)
+        throw_with_line_number("ComputationBox *cb is a null pointer");
+    if (molecules == nullptr)
+        throw_with_line_number("Molecules *molecules is a null pointer");
+    if (n_replicas < 1)
+        throw_with_line_number("The number of replicas (" + std::to_string(n_replicas) + ") must be positive.");
+
+    this->cb = cb;
+    this->molecules = molecules;
+    this->propagator_analyzer = propagator_analyzer;
+    this->n_replicas = n_replicas;
+
+    single_polymer_partitions.resize(n_replicas*molecules->get_n_polymer_types());
+    single_solvent_partitions.resize(n_replicas*molecules->get_n_solvent_types());
+}
+double PropagatorComputationBatch::get_total_partition(int replica, int polymer)
+{
+    const int P = molecules->get_n_polymer_types();
+    if (replica < 0 || replica > n_replicas-1)
+        throw_with_line_number("Replica index (" + std::to_string(replica) + ") must be in range [0, " + std::to_string(n_replicas-1) + "]");
+    if (polymer < 0 || polymer > P-1)
+        throw_with_line_number("Index (" + std::to_string(polymer) + ") must be in range [0, " + std::to_string(P-1) + "]");
+    return single_polymer_partitions[replica*P + polymer];
+}
+double PropagatorComputationBatch::get_solvent_partition(int replica, int s)
+{
+    const int S = molecules->get_n_solvent_types();
+    if (replica < 0 || replica > n_replicas-1)
+        throw_with_line_number("Replica index (" + std::to_string(replica) + ") must be in range [0, " + std::to_string(n_replicas-1) + "]");
+    if (s < 0 || s > S-1)
+        throw_with_line_number("Index (" + std::to_string(s) + ") must be in range [0, " + std::to_string(S-1) + "]");
+    return single_solvent_partitions[replica*S + s];
+}
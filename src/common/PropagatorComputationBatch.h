@@ -0,0 +1,78 @@
+/*-------------------------------------------------------------
+* This is an abstract PropagatorComputationBatch class.
+* It computes propagators and concentrations of R replicas of the same
+* molecules in the same computation box together, e.g., independent
+* L-FTS runs for ensemble averages. Operators (Boltzmann factors of bonds),
+* FFT plans and the schedule of propagators are shared by all replicas.
+* Fields, initial conditions and concentrations of all replicas are stored
+* contiguously, i.e., w[replica*n_grid + r].
+*------------------------------------------------------------*/
+
+#ifndef PROPAGATOR_COMPUTATION_BATCH_H_
+#define PROPAGATOR_COMPUTATION_BATCH_H_
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include "ComputationBox.h"
+#include "Molecules.h"
+#include "Polymer.h"
+#include "PropagatorAnalyzer.h"
+#include "Exception.h"
+
+class PropagatorComputationBatch
+{
+protected:
+    ComputationBox *cb;
+    Molecules *molecules;
+    PropagatorAnalyzer *propagator_analyzer;
+
+    // The number of replicas
+    int n_replicas;
+
+    // Total partition functions for each replica and polymer, [replica*n_polymer_types + polymer]
+    std::vector<double> single_polymer_partitions;
+
+    // Total partition functions for each replica and solvent, [replica*n_solvent_types + solvent]
+    std::vector<double> single_solvent_partitions;
+public:
+    PropagatorComputationBatch(ComputationBox *cb, Molecules *molecules, PropagatorAnalyzer* propagator_analyzer, int n_replicas);
+    virtual ~PropagatorComputationBatch() {};
+
+    int get_n_grid() {return cb->get_n_grid();};
+    int get_n_replicas() {return n_replicas;};
+    virtual void update_laplacian_operator() = 0;
+
+    // w_block[monomer_type] and q_init[name] are arrays of size n_replicas*n_grid
+    virtual void compute_propagators(
+        std::map<std::string, const double*> w_block,
+        std::map<std::string, const double*> q_init = {}) = 0;
+
+    virtual void compute_concentrations() = 0;
+
+    virtual void compute_statistics(
+        std::map<std::string, const double*> w_block,
+        std::map<std::string, const double*> q_init = {}) = 0;
+
+    // Multiple sources: all replicas share w_block[monomer_type] and q_init[name] of size n_grid,
+    // and replica r uses the r-th initial condition in q_init_batch (size n_replicas*n_grid) for q_init_source.
+    // Propagators that do not depend on q_init_source are computed only once.
+    virtual void compute_statistics_multi_source(
+        std::map<std::string, const double*> w_block,
+        std::string q_init_source, const double *q_init_batch,
+        std::map<std::string, const double*> q_init = {}) = 0;
+
+    double get_total_partition(int replica, int polymer);
+    double get_solvent_partition(int replica, int s);
+
+    // Output arrays are of size n_replicas*n_grid
+    virtual void get_chain_propagator(double *q_out, int polymer, int v, int u, int n) = 0;
+    virtual void get_total_concentration(std::string monomer_type, double *phi) = 0;
+    virtual void get_total_concentration(int polymer, std::string monomer_type, double *phi) = 0;
+    virtual void get_solvent_concentration(int s, double *phi) = 0;
+
+    // Check whether Q = int q(r,s)q^dagger(r,s) is constant w.r.t. variable s for all replicas.
+    virtual bool check_total_partition() = 0;
+};
+#endif
@@ -0,0 +1,247 @@
+#include <cmath>
+#include <queue>
+#include <algorithm>
+
+#include "Rpa.h"
+
+//----------------- get_k_square -------------------
+void Rpa::get_k_square(
+    std::vector<BoundaryCondition> bc,
+    double *k_square, std::vector<int> nx, std::vector<double> dx)
+{
+    try
+    {
+        int itemp, jtemp, ktemp, idx;
+        const double PI{3.14159265358979323846};
+        double xfactor[3];
+
+        const int DIM = nx.size();
+        std::vector<int> tnx;
+        std::vector<double> tdx;
+        if (DIM == 3)
+        {
+            tnx = {nx[0], nx[1], nx[2]};
+            tdx = {dx[0], dx[1], dx[2]};
+        }
+        else if (DIM == 2)
+        {
+            tnx = {1,   nx[0], nx[1]};
+            tdx = {1.0, dx[0], dx[1]};
+        }
+        else if (DIM == 1)
+        {
+            tnx = {1,   1,   nx[0]};
+            tdx = {1.0, 1.0, dx[0]};
+        }
+
+        for(size_t i=0; i<bc.size(); i++)
+        {
+            if (bc[i] != BoundaryCondition::PERIODIC)
+                throw_with_line_number("Currently, RPA only supports periodic boundary conditions");
+        }
+
+        for(int d=0; d<3; d++)
+            xfactor[d] = std::pow(2*PI/(tnx[d]*tdx[d]),2);
+
+        for(int i=0; i<tnx[0]; i++)
+        {
+            if( i > tnx[0]/2)
+                itemp = tnx[0]-i;
+            else
+                itemp = i;
+            for(int j=0; j<tnx[1]; j++)
+            {
+                if( j > tnx[1]/2)
+                    jtemp = tnx[1]-j;
+                else
+                    jtemp = j;
+                for(int k=0; k<tnx[2]/2+1; k++)
+                {
+                    ktemp = k;
+                    idx = i* tnx[1]*(tnx[2]/2+1) + j*(tnx[2]/2+1) + k;
+                    k_square[idx] = itemp*itemp*xfactor[0]+jtemp*jtemp*xfactor[1]+ktemp*ktemp*xfactor[2];
+                }
+            }
+        }
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+//----------------- get_path -------------------
+std::vector<int> Rpa::get_path(std::map<int, std::vector<int>>& adjacent_nodes, int v, int u)
+{
+    // Breadth-first search from v
+    std::map<int, int> parent;
+    std::queue<int> queue;
+    parent[v] = v;
+    queue.push(v);
+    while(!queue.empty())
+    {
+        int node = queue.front();
+        queue.pop();
+        if (node == u)
+            break;
+        for(int adjacent_node: adjacent_nodes[node])
+        {
+            if (parent.find(adjacent_node) == parent.end())
+            {
+                parent[adjacent_node] = node;
+                queue.push(adjacent_node);
+            }
+        }
+    }
+    if (parent.find(u) == parent.end())
+        throw_with_line_number("There is no path between node " + std::to_string(v) + " and node " + std::to_string(u) + ".");
+
+    std::vector<int> path = {u};
+    while(path.back() != v)
+        path.push_back(parent[path.back()]);
+    std::reverse(path.begin(), path.end());
+    return path;
+}
+//----------------- get_correlation_functions -------------------
+void Rpa::get_correlation_functions(
+    Molecules *molecules, std::vector<std::string> monomer_types,
+    const double *k_square, int n_complex_grid, double *s_ij)
+{
+    try
+    {
+        const int S = monomer_types.size();
+        const double ds = molecules->get_ds();
+        const bool is_continuous = (molecules->get_model_name() == "continuous");
+        const std::map<std::string, double>& bond_lengths = molecules->get_bond_lengths();
+
+        // Index of each monomer type
+        std::map<std::string, int> monomer_index;
+        for(int i=0; i<S; i++)
+            monomer_index[monomer_types[i]] = i;
+        auto get_monomer_index = [&](const std::string& monomer_type) -> int
+        {
+            if (monomer_index.find(monomer_type) == monomer_index.end())
+                throw_with_line_number("Monomer type '" + monomer_type + "' is not in the list of monomer types.");
+            return monomer_index[monomer_type];
+        };
+
+        for(int i=0; i<S*S*n_complex_grid; i++)
+            s_ij[i] = 0.0;
+
+        for(int p=0; p<molecules->get_n_polymer_types(); p++)
+        {
+            Polymer& pc = molecules->get_polymer(p);
+            std::vector<Block>& blocks = pc.get_blocks();
+            const int n_blocks = blocks.size();
+            const double prefactor = pc.get_volume_fraction()/pc.get_alpha();
+
+            // For each block, correlation function within the block, integral of the propagator
+            // from one end of the block, and the propagator that passes through the block
+            std::vector<std::vector<double>> self(n_blocks), end(n_blocks), transfer(n_blocks);
+            for(int b=0; b<n_blocks; b++)
+            {
+                const int n = blocks[b].n_segment;
+                const double length = n*ds;
+                const double bond_length_sq = std::pow(bond_lengths.at(blocks[b].monomer_type), 2);
+                self[b].resize(n_complex_grid);
+                end[b].resize(n_complex_grid);
+                transfer[b].resize(n_complex_grid);
+                for(int k=0; k<n_complex_grid; k++)
+                {
+                    const double x = k_square[k]*bond_length_sq/6.0;
+                    transfer[b][k] = exp(-x*length);
+                    if (is_continuous)
+                    {
+                        // Debye function, and its Taylor expansion at small wavenumbers
+                        const double y = x*length;
+                        if (y < 1e-4)
+                        {
+                            self[b][k] = length*length*(1.0 - y/3.0 + y*y/12.0);
+                            end[b][k]  = length*(1.0 - y/2.0 + y*y/6.0);
+                        }
+                        else
+                        {
+                            self[b][k] = 2.0*(exp(-y) + y - 1.0)/(x*x);
+                            end[b][k]  = (1.0 - exp(-y))/x;
+                        }
+                    }
+                    else
+                    {
+                        // Sum over segments. Segments at the ends of the block are connected to the junctions by half bonds.
+                        const double g = exp(-x*ds);
+                        const double g_half = exp(-x*ds/2.0);
+                        double sum_self = n;
+                        double sum_end = 0.0;
+                        double g_d = 1.0;
+                        for(int d=1; d<n; d++)
+                        {
+                            sum_end += g_d;
+                            g_d *= g;
+                            sum_self += 2.0*(n-d)*g_d;
+                        }
+                        sum_end += g_d;
+                        self[b][k] = ds*ds*sum_self;
+                        end[b][k]  = ds*g_half*sum_end;
+                    }
+                }
+            }
+
+            // Add correlation functions between all pairs of blocks
+            std::map<int, std::vector<int>>& adjacent_nodes = pc.get_adjacent_nodes();
+            for(int a=0; a<n_blocks; a++)
+            {
+                const int i = get_monomer_index(blocks[a].monomer_type);
+                double *_s_ii = &s_ij[(i*S+i)*n_complex_grid];
+                for(int k=0; k<n_complex_grid; k++)
+                    _s_ii[k] += prefactor*self[a][k];
+
+                for(int b=a+1; b<n_blocks; b++)
+                {
+                    const int j = get_monomer_index(blocks[b].monomer_type);
+
+                    // Path between the nearest ends of the two blocks
+                    std::vector<int> path;
+                    for(int v_a : {blocks[a].v, blocks[a].u})
+                    {
+                        for(int v_b : {blocks[b].v, blocks[b].u})
+                        {
+                            std::vector<int> path_candidate = get_path(adjacent_nodes, v_a, v_b);
+                            if (path.empty() || path_candidate.size() < path.size())
+                                path = path_candidate;
+                        }
+                    }
+                    std::vector<double> c_ab(n_complex_grid);
+                    for(int k=0; k<n_complex_grid; k++)
+                        c_ab[k] = prefactor*end[a][k]*end[b][k];
+                    for(size_t n=0; n+1<path.size(); n++)
+                    {
+                        const int c = pc.get_block_index_from_edge(path[n], path[n+1]);
+                        for(int k=0; k<n_complex_grid; k++)
+                            c_ab[k] *= transfer[c][k];
+                    }
+
+                    double *_s_ij = &s_ij[(i*S+j)*n_complex_grid];
+                    double *_s_ji = &s_ij[(j*S+i)*n_complex_grid];
+                    for(int k=0; k<n_complex_grid; k++)
+                    {
+                        _s_ij[k] += c_ab[k];
+                        _s_ji[k] += c_ab[k];
+                    }
+                }
+            }
+        }
+
+        // Solvents are not correlated with other molecules
+        for(int s=0; s<molecules->get_n_solvent_types(); s++)
+        {
+            double volume_fraction = std::get<0>(molecules->get_solvent(s));
+            const int i = get_monomer_index(std::get<1>(molecules->get_solvent(s)));
+            double *_s_ii = &s_ij[(i*S+i)*n_complex_grid];
+            for(int k=0; k<n_complex_grid; k++)
+                _s_ii[k] += volume_fraction*ds;
+        }
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
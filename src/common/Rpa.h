@@ -0,0 +1,36 @@
+/*----------------------------------------------------------
+* This class contains static methods for the random phase approximation (RPA).
+* Correlation functions of ideal (non-interacting) chains are computed
+* for the chain model, block lengths, bond lengths and ds of 'Molecules'.
+*-----------------------------------------------------------*/
+
+#ifndef RPA_H_
+#define RPA_H_
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include "Exception.h"
+#include "ComputationBox.h"
+#include "Molecules.h"
+
+class Rpa
+{
+private:
+    // Nodes on the path between two nodes of a tree
+    static std::vector<int> get_path(std::map<int, std::vector<int>>& adjacent_nodes, int v, int u);
+public:
+    // k^2 of each wavevector of the real-to-complex FFT grid
+    static void get_k_square(
+        std::vector<BoundaryCondition> bc,
+        double *k_square, std::vector<int> nx, std::vector<double> dx);
+
+    // Correlation functions, S_ij(k), between monomer types i and j. For small perturbations of fields,
+    // the concentrations change by delta_phi_i(k) = -sum_j S_ij(k)*delta_w_j(k).
+    // S_ij(k) is stored at s_ij[(i*n_monomer_types+j)*n_complex_grid + k].
+    static void get_correlation_functions(
+        Molecules *molecules, std::vector<std::string> monomer_types,
+        const double *k_square, int n_complex_grid, double *s_ij);
+};
+#endif
@@ -0,0 +1,340 @@
+#include <iostream>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+
+#include "Exception.h"
+#include "ScftSolver.h"
+
+ScftSolver::ScftSolver(ComputationBox *cb, Molecules *molecules, PropagatorComputation *solver,
+    AndersonMixing *optimizer,
+    std::vector<std::string> monomer_types,
+    std::vector<std::vector<double>> matrix_chi,
+    std::vector<std::vector<double>> matrix_p,
+    bool box_is_altering, int max_iter, double tolerance,
+    double scale_stress, int verbose_level,
+    std::map<std::string, std::map<std::string, double>> random_fractions)
+{
+    try
+    {
+        const int S = monomer_types.size();
+        const int M = cb->get_n_grid();
+        if (matrix_chi.size() != static_cast<size_t>(S) || matrix_p.size() != static_cast<size_t>(S))
+            throw_with_line_number("The sizes of matrix_chi and matrix_p must be the number of monomer types (" + std::to_string(S) + ").");
+        for(int i=0; i<S; i++)
+        {
+            if (matrix_chi[i].size() != static_cast<size_t>(S) || matrix_p[i].size() != static_cast<size_t>(S))
+                throw_with_line_number("The sizes of matrix_chi and matrix_p must be the number of monomer types (" + std::to_string(S) + ").");
+        }
+        for(const auto& item : random_fractions)
+        {
+            for(const auto& fraction : item.second)
+            {
+                if (std::find(monomer_types.begin(), monomer_types.end(), fraction.first) == monomer_types.end())
+                    throw_with_line_number("Monomer type '" + fraction.first + "' of random copolymer '" + item.first + "' is not in the list of monomer types.");
+            }
+        }
+        const int n_var = S*M + (box_is_altering ? cb->get_dim() : 0);
+        if (optimizer->get_n_var() != n_var)
+            throw_with_line_number("The number of variables of the optimizer (" + std::to_string(optimizer->get_n_var()) + ") must be " + std::to_string(n_var) + ".");
+
+        this->cb = cb;
+        this->molecules = molecules;
+        this->solver = solver;
+        this->optimizer = optimizer;
+        this->monomer_types = monomer_types;
+        this->matrix_chi = matrix_chi;
+        this->matrix_p = matrix_p;
+        this->random_fractions = random_fractions;
+        this->box_is_altering = box_is_altering;
+        this->scale_stress = scale_stress;
+        this->max_iter = max_iter;
+        this->tolerance = tolerance;
+        this->verbose_level = verbose_level;
+
+        w.resize(n_var, 0.0);
+        w_diff.resize(n_var, 0.0);
+        w_new.resize(n_var, 0.0);
+        phi.resize(S*M, 0.0);
+        free_energy = 0.0;
+        error_level = 1.0e20;
+
+        // Eigenvalues and eigenvectors of P_0*chi*P_0 by the Jacobi eigenvalue algorithm
+        std::vector<std::vector<double>> a(S, std::vector<double>(S, 0.0));
+        std::vector<std::vector<double>> v(S, std::vector<double>(S, 0.0));
+        for(int i=0; i<S; i++)
+        {
+            v[i][i] = 1.0;
+            for(int j=0; j<S; j++)
+            {
+                double sum = 0.0;
+                for(int k=0; k<S; k++)
+                    for(int l=0; l<S; l++)
+                        sum += ((i == k ? 1.0 : 0.0) - 1.0/S)*matrix_chi[k][l]*((l == j ? 1.0 : 0.0) - 1.0/S);
+                a[i][j] = sum;
+            }
+        }
+        for(int sweep=0; sweep<100; sweep++)
+        {
+            double off_diagonal = 0.0;
+            for(int p=0; p<S; p++)
+                for(int q=p+1; q<S; q++)
+                    off_diagonal += a[p][q]*a[p][q];
+            if (off_diagonal < 1e-30)
+                break;
+            for(int p=0; p<S; p++)
+            {
+                for(int q=p+1; q<S; q++)
+                {
+                    if (a[p][q] == 0.0)
+                        continue;
+                    const double theta = (a[q][q]-a[p][p])/(2.0*a[p][q]);
+                    const double t = (theta >= 0.0 ? 1.0 : -1.0)/(std::abs(theta) + std::sqrt(theta*theta + 1.0));
+                    const double c = 1.0/std::sqrt(t*t + 1.0);
+                    const double s = t*c;
+                    for(int k=0; k<S; k++)
+                    {
+                        const double a_kp = a[k][p], a_kq = a[k][q];
+                        a[k][p] = c*a_kp - s*a_kq;
+                        a[k][q] = s*a_kp + c*a_kq;
+                    }
+                    for(int k=0; k<S; k++)
+                    {
+                        const double a_pk = a[p][k], a_qk = a[q][k];
+                        a[p][k] = c*a_pk - s*a_qk;
+                        a[q][k] = s*a_pk + c*a_qk;
+                    }
+                    for(int k=0; k<S; k++)
+                    {
+                        const double v_kp = v[k][p], v_kq = v[k][q];
+                        v[k][p] = c*v_kp - s*v_kq;
+                        v[k][q] = s*v_kp + c*v_kq;
+                    }
+                }
+            }
+        }
+        // Zero eigenvalues, including the one of [1, 1, ..., 1], are excluded as in 'SymmetricPolymerTheory'
+        matrix_h.assign(S, std::vector<double>(S, 0.0));
+        for(int n=0; n<S; n++)
+        {
+            if (std::abs(a[n][n]) < 1e-8)
+                continue;
+            for(int i=0; i<S; i++)
+                for(int j=0; j<S; j++)
+                    matrix_h[i][j] += v[i][n]*v[j][n]/a[n][n];
+        }
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+void ScftSolver::set_fields(const double *w_input)
+{
+    const int S = monomer_types.size();
+    const int M = cb->get_n_grid();
+    for(int i=0; i<S*M; i++)
+        w[i] = w_input[i];
+}
+void ScftSolver::get_fields(double *w_output)
+{
+    const int S = monomer_types.size();
+    const int M = cb->get_n_grid();
+    for(int i=0; i<S*M; i++)
+        w_output[i] = w[i];
+}
+void ScftSolver::get_concentrations(double *phi_output)
+{
+    const int S = monomer_types.size();
+    const int M = cb->get_n_grid();
+    for(int i=0; i<S*M; i++)
+        phi_output[i] = phi[i];
+}
+void ScftSolver::compute_concentrations()
+{
+    try
+    {
+        const int S = monomer_types.size();
+        const int M = cb->get_n_grid();
+
+        std::map<std::string, const double*> w_input;
+        for(int i=0; i<S; i++)
+            w_input[monomer_types[i]] = &w[i*M];
+
+        // Fields of random copolymers, w_R = sum_i f_Ri*w_i
+        std::vector<std::vector<double>> w_random;
+        w_random.reserve(random_fractions.size());
+        for(const auto& item : random_fractions)
+        {
+            w_random.push_back(std::vector<double>(M, 0.0));
+            for(const auto& fraction : item.second)
+            {
+                const double *_w = w_input[fraction.first];
+                for(int r=0; r<M; r++)
+                    w_random.back()[r] += fraction.second*_w[r];
+            }
+            w_input[item.first] = w_random.back().data();
+        }
+
+        solver->compute_propagators(w_input, {});
+        solver->compute_concentrations();
+        for(int i=0; i<S; i++)
+            solver->get_total_concentration(monomer_types[i], &phi[i*M]);
+
+        // Add concentrations of random copolymers to each monomer type
+        std::vector<double> phi_random(M);
+        for(const auto& item : random_fractions)
+        {
+            solver->get_total_concentration(item.first, phi_random.data());
+            for(const auto& fraction : item.second)
+            {
+                const int i = std::find(monomer_types.begin(), monomer_types.end(), fraction.first) - monomer_types.begin();
+                for(int r=0; r<M; r++)
+                    phi[i*M+r] += fraction.second*phi_random[r];
+            }
+        }
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+double ScftSolver::compute_hamiltonian()
+{
+    // Since the fields have zero means, the field part is -1/2*<w^T*(P_0*chi*P_0)^+*w>
+    const int S = monomer_types.size();
+    const int M = cb->get_n_grid();
+    double hamiltonian = 0.0;
+    for(int i=0; i<S; i++)
+        for(int j=0; j<S; j++)
+            if (matrix_h[i][j] != 0.0)
+                hamiltonian -= 0.5*matrix_h[i][j]*cb->inner_product(&w[i*M], &w[j*M])/cb->get_volume();
+
+    for(int p=0; p<molecules->get_n_polymer_types(); p++)
+    {
+        Polymer& pc = molecules->get_polymer(p);
+        hamiltonian -= pc.get_volume_fraction()/pc.get_alpha()*log(solver->get_total_partition(p));
+    }
+    return hamiltonian;
+}
+void ScftSolver::print_iteration(int iter, double mass_error)
+{
+    printf("%8d %12.3E  [ ", iter, mass_error);
+    for(int p=0; p<molecules->get_n_polymer_types(); p++)
+        printf("%13.7E  ", solver->get_total_partition(p));
+    printf("] %15.9f %15.7E ", free_energy, error_level);
+    if (box_is_altering)
+    {
+        std::vector<double> lx = cb->get_lx();
+        printf(" [");
+        for(size_t d=0; d<lx.size(); d++)
+            printf(d == 0 ? " %10.7f" : ",%10.7f", lx[d]);
+        printf(" ]");
+    }
+    printf("\n");
+    fflush(stdout);
+}
+int ScftSolver::run()
+{
+    try
+    {
+        const int S = monomer_types.size();
+        const int M = cb->get_n_grid();
+        const int DIM = cb->get_dim();
+        double old_error_level;
+        double mass_error = 0.0;
+        int iter;
+
+        optimizer->reset_count();
+        free_energy = 1.0e20;
+        error_level = 1.0e20;
+
+        // Keep the level of field value
+        for(int i=0; i<S; i++)
+            cb->zero_mean(&w[i*M]);
+
+        for(iter=1; iter<=max_iter; iter++)
+        {
+            compute_concentrations();
+            free_energy = compute_hamiltonian();
+
+            // w_diff_i = sum_j (chi_ij*phi_j - P_ij*w_j)
+            for(int i=0; i<S; i++)
+            {
+                double *_w_diff = &w_diff[i*M];
+                for(int r=0; r<M; r++)
+                    _w_diff[r] = 0.0;
+                for(int j=0; j<S; j++)
+                {
+                    const double chi_ij = matrix_chi[i][j];
+                    const double p_ij = matrix_p[i][j];
+                    const double *_phi = &phi[j*M];
+                    const double *_w = &w[j*M];
+                    for(int r=0; r<M; r++)
+                        _w_diff[r] += chi_ij*_phi[r] - p_ij*_w[r];
+                }
+                // Keep the level of functional derivatives
+                cb->zero_mean(_w_diff);
+            }
+
+            // error_level measures the "relative distance" between the input and output fields
+            old_error_level = error_level;
+            error_level = std::sqrt(cb->multi_inner_product(S, w_diff.data(), w_diff.data())/
+                                   (cb->multi_inner_product(S, w.data(), w.data()) + 1.0));
+
+            // Mass conservation
+            mass_error = -1.0;
+            for(int i=0; i<S; i++)
+                mass_error += cb->integral(&phi[i*M])/cb->get_volume();
+
+            if (box_is_altering)
+            {
+                solver->compute_stress();
+                std::vector<double> stress = solver->get_stress();
+                double stress_norm = 0.0;
+                for(int d=0; d<DIM; d++)
+                {
+                    stress_norm += stress[d]*stress[d];
+                    w[S*M+d] = cb->get_lx()[d];
+                    w_diff[S*M+d] = -scale_stress*stress[d];
+                }
+                error_level += std::sqrt(stress_norm);
+            }
+
+            if (verbose_level >= 2)
+                print_iteration(iter, mass_error);
+
+            // Conditions to end the iteration
+            if (error_level < tolerance)
+                break;
+
+            optimizer->calculate_new_fields(w_new.data(), w.data(), w_diff.data(), old_error_level, error_level);
+            for(int i=0; i<S*M; i++)
+                w[i] = w_new[i];
+
+            if (box_is_altering)
+            {
+                // Restricting |dLx| to be less than 10 % of Lx
+                std::vector<double> lx = cb->get_lx();
+                for(int d=0; d<DIM; d++)
+                {
+                    const double dlx = std::min(std::max((w_new[S*M+d] - lx[d])/lx[d], -0.1), 0.1);
+                    lx[d] *= 1.0 + dlx;
+                }
+                cb->set_lx(lx);
+                solver->update_laplacian_operator();
+            }
+
+            // Keep the level of field value
+            for(int i=0; i<S; i++)
+                cb->zero_mean(&w[i*M]);
+        }
+        if (verbose_level == 1)
+            print_iteration(std::min(iter, max_iter), mass_error);
+        return std::min(iter, max_iter);
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
@@ -0,0 +1,79 @@
+/*----------------------------------------------------------
+* This class runs SCFT iterations until the self-consistency error becomes less than the tolerance.
+* The fields, the field residuals and the box lengths are stored in C++ so that each call of 'run'
+* finds a saddle point without copying arrays between C++ and Python at every iteration.
+* The field residual is w_diff_i = sum_j (chi_ij*phi_j - P_ij*w_j), and the box lengths are
+* updated by the stress together with the fields if 'box_is_altering' is true.
+* Fields and concentrations are ordered as 'monomer_types', i.e., w[i*n_grid + r].
+* Random copolymers are treated as mixtures of monomer types using 'random_fractions'.
+*-----------------------------------------------------------*/
+
+#ifndef SCFT_SOLVER_H_
+#define SCFT_SOLVER_H_
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include "ComputationBox.h"
+#include "Molecules.h"
+#include "PropagatorComputation.h"
+#include "AndersonMixing.h"
+
+class ScftSolver
+{
+private:
+    ComputationBox *cb;
+    Molecules *molecules;
+    PropagatorComputation *solver;
+    // Field optimizer (not owned)
+    AndersonMixing *optimizer;
+
+    std::vector<std::string> monomer_types;
+    std::vector<std::vector<double>> matrix_chi, matrix_p;
+    // Pseudo-inverse of P_0*chi*P_0, where P_0 = I - 1*1^T/S, for the field part of the Hamiltonian
+    std::vector<std::vector<double>> matrix_h;
+    std::map<std::string, std::map<std::string, double>> random_fractions;
+
+    bool box_is_altering;
+    double scale_stress;
+    int max_iter;
+    double tolerance;
+    // 0: no output, 1: print the last iteration, 2: print every iteration
+    int verbose_level;
+
+    // Fields (followed by box lengths if box_is_altering), residuals, and new fields
+    std::vector<double> w, w_diff, w_new;
+    // Concentrations of monomer types
+    std::vector<double> phi;
+    // Results of the last run
+    double free_energy, error_level;
+
+    // Compute concentrations of monomer types for the current fields
+    void compute_concentrations();
+    // Hamiltonian of the current fields
+    double compute_hamiltonian();
+    void print_iteration(int iter, double mass_error);
+public:
+    ScftSolver(ComputationBox *cb, Molecules *molecules, PropagatorComputation *solver,
+        AndersonMixing *optimizer,
+        std::vector<std::string> monomer_types,
+        std::vector<std::vector<double>> matrix_chi,
+        std::vector<std::vector<double>> matrix_p,
+        bool box_is_altering, int max_iter, double tolerance,
+        double scale_stress=1.0, int verbose_level=2,
+        std::map<std::string, std::map<std::string, double>> random_fractions={});
+    ~ScftSolver(){};
+
+    std::vector<std::string> get_monomer_types(){ return monomer_types;};
+    int get_n_grid(){ return cb->get_n_grid();};
+    void set_fields(const double *w_input);
+    void get_fields(double *w_output);
+    void get_concentrations(double *phi_output);
+
+    // Run SCFT iterations from the current fields, and return the number of iterations
+    int run();
+    double get_free_energy(){ return free_energy;};
+    double get_error_level(){ return error_level;};
+};
+#endif
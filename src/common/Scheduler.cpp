@@ -5,60 +5,68 @@
 #include <cassert>
 #include <map>
 #include <set>
+#include <limits>
+#include <functional>
+#include <sstream>
 
 #include "Scheduler.h"
+#include "ComputationCache.h"
 
-Scheduler::Scheduler(std::map<std::string, ComputationEdge, ComparePropagatorKey> computation_propagators, const int N_STREAM)
+Scheduler::Scheduler(const std::map<std::string, ComputationEdge, ComparePropagatorKey>& computation_propagators, const int N_STREAM)
 {
     try
     {
+        index_propagators(computation_propagators);
+
+        // Load the schedule if it is cached
+        std::string signature, cache_file_name;
+        if (ComputationCache::is_enabled())
+        {
+            signature = get_signature(computation_propagators, {}, N_STREAM, -1);
+            cache_file_name = ComputationCache::get_file_name("schedule", signature);
+            if (load(cache_file_name, signature))
+                return;
+        }
+
         int min_stream, minimum_time;
-        int job_finish_time[N_STREAM] = {0,};
+        std::vector<int> job_finish_time(N_STREAM, 0);
 
-        std::vector<std::string> job_queue[N_STREAM];
-        auto propagator_hierarchies = make_propagator_hierarchies(computation_propagators);
+        std::vector<std::vector<int>> job_queue(N_STREAM);
+        auto propagator_hierarchies = make_propagator_hierarchies();
 
         // For height of propagator
         for(size_t current_height=0; current_height<propagator_hierarchies.size(); current_height++)
         {
             auto& same_height_propagators = propagator_hierarchies[current_height];
-            std::vector<std::tuple<std::string, int>> Key_resolved_time;
+            std::vector<std::tuple<int, int>> id_resolved_time;
             // Determine when propagator is ready to be computed, i.e., find dependencies resolved time.
             for(size_t i=0; i<same_height_propagators.size(); i++)
             {
-                const auto& key = same_height_propagators[i];
+                const int id = same_height_propagators[i];
                 int max_resolved_time = 0;
-                for(size_t j=0; j<computation_propagators[key].deps.size(); j++)
+                for(const auto& dep: deps[id])
                 {
-                    const auto& sub_key = std::get<0>(computation_propagators[key].deps[j]);
-                    int sub_n_segment = std::max(std::get<1>(computation_propagators[key].deps[j]),1); // add 1, if it is 0
+                    const int sub_id = std::get<0>(dep);
+                    int sub_n_segment = std::max(std::get<1>(dep),1); // add 1, if it is 0
                     #ifndef NDEBUG
-                    if (stream_start_finish.find(sub_key) == stream_start_finish.end())
-                        throw_with_line_number("Could not find [" + sub_key + "] in stream_start_finish.");
+                    if (!is_placed(sub_id))
+                        throw_with_line_number("Could not find [" + keys[sub_id] + "] in stream_start_finish.");
                     #endif
-                    int sub_resolved_time = std::get<1>(stream_start_finish[sub_key]) + sub_n_segment; 
+                    int sub_resolved_time = std::get<1>(stream_start_finish[sub_id]) + sub_n_segment; 
                     if (max_resolved_time == 0 || max_resolved_time < sub_resolved_time)
                         max_resolved_time = sub_resolved_time;
                 }
-                resolved_time[key] = max_resolved_time;
-                Key_resolved_time.push_back(std::make_tuple(key, max_resolved_time));
+                resolved_time[id] = max_resolved_time;
+                id_resolved_time.push_back(std::make_tuple(id, max_resolved_time));
             }
 
             // Sort propagators with time that they are ready
-            std::sort(Key_resolved_time.begin(), Key_resolved_time.end(),
+            std::sort(id_resolved_time.begin(), id_resolved_time.end(),
                 [](auto const &t1, auto const &t2) {return std::get<1>(t1) < std::get<1>(t2);}
             );
 
-            // for(int i=0; i<Key_resolved_time.size(); i++)
-            // {
-            //     const auto& key = std::get<0>(Key_resolved_time[i]);
-            //     std::cout << key << ":\n\t";
-            //     std::cout << "max_n_segment: " << computation_propagators[key].max_n_segment;
-            //     std::cout << ", max_resolved_time: " << resolved_time[key] << std::endl;
-            // }
-
             // Add job to compute propagators 
-            for(size_t i=0; i<Key_resolved_time.size(); i++)
+            for(size_t i=0; i<id_resolved_time.size(); i++)
             {
                 // Find index of stream that has minimum job_finish_time
                 min_stream = 0;
@@ -72,26 +80,406 @@ Scheduler::Scheduler(std::map<std::string, ComputationEdge, ComparePropagatorKey
                     }
                 }
                 // Add job at stream[min_stream]
-                const auto& key = std::get<0>(Key_resolved_time[i]);
-                int max_n_segment = std::max(computation_propagators[key].max_n_segment, 1); // if max_n_segment is 0, add 1
-                int job_start_time = std::max(job_finish_time[min_stream], resolved_time[key]);
-                // std::cout << key << ", " << min_stream << ", " << job_start_time << ", " << job_start_time+max_n_segment << std::endl;
-                stream_start_finish[key] = std::make_tuple(min_stream, job_start_time, job_start_time + max_n_segment);
+                const int id = std::get<0>(id_resolved_time[i]);
+                int max_n_segment = std::max(max_n_segments[id], 1); // if max_n_segment is 0, add 1
+                int job_start_time = std::max(job_finish_time[min_stream], resolved_time[id]);
+                stream_start_finish[id] = std::make_tuple(min_stream, job_start_time, job_start_time + max_n_segment);
                 job_finish_time[min_stream] = job_start_time + max_n_segment;
-                job_queue[min_stream].push_back(key);
+                job_queue[min_stream].push_back(id);
+            }
+        }
+
+        make_time_spans(job_queue, N_STREAM);
+        make_stream_jobs(job_queue);
+        update_keys_of_schedule();
+
+        // All propagators are stored during the computation
+        peak_live_segments = 0;
+        for(int max_n_segment: max_n_segments)
+            peak_live_segments += max_n_segment+1;
+
+        if (!cache_file_name.empty())
+            save(cache_file_name, signature);
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+Scheduler::Scheduler(
+    const std::map<std::string, ComputationEdge, ComparePropagatorKey>& computation_propagators,
+    const std::map<std::tuple<int, std::string, std::string>, ComputationBlock>& computation_blocks,
+    const int N_STREAM, const int max_live_segments)
+{
+    // Memory-aware scheduling. A propagator history is live from its starting time until
+    // every propagator that depends on it has started and every block that uses it is finished.
+    // Propagators are placed one by one so that the number of live segments does not exceed
+    // 'max_live_segments'. If no propagator can be placed within the budget, the one that
+    // gives the smallest peak is placed anyway, so that the computation never gets stuck.
+    // If the peak is still larger than that of the schedule without a budget, the latter is used.
+    try
+    {
+        std::map<std::string, int> propagator_ids = index_propagators(computation_propagators);
+
+        // Load the schedule if it is cached
+        std::string signature, cache_file_name;
+        if (ComputationCache::is_enabled())
+        {
+            signature = get_signature(computation_propagators, computation_blocks, N_STREAM, max_live_segments);
+            cache_file_name = ComputationCache::get_file_name("schedule", signature);
+            if (load(cache_file_name, signature))
+                return;
+        }
+
+        const int N_PROPAGATORS = keys.size();
+        const int INF_TIME = std::numeric_limits<int>::max();
+
+        // Consumers of each propagator
+        std::vector<std::vector<int>> dependents(N_PROPAGATORS);
+        std::vector<std::set<int>> block_partners(N_PROPAGATORS);
+        std::vector<std::tuple<int, int>> block_ids;  // IDs of key_left and key_right of each block
+        for(int id=0; id<N_PROPAGATORS; id++)
+        {
+            for(const auto& dep: deps[id])
+                dependents[std::get<0>(dep)].push_back(id);
+        }
+        for(const auto& item: computation_blocks)
+        {
+            const int id_left  = propagator_ids.at(std::get<1>(item.first));
+            const int id_right = propagator_ids.at(std::get<2>(item.first));
+            block_ids.push_back(std::make_tuple(id_left, id_right));
+            block_partners[id_left].insert(id_right);
+            block_partners[id_right].insert(id_left);
+        }
+
+        // Time when a propagator can be released. It is called only when all consumers are placed.
+        auto find_release_time = [&](const int id) -> int
+        {
+            int release_time = std::get<2>(stream_start_finish[id]);
+            for(int dependent: dependents[id])
+                release_time = std::max(release_time, std::get<1>(stream_start_finish[dependent])+1);
+            for(int partner: block_partners[id])
+                release_time = std::max(release_time, std::get<2>(stream_start_finish[partner]));
+            return release_time;
+        };
+
+        // Place propagators one by one within 'budget'. If 'budget' is 0, there is no bound.
+        auto place_propagators = [&](const int budget) -> std::vector<std::vector<int>>
+        {
+            std::vector<int> job_finish_time(N_STREAM, 0);
+            std::vector<std::vector<int>> job_queue(N_STREAM);
+            stream_start_finish.assign(N_PROPAGATORS, std::make_tuple(-1, 0, 0));
+            resolved_time.assign(N_PROPAGATORS, 0);
+
+            // Release time of each placed propagator (INF_TIME if it is not known yet), and
+            // the number of consumers (dependents and block partners) that are not placed yet
+            std::vector<int> release_times(N_PROPAGATORS, INF_TIME);
+            std::vector<int> n_unplaced_consumers(N_PROPAGATORS);
+            for(int id=0; id<N_PROPAGATORS; id++)
+                n_unplaced_consumers[id] = dependents[id].size() + block_partners[id].size();
+
+            // Live segments of placed propagators as a step function of time
+            std::map<int, int> live_segment_changes;
+
+            // Propagators that are not placed yet, sorted by keys
+            std::vector<int> remaining_ids;
+            for(int id=0; id<N_PROPAGATORS; id++)
+                remaining_ids.push_back(id);
+            std::sort(remaining_ids.begin(), remaining_ids.end(),
+                [this](int id_1, int id_2) {return keys[id_1] < keys[id_2];}
+            );
+
+            while(!remaining_ids.empty())
+            {
+                // Maximum of live segments after each change point
+                std::vector<std::tuple<int, int>> suffix_max_live;
+                int live = 0;
+                for(const auto& item: live_segment_changes)
+                {
+                    live += item.second;
+                    suffix_max_live.push_back(std::make_tuple(item.first, live));
+                }
+                for(int i=static_cast<int>(suffix_max_live.size())-2; i>=0; i--)
+                    std::get<1>(suffix_max_live[i]) = std::max(std::get<1>(suffix_max_live[i]), std::get<1>(suffix_max_live[i+1]));
+                int max_live = 0;
+                if (!suffix_max_live.empty())
+                    max_live = std::get<1>(suffix_max_live[0]);
+
+                // Find index of stream that has minimum job_finish_time
+                int min_stream = std::min_element(job_finish_time.begin(), job_finish_time.end()) - job_finish_time.begin();
+
+                int best_id = -1, fallback_id = -1;
+                int best_start_time = INF_TIME, best_released = -1;
+                int fallback_start_time = 0, fallback_peak = INF_TIME, fallback_released = -1;
+                for(int id: remaining_ids)
+                {
+                    // Check if all dependencies are already placed
+                    int max_resolved_time = 0;
+                    bool is_ready = true;
+                    for(const auto& dep: deps[id])
+                    {
+                        const int sub_id = std::get<0>(dep);
+                        if (!is_placed(sub_id))
+                        {
+                            is_ready = false;
+                            break;
+                        }
+                        int sub_n_segment = std::max(std::get<1>(dep),1); // add 1, if it is 0
+                        max_resolved_time = std::max(max_resolved_time, std::get<1>(stream_start_finish[sub_id]) + sub_n_segment);
+                    }
+                    if (!is_ready)
+                        continue;
+                    int n_segments = max_n_segments[id]+1;
+                    int earliest_time = std::max(job_finish_time[min_stream], max_resolved_time);
+
+                    // The number of segments that become releasable by placing this propagator
+                    std::map<int, int> n_consumers;
+                    for(const auto& dep: deps[id])
+                        n_consumers[std::get<0>(dep)]++;
+                    for(int partner: block_partners[id])
+                        n_consumers[partner]++;
+                    int n_released = 0;
+                    for(const auto& item: n_consumers)
+                    {
+                        const int sub_id = item.first;
+                        if (sub_id != id && is_placed(sub_id) && release_times[sub_id] == INF_TIME &&
+                            n_unplaced_consumers[sub_id] == item.second)
+                            n_released += max_n_segments[sub_id]+1;
+                    }
+
+                    // Index of the change point just before 'earliest_time'
+                    int i_start = -1;
+                    for(size_t i=0; i<suffix_max_live.size(); i++)
+                    {
+                        if (std::get<0>(suffix_max_live[i]) <= earliest_time)
+                            i_start = i;
+                    }
+
+                    // Find the earliest time that the propagator fits in the memory budget
+                    int start_time = INF_TIME;
+                    if (budget <= 0 || suffix_max_live.empty())
+                        start_time = earliest_time;
+                    else
+                    {
+                        for(int i=std::max(i_start,0); i<static_cast<int>(suffix_max_live.size()); i++)
+                        {
+                            if (std::get<1>(suffix_max_live[i]) + n_segments <= budget)
+                            {
+                                start_time = std::max(std::get<0>(suffix_max_live[i]), earliest_time);
+                                break;
+                            }
+                        }
+                    }
 
-                // for(int j=0; j<N_STREAM; j++)
-                // {
-                //     std::cout << "(" << j << ": " << job_finish_time[j] << "), ";
-                // }
-                // std::cout << std::endl;
+                    // Prefer early start, and then propagators that release memory
+                    if (start_time != INF_TIME &&
+                        (start_time < best_start_time || (start_time == best_start_time && n_released > best_released)))
+                    {
+                        best_id = id;
+                        best_start_time = start_time;
+                        best_released = n_released;
+                    }
+
+                    // Otherwise, prefer the smallest peak when it starts at 'earliest_time'
+                    int peak = max_live;
+                    if (!suffix_max_live.empty())
+                        peak = std::max(peak, std::get<1>(suffix_max_live[std::max(i_start,0)]) + n_segments);
+                    else
+                        peak = n_segments;
+                    if (peak < fallback_peak || (peak == fallback_peak && n_released > fallback_released))
+                    {
+                        fallback_id = id;
+                        fallback_start_time = earliest_time;
+                        fallback_peak = peak;
+                        fallback_released = n_released;
+                    }
+                }
+
+                // Exceed the budget if there is no other choice
+                if (best_id < 0)
+                {
+                    if (fallback_id < 0)
+                        throw_with_line_number("Could not find a propagator to be scheduled. Check dependencies of propagators.");
+                    best_id = fallback_id;
+                    best_start_time = fallback_start_time;
+                }
+
+                // Add job at stream[min_stream]
+                int max_n_segment = std::max(max_n_segments[best_id], 1); // if max_n_segment is 0, add 1
+                stream_start_finish[best_id] = std::make_tuple(min_stream, best_start_time, best_start_time + max_n_segment);
+                resolved_time[best_id] = best_start_time;
+                job_finish_time[min_stream] = best_start_time + max_n_segment;
+                job_queue[min_stream].push_back(best_id);
+                remaining_ids.erase(std::find(remaining_ids.begin(), remaining_ids.end(), best_id));
+                live_segment_changes[best_start_time] += max_n_segments[best_id]+1;
+
+                // Update release times of propagators whose consumers are all placed
+                std::vector<int> updated_ids = {best_id};
+                for(const auto& dep: deps[best_id])
+                {
+                    n_unplaced_consumers[std::get<0>(dep)]--;
+                    updated_ids.push_back(std::get<0>(dep));
+                }
+                for(int partner: block_partners[best_id])
+                {
+                    n_unplaced_consumers[partner]--;
+                    updated_ids.push_back(partner);
+                }
+                for(int id: updated_ids)
+                {
+                    if (is_placed(id) && release_times[id] == INF_TIME && n_unplaced_consumers[id] == 0)
+                    {
+                        release_times[id] = find_release_time(id);
+                        live_segment_changes[release_times[id]] -= max_n_segments[id]+1;
+                    }
+                }
+            }
+            return job_queue;
+        };
+
+        std::vector<std::vector<int>> job_queue = place_propagators(max_live_segments);
+        make_time_spans(job_queue, N_STREAM);
+        make_release_schedule(computation_blocks, block_ids, dependents, block_partners);
+
+        // The budget must not make the peak larger than the schedule without a budget
+        if (max_live_segments > 0)
+        {
+            std::vector<std::tuple<int, int, int>> budget_stream_start_finish = stream_start_finish;
+            std::vector<int> budget_resolved_time = resolved_time;
+            int budget_peak_live_segments = peak_live_segments;
+
+            std::vector<std::vector<int>> job_queue_unbounded = place_propagators(0);
+            make_time_spans(job_queue_unbounded, N_STREAM);
+            make_release_schedule(computation_blocks, block_ids, dependents, block_partners);
+            if (peak_live_segments < budget_peak_live_segments)
+                job_queue = job_queue_unbounded;
+            else
+            {
+                stream_start_finish = budget_stream_start_finish;
+                resolved_time = budget_resolved_time;
+                make_time_spans(job_queue, N_STREAM);
+                make_release_schedule(computation_blocks, block_ids, dependents, block_partners);
             }
+        }
+        make_stream_jobs(job_queue);
+        update_keys_of_schedule();
 
+        if (!cache_file_name.empty())
+            save(cache_file_name, signature);
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+std::map<std::string, int> Scheduler::index_propagators(
+    const std::map<std::string, ComputationEdge, ComparePropagatorKey>& computation_propagators)
+{
+    // ID of propagator is its position in 'computation_propagators'
+    std::map<std::string, int> propagator_ids;
+    for(const auto& item: computation_propagators)
+    {
+        propagator_ids[item.first] = keys.size();
+        keys.push_back(item.first);
+        max_n_segments.push_back(item.second.max_n_segment);
+        heights.push_back(item.second.height);
+    }
+    for(const auto& item: computation_propagators)
+    {
+        std::vector<std::tuple<int, int>> sub_deps;
+        for(const auto& dep: item.second.deps)
+        {
+            if (propagator_ids.find(std::get<0>(dep)) == propagator_ids.end())
+                throw_with_line_number("Could not find the dependency [" + std::get<0>(dep) + "] of [" + item.first + "].");
+            sub_deps.push_back(std::make_tuple(propagator_ids[std::get<0>(dep)], std::get<1>(dep)));
         }
+        deps.push_back(sub_deps);
+    }
+    stream_start_finish.assign(keys.size(), std::make_tuple(-1, 0, 0));
+    resolved_time.assign(keys.size(), 0);
+    return propagator_ids;
+}
+bool Scheduler::is_placed(int id) const
+{
+    return std::get<0>(stream_start_finish[id]) >= 0;
+}
+std::string Scheduler::get_signature(
+    const std::map<std::string, ComputationEdge, ComparePropagatorKey>& computation_propagators,
+    const std::map<std::tuple<int, std::string, std::string>, ComputationBlock>& computation_blocks,
+    const int N_STREAM, const int max_live_segments)
+{
+    // Propagators and options that determine the schedule
+    std::stringstream ss;
+    ss << "streams: " << N_STREAM << ", max_live_segments: " << max_live_segments << "\n";
+    for(const auto& item: computation_propagators)
+        ss << item.first << ", " << item.second.max_n_segment << "\n";
+    for(const auto& item: computation_blocks)
+        ss << std::get<0>(item.first) << ", " << std::get<1>(item.first) << ", " << std::get<2>(item.first) << "\n";
+    return ss.str();
+}
+bool Scheduler::load(const std::string& file_name, const std::string& signature)
+{
+    std::ifstream in;
+    if (!ComputationCache::open(in, file_name, signature))
+        return false;
+
+    ComputationCache::read(in, stream_start_finish);
+    ComputationCache::read(in, resolved_time);
+    ComputationCache::read(in, sorted_propagator_with_start_time);
+    ComputationCache::read(in, time_stamp);
+    ComputationCache::read(in, schedule_ids);
+    ComputationCache::read(in, stream_job_queues);
+    ComputationCache::read(in, checkpoints);
+    ComputationCache::read(in, finished_blocks);
+    ComputationCache::read(in, released_propagator_ids);
+    ComputationCache::read(in, peak_live_segments);
 
+    // Discard the partially loaded schedule
+    if (!in || stream_start_finish.size() != keys.size())
+    {
+        stream_start_finish.assign(keys.size(), std::make_tuple(-1, 0, 0));
+        resolved_time.assign(keys.size(), 0);
+        sorted_propagator_with_start_time.clear();
+        time_stamp.clear();
+        schedule_ids.clear();
+        stream_job_queues.clear();
+        checkpoints.clear();
+        finished_blocks.clear();
+        released_propagator_ids.clear();
+        return false;
+    }
+    update_keys_of_schedule();
+    #ifndef NDEBUG
+    std::cout << "Schedule is loaded from '" << file_name << "'." << std::endl;
+    #endif
+    return true;
+}
+void Scheduler::save(const std::string& file_name, const std::string& signature)
+{
+    ComputationCache::save(file_name, signature, [this](std::ostream& out)
+    {
+        ComputationCache::write(out, stream_start_finish);
+        ComputationCache::write(out, resolved_time);
+        ComputationCache::write(out, sorted_propagator_with_start_time);
+        ComputationCache::write(out, time_stamp);
+        ComputationCache::write(out, schedule_ids);
+        ComputationCache::write(out, stream_job_queues);
+        ComputationCache::write(out, checkpoints);
+        ComputationCache::write(out, finished_blocks);
+        ComputationCache::write(out, released_propagator_ids);
+        ComputationCache::write(out, peak_live_segments);
+    });
+}
+void Scheduler::make_time_spans(std::vector<std::vector<int>>& job_queue, const int N_STREAM)
+{
+    try
+    {
         // Sort propagators with starting time
-        for(const auto& item : stream_start_finish)
-            sorted_propagator_with_start_time.push_back(std::make_tuple(item.first, std::get<1>(item.second)));
+        sorted_propagator_with_start_time.clear();
+        time_stamp.clear();
+        schedule_ids.clear();
+        for(size_t id=0; id<stream_start_finish.size(); id++)
+            sorted_propagator_with_start_time.push_back(std::make_tuple(id, std::get<1>(stream_start_finish[id])));
         std::sort(sorted_propagator_with_start_time.begin(), sorted_propagator_with_start_time.end(),
             [](auto const &t1, auto const &t2) {return std::get<1>(t1) < std::get<1>(t2);}
         );
@@ -100,43 +488,23 @@ Scheduler::Scheduler(std::map<std::string, ComputationEdge, ComparePropagatorKey
         std::set<int, std::less<int>> time_stamp_set;
         for(size_t i=0; i<sorted_propagator_with_start_time.size(); i++)
         {
-            auto& key = std::get<0>(sorted_propagator_with_start_time[i]);
+            const int id = std::get<0>(sorted_propagator_with_start_time[i]);
             int start_time = std::get<1>(sorted_propagator_with_start_time[i]);
-            int finish_time = start_time + std::max(computation_propagators[key].max_n_segment, 1); // if max_n_segment is 0, add 1
-            // std::cout << key << ":\n\t";
-            // std::cout << "max_n_segment: " << computation_propagators[key].max_n_segment;
-            // std::cout << ", start_time: " << start_time;
-            // std::cout << ", finish_time: " << finish_time << std::endl;
+            int finish_time = start_time + std::max(max_n_segments[id], 1); // if max_n_segment is 0, add 1
             time_stamp_set.insert(start_time);
             time_stamp_set.insert(finish_time);
         }
         std::copy(time_stamp_set.begin(), time_stamp_set.end(), std::back_inserter(time_stamp));
 
-        // for(int i=0; i<time_stamp.size()-1; i++)
-        // {
-        //     std::cout << "time_stamp" << i << ", " << time_stamp[i] << std::endl;
-        // }
-
-        // // scheduling
-        // for(int s=0; s<N_STREAM; s++)
-        // {         
-        //     for(int i=0; i<job_queue[s].size()-1; i++)
-        //     {
-        //        std::cout << job_queue[s][i] << std::endl;
-        //     }
-        //     std::cout << std::endl;
-        // }
-
         // For each stream, make iterator
-        std::vector<std::string>::iterator iters[N_STREAM];
+        std::vector<std::vector<int>::iterator> iters(N_STREAM);
         for(int s=0; s<N_STREAM; s++)
             iters[s] = job_queue[s].begin();
 
         // For each time stamp
         for(size_t i=0; i<time_stamp.size()-1; i++)
         {
-            // std::cout << time_stamp[i]+1 << ", " << time_stamp[i+1] << std::endl;
-            std::vector<std::tuple<std::string, int, int>> parallel_job;
+            std::vector<std::tuple<int, int, int>> parallel_job;
 
             // For each stream
             for(int s=0; s<N_STREAM; s++)
@@ -152,18 +520,16 @@ Scheduler::Scheduler(std::map<std::string, ComputationEdge, ComparePropagatorKey
                 // If iters[s] (propagator iter) is not the end of job_queue
                 if(iters[s] != job_queue[s].end())
                 {
-                    // std::cout << "\t*iters[s] " << *iters[s] << std::endl;
-                    // std::cout << "\ttime_stamp " << time_stamp[i] << ", " << time_stamp[i+1] << std::endl;
-                    // std::cout << "\tstream_start_finish " << std::get<1>(stream_start_finish[*iters[s]]) << ", " << std::get<2>(stream_start_finish[*iters[s]]) << std::endl;
+                    const int id = *iters[s];
 
                     // If the time span is in between starting time to finishing time, add propagator job to the parallel_job
-                    if( time_stamp[i] >= std::get<1>(stream_start_finish[*iters[s]]) 
-                        && time_stamp[i+1] <= std::get<2>(stream_start_finish[*iters[s]]))
+                    if( time_stamp[i] >= std::get<1>(stream_start_finish[id]) 
+                        && time_stamp[i+1] <= std::get<2>(stream_start_finish[id]))
                     {
                         int n_segment_from, n_segment_to;
 
                         // If max_n_segment is 0, skip propagator iterations 
-                        if(computation_propagators[*iters[s]].max_n_segment == 0)
+                        if(max_n_segments[id] == 0)
                         {
                             n_segment_from = 0;
                             n_segment_to = 0;
@@ -171,80 +537,285 @@ Scheduler::Scheduler(std::map<std::string, ComputationEdge, ComparePropagatorKey
                         // Set range of n_segment to be computed
                         else
                         {
-                            n_segment_from = time_stamp[i]-std::get<1>(stream_start_finish[*iters[s]]);
-                            n_segment_to = time_stamp[i+1]-std::get<1>(stream_start_finish[*iters[s]]);
+                            n_segment_from = time_stamp[i]-std::get<1>(stream_start_finish[id]);
+                            n_segment_to = time_stamp[i+1]-std::get<1>(stream_start_finish[id]);
                         }
-
-                        // std::cout << "\t\t" << *iters[s] << ": " << n_segment_from << ", " << n_segment_to << std::endl;
-                        parallel_job.push_back(std::make_tuple(*iters[s], n_segment_from, n_segment_to));
+                        parallel_job.push_back(std::make_tuple(id, n_segment_from, n_segment_to));
                     }
                 }
             }
-            schedule.push_back(parallel_job);
+            schedule_ids.push_back(parallel_job);
+        }
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+void Scheduler::make_release_schedule(
+    const std::map<std::tuple<int, std::string, std::string>, ComputationBlock>& computation_blocks,
+    const std::vector<std::tuple<int, int>>& block_ids,
+    std::vector<std::vector<int>>& dependents,
+    std::vector<std::set<int>>& block_partners)
+{
+    try
+    {
+        const int N_SPANS = schedule_ids.size();
+        std::map<int, int> span_starting_at;
+        for(int i=0; i<N_SPANS; i++)
+            span_starting_at[time_stamp[i]] = i;
+        std::map<int, int> span_finishing_at;
+        for(int i=0; i<N_SPANS; i++)
+            span_finishing_at[time_stamp[i+1]] = i;
+
+        finished_blocks.assign(N_SPANS, {});
+        released_propagator_ids.assign(N_SPANS, {});
+
+        // A block can be computed after both propagators are finished
+        size_t b = 0;
+        for(const auto& item: computation_blocks)
+        {
+            const int id_left  = std::get<0>(block_ids[b]);
+            const int id_right = std::get<1>(block_ids[b]);
+            int finish_time = std::max(std::get<2>(stream_start_finish[id_left]), std::get<2>(stream_start_finish[id_right]));
+            finished_blocks[span_finishing_at[finish_time]].push_back(item.first);
+            b++;
+        }
+
+        // A propagator can be released after all consumers are done
+        std::vector<int> live_segments(N_SPANS, 0);
+        for(size_t id=0; id<keys.size(); id++)
+        {
+            int release_span = span_finishing_at[std::get<2>(stream_start_finish[id])];
+            for(int dependent: dependents[id])
+                release_span = std::max(release_span, span_starting_at[std::get<1>(stream_start_finish[dependent])]);
+            for(int partner: block_partners[id])
+                release_span = std::max(release_span, span_finishing_at[std::get<2>(stream_start_finish[partner])]);
+            released_propagator_ids[release_span].push_back(id);
+
+            for(int i=span_starting_at[std::get<1>(stream_start_finish[id])]; i<=release_span; i++)
+                live_segments[i] += max_n_segments[id]+1;
         }
+        peak_live_segments = 0;
+        for(int i=0; i<N_SPANS; i++)
+            peak_live_segments = std::max(peak_live_segments, live_segments[i]);
     }
     catch(std::exception& exc)
     {
         throw_without_line_number(exc.what());
     }
 }
-std::vector<std::vector<std::string>> Scheduler::make_propagator_hierarchies(
-    std::map<std::string, ComputationEdge, ComparePropagatorKey> computation_propagators)
+void Scheduler::make_stream_jobs(std::vector<std::vector<int>>& job_queue)
+{
+    stream_job_queues = job_queue;
+
+    // Segment numbers that dependents wait for, and the last segment.
+    // As in the scheduling, a dependency on the 0th segment is resolved after the first step.
+    std::vector<std::set<int>> segment_set(keys.size());
+    for(size_t id=0; id<keys.size(); id++)
+    {
+        segment_set[id].insert(max_n_segments[id]);
+        for(const auto& dep: deps[id])
+        {
+            const int sub_id = std::get<0>(dep);
+            int sub_n_segment = std::min(std::max(std::get<1>(dep), 1), max_n_segments[sub_id]);
+            segment_set[sub_id].insert(sub_n_segment);
+        }
+    }
+    checkpoints.resize(segment_set.size());
+    for(size_t i=0; i<segment_set.size(); i++)
+        checkpoints[i] = std::vector<int>(segment_set[i].begin(), segment_set[i].end());
+}
+void Scheduler::update_keys_of_schedule()
+{
+    schedule.clear();
+    for(const auto& parallel_job: schedule_ids)
+    {
+        schedule.push_back({});
+        for(const auto& job: parallel_job)
+            schedule.back().push_back(std::make_tuple(keys[std::get<0>(job)], std::get<1>(job), std::get<2>(job)));
+    }
+    released_propagators.clear();
+    for(const auto& released: released_propagator_ids)
+    {
+        released_propagators.push_back({});
+        for(int id: released)
+            released_propagators.back().push_back(keys[id]);
+    }
+}
+void Scheduler::coarsen_schedule(const double barrier_cost)
 {
     try
     {
-        std::vector<std::vector<std::string>> propagator_hierarchies;
-        int current_height = 0;
-        std::vector<std::string> same_height_propagators; // key
-        std::vector<std::string> remaining_branches;
+        const int N_SPANS = schedule_ids.size();
+        const int N_STREAM = stream_job_queues.size();
+        const int N_PROPAGATORS = keys.size();
+        const bool has_release_schedule = !released_propagator_ids.empty();
+        if (N_SPANS <= 1)
+            return;
 
-        for(const auto& item : computation_propagators)
-            remaining_branches.push_back(item.first);
+        // The last segment of propagator that is computed before 'time'. -1 if nothing is computed.
+        auto computed_segment_at = [&](const int id, int time) -> int
+        {
+            int start_time = std::get<1>(stream_start_finish[id]);
+            if (time <= start_time)
+                return -1;
+            return std::min(time-start_time, max_n_segments[id]);
+        };
 
-        while(!remaining_branches.empty())
+        // Estimated duration of parallel jobs when the longest job is assigned first to the least loaded stream
+        auto estimate_duration = [N_STREAM](const std::vector<std::tuple<int, int, int>>& parallel_job) -> int
         {
-            same_height_propagators.clear();
-            for(size_t i=0; i<remaining_branches.size(); i++)
+            std::vector<int> n_steps;
+            for(const auto& job: parallel_job)
+                n_steps.push_back(std::max(std::get<2>(job)-std::get<1>(job), 1));
+            std::sort(n_steps.begin(), n_steps.end(), std::greater<int>());
+            std::vector<int> load(N_STREAM, 0);
+            for(int n: n_steps)
+                *std::min_element(load.begin(), load.end()) += n;
+            return *std::max_element(load.begin(), load.end());
+        };
+
+        // Merge jobs of two time spans. Segment ranges of the same propagator are concatenated.
+        auto merge_jobs = [](
+            const std::vector<std::tuple<int, int, int>>& parallel_job_1,
+            const std::vector<std::tuple<int, int, int>>& parallel_job_2)
+        {
+            std::vector<std::tuple<int, int, int>> merged = parallel_job_1;
+            for(const auto& job: parallel_job_2)
+            {
+                auto it = std::find_if(merged.begin(), merged.end(),
+                    [&job](auto const &t) {return std::get<0>(t) == std::get<0>(job);});
+                if (it == merged.end())
+                    merged.push_back(job);
+                else
+                    std::get<2>(*it) = std::get<2>(job);
+            }
+            return merged;
+        };
+
+        // Time spans where propagators start and are released
+        std::vector<int> start_span(N_PROPAGATORS, 0), release_span(N_PROPAGATORS, 0);
+        for(int i=0; i<N_SPANS; i++)
+        {
+            for(const auto& job: schedule_ids[i])
             {
-                if (current_height == PropagatorCode::get_height_from_key(remaining_branches[i]))
-                    same_height_propagators.push_back(remaining_branches[i]);
+                if (std::get<1>(job) == 0)
+                    start_span[std::get<0>(job)] = i;
             }
-            if (!same_height_propagators.empty())
+            if (has_release_schedule)
             {
-                for(size_t i=0; i<same_height_propagators.size(); i++)
-                    remaining_branches.erase(std::remove(remaining_branches.begin(), remaining_branches.end(), same_height_propagators[i]), remaining_branches.end());
-                propagator_hierarchies.push_back(same_height_propagators);
+                for(int id: released_propagator_ids[i])
+                    release_span[id] = i;
             }
-            current_height++;
         }
 
-        // for(int i=0; i<propagator_hierarchies.size(); i++)
-        // {
-        //     std::cout << "Height:" << i << std::endl;
-        //     for(const auto &item: propagator_hierarchies[i])
-        //         std::cout << item << ": " << PropagatorCode::get_height_from_key(item) << std::endl;
-        // }
-
-        // for(const auto& item: computation_propagators)
-        // {
-        //     auto& key = item.first;
-
-        //     int max_n_segment = item.second.max_n_segment;
-        //     //int monomer_type = item.second.monomer_type;
-        //     int height = item.second.height;
-        //     auto& deps = item.second.deps;
-
-        //     if (current_height < height)
-        //     {
-        //         propagator_hierarchies.push_back(same_height_propagators);
-        //         same_height_propagators.clear();
-        //         current_height = height;
-        //     }
-        //     same_height_propagators.push_back(key);
-        // }
-
-        // propagator_hierarchies.push_back(same_height_propagators);
-        // same_height_propagators.clear();
+        std::vector<int> new_time_stamp = {time_stamp[0]};
+        std::vector<std::vector<std::tuple<int, int, int>>> new_schedule;
+        std::vector<std::vector<std::tuple<int, std::string, std::string>>> new_finished_blocks;
+        std::vector<std::vector<int>> new_released_propagator_ids;
+
+        int group_first = 0;
+        auto group_jobs = schedule_ids[0];
+        int group_duration = time_stamp[1]-time_stamp[0];
+        auto close_group = [&](int group_last)
+        {
+            std::sort(group_jobs.begin(), group_jobs.end(),
+                [](auto const &t1, auto const &t2) {return std::get<2>(t1)-std::get<1>(t1) > std::get<2>(t2)-std::get<1>(t2);}
+            );
+            new_schedule.push_back(group_jobs);
+            new_time_stamp.push_back(time_stamp[group_last+1]);
+            if (has_release_schedule)
+            {
+                new_finished_blocks.push_back({});
+                new_released_propagator_ids.push_back({});
+                for(int i=group_first; i<=group_last; i++)
+                {
+                    new_finished_blocks.back().insert(new_finished_blocks.back().end(), finished_blocks[i].begin(), finished_blocks[i].end());
+                    new_released_propagator_ids.back().insert(new_released_propagator_ids.back().end(), released_propagator_ids[i].begin(), released_propagator_ids[i].end());
+                }
+            }
+        };
+
+        for(int i=1; i<N_SPANS; i++)
+        {
+            // Propagators starting in this time span must not depend on segments computed in the current group
+            bool is_mergeable = true;
+            for(const auto& job: schedule_ids[i])
+            {
+                if (std::get<1>(job) != 0)
+                    continue;
+                for(const auto& dep: deps[std::get<0>(job)])
+                {
+                    if (computed_segment_at(std::get<0>(dep), time_stamp[group_first]) < std::get<1>(dep))
+                        is_mergeable = false;
+                }
+            }
+
+            // Propagators are released at the end of the group, so the number of live segments must not exceed the peak
+            if (is_mergeable && has_release_schedule)
+            {
+                int live_segments = 0;
+                for(int id=0; id<N_PROPAGATORS; id++)
+                {
+                    if (start_span[id] <= i && release_span[id] >= group_first)
+                        live_segments += max_n_segments[id]+1;
+                }
+                if (live_segments > peak_live_segments)
+                    is_mergeable = false;
+            }
+
+            if (is_mergeable)
+            {
+                auto merged_jobs = merge_jobs(group_jobs, schedule_ids[i]);
+                int merged_duration = estimate_duration(merged_jobs);
+                int additional_idle_time = merged_duration - (group_duration + time_stamp[i+1]-time_stamp[i]);
+                if (additional_idle_time <= barrier_cost)
+                {
+                    group_jobs = merged_jobs;
+                    group_duration = merged_duration;
+                    continue;
+                }
+            }
+
+            close_group(i-1);
+            group_first = i;
+            group_jobs = schedule_ids[i];
+            group_duration = time_stamp[i+1]-time_stamp[i];
+        }
+        close_group(N_SPANS-1);
+
+        schedule_ids = new_schedule;
+        time_stamp = new_time_stamp;
+        if (has_release_schedule)
+        {
+            finished_blocks = new_finished_blocks;
+            released_propagator_ids = new_released_propagator_ids;
+        }
+        update_keys_of_schedule();
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+std::vector<std::vector<int>> Scheduler::make_propagator_hierarchies()
+{
+    try
+    {
+        std::vector<std::vector<int>> propagator_hierarchies;
+        int current_height = -1;
+
+        // IDs are sorted by height
+        for(size_t id=0; id<heights.size(); id++)
+        {
+            if (heights[id] != current_height)
+            {
+                propagator_hierarchies.push_back({});
+                current_height = heights[id];
+            }
+            propagator_hierarchies.back().push_back(id);
+        }
         return propagator_hierarchies;
     }
     catch(std::exception& exc)
@@ -256,15 +827,91 @@ std::vector<std::vector<std::tuple<std::string, int, int>>>& Scheduler::get_sche
 {
     return schedule;
 }
-void Scheduler::display(std::map<std::string, ComputationEdge, ComparePropagatorKey> computation_propagators)
+std::vector<std::vector<std::tuple<int, int, int>>>& Scheduler::get_schedule_ids()
+{
+    return schedule_ids;
+}
+std::vector<std::vector<int>>& Scheduler::get_stream_job_queues()
+{
+    return stream_job_queues;
+}
+std::vector<std::vector<int>>& Scheduler::get_checkpoints()
+{
+    return checkpoints;
+}
+int Scheduler::get_planned_makespan()
+{
+    return time_stamp.empty() ? 0 : time_stamp.back();
+}
+std::vector<std::tuple<std::string, int, int>> Scheduler::get_critical_path()
+{
+    try
+    {
+        // Earliest starting time of each propagator. IDs are sorted by height, so dependencies come first.
+        const int N_PROPAGATORS = keys.size();
+        std::vector<int> earliest_start(N_PROPAGATORS, 0);
+        std::vector<int> critical_dep(N_PROPAGATORS, -1);
+        int last_id = -1;
+        int last_finish_time = -1;
+        for(int id=0; id<N_PROPAGATORS; id++)
+        {
+            for(const auto& dep: deps[id])
+            {
+                const int sub_id = std::get<0>(dep);
+                int sub_resolved_time = earliest_start[sub_id] + std::max(std::get<1>(dep),1);
+                if (sub_resolved_time > earliest_start[id])
+                {
+                    earliest_start[id] = sub_resolved_time;
+                    critical_dep[id] = sub_id;
+                }
+            }
+            int finish_time = earliest_start[id] + std::max(max_n_segments[id], 1);
+            if (finish_time > last_finish_time)
+            {
+                last_finish_time = finish_time;
+                last_id = id;
+            }
+        }
+
+        // Trace back the dependencies
+        std::vector<std::tuple<std::string, int, int>> critical_path;
+        for(int id=last_id; id >= 0; id=critical_dep[id])
+        {
+            critical_path.insert(critical_path.begin(), std::make_tuple(keys[id], earliest_start[id],
+                earliest_start[id] + std::max(max_n_segments[id], 1)));
+        }
+        return critical_path;
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+std::vector<std::vector<std::tuple<int, std::string, std::string>>>& Scheduler::get_finished_blocks()
+{
+    return finished_blocks;
+}
+std::vector<std::vector<std::string>>& Scheduler::get_released_propagators()
+{
+    return released_propagators;
+}
+std::vector<std::vector<int>>& Scheduler::get_released_propagator_ids()
+{
+    return released_propagator_ids;
+}
+int Scheduler::get_peak_live_segments()
+{
+    return peak_live_segments;
+}
+void Scheduler::display()
 {
     for(size_t i=0; i<sorted_propagator_with_start_time.size(); i++)
     {
-        auto& key = std::get<0>(sorted_propagator_with_start_time[i]);
+        const int id = std::get<0>(sorted_propagator_with_start_time[i]);
         int start_time = std::get<1>(sorted_propagator_with_start_time[i]);
-        int finish_time = start_time + computation_propagators[key].max_n_segment;
-        std::cout << key << ":\n\t";
-        std::cout << "max_n_segment: " << computation_propagators[key].max_n_segment;
+        int finish_time = start_time + max_n_segments[id];
+        std::cout << keys[id] << ":\n\t";
+        std::cout << "max_n_segment: " << max_n_segments[id];
         std::cout << ", start_time: " << start_time;
         std::cout << ", finish_time: " << finish_time << std::endl;
     }
@@ -275,6 +922,11 @@ void Scheduler::display(std::map<std::string, ComputationEdge, ComparePropagator
         auto& parallel_job = schedule[i];
         for(size_t j=0; j<parallel_job.size(); j++)
             std::cout << "\t" << std::get<0>(parallel_job[j]) << ": " <<  std::get<1>(parallel_job[j]) << ", " <<  std::get<2>(parallel_job[j]) << std::endl;
+        if (i < released_propagators.size())
+        {
+            for(size_t j=0; j<released_propagators[i].size(); j++)
+                std::cout << "\treleased: " << released_propagators[i][j] << std::endl;
+        }
     }
+    std::cout << "Peak number of live segments: " << peak_live_segments << std::endl;
 }
-
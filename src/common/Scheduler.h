@@ -8,6 +8,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <set>
 
 #include "Exception.h"
 #include "Molecules.h"
@@ -16,22 +17,87 @@
 class Scheduler
 {
 private:
+    // Propagators are identified by their positions in 'computation_propagators' (see PropagatorAnalyzer::get_propagator_id).
+    // Keys are used only for the schedule that is exposed with keys.
+    std::vector<std::string> keys;                          // key of each propagator
+    std::vector<int> max_n_segments;                        // max_n_segment of each propagator
+    std::vector<int> heights;                               // height of each propagator
+    std::vector<std::vector<std::tuple<int, int>>> deps;    // (ID, n_segment) of dependencies of each propagator
 
     // Variables
-    std::map<std::string, std::tuple<int, int, int>, ComparePropagatorKey> stream_start_finish; //stream_number, starting time, finishing time
-    std::map<std::string, int> resolved_time; // when dependencies are resolved, e.g., when propagator is ready to be computed
-    std::vector<std::tuple<std::string, int>> sorted_propagator_with_start_time;  // computation starting time for each propagator
+    std::vector<std::tuple<int, int, int>> stream_start_finish; //stream_number, starting time, finishing time. stream_number is -1 if it is not placed yet.
+    std::vector<int> resolved_time; // when dependencies are resolved, e.g., when propagator is ready to be computed
+    std::vector<std::tuple<int, int>> sorted_propagator_with_start_time;  // computation starting time for each propagator
     std::vector<int> time_stamp; // times that new jobs are joined or jobs are finished.
-    std::vector<std::vector<std::tuple<std::string, int, int>>> schedule;   // job schedule for each time interval
+    std::vector<std::vector<std::tuple<int, int, int>>> schedule_ids;   // job schedule for each time interval, (ID, n_segment_from, n_segment_to)
+    std::vector<std::vector<std::tuple<std::string, int, int>>> schedule;   // the same schedule with keys
+    std::vector<std::vector<int>> stream_job_queues; // IDs of propagators assigned to each stream, sorted by starting time
+    std::vector<std::vector<int>> checkpoints; // segment numbers that each propagator (ID) notifies to its dependents
+
+    // Only for memory-aware scheduling
+    std::vector<std::vector<std::tuple<int, std::string, std::string>>> finished_blocks; // blocks that can be computed at the end of each time interval
+    std::vector<std::vector<int>> released_propagator_ids; // propagators that are no longer needed at the end of each time interval
+    std::vector<std::vector<std::string>> released_propagators; // the same propagators with keys
+    int peak_live_segments; // the maximum number of segments that are stored at the same time
 
     // Methods
-    std::vector<std::vector<std::string>> make_propagator_hierarchies(
-        std::map<std::string, ComputationEdge, ComparePropagatorKey> computation_propagators);
+    // Returns the IDs of keys
+    std::map<std::string, int> index_propagators(const std::map<std::string, ComputationEdge, ComparePropagatorKey>& computation_propagators);
+    bool is_placed(int id) const;
+    std::vector<std::vector<int>> make_propagator_hierarchies();
+    void make_time_spans(std::vector<std::vector<int>>& job_queue, const int N_STREAM);
+    void make_stream_jobs(std::vector<std::vector<int>>& job_queue);
+    void make_release_schedule(
+        const std::map<std::tuple<int, std::string, std::string>, ComputationBlock>& computation_blocks,
+        const std::vector<std::tuple<int, int>>& block_ids,
+        std::vector<std::vector<int>>& dependents,
+        std::vector<std::set<int>>& block_partners);
+    // Copy the schedule and released propagators with keys
+    void update_keys_of_schedule();
+
+    // Cache of the schedule (see ComputationCache)
+    static std::string get_signature(
+        const std::map<std::string, ComputationEdge, ComparePropagatorKey>& computation_propagators,
+        const std::map<std::tuple<int, std::string, std::string>, ComputationBlock>& computation_blocks,
+        const int N_STREAM, const int max_live_segments);
+    bool load(const std::string& file_name, const std::string& signature);
+    void save(const std::string& file_name, const std::string& signature);
 public:
 
-    Scheduler(std::map<std::string, ComputationEdge, ComparePropagatorKey> computation_propagators, const int N_STREAM);
+    Scheduler(const std::map<std::string, ComputationEdge, ComparePropagatorKey>& computation_propagators, const int N_STREAM);
+
+    // Memory-aware scheduling. The number of segments of live propagators is bounded by 'max_live_segments' if possible.
+    // If 'max_live_segments' is 0, there is no bound, but propagators are still released when they are no longer needed.
+    Scheduler(
+        const std::map<std::string, ComputationEdge, ComparePropagatorKey>& computation_propagators,
+        const std::map<std::tuple<int, std::string, std::string>, ComputationBlock>& computation_blocks,
+        const int N_STREAM, const int max_live_segments);
     ~Scheduler() {};
     std::vector<std::vector<std::tuple<std::string, int, int>>>& get_schedule();
-    void display(std::map<std::string, ComputationEdge, ComparePropagatorKey> computation_propagators);
+    // The same schedule with IDs of propagators
+    std::vector<std::vector<std::tuple<int, int, int>>>& get_schedule_ids();
+
+    // Merge adjacent time spans to reduce the number of barriers. Time spans are merged if propagators starting
+    // in the later one do not depend on segments computed in the earlier one, the peak number of live segments
+    // does not increase, and the estimated additional idle time is not larger than 'barrier_cost' (in units of segment steps).
+    // After merging, a time span can have more jobs than streams.
+    void coarsen_schedule(const double barrier_cost);
+
+    // For execution without time spans. Each stream computes its propagators in order, and
+    // each propagator notifies its progress at the checkpoints so that its dependents can start.
+    std::vector<std::vector<int>>& get_stream_job_queues();
+    std::vector<std::vector<int>>& get_checkpoints();
+
+    // Planned finishing time of all propagators, in units of segment steps
+    int get_planned_makespan();
+    // Longest chain of dependencies with unlimited streams, (key, starting time, finishing time)
+    std::vector<std::tuple<std::string, int, int>> get_critical_path();
+
+    // Only for memory-aware scheduling
+    std::vector<std::vector<std::tuple<int, std::string, std::string>>>& get_finished_blocks();
+    std::vector<std::vector<std::string>>& get_released_propagators();
+    std::vector<std::vector<int>>& get_released_propagator_ids();
+    int get_peak_live_segments();
+    void display();
 };
 #endif
@@ -0,0 +1,81 @@
+/*-------------------------------------------------------------
+* This is an abstract SemiImplicitMixing class.
+* Semi-implicit field update preconditioned by the linear response of ideal chains (RPA).
+* The field residual used in SCFT is w_deriv_i = sum_j (chi_ij*phi_j - P_ij*w_j).
+* For small changes of fields, phi_j changes by -sum_k S_jk(k)*delta_w_k(k), where S is the
+* correlation function matrix of the current 'Molecules' (see Rpa). Treating this linear
+* response implicitly, the fields are updated in Fourier space as
+*     delta_w(k) = lambda*(I + lambda*(chi*S(k) + P))^{-1} w_deriv(k),
+* which damps the stiff modes at small wavenumbers. In ordered phases beyond the spinodal,
+* only the positive part of chi is treated implicitly (see CpuSemiImplicitMixing).
+* Like simple mixing, the step size is reduced when error_level increases, but does not exceed lambda.
+* If 'anderson_mixing' is given, the semi-implicit update replaces the simple mixing of Anderson mixing,
+* i.e., the fields are updated by Anderson mixing once error_level becomes less than its start_error.
+* The first n_monomer_types*n_grid variables are fields, and the others (e.g., box lengths)
+* are updated by simple mixing.
+* (Ceniceros and Fredrickson, Multiscale Model. Simul. 2, 452 (2004))
+*------------------------------------------------------------*/
+
+#ifndef SEMI_IMPLICIT_MIXING_H_
+#define SEMI_IMPLICIT_MIXING_H_
+
+#include <string>
+#include <vector>
+
+#include "Exception.h"
+#include "ComputationBox.h"
+#include "Molecules.h"
+#include "AndersonMixing.h"
+
+class SemiImplicitMixing : public AndersonMixing
+{
+protected:
+    ComputationBox *cb;
+    Molecules *molecules;
+    std::vector<std::string> monomer_types;
+    std::vector<std::vector<double>> matrix_chi, matrix_p;
+    // Step size of the semi-implicit update
+    double lambda;
+    // Anderson mixing used after the semi-implicit updates (not owned)
+    AndersonMixing *anderson_mixing;
+public:
+    SemiImplicitMixing(ComputationBox *cb, Molecules *molecules,
+        std::vector<std::string> monomer_types,
+        std::vector<std::vector<double>> matrix_chi,
+        std::vector<std::vector<double>> matrix_p,
+        int n_var, double lambda, AndersonMixing *anderson_mixing)
+        : AndersonMixing(n_var, 0, 0.0, 0.1*lambda, lambda)
+    {
+        const int S = monomer_types.size();
+        if (lambda <= 0.0)
+            throw_with_line_number("lambda (" + std::to_string(lambda) + ") must be a positive number.");
+        if (matrix_chi.size() != static_cast<size_t>(S) || matrix_p.size() != static_cast<size_t>(S))
+            throw_with_line_number("The sizes of matrix_chi and matrix_p must be the number of monomer types (" + std::to_string(S) + ").");
+        for(int i=0; i<S; i++)
+        {
+            if (matrix_chi[i].size() != static_cast<size_t>(S) || matrix_p[i].size() != static_cast<size_t>(S))
+                throw_with_line_number("The sizes of matrix_chi and matrix_p must be the number of monomer types (" + std::to_string(S) + ").");
+        }
+        if (n_var < S*cb->get_n_grid())
+            throw_with_line_number("n_var (" + std::to_string(n_var) + ") must not be less than n_monomer_types*n_grid (" + std::to_string(S*cb->get_n_grid()) + ").");
+        if (anderson_mixing != nullptr && anderson_mixing->get_n_var() != n_var)
+            throw_with_line_number("The number of variables of Anderson mixing (" + std::to_string(anderson_mixing->get_n_var()) + ") must be n_var (" + std::to_string(n_var) + ").");
+
+        this->cb = cb;
+        this->molecules = molecules;
+        this->monomer_types = monomer_types;
+        this->matrix_chi = matrix_chi;
+        this->matrix_p = matrix_p;
+        this->lambda = lambda;
+        this->anderson_mixing = anderson_mixing;
+    };
+    virtual ~SemiImplicitMixing(){};
+
+    double get_lambda(){ return lambda;};
+
+    // Build the linear response kernels for the current box. Since the kernels
+    // depend on box lengths, they are rebuilt in 'calculate_new_fields' whenever
+    // the box lengths have been changed (e.g., before 'update_laplacian_operator').
+    virtual void update_kernels()=0;
+};
+#endif
@@ -0,0 +1,207 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <omp.h>
+
+#include "Tracer.h"
+
+Tracer::Tracer(int n_threads, std::string file_name, int max_calls)
+{
+    if (max_calls < 1)
+        throw_with_line_number("The maximum number of traced calls (" + std::to_string(max_calls) + ") must be positive.");
+
+    this->n_threads = n_threads;
+    this->file_name = file_name;
+    this->max_calls = max_calls;
+    this->n_recorded_calls = 0;
+    this->is_recording = true;
+    this->is_written = false;
+    this->origin = std::chrono::steady_clock::now();
+    this->events.resize(n_threads+1);
+    this->last_end.resize(n_threads+1, 0.0);
+    this->planned_makespan = 0;
+}
+void Tracer::set_plan(int planned_makespan, std::vector<std::tuple<std::string, int, int>> critical_path)
+{
+    this->planned_makespan = planned_makespan;
+    this->critical_path = critical_path;
+}
+double Tracer::now()
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - origin).count();
+}
+int Tracer::get_thread_id()
+{
+    // Events outside of parallel regions are recorded as phases
+    if (!omp_in_parallel())
+        return n_threads;
+    return omp_get_thread_num();
+}
+void Tracer::add_event(const std::string& name, const char* category, double start, double end, int n_segment_from, int n_segment_to)
+{
+    if (!is_recording)
+        return;
+    int tid = get_thread_id();
+    TraceEvent event = {name, category, tid, start, end, n_segment_from, n_segment_to};
+    if (tid >= 0 && tid <= n_threads)
+    {
+        events[tid].push_back(event);
+        last_end[tid] = end;
+    }
+    else
+    {
+        #pragma omp critical
+        events[n_threads].push_back(event);
+    }
+}
+void Tracer::add_phase(const std::string& name, double start)
+{
+    if (!is_recording)
+        return;
+    double end = now();
+    for(int t=0; t<n_threads; t++)
+    {
+        double wait_start = std::max(last_end[t], start);
+        if (end > wait_start)
+            events[t].push_back({name, "barrier", t, wait_start, end, -1, -1});
+    }
+    events[n_threads].push_back({name, "phase", n_threads, start, end, -1, -1});
+
+    // Stop recording, and write the trace so that it is kept even if the process does not finish normally
+    if (name == "compute_propagators" && ++n_recorded_calls >= max_calls)
+    {
+        is_recording = false;
+        write_chrome_trace();
+    }
+}
+void Tracer::write_chrome_trace()
+{
+    try
+    {
+        if (is_written)
+            return;
+        std::ofstream file(file_name);
+        if (!file.is_open())
+            throw_with_line_number("Could not open the trace file '" + file_name + "'.");
+
+        auto escape = [](const std::string& str)
+        {
+            std::string escaped;
+            for(char c: str)
+            {
+                if (c == '"' || c == '\\')
+                    escaped += '\\';
+                escaped += c;
+            }
+            return escaped;
+        };
+
+        file << std::fixed << std::setprecision(3);
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << std::endl;
+        for(int t=0; t<=n_threads; t++)
+        {
+            std::string thread_name = (t < n_threads) ? "stream " + std::to_string(t) : "phases";
+            file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << t
+                 << ",\"args\":{\"name\":\"" << thread_name << "\"}}";
+            file << "," << std::endl;
+        }
+        bool is_first = true;
+        for(int t=0; t<=n_threads; t++)
+        {
+            for(const auto& event: events[t])
+            {
+                if (!is_first)
+                    file << "," << std::endl;
+                is_first = false;
+                file << "{\"name\":\"" << escape(event.name) << "\",\"cat\":\"" << event.category
+                     << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << event.tid
+                     << ",\"ts\":" << event.start << ",\"dur\":" << event.end - event.start;
+                if (event.n_segment_from >= 0)
+                    file << ",\"args\":{\"n_segment_from\":" << event.n_segment_from << ",\"n_segment_to\":" << event.n_segment_to << "}";
+                file << "}";
+            }
+        }
+        file << std::endl << "]}" << std::endl;
+        file.close();
+        is_written = true;
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+void Tracer::display_summary()
+{
+    // Total time of the propagator computation
+    std::vector<std::pair<double, double>> calls;
+    double total_time = 0.0;
+    for(const auto& event: events[n_threads])
+    {
+        if (event.name == "compute_propagators")
+        {
+            calls.push_back(std::make_pair(event.start, event.end));
+            total_time += event.end - event.start;
+        }
+    }
+    const int n_calls = calls.size();
+    if (n_calls == 0)
+        return;
+
+    // Busy time of each stream and the number of computed segments.
+    // Propagators recomputed outside of compute_propagators (e.g., in compute_stress) are excluded.
+    // Calls do not overlap, so the sorted events are swept once with the sorted calls.
+    std::sort(calls.begin(), calls.end());
+    std::vector<double> busy_time(n_threads, 0.0);
+    long long int n_steps = 0;
+    for(int t=0; t<n_threads; t++)
+    {
+        std::vector<const TraceEvent*> propagator_events;
+        for(const auto& event: events[t])
+        {
+            if (event.category == "propagator")
+                propagator_events.push_back(&event);
+        }
+        std::sort(propagator_events.begin(), propagator_events.end(),
+            [](const TraceEvent* a, const TraceEvent* b) { return a->start < b->start; });
+
+        size_t c = 0;
+        for(const TraceEvent* event: propagator_events)
+        {
+            while (c < calls.size() && calls[c].second < event->start)
+                c++;
+            if (c == calls.size())
+                break;
+            if (calls[c].first <= event->start)
+            {
+                busy_time[t] += event->end - event->start;
+                n_steps += std::max(event->n_segment_to - event->n_segment_from, 1);
+            }
+        }
+    }
+    double total_busy_time = 0.0;
+    for(int t=0; t<n_threads; t++)
+        total_busy_time += busy_time[t];
+    double step_time = n_steps > 0 ? total_busy_time/n_steps : 0.0;
+
+    int critical_path_length = critical_path.empty() ? 0 : std::get<2>(critical_path.back());
+    double actual_makespan = total_time/n_calls;
+
+    std::cout << "---------- Summary of Propagator Computation Trace ----------" << std::endl;
+    std::cout << "Trace file: " << file_name << std::endl;
+    std::cout << "The number of compute_propagators calls: " << n_calls << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Average time per segment step (ms): " << step_time/1e3 << std::endl;
+    std::cout << "Planned makespan (steps, ms): " << planned_makespan << ", " << planned_makespan*step_time/1e3 << std::endl;
+    std::cout << "Actual makespan per call (steps, ms): " << (step_time > 0 ? actual_makespan/step_time : 0.0) << ", " << actual_makespan/1e3 << std::endl;
+    std::cout << "Critical path (steps, ms): " << critical_path_length << ", " << critical_path_length*step_time/1e3 << std::endl;
+    for(const auto& item: critical_path)
+        std::cout << "\t" << std::get<0>(item) << ": " << std::get<1>(item) << "-" << std::get<2>(item) << std::endl;
+    std::cout << "Idle time of each stream per call (ms, %):" << std::endl;
+    for(int t=0; t<n_threads; t++)
+    {
+        double idle_time = (total_time - busy_time[t])/n_calls;
+        std::cout << "\tstream " << t << ": " << idle_time/1e3 << ", " << 100.0*idle_time/actual_makespan << std::endl;
+    }
+    std::cout << std::defaultfloat;
+}
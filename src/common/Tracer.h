@@ -0,0 +1,118 @@
+/*----------------------------------------------------------
+* This class records timestamped spans of propagator computation for each thread,
+* and exports them as a Chrome trace JSON file (chrome://tracing or https://ui.perfetto.dev)
+*-----------------------------------------------------------*/
+
+#ifndef TRACER_H_
+#define TRACER_H_
+
+#include <string>
+#include <vector>
+#include <tuple>
+#include <chrono>
+
+#include "Exception.h"
+
+struct TraceEvent{
+    std::string name;      // e.g., propagator key
+    std::string category;  // "propagator", "fft", "concentration", "stress", "barrier", "phase"
+    int tid;               // thread id. The last id is used for phases.
+    double start;          // microseconds
+    double end;            // microseconds
+    int n_segment_from;    // range of segments, -1 if not applicable
+    int n_segment_to;
+};
+
+class Tracer
+{
+private:
+    std::string file_name;
+    int n_threads;
+    std::chrono::steady_clock::time_point origin;
+
+    // Only the first 'max_calls' calls of compute_propagators are recorded, and the trace file is
+    // written as soon as they are finished. It bounds the memory of events in long simulations.
+    int max_calls;
+    int n_recorded_calls;
+    bool is_recording;
+    bool is_written;
+
+    // Events of each thread. events[n_threads] is for phases that are recorded by the master thread.
+    std::vector<std::vector<TraceEvent>> events;
+    // Time that the last event of each thread is finished
+    std::vector<double> last_end;
+
+    // Schedule information for the summary
+    int planned_makespan;
+    std::vector<std::tuple<std::string, int, int>> critical_path;
+
+    int get_thread_id();
+public:
+    Tracer(int n_threads, std::string file_name, int max_calls=100);
+    ~Tracer() {};
+
+    std::string get_file_name() {return file_name;};
+    bool get_is_recording() {return is_recording;};
+
+    // Microseconds since the tracer is created
+    double now();
+
+    // Add event of the current thread
+    void add_event(const std::string& name, const char* category, double start, double end, int n_segment_from=-1, int n_segment_to=-1);
+
+    // Add phase that started at 'start' and finishes now. This must be invoked outside of parallel regions.
+    // Threads that finished their jobs earlier are recorded as waiting at the barrier.
+    // Recording stops after 'max_calls' phases of "compute_propagators", and the trace file is written.
+    void add_phase(const std::string& name, double start);
+
+    // Export events. It does nothing if the file is already written.
+    void write_chrome_trace();
+
+    // Set planned makespan of the scheduler and critical path for the summary.
+    // 'critical_path' is a list of (key, starting time, finishing time) with unlimited streams.
+    void set_plan(int planned_makespan, std::vector<std::tuple<std::string, int, int>> critical_path);
+
+    // Display per-stream idle time, and planned versus actual makespan
+    void display_summary();
+};
+
+// Records an event from construction to destruction. It does nothing if tracer is nullptr.
+class TraceScope
+{
+private:
+    Tracer *tracer;
+    std::string name;
+    const char* category;
+    double start;
+    int n_segment_from;
+    int n_segment_to;
+public:
+    TraceScope(Tracer *tracer, const std::string& name, const char* category, int n_segment_from=-1, int n_segment_to=-1)
+        : tracer(tracer), category(category), n_segment_from(n_segment_from), n_segment_to(n_segment_to)
+    {
+        if (tracer != nullptr && !tracer->get_is_recording())
+            this->tracer = nullptr;
+        if (this->tracer != nullptr)
+        {
+            this->name = name;
+            start = tracer->now();
+        }
+    };
+    TraceScope(Tracer *tracer, const std::tuple<int, std::string, std::string>& block_key, const char* category)
+        : tracer(tracer), category(category), n_segment_from(-1), n_segment_to(-1)
+    {
+        if (tracer != nullptr && !tracer->get_is_recording())
+            this->tracer = nullptr;
+        if (this->tracer != nullptr)
+        {
+            this->name = std::to_string(std::get<0>(block_key)) + ": " + std::get<1>(block_key) + ", " + std::get<2>(block_key);
+            start = tracer->now();
+        }
+    };
+    ~TraceScope()
+    {
+        if (tracer != nullptr)
+            tracer->add_event(name, category, start, tracer->now(), n_segment_from, n_segment_to);
+    };
+};
+#endif
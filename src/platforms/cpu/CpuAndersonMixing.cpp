@@ -1,8 +1,11 @@
 #include <iostream>
 #include <algorithm>
+#include <vector>
 #include "CpuAndersonMixing.h"
+#include "CpuAndersonMixingKernels.h"
 
-CpuAndersonMixing::CpuAndersonMixing(int n_var, int max_hist, 
+template <typename T>
+CpuAndersonMixing<T>::CpuAndersonMixing(int n_var, int max_hist, 
     double start_error, double mix_min, double mix_init)
     :AndersonMixing(n_var, max_hist, start_error,
                     mix_min,  mix_init)
@@ -11,13 +14,16 @@ CpuAndersonMixing::CpuAndersonMixing(int n_var, int max_hist,
     {
         // Number of anderson mixing steps, increases from 0 to max_hist
         n_anderson = -1;
-        // Record history of w in memory
-        cb_w_hist = new CircularBuffer(max_hist+1, n_var);
-        // Record history of w_deriv in memory
-        cb_w_deriv_hist = new CircularBuffer(max_hist+1, n_var);
+        // Record history of differences of (w + w_deriv) in memory
+        cb_w_out_diff_hist = new CircularBufferT<T>(std::max(max_hist, 1), n_var);
+        // Record history of differences of w_deriv in memory
+        cb_w_deriv_diff_hist = new CircularBufferT<T>(std::max(max_hist, 1), n_var);
         // Record history of (inner_product of w_deriv + inner_product of h_deriv) in memory
         cb_w_deriv_dots = new CircularBuffer(max_hist+1, max_hist+1);
 
+        this->w_out_prev = new double[n_var];
+        this->w_deriv_prev = new double[n_var];
+
         // define arrays for anderson mixing
         this->u_nm = new double*[max_hist];
         for(int i=0; i<max_hist; i++)
@@ -25,6 +31,8 @@ CpuAndersonMixing::CpuAndersonMixing(int n_var, int max_hist,
         this->v_n = new double[max_hist];
         this->a_n = new double[max_hist];
         this->w_deriv_dots = new double[max_hist+1];
+        this->w_deriv_diff_dots = new double[max_hist+1];
+        this->coeff = new double[max_hist+1];
 
         // Reset_count
         reset_count();
@@ -34,11 +42,14 @@ CpuAndersonMixing::CpuAndersonMixing(int n_var, int max_hist,
         throw_without_line_number(exc.what());
     }
 }
-CpuAndersonMixing::~CpuAndersonMixing()
+template <typename T>
+CpuAndersonMixing<T>::~CpuAndersonMixing()
 {
-    delete cb_w_hist;
-    delete cb_w_deriv_hist;
+    delete cb_w_out_diff_hist;
+    delete cb_w_deriv_diff_hist;
     delete cb_w_deriv_dots;
+    delete[] w_out_prev;
+    delete[] w_deriv_prev;
 
     for (int i=0; i<max_hist; i++)
         delete[] u_nm[i];
@@ -46,8 +57,11 @@ CpuAndersonMixing::~CpuAndersonMixing()
     delete[] v_n;
     delete[] a_n;
     delete[] w_deriv_dots;
+    delete[] w_deriv_diff_dots;
+    delete[] coeff;
 }
-void CpuAndersonMixing::reset_count()
+template <typename T>
+void CpuAndersonMixing<T>::reset_count()
 {
     try
     {
@@ -56,8 +70,8 @@ void CpuAndersonMixing::reset_count()
         // Number of anderson mixing steps, increases from 0 to max_hist
         n_anderson = -1;
 
-        cb_w_hist->reset();
-        cb_w_deriv_hist->reset();
+        cb_w_out_diff_hist->reset();
+        cb_w_deriv_diff_hist->reset();
         cb_w_deriv_dots->reset();
     }
     catch(std::exception& exc)
@@ -65,15 +79,16 @@ void CpuAndersonMixing::reset_count()
         throw_without_line_number(exc.what());
     }
 }
-double CpuAndersonMixing::dot_product(double *a, double *b)
+template <typename T>
+std::size_t CpuAndersonMixing<T>::get_memory_usage()
 {
-    double sum{0.0};
-    for(int i=0; i<n_var; i++)
-        sum += a[i]*b[i];
-    return sum;
+    return cb_w_out_diff_hist->get_memory_usage()
+         + cb_w_deriv_diff_hist->get_memory_usage()
+         + cb_w_deriv_dots->get_memory_usage()
+         + 2*sizeof(double)*static_cast<std::size_t>(n_var);
 }
-
-void CpuAndersonMixing::calculate_new_fields(
+template <typename T>
+void CpuAndersonMixing<T>::calculate_new_fields(
     double *w_new,
     double *w_current,
     double *w_deriv,
@@ -82,11 +97,6 @@ void CpuAndersonMixing::calculate_new_fields(
 {
     try
     {
-        double *w_hist1;
-        double *w_hist2;
-        double *w_deriv_hist1;
-        double *w_deriv_hist2;
-
         // Condition to start anderson mixing
         if(error_level < start_error || n_anderson >= 0)
             n_anderson = n_anderson + 1;
@@ -94,15 +104,36 @@ void CpuAndersonMixing::calculate_new_fields(
         {
             // Number of histories to use for anderson mixing
             n_anderson = std::min(max_hist, n_anderson);
-            // store the input and output field (the memory is used in a periodic way)
-            cb_w_hist->insert(w_current);
-            cb_w_deriv_hist->insert(w_deriv);
 
-            // Evaluate w_deriv inner_product products for calculating Unm and Vn in Thompson's paper
-            for(int i=0; i<= n_anderson; i++)
+            // store the differences from the previous iteration (the memory is used in a periodic way)
+            if(n_anderson > 0)
             {
-                w_deriv_dots[i] = dot_product(w_deriv, cb_w_deriv_hist->get_array(i));
+                #pragma omp parallel for simd if(n_var > CpuAndersonMixingKernels::BLOCK_SIZE)
+                for(int i=0; i<n_var; i++)
+                {
+                    w_out_prev[i] = w_current[i] + w_deriv[i] - w_out_prev[i];
+                    w_deriv_prev[i] = w_deriv[i] - w_deriv_prev[i];
+                }
+                cb_w_out_diff_hist->insert(w_out_prev);
+                cb_w_deriv_diff_hist->insert(w_deriv_prev);
             }
+            #pragma omp parallel for simd if(n_var > CpuAndersonMixingKernels::BLOCK_SIZE)
+            for(int i=0; i<n_var; i++)
+            {
+                w_out_prev[i] = w_current[i] + w_deriv[i];
+                w_deriv_prev[i] = w_deriv[i];
+            }
+
+            // Evaluate w_deriv inner_product products for calculating Unm and Vn in Thompson's paper
+            // All inner products are computed in a single pass over memory.
+            // w_deriv[k] = w_deriv[0] - sum_{j<k} (w_deriv[j]-w_deriv[j+1])
+            std::vector<T*> w_deriv_diff_hists(n_anderson);
+            for(int j=0; j<n_anderson; j++)
+                w_deriv_diff_hists[j] = cb_w_deriv_diff_hist->get_array(j);
+            CpuAndersonMixingKernels::multi_dot_products(n_var, 1, w_deriv, &w_deriv, w_deriv_dots);
+            CpuAndersonMixingKernels::multi_dot_products(n_var, n_anderson, w_deriv, w_deriv_diff_hists.data(), w_deriv_diff_dots);
+            for(int k=1; k<= n_anderson; k++)
+                w_deriv_dots[k] = w_deriv_dots[k-1] - w_deriv_diff_dots[k-1];
             cb_w_deriv_dots->insert(w_deriv_dots);
         }
         // Conditions to apply the simple mixing method
@@ -115,8 +146,7 @@ void CpuAndersonMixing::calculate_new_fields(
                 mix = mix*1.01;
 
             // Make a simple mixing of input and output fields for the next iteration
-            for(int i=0; i<n_var; i++)
-                w_new[i] = w_current[i] + mix*w_deriv[i];
+            CpuAndersonMixingKernels::simple_mixing(n_var, mix, w_current, w_deriv, w_new);
         }
         else
         {
@@ -140,18 +170,18 @@ void CpuAndersonMixing::calculate_new_fields(
             //print_array(n_anderson+1, v_n);
             //exit(-1);
 
-            // Calculate the new field
-            w_hist1 = cb_w_hist->get_array(0);
-            w_deriv_hist1 = cb_w_deriv_hist->get_array(0);
-            for(int i=0; i<n_var; i++)
-                w_new[i] = w_hist1[i] + w_deriv_hist1[i];
-            for(int i=0; i<n_anderson; i++)
+            // Calculate the new field, w_new = (w+w_deriv)[0] + sum_i a_n[i]*((w+w_deriv)[i+1] - (w+w_deriv)[0])
+            //                                 = (w+w_deriv)[0] - sum_j (sum_{i>=j} a_n[i])*((w+w_deriv)[j] - (w+w_deriv)[j+1])
+            // All differences are combined in a single pass over memory
+            std::vector<T*> w_out_diff_hists(n_anderson);
+            double a_sum = 0.0;
+            for(int j=n_anderson-1; j>=0; j--)
             {
-                w_hist2       = cb_w_hist->get_array(i+1);
-                w_deriv_hist2 = cb_w_deriv_hist->get_array(i+1);
-                for(int j=0; j<n_var; j++)
-                    w_new[j] += a_n[i]*(w_hist2[j] + w_deriv_hist2[j] - w_hist1[j] - w_deriv_hist1[j]);
+                a_sum += a_n[j];
+                coeff[j] = -a_sum;
+                w_out_diff_hists[j] = cb_w_out_diff_hist->get_array(j);
             }
+            CpuAndersonMixingKernels::add_linear_combination(n_var, n_anderson, w_current, w_deriv, coeff, w_out_diff_hists.data(), w_new);
         }
     }
     catch(std::exception& exc)
@@ -160,7 +190,8 @@ void CpuAndersonMixing::calculate_new_fields(
     }
 }
 // Print array for debugging 
-void CpuAndersonMixing::print_array(int n, double *a)
+template <typename T>
+void CpuAndersonMixing<T>::print_array(int n, double *a)
 {
     for(int i=0; i<n-1; i++)
     {
@@ -168,3 +199,7 @@ void CpuAndersonMixing::print_array(int n, double *a)
     }
     std::cout << a[n-1] << std::endl;
 }
+
+// Explicit template instantiation
+template class CpuAndersonMixing<double>;
+template class CpuAndersonMixing<float>;
@@ -1,5 +1,9 @@
 /*-------------------------------------------------------------
 * This is a derived CpuAndersonMixing class
+* Instead of the histories of fields, the differences between consecutive histories are stored.
+* The type of the differences, T, can be 'float' to reduce memory usage. Since the differences
+* become small as the iteration converges, the rounding errors of 'float' also become small.
+* The newest field and its derivative are kept in 'double'.
 *------------------------------------------------------------*/
 
 #ifndef CPU_ANDERSON_MIXING_H_
@@ -9,17 +13,21 @@
 #include "CircularBuffer.h"
 #include "AndersonMixing.h"
 
+template <typename T>
 class CpuAndersonMixing : public AndersonMixing
 {
 private:
-    // A few previous field values are stored
-    CircularBuffer *cb_w_hist, *cb_w_deriv_hist;
+    // Differences of (w + w_deriv) and w_deriv between consecutive histories
+    CircularBufferT<T> *cb_w_out_diff_hist, *cb_w_deriv_diff_hist;
+    // (w + w_deriv) and w_deriv of the previous iteration
+    double *w_out_prev, *w_deriv_prev;
     CircularBuffer *cb_w_deriv_dots;
-    double *w_deriv_dots;
+    double *w_deriv_dots, *w_deriv_diff_dots;
     // A matrix and arrays for determining coefficients
     double **u_nm, *v_n, *a_n;
-    
-    double dot_product(double *a, double *b);
+    // Coefficients of differences for the new field
+    double *coeff;
+
     void print_array(int n, double *a);
 public:
 
@@ -28,6 +36,7 @@ public:
     ~CpuAndersonMixing();
       
     void reset_count() override;
+    std::size_t get_memory_usage() override;
     void calculate_new_fields(
         double *w_new, double *w_current, double *w_deriv,
         double old_error_level, double error_level) override;
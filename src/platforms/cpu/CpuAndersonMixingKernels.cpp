@@ -0,0 +1,130 @@
+#include <vector>
+#include <algorithm>
+#include <omp.h>
+
+#include "CpuAndersonMixingKernels.h"
+
+template <typename T>
+void CpuAndersonMixingKernels::multi_dot_products(int n_var, int n, const double *a, T **b, double *dots)
+{
+    if (n == 0)
+        return;
+
+    const int n_blocks = (n_var+BLOCK_SIZE-1)/BLOCK_SIZE;
+    // Partial sums of each thread. The stride is padded to avoid false sharing.
+    const int stride = (n+7)/8*8;
+    int n_threads = 1;
+    std::vector<double> partial_sums;
+
+    #pragma omp parallel if(n_blocks > 1)
+    {
+        #pragma omp single
+        {
+            n_threads = omp_get_num_threads();
+            partial_sums.assign(n_threads*stride, 0.0);
+        }
+        double *sums = &partial_sums[omp_get_thread_num()*stride];
+
+        #pragma omp for schedule(static)
+        for(int blk=0; blk<n_blocks; blk++)
+        {
+            const int i_start = blk*BLOCK_SIZE;
+            const int i_end = std::min(i_start+BLOCK_SIZE, n_var);
+            for(int k=0; k<n; k++)
+            {
+                const T *b_k = b[k];
+                double sum = 0.0;
+                #pragma omp simd reduction(+:sum)
+                for(int i=i_start; i<i_end; i++)
+                    sum += a[i]*b_k[i];
+                sums[k] += sum;
+            }
+        }
+    }
+    for(int k=0; k<n; k++)
+    {
+        dots[k] = 0.0;
+        for(int t=0; t<n_threads; t++)
+            dots[k] += partial_sums[t*stride+k];
+    }
+}
+void CpuAndersonMixingKernels::linear_combination(int n_var, int n, const double *coeff, double **x, double **y, double *out)
+{
+    const int n_blocks = (n_var+BLOCK_SIZE-1)/BLOCK_SIZE;
+
+    #pragma omp parallel for schedule(static) if(n_blocks > 1)
+    for(int blk=0; blk<n_blocks; blk++)
+    {
+        const int i_start = blk*BLOCK_SIZE;
+        const int i_end = std::min(i_start+BLOCK_SIZE, n_var);
+        #pragma omp simd
+        for(int i=i_start; i<i_end; i++)
+            out[i] = 0.0;
+        for(int k=0; k<n; k++)
+        {
+            const double c = coeff[k];
+            const double *x_k = x[k];
+            const double *y_k = y[k];
+            #pragma omp simd
+            for(int i=i_start; i<i_end; i++)
+                out[i] += c*(x_k[i] + y_k[i]);
+        }
+    }
+}
+template <typename T>
+void CpuAndersonMixingKernels::add_linear_combination(int n_var, int n, const double *x, const double *y, const double *coeff, T **z, double *out)
+{
+    const int n_blocks = (n_var+BLOCK_SIZE-1)/BLOCK_SIZE;
+
+    #pragma omp parallel for schedule(static) if(n_blocks > 1)
+    for(int blk=0; blk<n_blocks; blk++)
+    {
+        const int i_start = blk*BLOCK_SIZE;
+        const int i_end = std::min(i_start+BLOCK_SIZE, n_var);
+        #pragma omp simd
+        for(int i=i_start; i<i_end; i++)
+            out[i] = x[i] + y[i];
+        for(int k=0; k<n; k++)
+        {
+            const double c = coeff[k];
+            const T *z_k = z[k];
+            #pragma omp simd
+            for(int i=i_start; i<i_end; i++)
+                out[i] += c*z_k[i];
+        }
+    }
+}
+void CpuAndersonMixingKernels::simple_mixing(int n_var, double mix, const double *x, const double *y, double *out)
+{
+    #pragma omp parallel for simd schedule(static) if(n_var > BLOCK_SIZE)
+    for(int i=0; i<n_var; i++)
+        out[i] = x[i] + mix*y[i];
+}
+void CpuAndersonMixingKernels::axpy(int n_var, double a, const double *x, double *y)
+{
+    #pragma omp parallel for simd schedule(static) if(n_var > BLOCK_SIZE)
+    for(int i=0; i<n_var; i++)
+        y[i] += a*x[i];
+}
+void CpuAndersonMixingKernels::scale(int n_var, double a, double *x)
+{
+    #pragma omp parallel for simd schedule(static) if(n_var > BLOCK_SIZE)
+    for(int i=0; i<n_var; i++)
+        x[i] *= a;
+}
+void CpuAndersonMixingKernels::rotate(int n_var, double cs, double sn, double *x, double *y)
+{
+    #pragma omp parallel for simd schedule(static) if(n_var > BLOCK_SIZE)
+    for(int i=0; i<n_var; i++)
+    {
+        double t = x[i];
+        x[i] =  cs*t + sn*y[i];
+        y[i] = -sn*t + cs*y[i];
+    }
+}
+
+// Explicit template instantiation
+template void CpuAndersonMixingKernels::multi_dot_products<double>(int, int, const double *, double **, double *);
+template void CpuAndersonMixingKernels::multi_dot_products<float>(int, int, const double *, float **, double *);
+template void CpuAndersonMixingKernels::add_linear_combination<double>(int, int, const double *, const double *, const double *, double **, double *);
+template void CpuAndersonMixingKernels::add_linear_combination<float>(int, int, const double *, const double *, const double *, float **, double *);
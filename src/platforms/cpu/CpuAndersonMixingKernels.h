@@ -0,0 +1,37 @@
+/*-------------------------------------------------------------
+* Kernels for Anderson mixing on CPU.
+* Each kernel makes a single pass over memory for all histories,
+* and is parallelized with OpenMP and vectorized with 'omp simd'.
+* Arrays are processed in blocks, so that a block of the shared array stays in cache
+* while it is used with all histories. Partial sums of each thread are added
+* in a fixed order, so results do not depend on the timing of threads.
+* Histories can be stored in 'float', and they are accumulated in 'double'.
+*------------------------------------------------------------*/
+
+#ifndef CPU_ANDERSON_MIXING_KERNELS_H_
+#define CPU_ANDERSON_MIXING_KERNELS_H_
+
+class CpuAndersonMixingKernels
+{
+public:
+    // Number of elements in a block
+    static const int BLOCK_SIZE = 2048;
+
+    // dots[k] = a*b[k], for k = 0, ..., n-1
+    template <typename T>
+    static void multi_dot_products(int n_var, int n, const double *a, T **b, double *dots);
+    // out = sum_k coeff[k]*(x[k] + y[k]), for k = 0, ..., n-1
+    static void linear_combination(int n_var, int n, const double *coeff, double **x, double **y, double *out);
+    // out = x + y + sum_k coeff[k]*z[k], for k = 0, ..., n-1. 'out' can be the same array as 'x' or 'y'.
+    template <typename T>
+    static void add_linear_combination(int n_var, int n, const double *x, const double *y, const double *coeff, T **z, double *out);
+    // out = x + mix*y
+    static void simple_mixing(int n_var, double mix, const double *x, const double *y, double *out);
+    // y = y + a*x
+    static void axpy(int n_var, double a, const double *x, double *y);
+    // x = a*x
+    static void scale(int n_var, double a, double *x);
+    // (x, y) = (cs*x + sn*y, -sn*x + cs*y)
+    static void rotate(int n_var, double cs, double sn, double *x, double *y);
+};
+#endif
@@ -0,0 +1,321 @@
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "CpuAndersonMixingQR.h"
+#include "CpuAndersonMixingKernels.h"
+
+CpuAndersonMixingQR::CpuAndersonMixingQR(int n_var, int max_hist,
+    double start_error, double mix_min, double mix_init,
+    std::string type, double max_condition)
+    :AndersonMixing(n_var, max_hist, start_error,
+                    mix_min,  mix_init)
+{
+    try
+    {
+        if (type != "I" && type != "II")
+            throw_with_line_number("Invalid type of Anderson mixing (" + type + "). This must be 'I' or 'II'.");
+        if (max_condition <= 1.0)
+            throw_with_line_number("max_condition (" + std::to_string(max_condition) + ") must be larger than 1.");
+        this->type = type;
+        this->max_condition = max_condition;
+
+        // Number of anderson mixing steps, increases from 0 to max_hist
+        n_anderson = -1;
+        // Record history of w in memory
+        cb_w_hist = new CircularBuffer(max_hist+1, n_var);
+        // Record history of w_deriv in memory
+        cb_w_deriv_hist = new CircularBuffer(max_hist+1, n_var);
+        // Record history of inner products in memory
+        if (type == "I")
+        {
+            cb_w_w_deriv_dots = new CircularBuffer(max_hist+1, max_hist+1);
+            cb_w_deriv_w_dots = new CircularBuffer(max_hist+1, max_hist+1);
+        }
+        else
+        {
+            cb_w_w_deriv_dots = nullptr;
+            cb_w_deriv_w_dots = nullptr;
+        }
+
+        // define arrays for anderson mixing
+        this->q_nm = new double*[max_hist];
+        this->r_nm = new double*[max_hist];
+        this->u_nm = new double*[max_hist];
+        for(int i=0; i<max_hist; i++)
+        {
+            this->q_nm[i] = new double[n_var];
+            this->r_nm[i] = new double[max_hist];
+            this->u_nm[i] = new double[max_hist];
+        }
+        this->hist_index = new int[max_hist];
+        this->v_n = new double[max_hist];
+        this->a_n = new double[max_hist];
+        this->coeff = new double[max_hist+1];
+        this->dots = new double[max_hist+1];
+
+        // Reset_count
+        reset_count();
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+CpuAndersonMixingQR::~CpuAndersonMixingQR()
+{
+    delete cb_w_hist;
+    delete cb_w_deriv_hist;
+    delete cb_w_w_deriv_dots;
+    delete cb_w_deriv_w_dots;
+
+    for (int i=0; i<max_hist; i++)
+    {
+        delete[] q_nm[i];
+        delete[] r_nm[i];
+        delete[] u_nm[i];
+    }
+    delete[] q_nm;
+    delete[] r_nm;
+    delete[] u_nm;
+    delete[] hist_index;
+    delete[] v_n;
+    delete[] a_n;
+    delete[] coeff;
+    delete[] dots;
+}
+void CpuAndersonMixingQR::reset_count()
+{
+    try
+    {
+        // Initialize mixing parameter
+        mix = mix_init;
+        // Number of anderson mixing steps, increases from 0 to max_hist
+        n_anderson = -1;
+        n_columns = 0;
+
+        cb_w_hist->reset();
+        cb_w_deriv_hist->reset();
+        if (type == "I")
+        {
+            cb_w_w_deriv_dots->reset();
+            cb_w_deriv_w_dots->reset();
+        }
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+std::size_t CpuAndersonMixingQR::get_memory_usage()
+{
+    std::size_t memory = cb_w_hist->get_memory_usage() + cb_w_deriv_hist->get_memory_usage();
+    memory += static_cast<std::size_t>(max_hist)*n_var*sizeof(double);
+    if (type == "I")
+        memory += cb_w_w_deriv_dots->get_memory_usage() + cb_w_deriv_w_dots->get_memory_usage();
+    return memory;
+}
+double CpuAndersonMixingQR::get_w_w_deriv_dot(int n, int m)
+{
+    if (n <= m)
+        return cb_w_w_deriv_dots->get(n, m-n);
+    else
+        return cb_w_deriv_w_dots->get(m, n-m);
+}
+void CpuAndersonMixingQR::append_column()
+{
+    const int k = n_columns;
+    double *q_new = q_nm[k];
+
+    // The new column is the difference of the two newest histories
+    CpuAndersonMixingKernels::simple_mixing(n_var, -1.0, cb_w_deriv_hist->get_array(0), cb_w_deriv_hist->get_array(1), q_new);
+    double norm;
+    CpuAndersonMixingKernels::multi_dot_products(n_var, 1, q_new, &q_new, &norm);
+    norm = std::sqrt(norm);
+
+    // Orthogonalize against the previous columns using modified Gram-Schmidt
+    for(int c=0; c<k; c++)
+    {
+        double r;
+        CpuAndersonMixingKernels::multi_dot_products(n_var, 1, q_new, &q_nm[c], &r);
+        CpuAndersonMixingKernels::axpy(n_var, -r, q_nm[c], q_new);
+        r_nm[c][k] = r;
+    }
+    double r_kk;
+    CpuAndersonMixingKernels::multi_dot_products(n_var, 1, q_new, &q_new, &r_kk);
+    r_kk = std::sqrt(r_kk);
+
+    // Reject the new column if it is (nearly) dependent on the previous columns
+    if (r_kk <= norm/max_condition)
+        return;
+    CpuAndersonMixingKernels::scale(n_var, 1.0/r_kk, q_new);
+    r_nm[k][k] = r_kk;
+    hist_index[k] = 0;
+    n_columns++;
+}
+void CpuAndersonMixingQR::remove_oldest_column()
+{
+    const int n = n_columns;
+
+    // Shift columns. R becomes an upper Hessenberg matrix.
+    for(int c=0; c<n-1; c++)
+    {
+        for(int j=0; j<=c+1; j++)
+            r_nm[j][c] = r_nm[j][c+1];
+        hist_index[c] = hist_index[c+1];
+    }
+    // Restore the upper triangular form using Givens rotations, and apply them to Q
+    for(int k=0; k<n-1; k++)
+    {
+        double a = r_nm[k][k];
+        double b = r_nm[k+1][k];
+        double h = std::sqrt(a*a + b*b);
+        if (h == 0.0)
+            continue;
+        double cs = a/h;
+        double sn = b/h;
+        for(int j=k; j<n-1; j++)
+        {
+            double t1 = r_nm[k][j];
+            double t2 = r_nm[k+1][j];
+            r_nm[k][j]   =  cs*t1 + sn*t2;
+            r_nm[k+1][j] = -sn*t1 + cs*t2;
+        }
+        CpuAndersonMixingKernels::rotate(n_var, cs, sn, q_nm[k], q_nm[k+1]);
+    }
+    // The last column of Q is no longer used
+    n_columns--;
+}
+double CpuAndersonMixingQR::estimate_condition()
+{
+    // Ratio of the largest and the smallest diagonal elements of R
+    double r_max = 0.0;
+    double r_min = std::numeric_limits<double>::max();
+    for(int c=0; c<n_columns; c++)
+    {
+        r_max = std::max(r_max, std::abs(r_nm[c][c]));
+        r_min = std::min(r_min, std::abs(r_nm[c][c]));
+    }
+    if (r_min == 0.0)
+        return std::numeric_limits<double>::infinity();
+    return r_max/r_min;
+}
+void CpuAndersonMixingQR::calculate_new_fields(
+    double *w_new,
+    double *w_current,
+    double *w_deriv,
+    double old_error_level,
+    double error_level)
+{
+    try
+    {
+        // Condition to start anderson mixing
+        if(error_level < start_error || n_anderson >= 0)
+            n_anderson = n_anderson + 1;
+        if(n_anderson >= 0)
+        {
+            // Number of histories to use for anderson mixing
+            n_anderson = std::min(max_hist, n_anderson);
+            // store the input and output field (the memory is used in a periodic way)
+            cb_w_hist->insert(w_current);
+            cb_w_deriv_hist->insert(w_deriv);
+
+            // Evaluate inner products with the previous histories in a single pass over memory
+            if (type == "I")
+            {
+                std::vector<double*> w_hists(n_anderson+1), w_deriv_hists(n_anderson+1);
+                for(int i=0; i<= n_anderson; i++)
+                {
+                    w_hists[i] = cb_w_hist->get_array(i);
+                    w_deriv_hists[i] = cb_w_deriv_hist->get_array(i);
+                }
+                CpuAndersonMixingKernels::multi_dot_products(n_var, n_anderson+1, w_current, w_deriv_hists.data(), dots);
+                cb_w_w_deriv_dots->insert(dots);
+                CpuAndersonMixingKernels::multi_dot_products(n_var, n_anderson+1, w_deriv, w_hists.data(), dots);
+                cb_w_deriv_w_dots->insert(dots);
+            }
+
+            // Update QR factorization. Columns are shifted by the new history, and
+            // the column that uses a history removed from the buffer is removed.
+            for(int c=0; c<n_columns; c++)
+                hist_index[c]++;
+            while(n_columns > 0 && hist_index[0]+1 > n_anderson)
+                remove_oldest_column();
+            if (n_anderson > 0)
+            {
+                append_column();
+                while(n_columns > 0 && estimate_condition() > max_condition)
+                    remove_oldest_column();
+            }
+        }
+        // Conditions to apply the simple mixing method
+        if(n_anderson <= 0 || n_columns == 0)
+        {
+            // dynamically change mixing parameter
+            if (old_error_level < error_level)
+                mix = std::max(mix*0.7, mix_min);
+            else
+                mix = mix*1.01;
+
+            // Make a simple mixing of input and output fields for the next iteration
+            CpuAndersonMixingKernels::simple_mixing(n_var, mix, w_current, w_deriv, w_new);
+            return;
+        }
+
+        // Find coefficients of columns
+        const int m = n_columns;
+        if (type == "II")
+        {
+            // Minimize |w_deriv[0] - dD a|, that is, R a = Q^T w_deriv[0]
+            CpuAndersonMixingKernels::multi_dot_products(n_var, m, w_deriv, q_nm, v_n);
+            for(int c=m-1; c>=0; c--)
+            {
+                double a = v_n[c];
+                for(int j=c+1; j<m; j++)
+                    a -= r_nm[c][j]*a_n[j];
+                a_n[c] = a/r_nm[c][c];
+            }
+        }
+        else
+        {
+            // Solve dW^T dD a = dW^T w_deriv[0]
+            for(int c=0; c<m; c++)
+            {
+                int n = hist_index[c];
+                v_n[c] = get_w_w_deriv_dot(n, 0) - get_w_w_deriv_dot(n+1, 0);
+                for(int j=0; j<m; j++)
+                {
+                    int l = hist_index[j];
+                    u_nm[c][j] = get_w_w_deriv_dot(n, l) - get_w_w_deriv_dot(n, l+1)
+                               - get_w_w_deriv_dot(n+1, l) + get_w_w_deriv_dot(n+1, l+1);
+                }
+            }
+            find_an(u_nm, v_n, a_n, m);
+        }
+
+        // w_new = w[0] + w_deriv[0] - sum_c a[c]*(dW[c] + dD[c])
+        const int n_hist = hist_index[0]+2;
+        for(int n=0; n<n_hist; n++)
+            coeff[n] = 0.0;
+        coeff[0] = 1.0;
+        for(int c=0; c<m; c++)
+        {
+            int n = hist_index[c];
+            coeff[n]   -= a_n[c];
+            coeff[n+1] += a_n[c];
+        }
+        std::vector<double*> w_hists(n_hist), w_deriv_hists(n_hist);
+        for(int n=0; n<n_hist; n++)
+        {
+            w_hists[n] = cb_w_hist->get_array(n);
+            w_deriv_hists[n] = cb_w_deriv_hist->get_array(n);
+        }
+        CpuAndersonMixingKernels::linear_combination(n_var, n_hist, coeff, w_hists.data(), w_deriv_hists.data(), w_new);
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
@@ -0,0 +1,66 @@
+/*-------------------------------------------------------------
+* This is a derived CpuAndersonMixingQR class.
+* The least squares problem of Anderson mixing is solved using QR factorization of
+* the matrix of residual differences, dD = [d_{k-m+1}-d_{k-m}, ..., d_k-d_{k-1}], where d is w_deriv.
+* The orthonormal factor Q and the triangular factor R are updated incrementally.
+* A new column is orthogonalized against Q by modified Gram-Schmidt, and it is rejected
+* if it is (nearly) dependent on the previous columns. The oldest column is removed by
+* Givens rotations applied to both R and Q. The oldest columns are also removed while
+* the estimated condition number of R exceeds 'max_condition'.
+* (Walker and Ni, SIAM J. Numer. Anal. 49, 1715 (2011))
+* Type-I uses the same columns, but its m x m system, dW^T dD a = dW^T d, is solved by
+* Gaussian elimination (find_an), not by the QR factorization.
+*------------------------------------------------------------*/
+
+#ifndef CPU_ANDERSON_MIXING_QR_H_
+#define CPU_ANDERSON_MIXING_QR_H_
+
+#include <string>
+
+#include "CircularBuffer.h"
+#include "AndersonMixing.h"
+
+class CpuAndersonMixingQR : public AndersonMixing
+{
+private:
+    // "II": minimize the norm of the residual (Type-II, the same as CpuAndersonMixing)
+    // "I" : project the residual using differences of fields (Type-I)
+    std::string type;
+    // Maximum condition number of R
+    double max_condition;
+
+    // A few previous field values are stored
+    CircularBuffer *cb_w_hist, *cb_w_deriv_hist;
+    // Inner products of the newest history with the previous ones (only for Type-I)
+    // cb_w_w_deriv_dots: w*w_deriv, cb_w_deriv_w_dots: w_deriv*w
+    CircularBuffer *cb_w_w_deriv_dots, *cb_w_deriv_w_dots;
+    double *dots;
+
+    // Orthonormal and upper triangular factors of dD. Columns are ordered from the oldest to the newest.
+    double **q_nm, **r_nm;
+    int n_columns;
+    // Column 'c' is w_deriv[n]-w_deriv[n+1], where n = hist_index[c] and 0 is the newest history
+    int *hist_index;
+    // A matrix and arrays for determining coefficients
+    double **u_nm, *v_n, *a_n, *coeff;
+
+    // Inner products of histories. 'n' and 'm' are indices of histories, and 0 is the newest one.
+    double get_w_w_deriv_dot(int n, int m);
+
+    // Append the difference of the two newest histories to Q and R, and remove the oldest column
+    void append_column();
+    void remove_oldest_column();
+    double estimate_condition();
+public:
+    CpuAndersonMixingQR(int n_var, int max_hist,
+        double start_error, double mix_min, double mix_init,
+        std::string type="II", double max_condition=1e10);
+    ~CpuAndersonMixingQR();
+
+    void reset_count() override;
+    std::size_t get_memory_usage() override;
+    void calculate_new_fields(
+        double *w_new, double *w_current, double *w_deriv,
+        double old_error_level, double error_level) override;
+};
+#endif
@@ -0,0 +1,711 @@
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+#include <omp.h>
+
+#include "CpuComputationBatchContinuous.h"
+#include "CpuSolverPseudo.h"
+#include "MklFFT3D.h"
+#include "MklFFT2D.h"
+#include "MklFFT1D.h"
+#include "Pseudo.h"
+#include "SimpsonRule.h"
+
+CpuComputationBatchContinuous::CpuComputationBatchContinuous(
+    ComputationBox *cb,
+    Molecules *molecules,
+    PropagatorAnalyzer *propagator_analyzer,
+    int n_replicas,
+    int n_replica_groups)
+    : PropagatorComputationBatch(cb, molecules, propagator_analyzer, n_replicas)
+{
+    try
+    {
+        #ifndef NDEBUG
+        std::cout << "--------- Continuous Chain Batch Solver, CPU Version ---------" << std::endl;
+        #endif
+
+        const int M = cb->get_n_grid();
+        const int M_COMPLEX = Pseudo::get_n_complex_grid(cb->get_nx());
+
+        if (molecules->get_model_name() != "continuous")
+            throw_with_line_number("CpuComputationBatchContinuous supports only continuous chain model.");
+
+        // The number of parallel streams for propagator computation
+        const char *ENV_OMP_NUM_THREADS = getenv("OMP_NUM_THREADS");
+        std::string env_omp_num_threads(ENV_OMP_NUM_THREADS ? ENV_OMP_NUM_THREADS  : "");
+        if (env_omp_num_threads.empty())
+            n_streams = 4;
+        else
+            n_streams = std::stoi(env_omp_num_threads);
+
+        // Allocate memory for propagators
+        if( propagator_analyzer->get_computation_propagators().size() == 0)
+            throw_with_line_number("There is no propagator code. Add polymers first.");
+        const int N_PROPAGATORS = propagator_analyzer->get_computation_propagators().size();
+        propagator.resize(N_PROPAGATORS);
+        propagator_size.resize(N_PROPAGATORS);
+        propagator_stride.resize(N_PROPAGATORS);
+        for(const auto& item: propagator_analyzer->get_computation_propagators())
+        {
+            const int id = propagator_analyzer->get_propagator_id(item.first);
+            propagator_size[id] = item.second.max_n_segment+1;
+            propagator_stride[id] = M;
+            propagator[id] = new double*[propagator_size[id]];
+            for(int i=0; i<propagator_size[id]; i++)
+                propagator[id][i] = new double[n_replicas*M];
+        }
+
+        // Allocate memory for concentrations
+        if( propagator_analyzer->get_computation_blocks().size() == 0)
+            throw_with_line_number("There is no block. Add polymers first.");
+        for(const auto& item: propagator_analyzer->get_computation_blocks())
+            phi_block[item.first] = new double[n_replicas*M];
+
+        // Remember one segment for each polymer chain to compute total partition function
+        int current_p = 0;
+        for(const auto& block: phi_block)
+        {
+            const auto& key = block.first;
+            int p = std::get<0>(key);
+
+            // Skip if already found one segment
+            if (p != current_p)
+                continue;
+
+            int n_aggregated = propagator_analyzer->get_computation_block(key).v_u.size()/
+                               propagator_analyzer->get_computation_block(key).n_repeated;
+            single_partition_segment.push_back(std::make_tuple(p, key, n_aggregated));
+            current_p++;
+        }
+        // Concentrations for each solvent
+        for(int s=0;s<molecules->get_n_solvent_types();s++)
+            phi_solvent.push_back(new double[n_replicas*M]);
+
+        // Create scheduler for computation of propagator
+        sc = new Scheduler(propagator_analyzer->get_computation_propagators(), n_streams);
+
+        // Threads that are not used by the jobs of a time span are used by groups of replicas.
+        // The number of groups can be given, and it is rounded down to a divisor of n_replicas.
+        if (n_replica_groups < 0)
+            throw_with_line_number("The number of replica groups (" + std::to_string(n_replica_groups) + ") must be non-negative.");
+        int target_groups = n_replica_groups;
+        if (target_groups == 0)
+        {
+            size_t max_span_jobs = 1;
+            for(const auto& jobs: sc->get_schedule_ids())
+                max_span_jobs = std::max(max_span_jobs, jobs.size());
+            target_groups = std::max(1, n_streams/static_cast<int>(max_span_jobs));
+        }
+        n_groups = std::min(target_groups, n_replicas);
+        while (n_replicas % n_groups != 0)
+            n_groups--;
+        group_size = n_replicas/n_groups;
+        #ifndef NDEBUG
+        std::cout << "The number of replica groups, replicas per group: " << n_groups << ", " << group_size << std::endl;
+        #endif
+
+        // FFT plans shared by all groups
+        if (cb->get_dim() == 3)
+        {
+            fft_group         = new MklFFT3D({cb->get_nx(0),cb->get_nx(1),cb->get_nx(2)}, group_size);
+            fft_group_double  = new MklFFT3D({cb->get_nx(0),cb->get_nx(1),cb->get_nx(2)}, 2*group_size);
+            fft_single        = new MklFFT3D({cb->get_nx(0),cb->get_nx(1),cb->get_nx(2)}, 1);
+            fft_single_double = new MklFFT3D({cb->get_nx(0),cb->get_nx(1),cb->get_nx(2)}, 2);
+        }
+        else if (cb->get_dim() == 2)
+        {
+            fft_group         = new MklFFT2D({cb->get_nx(0),cb->get_nx(1)}, group_size);
+            fft_group_double  = new MklFFT2D({cb->get_nx(0),cb->get_nx(1)}, 2*group_size);
+            fft_single        = new MklFFT2D({cb->get_nx(0),cb->get_nx(1)}, 1);
+            fft_single_double = new MklFFT2D({cb->get_nx(0),cb->get_nx(1)}, 2);
+        }
+        else
+        {
+            fft_group         = new MklFFT1D(cb->get_nx(0), group_size);
+            fft_group_double  = new MklFFT1D(cb->get_nx(0), 2*group_size);
+            fft_single        = new MklFFT1D(cb->get_nx(0), 1);
+            fft_single_double = new MklFFT1D(cb->get_nx(0), 2);
+        }
+
+        // Create boltz_bond, boltz_bond_half, exp_dw, and exp_dw_half
+        for(const auto& item: molecules->get_bond_lengths())
+        {
+            std::string monomer_type = item.first;
+            boltz_bond     [monomer_type] = new double[M_COMPLEX];
+            boltz_bond_half[monomer_type] = new double[M_COMPLEX];
+            exp_dw         [monomer_type] = new double[n_replicas*M];
+            exp_dw_half    [monomer_type] = new double[n_replicas*M];
+        }
+        update_laplacian_operator();
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+CpuComputationBatchContinuous::~CpuComputationBatchContinuous()
+{
+    delete fft_group;
+    delete fft_group_double;
+    delete fft_single;
+    delete fft_single_double;
+    delete sc;
+
+    for(const auto& item: boltz_bond)
+        delete[] item.second;
+    for(const auto& item: boltz_bond_half)
+        delete[] item.second;
+    for(const auto& item: exp_dw)
+        delete[] item.second;
+    for(const auto& item: exp_dw_half)
+        delete[] item.second;
+
+    for(size_t p=0; p<propagator.size(); p++)
+    {
+        for(int i=0; i<propagator_size[p]; i++)
+            delete[] propagator[p][i];
+        delete[] propagator[p];
+    }
+    for(const auto& item: phi_block)
+        delete[] item.second;
+    for(const auto& item: phi_solvent)
+        delete[] item;
+}
+void CpuComputationBatchContinuous::update_laplacian_operator()
+{
+    try
+    {
+        for(const auto& item: molecules->get_bond_lengths())
+        {
+            std::string monomer_type = item.first;
+            double bond_length_sq = item.second*item.second;
+            Pseudo::get_boltz_bond(cb->get_boundary_conditions(), boltz_bond     [monomer_type], bond_length_sq,   cb->get_nx(), cb->get_dx(), molecules->get_ds());
+            Pseudo::get_boltz_bond(cb->get_boundary_conditions(), boltz_bond_half[monomer_type], bond_length_sq/2, cb->get_nx(), cb->get_dx(), molecules->get_ds());
+        }
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+void CpuComputationBatchContinuous::compute_statistics(
+    std::map<std::string, const double*> w_input,
+    std::map<std::string, const double*> q_init)
+{
+    this->compute_propagators(w_input, q_init);
+    this->compute_concentrations();
+}
+void CpuComputationBatchContinuous::compute_propagators(
+    std::map<std::string, const double*> w_input,
+    std::map<std::string, const double*> q_init)
+{
+    try
+    {
+        check_inputs(w_input, q_init);
+        update_dw(w_input, false);
+        compute_propagators_by_schedule(q_init, std::vector<bool>(propagator.size(), false));
+        compute_single_partitions();
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+void CpuComputationBatchContinuous::compute_statistics_multi_source(
+    std::map<std::string, const double*> w_input,
+    std::string q_init_source, const double *q_init_batch,
+    std::map<std::string, const double*> q_init)
+{
+    try
+    {
+        q_init[q_init_source] = q_init_batch;
+        check_inputs(w_input, q_init);
+
+        // Find propagators that depend on the source. Deps of a propagator are computed before it.
+        std::vector<bool> is_shared(propagator.size(), true);
+        bool is_source_used = false;
+        for(const auto& branch_jobs: sc->get_schedule_ids())
+        {
+            for(const auto& job: branch_jobs)
+            {
+                const int id = std::get<0>(job);
+                const std::string& key = propagator_analyzer->get_propagator_key(id);
+                const ComputationEdge& edge = propagator_analyzer->get_computation_propagator(id);
+                if (edge.dep_ids.size() == 0 && key[0] == '{' && PropagatorCode::get_q_input_idx_from_key(key) == q_init_source)
+                {
+                    is_shared[id] = false;
+                    is_source_used = true;
+                }
+                for(const auto& dep: edge.dep_ids)
+                {
+                    if (!is_shared[std::get<0>(dep)])
+                        is_shared[id] = false;
+                }
+            }
+        }
+        if (!is_source_used)
+            throw_with_line_number("q_init[\"" + q_init_source + "\"] is not used by any propagator.");
+
+        update_dw(w_input, true);
+        compute_propagators_by_schedule(q_init, is_shared);
+        compute_single_partitions();
+        compute_concentrations();
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+void CpuComputationBatchContinuous::check_inputs(
+    std::map<std::string, const double*>& w_input,
+    std::map<std::string, const double*>& q_init)
+{
+    for(const auto& item: propagator_analyzer->get_computation_propagators())
+    {
+        if( w_input.find(item.second.monomer_type) == w_input.end())
+            throw_with_line_number("monomer_type \"" + item.second.monomer_type + "\" is not in w_input.");
+
+        const std::string& key = item.first;
+        if (item.second.deps.size() == 0 && key[0] == '{')
+        {
+            std::string g = PropagatorCode::get_q_input_idx_from_key(key);
+            if (q_init.find(g) == q_init.end())
+                throw_with_line_number("Could not find q_init[\"" + g + "\"].");
+        }
+    }
+    for(const auto& item: w_input)
+    {
+        if( exp_dw.find(item.first) == exp_dw.end())
+            throw_with_line_number("monomer_type \"" + item.first + "\" is not in exp_dw.");
+    }
+}
+void CpuComputationBatchContinuous::update_dw(std::map<std::string, const double*>& w_input, bool is_w_shared)
+{
+    const int M = cb->get_n_grid();
+    const double ds = molecules->get_ds();
+
+    // Update exp_dw and exp_dw_half of all replicas
+    for(const auto& item: w_input)
+    {
+        const double *w = item.second;
+        double *_exp_dw = exp_dw[item.first];
+        double *_exp_dw_half = exp_dw_half[item.first];
+        #pragma omp parallel for num_threads(n_streams)
+        for(int i=0; i<n_replicas*M; i++)
+        {
+            const double _w = is_w_shared ? w[i%M] : w[i];
+            _exp_dw     [i] = exp(-_w*ds*0.5);
+            _exp_dw_half[i] = exp(-_w*ds*0.25);
+        }
+    }
+}
+void CpuComputationBatchContinuous::allocate_propagators(const std::vector<bool>& is_shared)
+{
+    const int M = cb->get_n_grid();
+
+    // Reallocate only the propagators whose storage is changed
+    for(size_t id=0; id<propagator.size(); id++)
+    {
+        const int stride = is_shared[id] ? 0 : M;
+        if (propagator_stride[id] == stride)
+            continue;
+        propagator_stride[id] = stride;
+        for(int i=0; i<propagator_size[id]; i++)
+        {
+            delete[] propagator[id][i];
+            propagator[id][i] = new double[is_shared[id] ? M : n_replicas*M];
+        }
+    }
+}
+void CpuComputationBatchContinuous::compute_propagators_by_schedule(
+    std::map<std::string, const double*>& q_init, const std::vector<bool>& is_shared)
+{
+    const int M = cb->get_n_grid();
+    const int M_COMPLEX = Pseudo::get_n_complex_grid(cb->get_nx());
+
+    allocate_propagators(is_shared);
+
+    // For each time span, compute the jobs of all groups of replicas in parallel
+    for(const auto& branch_jobs: sc->get_schedule_ids())
+    {
+        // Tasks (ID, group, n_segment_from, n_segment_to). Shared propagators are computed once (group -1).
+        std::vector<std::tuple<int, int, int, int>> tasks;
+        for(const auto& job: branch_jobs)
+        {
+            const int id = std::get<0>(job);
+            if (is_shared[id])
+                tasks.push_back(std::make_tuple(id, -1, std::get<1>(job), std::get<2>(job)));
+            else
+            {
+                for(int g=0; g<n_groups; g++)
+                    tasks.push_back(std::make_tuple(id, g, std::get<1>(job), std::get<2>(job)));
+            }
+        }
+
+        #pragma omp parallel num_threads(n_streams)
+        {
+            // Work arrays of each thread
+            std::vector<double> q_work(2*group_size*M);
+            std::vector<std::complex<double>> k_q_work(2*group_size*M_COMPLEX);
+
+            #pragma omp for schedule(dynamic)
+            for(size_t t=0; t<tasks.size(); t++)
+            {
+                const auto& task = tasks[t];
+                compute_propagator_job(std::get<0>(task), std::get<1>(task), std::get<2>(task), std::get<3>(task),
+                    q_init, q_work.data(), k_q_work.data());
+            }
+        }
+    }
+}
+void CpuComputationBatchContinuous::compute_single_partitions()
+{
+    const int P = molecules->get_n_polymer_types();
+
+    // Compute total partition function of each distinct polymers
+    for(const auto& segment_info: single_partition_segment)
+    {
+        int p                 = std::get<0>(segment_info);
+        const auto& key       = std::get<1>(segment_info);
+        int n_aggregated      = std::get<2>(segment_info);
+        const ComputationBlock& block = propagator_analyzer->get_computation_block(key);
+
+        double *q_left  = propagator[block.id_left][block.n_segment_left];
+        double *q_right = propagator[block.id_right][0];
+        const int STRIDE_LEFT  = propagator_stride[block.id_left];
+        const int STRIDE_RIGHT = propagator_stride[block.id_right];
+        for(int r=0; r<n_replicas; r++)
+            single_polymer_partitions[r*P+p] = cb->inner_product(&q_left[r*STRIDE_LEFT], &q_right[r*STRIDE_RIGHT])/n_aggregated/cb->get_volume();
+    }
+}
+void CpuComputationBatchContinuous::compute_propagator_job(
+    int id, int group, int n_segment_from, int n_segment_to,
+    std::map<std::string, const double*>& q_init, double *q_work, std::complex<double> *k_q_work)
+{
+    const int M = cb->get_n_grid();
+    // A shared propagator is computed once, and it depends only on shared propagators
+    const int N_FIELDS = (group < 0) ? 1 : group_size;
+    const int OFFSET = (group < 0) ? 0 : group*group_size*M;
+    const double *q_mask = cb->get_mask();
+
+    const std::string& key = propagator_analyzer->get_propagator_key(id);
+    const ComputationEdge& edge = propagator_analyzer->get_computation_propagator(id);
+    double **_propagator = propagator[id];
+
+    if (n_segment_from == 0)
+    {
+        double *_q_0 = &_propagator[0][OFFSET];
+
+        // If it is leaf node
+        if (edge.dep_ids.size() == 0 && key[0] == '{')
+        {
+            const double *_q_init = &q_init.at(PropagatorCode::get_q_input_idx_from_key(key))[OFFSET];
+            for(int i=0; i<N_FIELDS*M; i++)
+                _q_0[i] = _q_init[i];
+        }
+        else if (edge.dep_ids.size() == 0)
+        {
+            for(int i=0; i<N_FIELDS*M; i++)
+                _q_0[i] = 1.0;
+        }
+        // If it is aggregated, add all propagators at junction
+        else if (key[0] == '[')
+        {
+            for(int i=0; i<N_FIELDS*M; i++)
+                _q_0[i] = 0.0;
+            for(const auto& dep: edge.dep_ids)
+            {
+                // Shared deps are read at offset 0 for all replicas
+                const int SUB_STRIDE = propagator_stride[std::get<0>(dep)];
+                const double *_q_sub = &propagator[std::get<0>(dep)][std::get<1>(dep)][SUB_STRIDE == 0 ? 0 : OFFSET];
+                const double sub_n_repeated = std::get<2>(dep);
+                for(int b=0; b<N_FIELDS; b++)
+                    for(int i=0; i<M; i++)
+                        _q_0[b*M+i] += _q_sub[b*SUB_STRIDE+i]*sub_n_repeated;
+            }
+        }
+        // Multiply all propagators at junction
+        else
+        {
+            for(int i=0; i<N_FIELDS*M; i++)
+                _q_0[i] = 1.0;
+            for(const auto& dep: edge.dep_ids)
+            {
+                const int SUB_STRIDE = propagator_stride[std::get<0>(dep)];
+                const double *_q_sub = &propagator[std::get<0>(dep)][std::get<1>(dep)][SUB_STRIDE == 0 ? 0 : OFFSET];
+                for(int b=0; b<N_FIELDS; b++)
+                    for(int i=0; i<M; i++)
+                        _q_0[b*M+i] *= _q_sub[b*SUB_STRIDE+i];
+            }
+        }
+
+        // Multiply mask
+        if (q_mask != nullptr)
+        {
+            for(int b=0; b<N_FIELDS; b++)
+                for(int i=0; i<M; i++)
+                    _q_0[b*M+i] *= q_mask[i];
+        }
+    }
+
+    // Advance propagator successively
+    for(int n=n_segment_from; n<n_segment_to; n++)
+        advance_propagator(OFFSET, N_FIELDS, &_propagator[n][OFFSET], &_propagator[n+1][OFFSET], edge.monomer_type, q_work, k_q_work);
+}
+void CpuComputationBatchContinuous::advance_propagator(
+    int offset, int n_fields, double *q_in, double *q_out, const std::string& monomer_type,
+    double *q_work, std::complex<double> *k_q_work)
+{
+    FFT *_fft = (n_fields == group_size) ? fft_group : fft_single;
+    FFT *_fft_double = (n_fields == group_size) ? fft_group_double : fft_single_double;
+
+    CpuSolverPseudo::advance_propagator_continuous_fields(_fft, _fft_double, nullptr, n_fields,
+        cb->get_n_grid(), Pseudo::get_n_complex_grid(cb->get_nx()),
+        &exp_dw[monomer_type][offset], &exp_dw_half[monomer_type][offset],
+        boltz_bond[monomer_type], boltz_bond_half[monomer_type],
+        q_in, q_out, cb->get_mask(), q_work, k_q_work);
+}
+void CpuComputationBatchContinuous::compute_concentrations()
+{
+    try
+    {
+        const int M = cb->get_n_grid();
+        const int P = molecules->get_n_polymer_types();
+        const int S = molecules->get_n_solvent_types();
+
+        // Calculate segment concentrations
+        #pragma omp parallel for num_threads(n_streams)
+        for(size_t b=0; b<phi_block.size();b++)
+        {
+            auto block = phi_block.begin();
+            advance(block, b);
+            const auto& key = block->first;
+
+            int p = std::get<0>(key);
+            const ComputationBlock& computation_block = propagator_analyzer->get_computation_block(key);
+            int n_segment_right = computation_block.n_segment_right;
+            int n_segment_left  = computation_block.n_segment_left;
+            int n_repeated      = computation_block.n_repeated;
+
+            // If there is no segment
+            if(n_segment_right == 0)
+            {
+                for(int i=0; i<n_replicas*M; i++)
+                    block->second[i] = 0.0;
+                continue;
+            }
+
+            calculate_phi_one_block(
+                block->second,
+                propagator[computation_block.id_left], propagator_stride[computation_block.id_left],
+                propagator[computation_block.id_right], propagator_stride[computation_block.id_right],
+                n_segment_right,
+                n_segment_left);
+
+            // Normalize concentration of each replica
+            Polymer& pc = molecules->get_polymer(p);
+            for(int r=0; r<n_replicas; r++)
+            {
+                double norm = molecules->get_ds()*pc.get_volume_fraction()/pc.get_alpha()/single_polymer_partitions[r*P+p]*n_repeated;
+                for(int i=0; i<M; i++)
+                    block->second[r*M+i] *= norm;
+            }
+        }
+
+        // Calculate partition functions and concentrations of solvents
+        for(int s=0; s<S; s++)
+        {
+            double volume_fraction = std::get<0>(molecules->get_solvent(s));
+            std::string monomer_type = std::get<1>(molecules->get_solvent(s));
+
+            for(int r=0; r<n_replicas; r++)
+            {
+                double *_phi = &phi_solvent[s][r*M];
+                double *_exp_dw = &exp_dw[monomer_type][r*M];
+
+                single_solvent_partitions[r*S+s] = cb->inner_product(_exp_dw, _exp_dw)/cb->get_volume();
+                for(int i=0; i<M; i++)
+                    _phi[i] = _exp_dw[i]*_exp_dw[i]*volume_fraction/single_solvent_partitions[r*S+s];
+            }
+        }
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+void CpuComputationBatchContinuous::calculate_phi_one_block(
+    double *phi, double **q_1, const int stride_1, double **q_2, const int stride_2, const int N_RIGHT, const int N_LEFT)
+{
+    const int M = cb->get_n_grid();
+    std::vector<double> simpson_rule_coeff = SimpsonRule::get_coeff(N_RIGHT);
+
+    // Compute segment concentration. Shared propagators are read at offset 0 for all replicas.
+    for(int r=0; r<n_replicas; r++)
+    {
+        double *_phi = &phi[r*M];
+        for(int i=0; i<M; i++)
+            _phi[i] = simpson_rule_coeff[0]*q_1[N_LEFT][r*stride_1+i]*q_2[0][r*stride_2+i];
+        for(int n=1; n<=N_RIGHT; n++)
+        {
+            const double *_q_1 = &q_1[N_LEFT-n][r*stride_1];
+            const double *_q_2 = &q_2[n][r*stride_2];
+            for(int i=0; i<M; i++)
+                _phi[i] += simpson_rule_coeff[n]*_q_1[i]*_q_2[i];
+        }
+    }
+}
+void CpuComputationBatchContinuous::get_chain_propagator(double *q_out, int polymer, int v, int u, int n)
+{
+    // This method should be invoked after invoking compute_statistics()
+    try
+    {
+        const int M = cb->get_n_grid();
+        Polymer& pc = molecules->get_polymer(polymer);
+        std::string dep = pc.get_propagator_key(v,u);
+
+        if (propagator_analyzer->get_computation_propagators().find(dep) == propagator_analyzer->get_computation_propagators().end())
+            throw_with_line_number("Could not find the propagator code '" + dep + "'. Disable 'aggregation' option to obtain propagator_analyzer.");
+
+        const int N_RIGHT = propagator_analyzer->get_computation_propagator(dep).max_n_segment;
+        if (n < 0 || n > N_RIGHT)
+            throw_with_line_number("n (" + std::to_string(n) + ") must be in range [0, " + std::to_string(N_RIGHT) + "]");
+
+        const int id = propagator_analyzer->get_propagator_id(dep);
+        double *_partition = propagator[id][n];
+        for(int r=0; r<n_replicas; r++)
+            for(int i=0; i<M; i++)
+                q_out[r*M+i] = _partition[r*propagator_stride[id]+i];
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+void CpuComputationBatchContinuous::get_total_concentration(std::string monomer_type, double *phi)
+{
+    try
+    {
+        const int M = cb->get_n_grid();
+        for(int i=0; i<n_replicas*M; i++)
+            phi[i] = 0.0;
+
+        // For each block
+        for(const auto& block: phi_block)
+        {
+            std::string key_left = std::get<1>(block.first);
+            int n_segment_right = propagator_analyzer->get_computation_block(block.first).n_segment_right;
+            if (PropagatorCode::get_monomer_type_from_key(key_left) == monomer_type && n_segment_right != 0)
+            {
+                for(int i=0; i<n_replicas*M; i++)
+                    phi[i] += block.second[i];
+            }
+        }
+
+        // For each solvent
+        for(int s=0;s<molecules->get_n_solvent_types();s++)
+        {
+            if (std::get<1>(molecules->get_solvent(s)) == monomer_type)
+            {
+                for(int i=0; i<n_replicas*M; i++)
+                    phi[i] += phi_solvent[s][i];
+            }
+        }
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+void CpuComputationBatchContinuous::get_total_concentration(int p, std::string monomer_type, double *phi)
+{
+    try
+    {
+        const int M = cb->get_n_grid();
+        const int P = molecules->get_n_polymer_types();
+
+        if (p < 0 || p > P-1)
+            throw_with_line_number("Index (" + std::to_string(p) + ") must be in range [0, " + std::to_string(P-1) + "]");
+
+        for(int i=0; i<n_replicas*M; i++)
+            phi[i] = 0.0;
+
+        // For each block
+        for(const auto& block: phi_block)
+        {
+            int polymer_idx = std::get<0>(block.first);
+            std::string key_left = std::get<1>(block.first);
+            int n_segment_right = propagator_analyzer->get_computation_block(block.first).n_segment_right;
+            if (polymer_idx == p && PropagatorCode::get_monomer_type_from_key(key_left) == monomer_type && n_segment_right != 0)
+            {
+                for(int i=0; i<n_replicas*M; i++)
+                    phi[i] += block.second[i];
+            }
+        }
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+void CpuComputationBatchContinuous::get_solvent_concentration(int s, double *phi)
+{
+    try
+    {
+        const int M = cb->get_n_grid();
+        const int S = molecules->get_n_solvent_types();
+
+        if (s < 0 || s > S-1)
+            throw_with_line_number("Index (" + std::to_string(s) + ") must be in range [0, " + std::to_string(S-1) + "]");
+
+        for(int i=0; i<n_replicas*M; i++)
+            phi[i] = phi_solvent[s][i];
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+bool CpuComputationBatchContinuous::check_total_partition()
+{
+    const int P = molecules->get_n_polymer_types();
+
+    std::cout<< "Replica id, polymer id: maximum,  minimum, and difference of total partitions" << std::endl;
+    for(int r=0; r<n_replicas; r++)
+    {
+        std::vector<std::vector<double>> total_partitions(P);
+        for(const auto& block: phi_block)
+        {
+            const auto& key = block.first;
+            int p               = std::get<0>(key);
+            const ComputationBlock& computation_block = propagator_analyzer->get_computation_block(key);
+            int n_segment_right = computation_block.n_segment_right;
+            int n_segment_left  = computation_block.n_segment_left;
+            int n_repeated      = computation_block.n_repeated;
+            int n_propagators   = computation_block.v_u.size();
+
+            double **q_1 = propagator[computation_block.id_left];
+            double **q_2 = propagator[computation_block.id_right];
+            const int OFFSET_1 = r*propagator_stride[computation_block.id_left];
+            const int OFFSET_2 = r*propagator_stride[computation_block.id_right];
+            for(int n=0; n<=n_segment_right; n++)
+            {
+                double total_partition = cb->inner_product(&q_1[n_segment_left-n][OFFSET_1], &q_2[n][OFFSET_2])*n_repeated/cb->get_volume();
+                total_partitions[p].push_back(total_partition/n_propagators);
+            }
+        }
+
+        for(int p=0; p<P; p++)
+        {
+            double max_partition = *std::max_element(total_partitions[p].begin(), total_partitions[p].end());
+            double min_partition = *std::min_element(total_partitions[p].begin(), total_partitions[p].end());
+            double diff_partition = std::abs(max_partition - min_partition);
+
+            std::cout<< "\t" << r << ", " << p << ": " << max_partition << ", " << min_partition << ", " << diff_partition << std::endl;
+            if (diff_partition > 1e-7)
+                return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,120 @@
+/*-------------------------------------------------------------
+* This is a derived CpuComputationBatchContinuous class.
+* Propagators of all replicas are advanced together. Each contour step of
+* a group of replicas calls batched FFTs (MKL with the number of transforms),
+* and the Boltzmann factors of bonds are shared by all replicas.
+* Jobs of a time span of the schedule and groups of replicas are computed in
+* parallel, so that both streams and replicas use the CPU threads.
+*------------------------------------------------------------*/
+
+#ifndef CPU_COMPUTATION_BATCH_CONTINUOUS_H_
+#define CPU_COMPUTATION_BATCH_CONTINUOUS_H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <complex>
+
+#include "ComputationBox.h"
+#include "Polymer.h"
+#include "Molecules.h"
+#include "PropagatorAnalyzer.h"
+#include "PropagatorComputationBatch.h"
+#include "Scheduler.h"
+#include "FFT.h"
+
+class CpuComputationBatchContinuous : public PropagatorComputationBatch
+{
+private:
+    // The number of parallel streams for propagator computation
+    int n_streams;
+    // Replicas are divided into groups of the same size, and each group is advanced by batched FFTs
+    int n_groups, group_size;
+
+    // FFTs of group_size fields, and of 2*group_size fields for the two Richardson steps from the same q_in
+    FFT *fft_group;
+    FFT *fft_group_double;
+    // FFTs of a single field and two fields, for propagators shared by all replicas
+    FFT *fft_single;
+    FFT *fft_single_double;
+
+    // Boltzmann factors for the single and half bonds, shared by all replicas
+    std::map<std::string, double*> boltz_bond;
+    std::map<std::string, double*> boltz_bond_half;
+    // Boltzmann factors for the single and half segments of all replicas
+    std::map<std::string, double*> exp_dw;
+    std::map<std::string, double*> exp_dw_half;
+
+    // Scheduler for propagator
+    Scheduler *sc;
+    // Propagators of all replicas, indexed by propagator ID (see PropagatorAnalyzer::get_propagator_id)
+    std::vector<double **> propagator;
+    std::vector<int> propagator_size;
+    // Distance between replicas in the segments of each propagator. It is 0 if the propagator is shared by
+    // all replicas and stored only once, otherwise n_grid.
+    std::vector<int> propagator_stride;
+
+    // Remember one segment for each polymer chain to compute total partition function
+    // (polymer id, block key, n_aggregated)
+    std::vector<std::tuple<int, std::tuple<int, std::string, std::string>, int>> single_partition_segment;
+
+    // key: (polymer id, key_left, key_right) (assert(key_left <= key_right)), value: concentrations of all replicas
+    std::map<std::tuple<int, std::string, std::string>, double *> phi_block;
+
+    // Solvent concentrations of all replicas
+    std::vector<double *> phi_solvent;
+
+    // Check the monomer types of w_input and the keys of q_init
+    void check_inputs(std::map<std::string, const double*>& w_input, std::map<std::string, const double*>& q_init);
+    // Update exp_dw and exp_dw_half. If is_w_shared, all replicas use the same fields of size n_grid.
+    void update_dw(std::map<std::string, const double*>& w_input, bool is_w_shared);
+    // Allocate segments of propagators. Propagators marked in is_shared are stored once for all replicas.
+    void allocate_propagators(const std::vector<bool>& is_shared);
+    // Compute all propagators following the schedule. Propagators marked in is_shared are computed once.
+    void compute_propagators_by_schedule(std::map<std::string, const double*>& q_init, const std::vector<bool>& is_shared);
+    // Compute total partition functions of polymers of all replicas
+    void compute_single_partitions();
+
+    // Compute segments of a propagator from 'n_segment_from' to 'n_segment_to' for a group of replicas.
+    // If group is -1, the propagator is shared by all replicas and computed once.
+    void compute_propagator_job(int id, int group, int n_segment_from, int n_segment_to,
+        std::map<std::string, const double*>& q_init, double *q_work, std::complex<double> *k_q_work);
+
+    // Advance propagators of 'n_fields' replicas starting from the replica at 'offset' by one contour step
+    void advance_propagator(int offset, int n_fields, double *q_in, double *q_out, const std::string& monomer_type,
+        double *q_work, std::complex<double> *k_q_work);
+
+    // Calculate concentration of one block for all replicas. stride_1 and stride_2 are the strides of q_1 and q_2.
+    void calculate_phi_one_block(double *phi, double **q_1, const int stride_1, double **q_2, const int stride_2,
+        const int N_RIGHT, const int N_LEFT);
+public:
+    // If n_replica_groups is 0, it is chosen from the threads that are not used by the jobs of a time span
+    CpuComputationBatchContinuous(ComputationBox *cb, Molecules *molecules, PropagatorAnalyzer* propagator_analyzer, int n_replicas, int n_replica_groups=0);
+    ~CpuComputationBatchContinuous();
+
+    void update_laplacian_operator() override;
+
+    void compute_propagators(
+        std::map<std::string, const double*> w_block,
+        std::map<std::string, const double*> q_init = {}) override;
+
+    void compute_concentrations() override;
+
+    void compute_statistics(
+        std::map<std::string, const double*> w_block,
+        std::map<std::string, const double*> q_init = {}) override;
+
+    void compute_statistics_multi_source(
+        std::map<std::string, const double*> w_block,
+        std::string q_init_source, const double *q_init_batch,
+        std::map<std::string, const double*> q_init = {}) override;
+
+    void get_chain_propagator(double *q_out, int polymer, int v, int u, int n) override;
+    void get_total_concentration(std::string monomer_type, double *phi) override;
+    void get_total_concentration(int polymer, std::string monomer_type, double *phi) override;
+    void get_solvent_concentration(int s, double *phi) override;
+
+    // For tests
+    bool check_total_partition() override;
+};
+#endif
@@ -1,16 +1,20 @@
 #include <cmath>
+#include <thread>
+#include <algorithm>
 #include <omp.h>
 
 #include "CpuComputationContinuous.h"
 #include "CpuSolverPseudo.h"
 #include "CpuSolverReal.h"
+#include "CpuComputationBatchContinuous.h"
 #include "SimpsonRule.h"
 
 CpuComputationContinuous::CpuComputationContinuous(
     ComputationBox *cb,
     Molecules *molecules,
     PropagatorAnalyzer *propagator_analyzer,
-    std::string method)
+    std::string method,
+    bool reduce_memory_usage)
     : PropagatorComputation(cb, molecules, propagator_analyzer)
 {
     try
@@ -20,6 +24,8 @@ CpuComputationContinuous::CpuComputationContinuous(
         #endif
 
         const int M = cb->get_n_grid();
+        this->method = method;
+        this->batch_solver = nullptr;
         if(method == "pseudospectral")
             this->propagator_solver = new CpuSolverPseudo(cb, molecules);
         else if(method == "realspace")
@@ -36,23 +42,47 @@ CpuComputationContinuous::CpuComputationContinuous(
         std::cout << "The number of CPU threads: " << n_streams << std::endl;
         #endif
 
+        this->reduce_memory_usage = reduce_memory_usage;
+        this->is_phi_block_normalized = false;
+
+        // Trace propagator computation if the file name is given
+        const char *ENV_TRACE_FILE = getenv("LFTS_TRACE_FILE");
+        std::string env_trace_file(ENV_TRACE_FILE ? ENV_TRACE_FILE : "");
+        // Only the first LFTS_TRACE_MAX_CALLS calls of compute_propagators are recorded (default: 100)
+        const char *ENV_TRACE_MAX_CALLS = getenv("LFTS_TRACE_MAX_CALLS");
+        std::string env_trace_max_calls(ENV_TRACE_MAX_CALLS ? ENV_TRACE_MAX_CALLS : "");
+        if (env_trace_file.empty())
+            tracer = nullptr;
+        else if (env_trace_max_calls.empty())
+            tracer = new Tracer(n_streams, env_trace_file);
+        else
+            tracer = new Tracer(n_streams, env_trace_file, std::stoi(env_trace_max_calls));
+        propagator_solver->set_tracer(tracer);
+
         // Allocate memory for propagators
         if( propagator_analyzer->get_computation_propagators().size() == 0)
             throw_with_line_number("There is no propagator code. Add polymers first.");
+        const int N_PROPAGATORS = propagator_analyzer->get_computation_propagators().size();
+        propagator.resize(N_PROPAGATORS);
+        propagator_size.resize(N_PROPAGATORS);
+        #ifndef NDEBUG
+        propagator_finished.resize(N_PROPAGATORS);
+        #endif
         for(const auto& item: propagator_analyzer->get_computation_propagators())
         {
-            std::string key = item.first;
+            const int id = propagator_analyzer->get_propagator_id(item.first);
             int max_n_segment = item.second.max_n_segment+1;
 
-            propagator_size[key] = max_n_segment;
-            propagator[key] = new double*[max_n_segment];
-            for(int i=0; i<propagator_size[key]; i++)
-                propagator[key][i] = new double[M];
+            propagator_size[id] = max_n_segment;
+            propagator[id] = new double*[max_n_segment];
+            // If reduce_memory_usage is on, segments are allocated when the propagator computation starts
+            for(int i=0; i<propagator_size[id]; i++)
+                propagator[id][i] = reduce_memory_usage ? nullptr : new double[M];
 
             #ifndef NDEBUG
-            propagator_finished[key] = new bool[max_n_segment];
+            propagator_finished[id] = new bool[max_n_segment];
             for(int i=0; i<max_n_segment;i++)
-                propagator_finished[key][i] = false;
+                propagator_finished[id][i] = false;
             #endif
         }
 
@@ -79,13 +109,11 @@ CpuComputationContinuous::CpuComputationContinuous(
 
             int n_aggregated = propagator_analyzer->get_computation_block(key).v_u.size()/
                                propagator_analyzer->get_computation_block(key).n_repeated;
-            int n_segment_left = propagator_analyzer->get_computation_block(key).n_segment_left;
 
             single_partition_segment.push_back(std::make_tuple(
                 p,
-                propagator[key_left][n_segment_left],  // q
-                propagator[key_right][0],              // q_dagger
-                n_aggregated                           // how many propagators are aggregated
+                key,                // q(n_segment_left) of key_left, and q_dagger(0) of key_right
+                n_aggregated        // how many propagators are aggregated
                 ));
             current_p++;
         }
@@ -94,7 +122,40 @@ CpuComputationContinuous::CpuComputationContinuous(
             phi_solvent.push_back(new double[M]);
 
         // Create scheduler for computation of propagator
-        sc = new Scheduler(propagator_analyzer->get_computation_propagators(), n_streams); 
+        if (reduce_memory_usage)
+        {
+            // The maximum number of segments that are stored at the same time. 0 means no limit.
+            const char *ENV_MAX_LIVE_SEGMENTS = getenv("LFTS_MAX_LIVE_SEGMENTS");
+            std::string env_max_live_segments(ENV_MAX_LIVE_SEGMENTS ? ENV_MAX_LIVE_SEGMENTS  : "");
+            int max_live_segments = 0;
+            if (!env_max_live_segments.empty())
+                max_live_segments = std::stoi(env_max_live_segments);
+
+            sc = new Scheduler(
+                propagator_analyzer->get_computation_propagators(),
+                propagator_analyzer->get_computation_blocks(),
+                n_streams, max_live_segments);
+
+            // Merge time spans to reduce barriers. The cost of a barrier in units of segment steps can be given.
+            const char *ENV_BARRIER_COST = getenv("LFTS_BARRIER_COST");
+            std::string env_barrier_cost(ENV_BARRIER_COST ? ENV_BARRIER_COST  : "");
+            double barrier_cost = 0.0;
+            if (!env_barrier_cost.empty())
+                barrier_cost = std::stod(env_barrier_cost);
+            sc->coarsen_schedule(barrier_cost);
+
+            #ifndef NDEBUG
+            std::cout << "Peak number of live segments: " << sc->get_peak_live_segments() << std::endl;
+            #endif
+        }
+        else
+            sc = new Scheduler(propagator_analyzer->get_computation_propagators(), n_streams); 
+
+        propagator_progress = new std::atomic<int>[N_PROPAGATORS];
+        compile_propagator_plan();
+
+        if (tracer != nullptr)
+            tracer->set_plan(sc->get_planned_makespan(), sc->get_critical_path());
 
         propagator_solver->update_laplacian_operator();
     }
@@ -105,15 +166,35 @@ CpuComputationContinuous::CpuComputationContinuous(
 }
 CpuComputationContinuous::~CpuComputationContinuous()
 {
+    if (tracer != nullptr)
+    {
+        try
+        {
+            tracer->write_chrome_trace();
+            tracer->display_summary();
+        }
+        catch(std::exception& exc)
+        {
+            std::cout << exc.what() << std::endl;
+        }
+        delete tracer;
+    }
     delete propagator_solver;
+    delete batch_solver;
     delete sc;
 
-    for(const auto& item: propagator)
+    for(size_t p=0; p<propagator.size(); p++)
     {
-        for(int i=0; i<propagator_size[item.first]; i++)
-            delete[] item.second[i];
-        delete[] item.second;
+        for(int i=0; i<propagator_size[p]; i++)
+        {
+            if(propagator[p][i] != nullptr)
+                delete[] propagator[p][i];
+        }
+        delete[] propagator[p];
     }
+    delete[] propagator_progress;
+    for(const auto& item: segment_pool)
+        delete[] item;
 
     for(const auto& item: phi_block)
         delete[] item.second;
@@ -122,7 +203,7 @@ CpuComputationContinuous::~CpuComputationContinuous()
 
     #ifndef NDEBUG
     for(const auto& item: propagator_finished)
-        delete[] item.second;
+        delete[] item;
     #endif
 }
 void CpuComputationContinuous::update_laplacian_operator()
@@ -130,6 +211,8 @@ void CpuComputationContinuous::update_laplacian_operator()
     try
     {
         propagator_solver->update_laplacian_operator();
+        if (batch_solver != nullptr)
+            batch_solver->update_laplacian_operator();
     }
     catch(std::exception& exc)
     {
@@ -137,6 +220,97 @@ void CpuComputationContinuous::update_laplacian_operator()
     }
 }
 
+void CpuComputationContinuous::compute_statistics_batch(
+    std::vector<std::map<std::string, const double*>> w_inputs,
+    std::vector<std::string> monomer_types,
+    double *partitions, double *phi, int batch_size,
+    std::map<std::string, const double*> q_init)
+{
+    try
+    {
+        // The batch solver uses the pseudo-spectral method
+        if (method != "pseudospectral")
+        {
+            PropagatorComputation::compute_statistics_batch(w_inputs, monomer_types, partitions, phi, batch_size, q_init);
+            return;
+        }
+
+        const int M = cb->get_n_grid();
+        const int P = molecules->get_n_polymer_types();
+        const int S = monomer_types.size();
+        const int K = w_inputs.size();
+
+        if (batch_size < 1)
+            throw_with_line_number("The batch size (" + std::to_string(batch_size) + ") must be positive.");
+        if (K == 0)
+            return;
+
+        // One batch solver of batch_size replicas is used for all batches. The last batch is padded
+        // with the last set of fields, and the results of the padded replicas are discarded.
+        if (batch_solver == nullptr || batch_solver->get_n_replicas() != batch_size)
+        {
+            delete batch_solver;
+            batch_solver = nullptr;
+            batch_solver = new CpuComputationBatchContinuous(cb, molecules, propagator_analyzer, batch_size);
+        }
+
+        // Contiguous fields, initial conditions and concentrations of a batch
+        std::map<std::string, std::vector<double>> w_batch, q_init_batch;
+        for(const auto& item: w_inputs[0])
+            w_batch[item.first].resize(batch_size*M);
+        for(const auto& item: q_init)
+        {
+            q_init_batch[item.first].resize(batch_size*M);
+            for(int r=0; r<batch_size; r++)
+                for(int i=0; i<M; i++)
+                    q_init_batch[item.first][r*M+i] = item.second[i];
+        }
+        std::vector<double> phi_batch(batch_size*M);
+
+        for(int k_from=0; k_from<K; k_from+=batch_size)
+        {
+            const int R = std::min(batch_size, K-k_from);
+
+            // Gather fields
+            for(auto& item: w_batch)
+            {
+                for(int r=0; r<batch_size; r++)
+                {
+                    const int k = std::min(k_from+r, K-1);
+                    const auto& w_input = w_inputs[k];
+                    if (w_input.size() != w_batch.size() || w_input.find(item.first) == w_input.end())
+                        throw_with_line_number("Monomer types of w_inputs[" + std::to_string(k) + "] and w_inputs[0] must match.");
+                    const double *_w = w_input.at(item.first);
+                    for(int i=0; i<M; i++)
+                        item.second[r*M+i] = _w[i];
+                }
+            }
+            std::map<std::string, const double*> w_block, q_init_block;
+            for(const auto& item: w_batch)
+                w_block[item.first] = item.second.data();
+            for(const auto& item: q_init_batch)
+                q_init_block[item.first] = item.second.data();
+
+            batch_solver->compute_statistics(w_block, q_init_block);
+
+            // Scatter partition functions and concentrations
+            for(int r=0; r<R; r++)
+                for(int p=0; p<P; p++)
+                    partitions[(k_from+r)*P+p] = batch_solver->get_total_partition(r, p);
+            for(int s=0; s<S; s++)
+            {
+                batch_solver->get_total_concentration(monomer_types[s], phi_batch.data());
+                for(int r=0; r<R; r++)
+                    for(int i=0; i<M; i++)
+                        phi[((k_from+r)*S+s)*M+i] = phi_batch[r*M+i];
+            }
+        }
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
 void CpuComputationContinuous::compute_statistics(
     std::map<std::string, const double*> w_input,
     std::map<std::string, const double*> q_init)
@@ -162,212 +336,385 @@ void CpuComputationContinuous::compute_propagators(
         // Update dw or exp_dw
         propagator_solver->update_dw(w_input);
 
-        // Assign a pointer for mask
-        const double *q_mask = cb->get_mask();
+        double trace_start = (tracer != nullptr) ? tracer->now() : 0.0;
+
+        // Keep q_init to recompute propagators later
+        if (reduce_memory_usage || propagator_analyzer->is_aggregated())
+        {
+            q_init_copy.clear();
+            for(const auto& item: q_init)
+                q_init_copy[item.first] = std::vector<double>(item.second, item.second+M);
+        }
+        // Propagators before aggregation are recovered again from the new propagators
+        recovered_propagators.clear();
+        recovered_segments.clear();
+
+        if (reduce_memory_usage)
+        {
+            // Compute concentrations and total partition functions before propagators are released
+            is_phi_block_normalized = false;
+            compute_propagators_by_schedule(q_init,
+                [this](const std::tuple<int, std::string, std::string>& key)
+                {
+                    compute_block_concentration(key);
+                    compute_single_partition(key);
+                });
+        }
+        else
+        {
+            compute_propagators_by_stream(q_init);
+
+            // Compute total partition function of each distinct polymers
+            for(const auto& segment_info: single_partition_segment)
+                compute_single_partition(std::get<1>(segment_info));
+        }
+        if (tracer != nullptr)
+            tracer->add_phase("compute_propagators", trace_start);
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+void CpuComputationContinuous::compute_propagators_by_schedule(
+    std::map<std::string, const double*>& q_init,
+    std::function<void(const std::tuple<int, std::string, std::string>&)> block_consumer)
+{
+    try
+    {
+        resolve_q_init(q_init);
 
         // For each time span
-        auto& branch_schedule = sc->get_schedule();
-        for (auto parallel_job = branch_schedule.begin(); parallel_job != branch_schedule.end(); parallel_job++)
+        for(size_t span=0; span<span_jobs.size(); span++)
         {
+            const auto& jobs = span_jobs[span];
             // display all jobs
             #ifndef NDEBUG
             std::cout << "jobs:" << std::endl;
-            for(size_t job=0; job<parallel_job->size(); job++)
+            for(size_t job=0; job<jobs.size(); job++)
             {
-                auto& key = std::get<0>((*parallel_job)[job]);
-                int n_segment_from = std::get<1>((*parallel_job)[job]);
-                int n_segment_to = std::get<2>((*parallel_job)[job]);
+                const std::string& key = propagator_analyzer->get_propagator_key(std::get<0>(jobs[job]));
+                int n_segment_from = std::get<1>(jobs[job]);
+                int n_segment_to = std::get<2>(jobs[job]);
                 std::cout << "key, n_segment_from, n_segment_to: " + key + ", " + std::to_string(n_segment_from) + ", " + std::to_string(n_segment_to) + ". " << std::endl;
             }
             #endif
 
-            // For each propagator
-            #pragma omp parallel for num_threads(n_streams)
-            for(size_t job=0; job<parallel_job->size(); job++)
+            // Allocate memory for propagators that start in this time span
+            if (reduce_memory_usage)
             {
-                auto& key = std::get<0>((*parallel_job)[job]);
-                int n_segment_from = std::get<1>((*parallel_job)[job]);
-                int n_segment_to   = std::get<2>((*parallel_job)[job]);
-                auto& deps = propagator_analyzer->get_computation_propagator(key).deps;
-                auto monomer_type = propagator_analyzer->get_computation_propagator(key).monomer_type;
-
-                // // Display job info
-                // #ifndef NDEBUG
-                // std::cout << job << " started" << std::endl;
-                // #endif
-
-                // Check key
-                #ifndef NDEBUG
-                if (propagator.find(key) == propagator.end())
-                    std::cout << "Could not find key '" + key + "'. " << std::endl;
-                #endif
+                for(size_t job=0; job<jobs.size(); job++)
+                {
+                    if (std::get<1>(jobs[job]) == 0)
+                        allocate_propagator(std::get<0>(jobs[job]));
+                }
+            }
 
-                double **_propagator = propagator[key];
+            // For each propagator
+            double span_start = (tracer != nullptr) ? tracer->now() : 0.0;
+            #pragma omp parallel for num_threads(n_streams) schedule(dynamic)
+            for(size_t job=0; job<jobs.size(); job++)
+                compute_propagator_job(std::get<0>(jobs[job]), std::get<1>(jobs[job]), std::get<2>(jobs[job]));
 
-                // If it is leaf node
-                if(n_segment_from == 0 && deps.size() == 0) 
-                {
-                     // q_init
-                    if (key[0] == '{')
-                    {
-                        std::string g = PropagatorCode::get_q_input_idx_from_key(key);
-                        if (q_init.find(g) == q_init.end())
-                            std::cout << "Could not find q_init[\"" + g + "\"]." << std::endl;
-                        for(int i=0; i<M; i++)
-                            _propagator[0][i] = q_init[g][i];
-                    }
-                    else
-                    {
-                        for(int i=0; i<M; i++)
-                            _propagator[0][i] = 1.0;
-                    }
+            if (tracer != nullptr)
+                tracer->add_phase("span " + std::to_string(span), span_start);
 
-                    #ifndef NDEBUG
-                    propagator_finished[key][0] = true;
-                    #endif
+            // Compute blocks whose propagators are finished, and release propagators that are no longer needed
+            if (reduce_memory_usage)
+            {
+                double blocks_start = (tracer != nullptr) ? tracer->now() : 0.0;
+                auto& finished_blocks = sc->get_finished_blocks()[span];
+                #pragma omp parallel for num_threads(n_streams)
+                for(size_t b=0; b<finished_blocks.size(); b++)
+                {
+                    TraceScope trace_scope(tracer, finished_blocks[b], "block");
+                    block_consumer(finished_blocks[b]);
                 }
-                // If it is not leaf node
-                else if (n_segment_from == 0 && deps.size() > 0) 
+                if (tracer != nullptr)
+                    tracer->add_phase("blocks " + std::to_string(span), blocks_start);
+
+                for(int id: span_released[span])
+                    release_propagator(id);
+            }
+        }
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+void CpuComputationContinuous::compute_propagators_by_stream(std::map<std::string, const double*>& q_init)
+{
+    try
+    {
+        auto& job_queues = sc->get_stream_job_queues();
+        auto& checkpoints = sc->get_checkpoints();
+        resolve_q_init(q_init);
+
+        for(int p=0; p<propagator_analyzer->get_n_computation_propagator_codes(); p++)
+            propagator_progress[p].store(-1, std::memory_order_relaxed);
+
+        // Each thread needs its own stream. Otherwise, follow the time spans.
+        int n_threads = 0;
+        double trace_start = (tracer != nullptr) ? tracer->now() : 0.0;
+        #pragma omp parallel num_threads(n_streams)
+        {
+            #pragma omp single
+            n_threads = omp_get_num_threads();
+
+            const int STREAM = omp_get_thread_num();
+            if (n_threads == static_cast<int>(job_queues.size()))
+            {
+                for(int id: job_queues[STREAM])
                 {
-                    // If it is aggregated
-                    if (key[0] == '[')
+                    // Wait until the segments of dependencies are computed
                     {
-                        for(int i=0; i<M; i++)
-                            _propagator[0][i] = 0.0;
-                        
-                        // Add all propagators at junction if necessary 
-                        for(size_t d=0; d<deps.size(); d++)
+                        TraceScope trace_scope(tracer, propagator_analyzer->get_propagator_key(id), "wait");
+                        for(const auto& dep: propagator_plan[id].junction)
                         {
-                            std::string sub_dep = std::get<0>(deps[d]);
-                            int sub_n_segment   = std::get<1>(deps[d]);
-                            int sub_n_repeated  = std::get<2>(deps[d]);
-
-                            // Check sub key
-                            #ifndef NDEBUG
-                            if (propagator.find(sub_dep) == propagator.end())
-                                std::cout << "Could not find sub key '" + sub_dep + "'. " << std::endl;
-                            if (!propagator_finished[sub_dep][sub_n_segment])
-                                std::cout << "Could not compute '" + key +  "', since '"+ sub_dep + std::to_string(sub_n_segment) + "' is not prepared." << std::endl;
-                            #endif
-
-                            double **_propagator_sub_dep = propagator[sub_dep];
-                            for(int i=0; i<M; i++)
-                                _propagator[0][i] += _propagator_sub_dep[sub_n_segment][i]*sub_n_repeated;
+                            std::atomic<int>& sub_progress = propagator_progress[std::get<0>(dep)];
+                            while(sub_progress.load(std::memory_order_acquire) < std::get<2>(dep))
+                                std::this_thread::yield();
                         }
-                        #ifndef NDEBUG
-                        propagator_finished[key][0] = true;
-                        #endif
-                        // std::cout << "finished, key, n: " + key + ", 0" << std::endl;
                     }
-                    else
-                    {
-                        for(int i=0; i<M; i++)
-                            _propagator[0][i] = 1.0;
-                        
-                        // Multiply all propagators at junction if necessary 
-                        for(size_t d=0; d<deps.size(); d++)
-                        {
-                            std::string sub_dep = std::get<0>(deps[d]);
-                            int sub_n_segment   = std::get<1>(deps[d]);
-
-                            // Check sub key
-                            #ifndef NDEBUG
-                            if (propagator.find(sub_dep) == propagator.end())
-                                std::cout << "Could not find sub key '" + sub_dep + "'. " << std::endl;
-                            if (!propagator_finished[sub_dep][sub_n_segment])
-                                std::cout << "Could not compute '" + key +  "', since '"+ sub_dep + std::to_string(sub_n_segment) + "' is not prepared." << std::endl;
-                            #endif
-
-                            double **_propagator_sub_dep = propagator[sub_dep];
-                            for(int i=0; i<M; i++)
-                                _propagator[0][i] *= _propagator_sub_dep[sub_n_segment][i];
-                        }
 
-                        #ifndef NDEBUG
-                        propagator_finished[key][0] = true;
-                        #endif
-                        // std::cout << "finished, key, n: " + key + ", 0" << std::endl;
+                    // Compute segments up to each checkpoint, and notify the dependents
+                    std::atomic<int>& progress = propagator_progress[id];
+                    int n_segment_from = 0;
+                    for(int n_segment_to: checkpoints[id])
+                    {
+                        compute_propagator_job(id, n_segment_from, n_segment_to);
+                        progress.store(n_segment_to, std::memory_order_release);
+                        n_segment_from = n_segment_to;
                     }
                 }
-        
-                // Multiply mask
-                if (n_segment_from == 0 && q_mask != nullptr)
-                {
-                    for(int i=0; i<M; i++)
-                        _propagator[0][i] *= q_mask[i];
-                }
-
-                // Advance propagator successively
-                for(int n=n_segment_from; n<n_segment_to; n++)
-                {
-                    #ifndef NDEBUG
-                    if (!propagator_finished[key][n])
-                        std::cout << "unfinished, key: " + key + ", " + std::to_string(n) << std::endl;
-                    if (propagator_finished[key][n+1])
-                        std::cout << "already finished: " + key + ", " + std::to_string(n) << std::endl;
-                    #endif
-
-                    propagator_solver->advance_propagator_continuous(
-                            _propagator[n],
-                            _propagator[n+1],
-                            monomer_type, q_mask);
-
-                    #ifndef NDEBUG
-                    propagator_finished[key][n+1] = true;
-                    #endif
-                }
-                // // Display job info
-                // #ifndef NDEBUG
-                // std::cout << job << " finished" << std::endl;
-                // #endif
             }
         }
+        if (tracer != nullptr)
+            tracer->add_phase("streams", trace_start);
 
-        // for(const auto& block: phi_block)
-        // {
-        //     int p                = std::get<0>(block.first);
-        //     std::string key_left    = std::get<1>(block.first);
-        //     std::string key_right    = std::get<2>(block.first);
-        //     int n_segment        = std::get<3>(block.first);
+        if (n_threads != static_cast<int>(job_queues.size()))
+            compute_propagators_by_schedule(q_init, nullptr);
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+void CpuComputationContinuous::compile_propagator_plan()
+{
+    try
+    {
+        // Resolve deps and initial conditions of each propagator
+        propagator_plan.clear();
+        q_init_names.clear();
+        for(int id=0; id<propagator_analyzer->get_n_computation_propagator_codes(); id++)
+        {
+            const std::string& key = propagator_analyzer->get_propagator_key(id);
+            const ComputationEdge& edge = propagator_analyzer->get_computation_propagator(id);
+
+            PropagatorPlan plan = make_propagator_plan(key, edge, propagator[id]);
+            for(const auto& dep: edge.dep_ids)
+            {
+                int sub_dep = std::get<0>(dep);
+                plan.junction.push_back(std::make_tuple(sub_dep, propagator[sub_dep], std::get<1>(dep), std::get<2>(dep)));
+            }
+            propagator_plan.push_back(plan);
+        }
+        q_init_ptr.resize(q_init_names.size());
+
+        // Jobs of each time span
+        span_jobs.clear();
+        span_released.clear();
+        span_jobs = sc->get_schedule_ids();
+        span_released.resize(span_jobs.size());
+        if (reduce_memory_usage)
+            span_released = sc->get_released_propagator_ids();
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+CpuComputationContinuous::PropagatorPlan CpuComputationContinuous::make_propagator_plan(
+    const std::string& key, const ComputationEdge& edge, double **q)
+{
+    PropagatorPlan plan;
+    plan.q = q;
+    plan.monomer_type = &edge.monomer_type;
+    plan.q_init_idx = -1;
+    if (edge.deps.size() == 0 && key[0] == '{')
+    {
+        std::string g = PropagatorCode::get_q_input_idx_from_key(key);
+        auto it = std::find(q_init_names.begin(), q_init_names.end(), g);
+        plan.q_init_idx = it - q_init_names.begin();
+        if (it == q_init_names.end())
+            q_init_names.push_back(g);
+        plan.initial_condition = InitialCondition::Q_INIT;
+    }
+    else if (edge.deps.size() == 0)
+        plan.initial_condition = InitialCondition::ONES;
+    // If it is aggregated
+    else if (key[0] == '[')
+        plan.initial_condition = InitialCondition::SUM;
+    else
+        plan.initial_condition = InitialCondition::PRODUCT;
+    return plan;
+}
+void CpuComputationContinuous::resolve_q_init(std::map<std::string, const double*>& q_init)
+{
+    for(size_t i=0; i<q_init_names.size(); i++)
+    {
+        if (q_init.find(q_init_names[i]) == q_init.end())
+            throw_with_line_number("Could not find q_init[\"" + q_init_names[i] + "\"].");
+        q_init_ptr[i] = q_init[q_init_names[i]];
+    }
+}
+void CpuComputationContinuous::compute_propagator_job(int id, int n_segment_from, int n_segment_to)
+{
+    TraceScope trace_scope(tracer, propagator_analyzer->get_propagator_key(id), "propagator", n_segment_from, n_segment_to);
+    compute_propagator_segments(propagator_plan[id], id, n_segment_from, n_segment_to);
+}
+void CpuComputationContinuous::compute_propagator_segments(const PropagatorPlan& plan, int id, int n_segment_from, int n_segment_to)
+{
+    const int M = cb->get_n_grid();
+    const double *q_mask = cb->get_mask();
 
-        //     // Check keys
-        //     if (propagator.find(key_left) == propagator.end())
-        //         throw_with_line_number("Could not find key_left key'" + key_left + "'. ");
-        //     if (propagator.find(key_right) == propagator.end())
-        //         throw_with_line_number("Could not find key_right key'" + key_right + "'. ");
+    #ifndef NDEBUG
+    // Only the computation propagators are checked
+    const std::string key = (id >= 0) ? propagator_analyzer->get_propagator_key(id) : "";
+    #endif
 
-        //     for(int i=0; i<=n_segment; i++)
-        //     {
-        //         if (!propagator_finished[key_left][i])
-        //             throw_with_line_number("unfinished, key_left, n'" + key_left + ", " + std::to_string(i) + "'. ");
-        //     }
+    double **_propagator = plan.q;
 
-        //     for(int i=0; i<=n_segment; i++)
-        //     {
-        //         if (!propagator_finished[key_right][i])
-        //             throw_with_line_number("unfinished, key_right, n'" + key_right + ", " + std::to_string(i) + "'. ");
-        //     }
-        // }
+    if (n_segment_from == 0)
+    {
+        // If it is leaf node
+        if (plan.initial_condition == InitialCondition::ONES)
+        {
+            for(int i=0; i<M; i++)
+                _propagator[0][i] = 1.0;
+        }
+        // q_init
+        else if (plan.initial_condition == InitialCondition::Q_INIT)
+        {
+            const double *_q_init = q_init_ptr[plan.q_init_idx];
+            for(int i=0; i<M; i++)
+                _propagator[0][i] = _q_init[i];
+        }
+        // If it is aggregated, add all propagators at junction
+        else if (plan.initial_condition == InitialCondition::SUM)
+        {
+            for(int i=0; i<M; i++)
+                _propagator[0][i] = 0.0;
+            for(const auto& dep: plan.junction)
+            {
+                // Check sub key
+                #ifndef NDEBUG
+                if (id >= 0 && !propagator_finished[std::get<0>(dep)][std::get<2>(dep)])
+                    std::cout << "Could not compute '" + key +  "', since '"+ propagator_analyzer->get_propagator_key(std::get<0>(dep)) + std::to_string(std::get<2>(dep)) + "' is not prepared." << std::endl;
+                #endif
 
-        // Compute total partition function of each distinct polymers
-        for(const auto& segment_info: single_partition_segment)
+                const double *_q_sub = std::get<1>(dep)[std::get<2>(dep)];
+                const double sub_n_repeated = std::get<3>(dep);
+                for(int i=0; i<M; i++)
+                    _propagator[0][i] += _q_sub[i]*sub_n_repeated;
+            }
+        }
+        // Multiply all propagators at junction
+        else
         {
-            int p                    = std::get<0>(segment_info);
-            double *propagator_left  = std::get<1>(segment_info);
-            double *propagator_right = std::get<2>(segment_info);
-            int n_aggregated         = std::get<3>(segment_info);
+            for(int i=0; i<M; i++)
+                _propagator[0][i] = 1.0;
+            for(const auto& dep: plan.junction)
+            {
+                // Check sub key
+                #ifndef NDEBUG
+                if (id >= 0 && !propagator_finished[std::get<0>(dep)][std::get<2>(dep)])
+                    std::cout << "Could not compute '" + key +  "', since '"+ propagator_analyzer->get_propagator_key(std::get<0>(dep)) + std::to_string(std::get<2>(dep)) + "' is not prepared." << std::endl;
+                #endif
 
-            single_polymer_partitions[p]= cb->inner_product(
-                propagator_left, propagator_right)/n_aggregated/cb->get_volume();
+                const double *_q_sub = std::get<1>(dep)[std::get<2>(dep)];
+                for(int i=0; i<M; i++)
+                    _propagator[0][i] *= _q_sub[i];
+            }
         }
 
+        // Multiply mask
+        if (q_mask != nullptr)
+        {
+            for(int i=0; i<M; i++)
+                _propagator[0][i] *= q_mask[i];
+        }
+
+        #ifndef NDEBUG
+        if (id >= 0)
+            propagator_finished[id][0] = true;
+        #endif
     }
-    catch(std::exception& exc)
+
+    // Advance propagator successively
+    for(int n=n_segment_from; n<n_segment_to; n++)
     {
-        throw_without_line_number(exc.what());
+        #ifndef NDEBUG
+        if (id >= 0 && !propagator_finished[id][n])
+            std::cout << "unfinished, key: " + key + ", " + std::to_string(n) << std::endl;
+        if (id >= 0 && propagator_finished[id][n+1])
+            std::cout << "already finished: " + key + ", " + std::to_string(n) << std::endl;
+        #endif
+
+        propagator_solver->advance_propagator_continuous(
+                _propagator[n],
+                _propagator[n+1],
+                *plan.monomer_type, q_mask);
+
+        #ifndef NDEBUG
+        if (id >= 0)
+            propagator_finished[id][n+1] = true;
+        #endif
+    }
+}
+void CpuComputationContinuous::allocate_propagator(int id)
+{
+    const int M = cb->get_n_grid();
+    for(int i=0; i<propagator_size[id]; i++)
+    {
+        if (segment_pool.empty())
+            propagator[id][i] = new double[M];
+        else
+        {
+            propagator[id][i] = segment_pool.back();
+            segment_pool.pop_back();
+        }
+    }
+}
+void CpuComputationContinuous::release_propagator(int id)
+{
+    for(int i=0; i<propagator_size[id]; i++)
+    {
+        segment_pool.push_back(propagator[id][i]);
+        propagator[id][i] = nullptr;
+
+        #ifndef NDEBUG
+        propagator_finished[id][i] = false;
+        #endif
     }
 }
+void CpuComputationContinuous::compute_single_partition(const std::tuple<int, std::string, std::string>& key)
+{
+    for(const auto& segment_info: single_partition_segment)
+    {
+        if (std::get<1>(segment_info) != key)
+            continue;
+
+        int p                 = std::get<0>(segment_info);
+        int n_aggregated      = std::get<2>(segment_info);
+        const ComputationBlock& block = propagator_analyzer->get_computation_block(key);
 
+        single_polymer_partitions[p]= cb->inner_product(
+            propagator[block.id_left][block.n_segment_left], propagator[block.id_right][0])/n_aggregated/cb->get_volume();
+    }
+}
 void CpuComputationContinuous::compute_concentrations()
 {
     try
@@ -375,44 +722,29 @@ void CpuComputationContinuous::compute_concentrations()
         const int M = cb->get_n_grid();
 
         // Calculate segment concentrations
+        double trace_start = (tracer != nullptr) ? tracer->now() : 0.0;
         #pragma omp parallel for num_threads(n_streams)
         for(size_t b=0; b<phi_block.size();b++)
         {
             auto block = phi_block.begin();
             advance(block, b);
             const auto& key = block->first;
+            TraceScope trace_scope(tracer, key, "concentration");
 
-            int p                 = std::get<0>(key);
-            std::string key_left  = std::get<1>(key);
-            std::string key_right = std::get<2>(key);
+            int p = std::get<0>(key);
+            const ComputationBlock& computation_block = propagator_analyzer->get_computation_block(key);
+            int n_segment_right = computation_block.n_segment_right;
+            int n_repeated = computation_block.n_repeated;
 
-            int n_segment_right = propagator_analyzer->get_computation_block(key).n_segment_right;
-            int n_segment_left  = propagator_analyzer->get_computation_block(key).n_segment_left;
-            int n_repeated = propagator_analyzer->get_computation_block(key).n_repeated;
+            // If reduce_memory_usage is on, concentrations are already computed in compute_propagators()
+            if (!reduce_memory_usage)
+                compute_block_concentration(key);
+            else if (is_phi_block_normalized)
+                continue;
 
             // If there is no segment
             if(n_segment_right == 0)
-            {
-                for(int i=0; i<M;i++)
-                    block->second[i] = 0.0;
                 continue;
-            }
-
-            // Check keys
-            #ifndef NDEBUG
-            if (propagator.find(key_left) == propagator.end())
-                std::cout << "Could not find key_left key'" + key_left + "'. " << std::endl;
-            if (propagator.find(key_right) == propagator.end())
-                std::cout << "Could not find key_right key'" + key_right + "'. " << std::endl;
-            #endif
-
-            // Calculate phi of one block (possibly multiple blocks when using aggregation)
-            calculate_phi_one_block(
-                block->second,          // phi
-                propagator[key_left],   // dependency v
-                propagator[key_right],  // dependency u
-                n_segment_right,
-                n_segment_left);
 
             // Normalize concentration
             Polymer& pc = molecules->get_polymer(p);
@@ -420,6 +752,9 @@ void CpuComputationContinuous::compute_concentrations()
             for(int i=0; i<M; i++)
                 block->second[i] *= norm;
         }
+        is_phi_block_normalized = true;
+        if (tracer != nullptr)
+            tracer->add_phase("compute_concentrations", trace_start);
 
         // Calculate partition functions and concentrations of solvents
         for(int s=0; s<molecules->get_n_solvent_types(); s++)
@@ -441,6 +776,32 @@ void CpuComputationContinuous::compute_concentrations()
         throw_without_line_number(exc.what());
     }
 }
+void CpuComputationContinuous::compute_block_concentration(const std::tuple<int, std::string, std::string>& key)
+{
+    const int M = cb->get_n_grid();
+
+    const ComputationBlock& block = propagator_analyzer->get_computation_block(key);
+    int n_segment_right = block.n_segment_right;
+    int n_segment_left  = block.n_segment_left;
+    double *_phi = phi_block[key];
+
+    // If there is no segment
+    if(n_segment_right == 0)
+    {
+        for(int i=0; i<M;i++)
+            _phi[i] = 0.0;
+        return;
+    }
+
+    // Check keys
+    // Calculate phi of one block (possibly multiple blocks when using aggregation)
+    calculate_phi_one_block(
+        _phi,                   // phi
+        propagator[block.id_left],   // dependency v
+        propagator[block.id_right],  // dependency u
+        n_segment_right,
+        n_segment_left);
+}
 void CpuComputationContinuous::calculate_phi_one_block(
     double *phi, double **q_1, double **q_2, const int N_RIGHT, const int N_LEFT)
 {
@@ -587,12 +948,17 @@ void CpuComputationContinuous::get_block_concentration(int p, double *phi)
         if (p < 0 || p > P-1)
             throw_with_line_number("Index (" + std::to_string(p) + ") must be in range [0, " + std::to_string(P-1) + "]");
 
-        if (propagator_analyzer->is_aggregated())
-            throw_with_line_number("Disable 'aggregation' option to invoke 'get_block_concentration'.");
-
         Polymer& pc = molecules->get_polymer(p);
         std::vector<Block>& blocks = pc.get_blocks();
 
+        // If propagators are aggregated, blocks are recovered from the propagators before aggregation
+        if (propagator_analyzer->is_aggregated())
+        {
+            if (reduce_memory_usage)
+                throw_with_line_number("Disable 'reduce_memory_usage' option to invoke 'get_block_concentration' with aggregation.");
+            recover_original_propagators(p);
+        }
+
         for(size_t b=0; b<blocks.size(); b++)
         {
             std::string key_left  = pc.get_propagator_key(blocks[b].v, blocks[b].u);
@@ -600,9 +966,29 @@ void CpuComputationContinuous::get_block_concentration(int p, double *phi)
             if (key_left < key_right)
                 key_left.swap(key_right);
 
-            double* _essential_phi_block = phi_block[std::make_tuple(p, key_left, key_right)];
+            if (!propagator_analyzer->is_aggregated())
+            {
+                double* _essential_phi_block = phi_block[std::make_tuple(p, key_left, key_right)];
+                for(int i=0; i<M; i++)
+                    phi[i+b*M] = _essential_phi_block[i]; 
+                continue;
+            }
+
+            const ComputationBlock& block = propagator_analyzer->get_original_blocks().at(std::make_tuple(p, key_left, key_right));
+            double *_phi = &phi[b*M];
+            if (block.n_segment_right == 0)
+            {
+                for(int i=0; i<M; i++)
+                    _phi[i] = 0.0;
+                continue;
+            }
+            calculate_phi_one_block(_phi, recovered_propagators[key_left].data(), recovered_propagators[key_right].data(),
+                block.n_segment_right, block.n_segment_left);
+
+            // Normalize concentration
+            double norm = molecules->get_ds()*pc.get_volume_fraction()/pc.get_alpha()/single_polymer_partitions[p]*block.n_repeated;
             for(int i=0; i<M; i++)
-                phi[i+b*M] = _essential_phi_block[i]; 
+                _phi[i] *= norm;
         }
     }
     catch(std::exception& exc)
@@ -610,6 +996,81 @@ void CpuComputationContinuous::get_block_concentration(int p, double *phi)
         throw_without_line_number(exc.what());
     }
 }
+void CpuComputationContinuous::recover_original_propagators(int p)
+{
+    const int M = cb->get_n_grid();
+    auto& original_propagators = propagator_analyzer->get_original_propagators();
+    auto& computation_propagators = propagator_analyzer->get_computation_propagators();
+
+    // Find propagators required by the blocks of the polymer that are not recovered yet.
+    // Deps are not required if the propagator is already computed.
+    std::set<std::string, ComparePropagatorKey> required_keys;
+    std::vector<std::string> stack;
+    for(const auto& block: propagator_analyzer->get_original_blocks())
+    {
+        if (std::get<0>(block.first) != p)
+            continue;
+        stack.push_back(std::get<1>(block.first));
+        stack.push_back(std::get<2>(block.first));
+    }
+    while(!stack.empty())
+    {
+        std::string key = stack.back();
+        stack.pop_back();
+        if (recovered_propagators.find(key) != recovered_propagators.end() || !required_keys.insert(key).second)
+            continue;
+        auto it = computation_propagators.find(key);
+        if (it != computation_propagators.end() && it->second.max_n_segment > 0)
+            continue;
+        for(const auto& dep: original_propagators.at(key).deps)
+            stack.push_back(std::get<0>(dep));
+    }
+
+    // Plans of the segments to be computed, (plan, n_segment_from, n_segment_to)
+    // Deps have lower heights, so they are recovered first
+    std::vector<std::tuple<PropagatorPlan, int, int>> plans;
+    for(const std::string& key: required_keys)
+    {
+        const ComputationEdge& edge = original_propagators.at(key);
+        const int N = edge.max_n_segment;
+        std::vector<double *>& _q = recovered_propagators[key];
+
+        // Reuse segments that are already computed
+        int n_computed = -1;
+        auto it = computation_propagators.find(key);
+        if (it != computation_propagators.end() && it->second.max_n_segment > 0)
+        {
+            double **_q_computed = propagator[propagator_analyzer->get_propagator_id(key)];
+            n_computed = std::min(it->second.max_n_segment, N);
+            _q.assign(_q_computed, _q_computed+n_computed+1);
+        }
+        for(int n=n_computed+1; n<=N; n++)
+        {
+            recovered_segments.push_back(std::vector<double>(M));
+            _q.push_back(recovered_segments.back().data());
+        }
+        if (n_computed == N)
+            continue;
+
+        PropagatorPlan plan = make_propagator_plan(key, edge, _q.data());
+        for(const auto& dep: edge.deps)
+        {
+            plan.junction.push_back(std::make_tuple(-1, recovered_propagators[std::get<0>(dep)].data(),
+                std::get<1>(dep), std::get<2>(dep)));
+        }
+        plans.push_back(std::make_tuple(plan, std::max(n_computed, 0), N));
+    }
+
+    // The arrays of q_init given to compute_propagators may be freed, so their copies are used
+    std::map<std::string, const double*> q_init;
+    for(const auto& item: q_init_copy)
+        q_init[item.first] = item.second.data();
+    q_init_ptr.resize(q_init_names.size());
+    resolve_q_init(q_init);
+
+    for(const auto& item: plans)
+        compute_propagator_segments(std::get<0>(item), -1, std::get<1>(item), std::get<2>(item));
+}
 double CpuComputationContinuous::get_solvent_partition(int s)
 {
     try
@@ -640,6 +1101,20 @@ void CpuComputationContinuous::get_solvent_concentration(int s, double *phi)
         throw_without_line_number(exc.what());
     }
 }
+std::map<std::tuple<int, std::string, std::string>, const double*> CpuComputationContinuous::get_block_concentration_ptrs()
+{
+    std::map<std::tuple<int, std::string, std::string>, const double*> ptrs;
+    for(const auto& item: phi_block)
+        ptrs[item.first] = item.second;
+    return ptrs;
+}
+const double* CpuComputationContinuous::get_solvent_concentration_ptr(int s)
+{
+    const int S = molecules->get_n_solvent_types();
+    if (s < 0 || s > S-1)
+        throw_with_line_number("Index (" + std::to_string(s) + ") must be in range [0, " + std::to_string(S-1) + "]");
+    return phi_solvent[s];
+}
 void CpuComputationContinuous::compute_stress()
 {
     // This method should be invoked after invoking compute_statistics().
@@ -662,42 +1137,34 @@ void CpuComputationContinuous::compute_stress()
         }
 
         // Compute stress for each block
-        #pragma omp parallel for num_threads(n_streams)
-        for(size_t b=0; b<phi_block.size();b++)
+        double trace_start = (tracer != nullptr) ? tracer->now() : 0.0;
+        if (!reduce_memory_usage)
         {
-            auto block = phi_block.begin();
-            advance(block, b);
-            const auto& key   = block->first;
-
-            std::string key_left  = std::get<1>(key);
-            std::string key_right = std::get<2>(key);
-
-            const int N_RIGHT = propagator_analyzer->get_computation_block(key).n_segment_right;
-            const int N_LEFT  = propagator_analyzer->get_computation_block(key).n_segment_left;
-            std::string monomer_type = propagator_analyzer->get_computation_block(key).monomer_type;
-            int n_repeated = propagator_analyzer->get_computation_block(key).n_repeated;
-
-            // If there is no segment
-            if(N_RIGHT == 0)
-                continue;
-
-            double **q_1 = propagator[key_left];     // dependency v
-            double **q_2 = propagator[key_right];    // dependency u
-
-            std::vector<double> s_coeff = SimpsonRule::get_coeff(N_RIGHT);
-            std::array<double,3> _block_dq_dl = block_dq_dl[key];
-
-            // Compute
-            for(int n=0; n<=N_RIGHT; n++)
+            #pragma omp parallel for num_threads(n_streams)
+            for(size_t b=0; b<phi_block.size();b++)
             {
-                std::vector<double> segment_stress = propagator_solver->compute_single_segment_stress_continuous(
-                    q_1[N_LEFT-n], q_2[n], monomer_type);
-                for(int d=0; d<DIM; d++)
-                    _block_dq_dl[d] += segment_stress[d]*s_coeff[n]*n_repeated;
+                auto block = phi_block.begin();
+                advance(block, b);
+                TraceScope trace_scope(tracer, block->first, "stress");
+                block_dq_dl[block->first] = compute_block_stress(block->first);
             }
-            block_dq_dl[key] = _block_dq_dl;
+        }
+        // Propagators are already released, so recompute them
+        else
+        {
+            std::map<std::string, const double*> q_init;
+            for(const auto& item: q_init_copy)
+                q_init[item.first] = item.second.data();
+            compute_propagators_by_schedule(q_init,
+                [this, &block_dq_dl](const std::tuple<int, std::string, std::string>& key)
+                {
+                    block_dq_dl[key] = compute_block_stress(key);
+                });
         }
 
+        if (tracer != nullptr)
+            tracer->add_phase("compute_stress", trace_start);
+
         // Compute total stress
         int n_polymer_types = molecules->get_n_polymer_types();
         for(int p=0; p<n_polymer_types; p++)
@@ -724,6 +1191,37 @@ void CpuComputationContinuous::compute_stress()
         throw_without_line_number(exc.what());
     }
 }
+std::array<double,3> CpuComputationContinuous::compute_block_stress(const std::tuple<int, std::string, std::string>& key)
+{
+    const int DIM  = cb->get_dim();
+
+    const ComputationBlock& block = propagator_analyzer->get_computation_block(key);
+    const int N_RIGHT = block.n_segment_right;
+    const int N_LEFT  = block.n_segment_left;
+    const std::string& monomer_type = block.monomer_type;
+    int n_repeated = block.n_repeated;
+
+    std::array<double,3> _block_dq_dl = {0.0, 0.0, 0.0};
+
+    // If there is no segment
+    if(N_RIGHT == 0)
+        return _block_dq_dl;
+
+    double **q_1 = propagator[block.id_left];     // dependency v
+    double **q_2 = propagator[block.id_right];    // dependency u
+
+    std::vector<double> s_coeff = SimpsonRule::get_coeff(N_RIGHT);
+
+    // Compute
+    for(int n=0; n<=N_RIGHT; n++)
+    {
+        std::vector<double> segment_stress = propagator_solver->compute_single_segment_stress_continuous(
+            q_1[N_LEFT-n], q_2[n], monomer_type);
+        for(int d=0; d<DIM; d++)
+            _block_dq_dl[d] += segment_stress[d]*s_coeff[n]*n_repeated;
+    }
+    return _block_dq_dl;
+}
 void CpuComputationContinuous::get_chain_propagator(double *q_out, int polymer, int v, int u, int n)
 {
     // This method should be invoked after invoking compute_statistics()
@@ -736,6 +1234,9 @@ void CpuComputationContinuous::get_chain_propagator(double *q_out, int polymer,
         Polymer& pc = molecules->get_polymer(polymer);
         std::string dep = pc.get_propagator_key(v,u);
 
+        if (reduce_memory_usage)
+            throw_with_line_number("Disable 'reduce_memory_usage' option to invoke 'get_chain_propagator'.");
+
         if (propagator_analyzer->get_computation_propagators().find(dep) == propagator_analyzer->get_computation_propagators().end())
             throw_with_line_number("Could not find the propagator code '" + dep + "'. Disable 'aggregation' option to obtain propagator_analyzer.");
 
@@ -743,7 +1244,7 @@ void CpuComputationContinuous::get_chain_propagator(double *q_out, int polymer,
         if (n < 0 || n > N_RIGHT)
             throw_with_line_number("n (" + std::to_string(n) + ") must be in range [0, " + std::to_string(N_RIGHT) + "]");
 
-        double **_partition = propagator[dep];
+        double **_partition = propagator[propagator_analyzer->get_propagator_id(dep)];
         for(int i=0; i<M; i++)
             q_out[i] = _partition[n][i];
     }
@@ -752,6 +1253,38 @@ void CpuComputationContinuous::get_chain_propagator(double *q_out, int polymer,
         throw_without_line_number(exc.what());
     }
 }
+std::vector<double> CpuComputationContinuous::compute_block_partitions(const std::tuple<int, std::string, std::string>& key)
+{
+    int p                 = std::get<0>(key);
+    std::string key_left  = std::get<1>(key);
+    std::string key_right = std::get<2>(key);
+
+    const ComputationBlock& block = propagator_analyzer->get_computation_block(key);
+    int n_segment_right = block.n_segment_right;
+    int n_segment_left  = block.n_segment_left;
+    int n_repeated      = block.n_repeated;
+    int n_propagators   = block.v_u.size();
+
+    #ifndef NDEBUG
+    std::cout<< p << ", " << key_left << ", " << key_right << ": " << n_segment_left << ", " << n_segment_right << ", " << n_propagators << ", " << n_repeated << std::endl;
+    #endif
+
+    std::vector<double> block_partitions;
+    for(int n=0;n<=n_segment_right;n++)
+    {
+        double total_partition = cb->inner_product(
+            propagator[block.id_left][n_segment_left-n],
+            propagator[block.id_right][n])*n_repeated/cb->get_volume();
+
+        total_partition /= n_propagators;
+        block_partitions.push_back(total_partition);
+
+        #ifndef NDEBUG
+        std::cout<< p << ", " << n << ": " << total_partition << std::endl;
+        #endif
+    }
+    return block_partitions;
+}
 bool CpuComputationContinuous::check_total_partition()
 {
     // const int M = cb->get_n_grid();
@@ -763,35 +1296,32 @@ bool CpuComputationContinuous::check_total_partition()
         total_partitions.push_back(total_partitions_p);
     }
 
+    std::map<std::tuple<int, std::string, std::string>, std::vector<double>> block_partitions;
     for(const auto& block: phi_block)
-    {
-        const auto& key = block.first;
-        int p                 = std::get<0>(key);
-        std::string key_left  = std::get<1>(key);
-        std::string key_right = std::get<2>(key);
-
-        int n_segment_right = propagator_analyzer->get_computation_block(key).n_segment_right;
-        int n_segment_left  = propagator_analyzer->get_computation_block(key).n_segment_left;
-        int n_repeated      = propagator_analyzer->get_computation_block(key).n_repeated;
-        int n_propagators   = propagator_analyzer->get_computation_block(key).v_u.size();
-
-        #ifndef NDEBUG
-        std::cout<< p << ", " << key_left << ", " << key_right << ": " << n_segment_left << ", " << n_segment_right << ", " << n_propagators << ", " << propagator_analyzer->get_computation_block(key).n_repeated << std::endl;
-        #endif
-
-        for(int n=0;n<=n_segment_right;n++)
-        {
-            double total_partition = cb->inner_product(
-                propagator[key_left][n_segment_left-n],
-                propagator[key_right][n])*n_repeated/cb->get_volume();
+        block_partitions[block.first] = {};
 
-            total_partition /= n_propagators;
-            total_partitions[p].push_back(total_partition);
+    if (!reduce_memory_usage)
+    {
+        for(const auto& block: phi_block)
+            block_partitions[block.first] = compute_block_partitions(block.first);
+    }
+    // Propagators are already released, so recompute them
+    else
+    {
+        std::map<std::string, const double*> q_init;
+        for(const auto& item: q_init_copy)
+            q_init[item.first] = item.second.data();
+        compute_propagators_by_schedule(q_init,
+            [this, &block_partitions](const std::tuple<int, std::string, std::string>& key)
+            {
+                block_partitions[key] = compute_block_partitions(key);
+            });
+    }
 
-            #ifndef NDEBUG
-            std::cout<< p << ", " << n << ": " << total_partition << std::endl;
-            #endif
-        }
+    for(const auto& item: block_partitions)
+    {
+        int p = std::get<0>(item.first);
+        total_partitions[p].insert(total_partitions[p].end(), item.second.begin(), item.second.end());
     }
 
     // Find minimum and maximum of total_partitions
@@ -8,36 +8,45 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <functional>
+#include <atomic>
+#include <deque>
 
 #include "ComputationBox.h"
 #include "Polymer.h"
 #include "Molecules.h"
 #include "PropagatorAnalyzer.h"
 #include "PropagatorComputation.h"
+#include "PropagatorComputationBatch.h"
 #include "CpuSolverPseudo.h"
 #include "Scheduler.h"
+#include "Tracer.h"
 
 class CpuComputationContinuous : public PropagatorComputation
 {
 private:
     // Pseudo-spectral PDE solver
     CpuSolver *propagator_solver;
+    // "pseudospectral" or "realspace"
+    std::string method;
+    // Batch solver for compute_statistics_batch, created for 'batch_size' replicas and kept while it is unchanged
+    PropagatorComputationBatch *batch_solver;
     // Scheduler for propagator
     Scheduler *sc;
     // The number of parallel streams for propagator computation
     int n_streams;
-    // key: (dep) + monomer_type, value: propagator
-    std::map<std::string, double **> propagator; 
+    // Propagators, indexed by propagator ID (see PropagatorAnalyzer::get_propagator_id)
+    std::vector<double **> propagator;
     // Map for deallocation of propagator
-    std::map<std::string, int> propagator_size;
+    std::vector<int> propagator_size;
     // Check if computation of propagator is finished
     #ifndef NDEBUG
-    std::map<std::string, bool *> propagator_finished;
+    std::vector<bool *> propagator_finished;
     #endif
 
     // Remember one segment for each polymer chain to compute total partition function
-    // (polymer id, propagator forward, propagator backward, n_repeated)
-    std::vector<std::tuple<int, double *, double *, int>> single_partition_segment;
+    // (polymer id, block key, n_aggregated)
+    std::vector<std::tuple<int, std::tuple<int, std::string, std::string>, int>> single_partition_segment;
 
     // key: (polymer id, key_left, key_right) (assert(key_left <= key_right)), value: concentrations
     std::map<std::tuple<int, std::string, std::string>, double *> phi_block;
@@ -45,10 +54,89 @@ private:
     // Solvent concentrations
     std::vector<double *> phi_solvent;
 
+    // Release propagators as soon as they are no longer needed, and reuse their memory
+    bool reduce_memory_usage;
+    // Segments that are not used by any propagator (only for reduce_memory_usage)
+    std::vector<double *> segment_pool;
+    // Copies of q_init to recompute propagators for stress (only for reduce_memory_usage)
+    // or to recover propagators before aggregation
+    std::map<std::string, std::vector<double>> q_init_copy;
+    // Whether phi_block is already normalized (only for reduce_memory_usage)
+    bool is_phi_block_normalized;
+
+    // Tracer of propagator computation (enabled by environment variable LFTS_TRACE_FILE), nullptr if disabled
+    Tracer *tracer;
+
+    // The last computed segment of each propagator, -1 if not started (only for compute_propagators_by_stream)
+    std::atomic<int> *propagator_progress;
+
+    // Precompiled propagator. Deps, monomer types and q_init are resolved to pointers and indices
+    // once at construction, so that the job loops do not touch keys or maps.
+    enum class InitialCondition {ONES, Q_INIT, SUM, PRODUCT};
+    struct PropagatorPlan
+    {
+        double **q;                                             // Segments of the propagator
+        const std::string *monomer_type;                        // Monomer type for the solver
+        InitialCondition initial_condition;                     // How q(r,0) is prepared
+        int q_init_idx;                                         // Index of q_init_names, -1 if not used
+        std::vector<std::tuple<int, double **, int, double>> junction; // (dep ID, segments of dep, n_segment, n_repeated)
+    };
+    // Plans indexed by propagator ID
+    std::vector<PropagatorPlan> propagator_plan;
+    // Names of q_init that are used, and their pointers resolved at each call
+    std::vector<std::string> q_init_names;
+    std::vector<const double *> q_init_ptr;
+    // Jobs (ID, n_segment_from, n_segment_to) and released propagator IDs of each time span
+    std::vector<std::vector<std::tuple<int, int, int>>> span_jobs;
+    std::vector<std::vector<int>> span_released;
+
+    // Propagators before aggregation, recovered once after each compute_propagators (see recover_original_propagators).
+    // Segments reused from the computed propagators are not owned, and the other segments are stored in 'recovered_segments'.
+    std::map<std::string, std::vector<double *>> recovered_propagators;
+    std::deque<std::vector<double>> recovered_segments;
+
+    // Compile the plan of propagator computation
+    void compile_propagator_plan();
+    // Plan of a propagator without junction. The name of q_init is added to q_init_names if it is used.
+    PropagatorPlan make_propagator_plan(const std::string& key, const ComputationEdge& edge, double **q);
+    // Find the pointers of q_init used by the plan
+    void resolve_q_init(std::map<std::string, const double*>& q_init);
+
+    // Allocate and deallocate segments of a propagator (only for reduce_memory_usage)
+    void allocate_propagator(int id);
+    void release_propagator(int id);
+
+    // Compute propagators following the schedule. If reduce_memory_usage is on, 'block_consumer' is invoked
+    // for each block right after its propagators are finished, and then the propagators are released.
+    void compute_propagators_by_schedule(
+        std::map<std::string, const double*>& q_init,
+        std::function<void(const std::tuple<int, std::string, std::string>&)> block_consumer);
+
+    // Compute propagators in one parallel region. Each thread follows the job queue of its stream, and
+    // waits only for the segments of the propagators it depends on instead of barriers between time spans.
+    void compute_propagators_by_stream(std::map<std::string, const double*>& q_init);
+
+    // Compute segments of a propagator from 'n_segment_from' to 'n_segment_to'
+    void compute_propagator_job(int id, int n_segment_from, int n_segment_to);
+    // Compute segments of a plan. 'id' is -1 if the plan is not one of the computation propagators.
+    void compute_propagator_segments(const PropagatorPlan& plan, int id, int n_segment_from, int n_segment_to);
+
+    // Compute total partition function using the block
+    void compute_single_partition(const std::tuple<int, std::string, std::string>& key);
+
+    // Compute quantities of one block
+    void compute_block_concentration(const std::tuple<int, std::string, std::string>& key);
+    std::array<double,3> compute_block_stress(const std::tuple<int, std::string, std::string>& key);
+    std::vector<double> compute_block_partitions(const std::tuple<int, std::string, std::string>& key);
+
     // Calculate concentration of one block
     void calculate_phi_one_block(double *phi, double **q_1, double **q_2, const int N_RIGHT, const int N_LEFT);
+
+    // Recover propagators of the blocks of polymer 'p' before aggregation into 'recovered_propagators'. Segments of
+    // the aggregated computation are reused, and missing segments are computed from the junctions.
+    void recover_original_propagators(int p);
 public:
-    CpuComputationContinuous(ComputationBox *cb, Molecules *molecules, PropagatorAnalyzer* propagator_analyzer, std::string method);
+    CpuComputationContinuous(ComputationBox *cb, Molecules *molecules, PropagatorAnalyzer* propagator_analyzer, std::string method, bool reduce_memory_usage=false);
     ~CpuComputationContinuous();
     
     void update_laplacian_operator() override;
@@ -63,6 +151,13 @@ public:
         std::map<std::string, const double*> w_block,
         std::map<std::string, const double*> q_init = {}) override;
 
+    // Field sets are computed together by the batch solver of the pseudo-spectral method
+    void compute_statistics_batch(
+        std::vector<std::map<std::string, const double*>> w_inputs,
+        std::vector<std::string> monomer_types,
+        double *partitions, double *phi, int batch_size=1,
+        std::map<std::string, const double*> q_init = {}) override;
+
     void compute_stress() override;
     double get_total_partition(int polymer) override;
     void get_chain_propagator(double *q_out, int polymer, int v, int u, int n) override;
@@ -74,6 +169,8 @@ public:
 
     double get_solvent_partition(int s) override;
     void get_solvent_concentration(int s, double *phi) override;
+    std::map<std::tuple<int, std::string, std::string>, const double*> get_block_concentration_ptrs() override;
+    const double* get_solvent_concentration_ptr(int s) override;
 
     // Grand canonical ensemble
     void get_total_concentration_gce(double fugacity, int polymer, std::string monomer_type, double *phi) override;
@@ -1,5 +1,8 @@
 #include <cmath>
+#include <thread>
+#include <algorithm>
 #include <chrono>
+#include <omp.h>
 
 #include "CpuComputationDiscrete.h"
 #include "CpuSolverPseudo.h"
@@ -8,7 +11,8 @@
 CpuComputationDiscrete::CpuComputationDiscrete(
     ComputationBox *cb,
     Molecules *molecules,
-    PropagatorAnalyzer *propagator_analyzer)
+    PropagatorAnalyzer *propagator_analyzer,
+    bool reduce_memory_usage)
     : PropagatorComputation(cb, molecules, propagator_analyzer)
 {
     try
@@ -31,9 +35,35 @@ CpuComputationDiscrete::CpuComputationDiscrete(
         std::cout << "The number of CPU threads: " << n_streams << std::endl;
         #endif
 
+        this->reduce_memory_usage = reduce_memory_usage;
+        this->is_phi_block_normalized = false;
+
+        // Trace propagator computation if the file name is given
+        const char *ENV_TRACE_FILE = getenv("LFTS_TRACE_FILE");
+        std::string env_trace_file(ENV_TRACE_FILE ? ENV_TRACE_FILE : "");
+        // Only the first LFTS_TRACE_MAX_CALLS calls of compute_propagators are recorded (default: 100)
+        const char *ENV_TRACE_MAX_CALLS = getenv("LFTS_TRACE_MAX_CALLS");
+        std::string env_trace_max_calls(ENV_TRACE_MAX_CALLS ? ENV_TRACE_MAX_CALLS : "");
+        if (env_trace_file.empty())
+            tracer = nullptr;
+        else if (env_trace_max_calls.empty())
+            tracer = new Tracer(n_streams, env_trace_file);
+        else
+            tracer = new Tracer(n_streams, env_trace_file, std::stoi(env_trace_max_calls));
+        propagator_solver->set_tracer(tracer);
+
         // Allocate memory for propagators
+        // If reduce_memory_usage is on, segments are allocated when the propagator computation starts
         if( propagator_analyzer->get_computation_propagators().size() == 0)
             throw_with_line_number("There is no propagator code. Add polymers first.");
+        const int N_PROPAGATORS = propagator_analyzer->get_computation_propagators().size();
+        propagator.resize(N_PROPAGATORS);
+        propagator_half_steps.resize(N_PROPAGATORS);
+        propagator_size.resize(N_PROPAGATORS);
+        #ifndef NDEBUG
+        propagator_finished.resize(N_PROPAGATORS);
+        propagator_half_steps_finished.resize(N_PROPAGATORS);
+        #endif
         for(const auto& item: propagator_analyzer->get_computation_propagators())
         {
              // There are N segments
@@ -45,39 +75,41 @@ CpuComputationDiscrete::CpuComputationDiscrete(
              // -- : full bond
              // O  : full segment
 
-            std::string key = item.first;
+            const int id = propagator_analyzer->get_propagator_id(item.first);
             int max_n_segment = item.second.max_n_segment+1; 
-            propagator_size[key] = max_n_segment;
+            propagator_size[id] = max_n_segment;
 
             // Allocate memory for q(r,1/2)
-            propagator_half_steps[key] = new double*[max_n_segment];
-            if (item.second.deps.size() > 0)
-                propagator_half_steps[key][0] = new double[M];
+            propagator_half_steps[id] = new double*[max_n_segment];
+            if (item.second.deps.size() > 0 && !reduce_memory_usage)
+                propagator_half_steps[id][0] = new double[M];
             else
-                propagator_half_steps[key][0] = nullptr;
+                propagator_half_steps[id][0] = nullptr;
 
             // Allocate memory for q(r,s+1/2)
-            for(int i=1; i<propagator_size[key]; i++)
+            for(int i=1; i<propagator_size[id]; i++)
             {
-                if (item.second.junction_ends.find(i) == item.second.junction_ends.end())
-                    propagator_half_steps[key][i] = nullptr;
+                if (item.second.junction_ends.find(i) == item.second.junction_ends.end() || reduce_memory_usage)
+                    propagator_half_steps[id][i] = nullptr;
                 else
-                    propagator_half_steps[key][i] = new double[M];
+                    propagator_half_steps[id][i] = new double[M];
             }
 
             // Allocate memory for q(r,s)
             // Index 0 will be not used
-            propagator[key] = new double*[max_n_segment];
-            propagator[key][0] = nullptr;
-            for(int i=1; i<propagator_size[key]; i++)
-                propagator[key][i] = new double[M];
+            propagator[id] = new double*[max_n_segment];
+            propagator[id][0] = nullptr;
+            for(int i=1; i<propagator_size[id]; i++)
+                propagator[id][i] = reduce_memory_usage ? nullptr : new double[M];
 
             #ifndef NDEBUG
-            propagator_finished[key] = new bool[max_n_segment];
+            propagator_finished[id] = new bool[max_n_segment];
+            propagator_half_steps_finished[id] = new bool[max_n_segment];
             for(int i=0; i<max_n_segment;i++)
-                propagator_finished[key][i] = false;
-            for (int n: item.second.junction_ends)
-                propagator_half_steps_finished[key][n] = false;
+            {
+                propagator_finished[id][i] = false;
+                propagator_half_steps_finished[id][i] = false;
+            }
             #endif
         }
 
@@ -105,7 +137,6 @@ CpuComputationDiscrete::CpuComputationDiscrete(
             int n_aggregated = propagator_analyzer->get_computation_block(key).v_u.size()/
                                propagator_analyzer->get_computation_block(key).n_repeated;
             int n_segment_left = propagator_analyzer->get_computation_block(key).n_segment_left;
-            std::string monomer_type = propagator_analyzer->get_computation_block(key).monomer_type;
 
             // Skip if n_segment_left is 0
             if (n_segment_left == 0)
@@ -113,10 +144,8 @@ CpuComputationDiscrete::CpuComputationDiscrete(
 
             single_partition_segment.push_back(std::make_tuple(
                 p,
-                propagator[key_left][n_segment_left],    // q
-                propagator[key_right][1],                  // q_dagger
-                monomer_type,       
-                n_aggregated                               // how many propagators are aggregated
+                key,                // q(n_segment_left) of key_left, and q_dagger(1) of key_right
+                n_aggregated        // how many propagators are aggregated
                 ));
             current_p++;
         }
@@ -126,7 +155,40 @@ CpuComputationDiscrete::CpuComputationDiscrete(
             phi_solvent.push_back(new double[M]);
 
         // Create scheduler for computation of propagator
-        sc = new Scheduler(propagator_analyzer->get_computation_propagators(), n_streams); 
+        if (reduce_memory_usage)
+        {
+            // The maximum number of segments that are stored at the same time. 0 means no limit.
+            const char *ENV_MAX_LIVE_SEGMENTS = getenv("LFTS_MAX_LIVE_SEGMENTS");
+            std::string env_max_live_segments(ENV_MAX_LIVE_SEGMENTS ? ENV_MAX_LIVE_SEGMENTS  : "");
+            int max_live_segments = 0;
+            if (!env_max_live_segments.empty())
+                max_live_segments = std::stoi(env_max_live_segments);
+
+            sc = new Scheduler(
+                propagator_analyzer->get_computation_propagators(),
+                propagator_analyzer->get_computation_blocks(),
+                n_streams, max_live_segments);
+
+            // Merge time spans to reduce barriers. The cost of a barrier in units of segment steps can be given.
+            const char *ENV_BARRIER_COST = getenv("LFTS_BARRIER_COST");
+            std::string env_barrier_cost(ENV_BARRIER_COST ? ENV_BARRIER_COST  : "");
+            double barrier_cost = 0.0;
+            if (!env_barrier_cost.empty())
+                barrier_cost = std::stod(env_barrier_cost);
+            sc->coarsen_schedule(barrier_cost);
+
+            #ifndef NDEBUG
+            std::cout << "Peak number of live segments: " << sc->get_peak_live_segments() << std::endl;
+            #endif
+        }
+        else
+            sc = new Scheduler(propagator_analyzer->get_computation_propagators(), n_streams); 
+
+        propagator_progress = new std::atomic<int>[N_PROPAGATORS];
+        compile_propagator_plan();
+
+        if (tracer != nullptr)
+            tracer->set_plan(sc->get_planned_makespan(), sc->get_critical_path());
 
         update_laplacian_operator();
     }
@@ -137,28 +199,45 @@ CpuComputationDiscrete::CpuComputationDiscrete(
 }
 CpuComputationDiscrete::~CpuComputationDiscrete()
 {
+    if (tracer != nullptr)
+    {
+        try
+        {
+            tracer->write_chrome_trace();
+            tracer->display_summary();
+        }
+        catch(std::exception& exc)
+        {
+            std::cout << exc.what() << std::endl;
+        }
+        delete tracer;
+    }
     delete propagator_solver;
     delete sc;
 
-    for(const auto& item: propagator)
+    for(size_t p=0; p<propagator.size(); p++)
     {
-        for(int i=0; i<propagator_size[item.first]; i++)
+        for(int i=0; i<propagator_size[p]; i++)
         {
-            if(item.second[i] != nullptr)
-                delete[] item.second[i];
+            if(propagator[p][i] != nullptr)
+                delete[] propagator[p][i];
         }
-        delete[] item.second;
+        delete[] propagator[p];
     }
-    for(const auto& item: propagator_half_steps)
+    delete[] propagator_progress;
+    for(size_t p=0; p<propagator_half_steps.size(); p++)
     {
-        for(int i=0; i<propagator_size[item.first]; i++)
+        for(int i=0; i<propagator_size[p]; i++)
         {
-            if(item.second[i] != nullptr)
-                delete[] item.second[i];
+            if(propagator_half_steps[p][i] != nullptr)
+                delete[] propagator_half_steps[p][i];
         }
-        delete[] item.second;
+        delete[] propagator_half_steps[p];
     }
     
+    for(const auto& item: segment_pool)
+        delete[] item;
+
     for(const auto& item: phi_block)
         delete[] item.second;
     for(const auto& item: phi_solvent)
@@ -166,7 +245,9 @@ CpuComputationDiscrete::~CpuComputationDiscrete()
 
     #ifndef NDEBUG
     for(const auto& item: propagator_finished)
-        delete[] item.second;
+        delete[] item;
+    for(const auto& item: propagator_half_steps_finished)
+        delete[] item;
     #endif
 }
 void CpuComputationDiscrete::update_laplacian_operator()
@@ -203,34 +284,81 @@ void CpuComputationDiscrete::compute_propagators(
                 throw_with_line_number("monomer_type \"" + item.second.monomer_type + "\" is not in w_input.");
         }
 
+        // Update dw or exp_dw
+        propagator_solver->update_dw(w_input);
+
+        double trace_start = (tracer != nullptr) ? tracer->now() : 0.0;
+
+        // Keep q_init to recompute propagators later
+        if (reduce_memory_usage || propagator_analyzer->is_aggregated())
+        {
+            q_init_copy.clear();
+            for(const auto& item: q_init)
+                q_init_copy[item.first] = std::vector<double>(item.second, item.second+M);
+        }
+        // Propagators before aggregation are recovered again from the new propagators
+        recovered_propagators.clear();
+        recovered_half_steps.clear();
+        recovered_segments.clear();
+
+        if (reduce_memory_usage)
+        {
+            // Compute concentrations and total partition functions before propagators are released
+            is_phi_block_normalized = false;
+            compute_propagators_by_schedule(q_init,
+                [this](const std::tuple<int, std::string, std::string>& key)
+                {
+                    compute_block_concentration(key);
+                    compute_single_partition(key);
+                });
+        }
+        else
+        {
+            compute_propagators_by_stream(q_init);
+
+            // Compute total partition function of each distinct polymers
+            for(const auto& segment_info: single_partition_segment)
+                compute_single_partition(std::get<1>(segment_info));
+        }
+        if (tracer != nullptr)
+            tracer->add_phase("compute_propagators", trace_start);
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+void CpuComputationDiscrete::compute_propagators_by_schedule(
+    std::map<std::string, const double*>& q_init,
+    std::function<void(const std::tuple<int, std::string, std::string>&)> block_consumer)
+{
+    try
+    {
         #ifndef NDEBUG
         this->time_complexity = 0;
         #endif
 
-        // Update dw or exp_dw
-        propagator_solver->update_dw(w_input);
+        resolve_q_init(q_init);
 
-        // Assign a pointer for mask
-        const double *q_mask = cb->get_mask();
-        
         // For each time span
-        auto& branch_schedule = sc->get_schedule();
-        for (auto parallel_job = branch_schedule.begin(); parallel_job != branch_schedule.end(); parallel_job++)
+        for(size_t span=0; span<span_jobs.size(); span++)
         {
+            const auto& jobs = span_jobs[span];
             // display all jobs
             #ifndef NDEBUG
             std::cout << "jobs:" << std::endl;
-            for(size_t job=0; job<parallel_job->size(); job++)
+            for(size_t job=0; job<jobs.size(); job++)
             {
-                auto& key = std::get<0>((*parallel_job)[job]);
-                int n_segment_from = std::get<1>((*parallel_job)[job]);
-                int n_segment_to = std::get<2>((*parallel_job)[job]);
+                const int id = std::get<0>(jobs[job]);
+                const std::string& key = propagator_analyzer->get_propagator_key(id);
+                int n_segment_from = std::get<1>(jobs[job]);
+                int n_segment_to = std::get<2>(jobs[job]);
                 std::cout << "key, n_segment_from, n_segment_to: " + key + ", " + std::to_string(n_segment_from) + ", " + std::to_string(n_segment_to) + ". " << std::endl;
                 std::cout << "half_steps: ";
                 std::cout << "{";
-                for (int i=0; i<propagator_size[key]; i++)
+                for (int i=0; i<propagator_size[id]; i++)
                 {
-                    if (propagator_half_steps[key][i] != nullptr)
+                    if (propagator_half_steps[id][i] != nullptr)
                         std::cout << i << ", ";
                 }
                 std::cout << "}, "<< std::endl;
@@ -239,348 +367,550 @@ void CpuComputationDiscrete::compute_propagators(
                 (std::chrono::system_clock::now().time_since_epoch()).count();
             #endif
 
+            // Allocate memory for propagators that start in this time span
+            if (reduce_memory_usage)
+            {
+                for(size_t job=0; job<jobs.size(); job++)
+                {
+                    if (std::get<1>(jobs[job]) == 0)
+                        allocate_propagator(std::get<0>(jobs[job]));
+                }
+            }
+
             // For each propagator
-            #pragma omp parallel for num_threads(n_streams)
-            for(size_t job=0; job<parallel_job->size(); job++)
+            double span_start = (tracer != nullptr) ? tracer->now() : 0.0;
+            #pragma omp parallel for num_threads(n_streams) schedule(dynamic)
+            for(size_t job=0; job<jobs.size(); job++)
+                compute_propagator_job(std::get<0>(jobs[job]), std::get<1>(jobs[job]), std::get<2>(jobs[job]));
+
+            if (tracer != nullptr)
+                tracer->add_phase("span " + std::to_string(span), span_start);
+
+            // Compute blocks whose propagators are finished, and release propagators that are no longer needed
+            if (reduce_memory_usage)
             {
-                auto& key = std::get<0>((*parallel_job)[job]);
-                int n_segment_from = std::get<1>((*parallel_job)[job]);
-                int n_segment_to = std::get<2>((*parallel_job)[job]);
-                auto& deps = propagator_analyzer->get_computation_propagator(key).deps;
-                auto monomer_type = propagator_analyzer->get_computation_propagator(key).monomer_type;
-
-                // #ifndef NDEBUG
-                // #pragma omp critical
-                // std::cout << job << " started, " << 
-                //     std::chrono::duration_cast<std::chrono::microseconds>
-                //     (std::chrono::system_clock::now().time_since_epoch()).count() - start_time << std::endl;
-                // #endif
-
-                // Check key
-                #ifndef NDEBUG
-                if (propagator.find(key) == propagator.end())
-                    std::cout << "Could not find key '" << key << "'. " << std::endl;
-                #endif
+                double blocks_start = (tracer != nullptr) ? tracer->now() : 0.0;
+                auto& finished_blocks = sc->get_finished_blocks()[span];
+                #pragma omp parallel for num_threads(n_streams)
+                for(size_t b=0; b<finished_blocks.size(); b++)
+                {
+                    TraceScope trace_scope(tracer, finished_blocks[b], "block");
+                    block_consumer(finished_blocks[b]);
+                }
+                if (tracer != nullptr)
+                    tracer->add_phase("blocks " + std::to_string(span), blocks_start);
+
+                for(int id: span_released[span])
+                    release_propagator(id);
+            }
+        }
+
+        #ifndef NDEBUG
+        std::cout << "time_complexity: " << this->time_complexity << std::endl;
+        #endif
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+void CpuComputationDiscrete::compute_propagators_by_stream(std::map<std::string, const double*>& q_init)
+{
+    try
+    {
+        auto& job_queues = sc->get_stream_job_queues();
+        auto& checkpoints = sc->get_checkpoints();
+        resolve_q_init(q_init);
 
-                double **_propagator = propagator[key];
-                const double *_exp_dw = propagator_solver->exp_dw[monomer_type];
+        for(int p=0; p<propagator_analyzer->get_n_computation_propagator_codes(); p++)
+            propagator_progress[p].store(-1, std::memory_order_relaxed);
 
-                // Calculate one block end
-                if (n_segment_from == 0 && deps.size() == 0) // if it is leaf node
+        // Each thread needs its own stream. Otherwise, follow the time spans.
+        int n_threads = 0;
+        double trace_start = (tracer != nullptr) ? tracer->now() : 0.0;
+        #pragma omp parallel num_threads(n_streams)
+        {
+            #pragma omp single
+            n_threads = omp_get_num_threads();
+
+            const int STREAM = omp_get_thread_num();
+            if (n_threads == static_cast<int>(job_queues.size()))
+            {
+                for(int id: job_queues[STREAM])
                 {
-                    // #ifndef NDEBUG
-                    // #pragma omp critical
-                    // std::cout << job << " init 1, " << 
-                    //     std::chrono::duration_cast<std::chrono::microseconds>
-                    //     (std::chrono::system_clock::now().time_since_epoch()).count() - start_time << std::endl;
-                    // #endif
-
-                     // q_init
-                    if (key[0] == '{')
+                    // Wait until the segments of dependencies are computed
                     {
-                        std::string g = PropagatorCode::get_q_input_idx_from_key(key);
-                        if (q_init.find(g) == q_init.end())
-                            std::cout << "Could not find q_init[\"" + g + "\"]." << std::endl;
-                        for(int i=0; i<M; i++)
-                            _propagator[1][i] = q_init[g][i]*_exp_dw[i];
+                        TraceScope trace_scope(tracer, propagator_analyzer->get_propagator_key(id), "wait");
+                        for(const auto& dep: propagator_plan[id].junction)
+                        {
+                            std::atomic<int>& sub_progress = propagator_progress[std::get<0>(dep)];
+                            while(sub_progress.load(std::memory_order_acquire) < std::get<2>(dep))
+                                std::this_thread::yield();
+                        }
                     }
-                    else
+
+                    // Compute segments up to each checkpoint, and notify the dependents
+                    std::atomic<int>& progress = propagator_progress[id];
+                    int n_segment_from = 0;
+                    for(int n_segment_to: checkpoints[id])
                     {
-                        for(int i=0; i<M; i++)
-                            _propagator[1][i] = _exp_dw[i];
+                        compute_propagator_job(id, n_segment_from, n_segment_to);
+                        progress.store(n_segment_to, std::memory_order_release);
+                        n_segment_from = n_segment_to;
                     }
-
-                    #ifndef NDEBUG
-                    propagator_finished[key][1] = true;
-                    #endif
                 }
-                else if (n_segment_from == 0 && deps.size() > 0) // if it is not leaf node
-                {
-                    // If it is aggregated
-                    if (key[0] == '[')
-                    {
-                        // #ifndef NDEBUG
-                        // #pragma omp critical
-                        // std::cout << job << " init 2, " << 
-                        //     std::chrono::duration_cast<std::chrono::microseconds>
-                        //     (std::chrono::system_clock::now().time_since_epoch()).count() - start_time << std::endl;
-                        // #endif
-
-                        for(int i=0; i<M; i++)
-                            _propagator[1][i] = 0.0;
-                        for(size_t d=0; d<deps.size(); d++)
-                        {
-                            std::string sub_dep = std::get<0>(deps[d]);
-                            int sub_n_segment   = std::get<1>(deps[d]);
-                            int sub_n_repeated  = std::get<2>(deps[d]);
-                            double **_propagator_sub_dep;
-
-                            if (sub_n_segment == 0)
-                            {
-                                // Check sub key
-                                #ifndef NDEBUG
-                                if (propagator_half_steps.find(sub_dep) == propagator_half_steps.end())
-                                    std::cout << "Could not find sub key '" + sub_dep + "'. " << std::endl;
-                                if (!propagator_half_steps_finished[sub_dep][0])
-                                    std::cout << "Could not compute '" + key +  "', since '"+ sub_dep + std::to_string(0) + "' is not prepared." << std::endl;
-                                #endif
-
-                                _propagator_sub_dep = propagator_half_steps[sub_dep];
-                            }
-                            else
-                            {
-                                // Check sub key
-                                #ifndef NDEBUG
-                                if (propagator.find(sub_dep) == propagator.end())
-                                    std::cout << "Could not find sub key '" + sub_dep + "'. " << std::endl;
-                                if (!propagator_finished[sub_dep][sub_n_segment])
-                                    std::cout << "Could not compute '" + key +  "', since '"+ sub_dep + std::to_string(sub_n_segment) + "' is not prepared." << std::endl;
-                                #endif
-
-                                _propagator_sub_dep = propagator[sub_dep];
-                            }
-                            for(int i=0; i<M; i++)
-                                _propagator[1][i] += _propagator_sub_dep[sub_n_segment][i]*sub_n_repeated;
-                        }
+            }
+        }
+        if (tracer != nullptr)
+            tracer->add_phase("streams", trace_start);
 
-                        #ifndef NDEBUG
-                        #pragma omp critical
-                        this->time_complexity++;
-                        #endif
+        if (n_threads != static_cast<int>(job_queues.size()))
+            compute_propagators_by_schedule(q_init, nullptr);
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+void CpuComputationDiscrete::compile_propagator_plan()
+{
+    try
+    {
+        // Resolve deps and initial conditions of each propagator
+        propagator_plan.clear();
+        q_init_names.clear();
+        for(int id=0; id<propagator_analyzer->get_n_computation_propagator_codes(); id++)
+        {
+            const std::string& key = propagator_analyzer->get_propagator_key(id);
+            const ComputationEdge& edge = propagator_analyzer->get_computation_propagator(id);
 
-                        // if sub_n_segment == 0
-                        if (std::get<1>(deps[0]) == 0)
-                        {
-                            double *_propagator_half_step = propagator_half_steps[key][0];
-                            for(int i=0; i<M; i++)
-                                _propagator_half_step[i] = _propagator[1][i];
+            PropagatorPlan plan = make_propagator_plan(key, edge, propagator[id], propagator_half_steps[id]);
 
-                            // Add half bond
-                            propagator_solver->advance_propagator_discrete_half_bond_step(
-                                _propagator[1], _propagator[1], monomer_type);
+            // Aggregated propagators start from q(r,n) of deps, or q(r,1/2) if n is 0.
+            // Junctions combine half bond steps q(r,n+1/2) of deps.
+            for(const auto& dep: edge.dep_ids)
+            {
+                int sub_dep = std::get<0>(dep);
+                int sub_n_segment = std::get<1>(dep);
+                double **_q_sub = propagator[sub_dep];
+                if (plan.initial_condition == InitialCondition::PRODUCT || sub_n_segment == 0)
+                    _q_sub = propagator_half_steps[sub_dep];
+                plan.junction.push_back(std::make_tuple(sub_dep, _q_sub, sub_n_segment, std::get<2>(dep)));
+            }
+            propagator_plan.push_back(plan);
+        }
+        q_init_ptr.resize(q_init_names.size());
+
+        // Jobs of each time span
+        span_jobs.clear();
+        span_released.clear();
+        span_jobs = sc->get_schedule_ids();
+        span_released.resize(span_jobs.size());
+        if (reduce_memory_usage)
+            span_released = sc->get_released_propagator_ids();
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+CpuComputationDiscrete::PropagatorPlan CpuComputationDiscrete::make_propagator_plan(
+    const std::string& key, const ComputationEdge& edge, double **q, double **q_half_steps)
+{
+    PropagatorPlan plan;
+    plan.q = q;
+    plan.q_half_steps = q_half_steps;
+    plan.monomer_type = &edge.monomer_type;
+    plan.exp_dw = propagator_solver->exp_dw[edge.monomer_type];
+    plan.q_init_idx = -1;
+    if (edge.deps.size() == 0 && key[0] == '{')
+    {
+        std::string g = PropagatorCode::get_q_input_idx_from_key(key);
+        auto it = std::find(q_init_names.begin(), q_init_names.end(), g);
+        plan.q_init_idx = it - q_init_names.begin();
+        if (it == q_init_names.end())
+            q_init_names.push_back(g);
+        plan.initial_condition = InitialCondition::Q_INIT;
+    }
+    else if (edge.deps.size() == 0)
+        plan.initial_condition = InitialCondition::ONES;
+    // If it is aggregated
+    else if (key[0] == '[')
+        plan.initial_condition = InitialCondition::SUM;
+    else
+        plan.initial_condition = InitialCondition::PRODUCT;
+    return plan;
+}
+void CpuComputationDiscrete::resolve_q_init(std::map<std::string, const double*>& q_init)
+{
+    for(size_t i=0; i<q_init_names.size(); i++)
+    {
+        if (q_init.find(q_init_names[i]) == q_init.end())
+            throw_with_line_number("Could not find q_init[\"" + q_init_names[i] + "\"].");
+        q_init_ptr[i] = q_init[q_init_names[i]];
+    }
+}
+void CpuComputationDiscrete::compute_propagator_job(int id, int n_segment_from, int n_segment_to)
+{
+    TraceScope trace_scope(tracer, propagator_analyzer->get_propagator_key(id), "propagator", n_segment_from, n_segment_to);
+    compute_propagator_segments(propagator_plan[id], id, n_segment_from, n_segment_to);
+}
+void CpuComputationDiscrete::compute_propagator_segments(const PropagatorPlan& plan, int id, int n_segment_from, int n_segment_to)
+{
+    const int M = cb->get_n_grid();
+    const double *q_mask = cb->get_mask();
 
-                            // Add full segment
-                            for(int i=0; i<M; i++)
-                                _propagator[1][i] *= _exp_dw[i];
-                        }
-                        else
-                        {
-                            propagator_solver->advance_propagator_discrete(
-                                _propagator[1],
-                                _propagator[1],
-                                monomer_type,
-                                q_mask);
-                        }
+    auto& deps = plan.junction;
+    const std::string& monomer_type = *plan.monomer_type;
 
-                        #ifndef NDEBUG
-                        propagator_finished[key][1] = true;
-                        #endif
-                        // std::cout << "finished, key, n: " + key + ", 0" << std::endl;
-                    }
-                    else
-                    {
-                        // Example (four branches)
-                        //     A
-                        //     |
-                        // O - . - B
-                        //     |
-                        //     C
-
-                        // Legend)
-                        // .       : junction
-                        // O       : full segment
-                        // -, |    : half bonds
-                        // A, B, C : other full segments
-
-                        // #ifndef NDEBUG
-                        // #pragma omp critical
-                        // std::cout << job << " init 3, " << 
-                        //     std::chrono::duration_cast<std::chrono::microseconds>
-                        //     (std::chrono::system_clock::now().time_since_epoch()).count() - start_time << std::endl;
-                        // #endif
-
-                        // Combine branches
-                        double *_q_junction_start = propagator_half_steps[key][0];
-                        for(int i=0; i<M; i++)
-                            _q_junction_start[i] = 1.0;
-                        for(size_t d=0; d<deps.size(); d++)
-                        {
-                            std::string sub_dep = std::get<0>(deps[d]);
-                            int sub_n_segment   = std::get<1>(deps[d]);
-
-                            // Check sub key
-                            #ifndef NDEBUG
-                            if (!propagator_half_steps_finished[sub_dep][sub_n_segment])
-                                std::cout << "Could not compute '" + key +  "', since '"+ sub_dep + std::to_string(sub_n_segment) + "+1/2' is not prepared." << std::endl;
-                            #endif
-
-                            double *_propagator_half_step = propagator_half_steps[sub_dep][sub_n_segment];
-                            for(int i=0; i<M; i++)
-                                _q_junction_start[i] *= _propagator_half_step[i];
-                        }
+    #ifndef NDEBUG
+    // Only the computation propagators are checked
+    const std::string key = (id >= 0) ? propagator_analyzer->get_propagator_key(id) : "";
+    #endif
 
-                        #ifndef NDEBUG
-                        propagator_half_steps_finished[key][0] = true;
-                        #endif
+    // #ifndef NDEBUG
+    // #pragma omp critical
+    // std::cout << job << " started, " << 
+    //     std::chrono::duration_cast<std::chrono::microseconds>
+    //     (std::chrono::system_clock::now().time_since_epoch()).count() - start_time << std::endl;
+    // #endif
 
-                        if (n_segment_to > 0)
-                        {
-                            #ifndef NDEBUG
-                            #pragma omp critical
-                            this->time_complexity++;
-                            #endif
-
-                            // Add half bond
-                            propagator_solver->advance_propagator_discrete_half_bond_step(
-                                _q_junction_start, _propagator[1], monomer_type);
-
-                            // Add full segment
-                            for(int i=0; i<M; i++)
-                                _propagator[1][i] *= _exp_dw[i];
-                            
-                            #ifndef NDEBUG
-                            propagator_finished[key][1] = true;
-                            #endif
-                        }
-                    }
-                }
+    double **_propagator = plan.q;
+    double **_propagator_half_steps = plan.q_half_steps;
+    const double *_exp_dw = plan.exp_dw;
 
-                if (n_segment_to == 0)
-                    continue;
+    // Calculate one block end
+    if (n_segment_from == 0 && deps.size() == 0) // if it is leaf node
+    {
+        // #ifndef NDEBUG
+        // #pragma omp critical
+        // std::cout << job << " init 1, " << 
+        //     std::chrono::duration_cast<std::chrono::microseconds>
+        //     (std::chrono::system_clock::now().time_since_epoch()).count() - start_time << std::endl;
+        // #endif
+
+         // q_init
+        if (plan.initial_condition == InitialCondition::Q_INIT)
+        {
+            const double *_q_init = q_init_ptr[plan.q_init_idx];
+            for(int i=0; i<M; i++)
+                _propagator[1][i] = _q_init[i]*_exp_dw[i];
+        }
+        else
+        {
+            for(int i=0; i<M; i++)
+                _propagator[1][i] = _exp_dw[i];
+        }
 
-                if (n_segment_from == 0)
-                {
-                    // Multiply mask
-                    if (q_mask != nullptr)
-                    {
-                        for(int i=0; i<M; i++)
-                            _propagator[1][i] *= q_mask[i];
-                    }
+        #ifndef NDEBUG
+        if (id >= 0)
+            propagator_finished[id][1] = true;
+        #endif
+    }
+    else if (n_segment_from == 0 && deps.size() > 0) // if it is not leaf node
+    {
+        // If it is aggregated
+        if (plan.initial_condition == InitialCondition::SUM)
+        {
+            // #ifndef NDEBUG
+            // #pragma omp critical
+            // std::cout << job << " init 2, " << 
+            //     std::chrono::duration_cast<std::chrono::microseconds>
+            //     (std::chrono::system_clock::now().time_since_epoch()).count() - start_time << std::endl;
+            // #endif
 
-                    // q(r, 1+1/2)
-                    if (propagator_half_steps[key][1] != nullptr)
-                    {
-                        #ifndef NDEBUG
-                        if (propagator_finished[key][1])
-                            std::cout << "already finished: " + key + ", " + std::to_string(1) << std::endl;
-                        #endif
-
-                        #ifndef NDEBUG
-                        #pragma omp critical
-                        this->time_complexity++;
-                        #endif
-
-                        propagator_solver->advance_propagator_discrete_half_bond_step(
-                            _propagator[1],
-                            propagator_half_steps[key][1],
-                            monomer_type);
-
-                        #ifndef NDEBUG
-                        propagator_half_steps_finished[key][1] = true;
-                        #endif
-                    }
-                    n_segment_from++;
-                }
+            for(int i=0; i<M; i++)
+                _propagator[1][i] = 0.0;
+            for(size_t d=0; d<deps.size(); d++)
+            {
+                int sub_n_segment     = std::get<2>(deps[d]);
+                double sub_n_repeated = std::get<3>(deps[d]);
+                // q(r,1/2) if sub_n_segment == 0, otherwise q(r,sub_n_segment)
+                double **_propagator_sub_dep = std::get<1>(deps[d]);
 
-                // Advance propagator successively
-                // q(r, s)
-                for(int n=n_segment_from; n<n_segment_to; n++)
-                {
-                    #ifndef NDEBUG
-                    if (!propagator_finished[key][n])
-                        std::cout << "unfinished, key: " + key + ", " + std::to_string(n) << std::endl;
-                    if (propagator_finished[key][n+1])
-                        std::cout << "already finished: " + key + ", " + std::to_string(n+1) << std::endl;
-                    #endif
-
-                    // #ifndef NDEBUG
-                    // #pragma omp critical
-                    // std::cout << job << " q_s, " << n << ", " << 
-                    //     std::chrono::duration_cast<std::chrono::microseconds>
-                    //     (std::chrono::system_clock::now().time_since_epoch()).count() - start_time << std::endl;
-                    // #endif
-
-                    #ifndef NDEBUG
-                    #pragma omp critical
-                    this->time_complexity++;
-                    #endif
-
-                    propagator_solver->advance_propagator_discrete(
-                        _propagator[n], _propagator[n+1],
-                        monomer_type, q_mask);
-
-                    #ifndef NDEBUG
-                    propagator_finished[key][n+1] = true;
-                    #endif
-                }
+                // Check sub key
+                #ifndef NDEBUG
+                int sub_dep = std::get<0>(deps[d]);
+                if (id >= 0 && sub_n_segment == 0 && !propagator_half_steps_finished[sub_dep][0])
+                    std::cout << "Could not compute '" + key +  "', since '"+ propagator_analyzer->get_propagator_key(sub_dep) + std::to_string(0) + "' is not prepared." << std::endl;
+                if (id >= 0 && sub_n_segment > 0 && !propagator_finished[sub_dep][sub_n_segment])
+                    std::cout << "Could not compute '" + key +  "', since '"+ propagator_analyzer->get_propagator_key(sub_dep) + std::to_string(sub_n_segment) + "' is not prepared." << std::endl;
+                #endif
 
-                // q(r, s+1/2)
-                for(int n=n_segment_from; n<n_segment_to; n++)
-                {
-                    if (propagator_half_steps[key][n+1] != nullptr)
-                    {
-                        // #ifndef NDEBUG
-                        // #pragma omp critical
-                        // std::cout << job << " q_s+1/2, " << n << ", " << 
-                        //     std::chrono::duration_cast<std::chrono::microseconds>
-                        //     (std::chrono::system_clock::now().time_since_epoch()).count() - start_time << std::endl;
-                        // #endif
-
-                        #ifndef NDEBUG
-                        if (propagator_half_steps_finished[key][n+1])
-                            std::cout << "already half_step finished: " + key + ", " + std::to_string(n+1) << std::endl;
-                        #endif
-
-                        #ifndef NDEBUG
-                        #pragma omp critical
-                        this->time_complexity++;
-                        #endif
-
-                        propagator_solver->advance_propagator_discrete_half_bond_step(
-                            _propagator[n+1],
-                            propagator_half_steps[key][n+1],
-                            monomer_type);
-
-                        #ifndef NDEBUG
-                        propagator_half_steps_finished[key][n+1] = true;
-                        #endif
-                    }
-                }
+                for(int i=0; i<M; i++)
+                    _propagator[1][i] += _propagator_sub_dep[sub_n_segment][i]*sub_n_repeated;
+            }
+
+            #ifndef NDEBUG
+            #pragma omp critical
+            this->time_complexity++;
+            #endif
 
-                // #ifndef NDEBUG
-                // #pragma omp critical
-                // std::cout << job << " finished, " << 
-                //     std::chrono::duration_cast<std::chrono::microseconds>
-                //     (std::chrono::system_clock::now().time_since_epoch()).count() - start_time << std::endl;
-                // #endif
+            // if sub_n_segment == 0
+            if (std::get<2>(deps[0]) == 0)
+            {
+                double *_propagator_half_step = _propagator_half_steps[0];
+                for(int i=0; i<M; i++)
+                    _propagator_half_step[i] = _propagator[1][i];
+
+                // Add half bond
+                propagator_solver->advance_propagator_discrete_half_bond_step(
+                    _propagator[1], _propagator[1], monomer_type);
+
+                // Add full segment
+                for(int i=0; i<M; i++)
+                    _propagator[1][i] *= _exp_dw[i];
             }
+            else
+            {
+                propagator_solver->advance_propagator_discrete(
+                    _propagator[1],
+                    _propagator[1],
+                    monomer_type,
+                    q_mask);
+            }
+
+            #ifndef NDEBUG
+            if (id >= 0)
+                propagator_finished[id][1] = true;
+            #endif
+            // std::cout << "finished, key, n: " + key + ", 0" << std::endl;
         }
+        else
+        {
+            // Example (four branches)
+            //     A
+            //     |
+            // O - . - B
+            //     |
+            //     C
+
+            // Legend)
+            // .       : junction
+            // O       : full segment
+            // -, |    : half bonds
+            // A, B, C : other full segments
+
+            // #ifndef NDEBUG
+            // #pragma omp critical
+            // std::cout << job << " init 3, " << 
+            //     std::chrono::duration_cast<std::chrono::microseconds>
+            //     (std::chrono::system_clock::now().time_since_epoch()).count() - start_time << std::endl;
+            // #endif
+
+            // Combine branches
+            double *_q_junction_start = _propagator_half_steps[0];
+            for(int i=0; i<M; i++)
+                _q_junction_start[i] = 1.0;
+            for(size_t d=0; d<deps.size(); d++)
+            {
+                int sub_n_segment = std::get<2>(deps[d]);
 
+                // Check sub key
+                #ifndef NDEBUG
+                int sub_dep = std::get<0>(deps[d]);
+                if (id >= 0 && !propagator_half_steps_finished[sub_dep][sub_n_segment])
+                    std::cout << "Could not compute '" + key +  "', since '"+ propagator_analyzer->get_propagator_key(sub_dep) + std::to_string(sub_n_segment) + "+1/2' is not prepared." << std::endl;
+                #endif
+
+                double *_propagator_half_step = std::get<1>(deps[d])[sub_n_segment];
+                for(int i=0; i<M; i++)
+                    _q_junction_start[i] *= _propagator_half_step[i];
+            }
+
+            #ifndef NDEBUG
+            if (id >= 0)
+                propagator_half_steps_finished[id][0] = true;
+            #endif
+
+            if (n_segment_to > 0)
+            {
+                #ifndef NDEBUG
+                #pragma omp critical
+                this->time_complexity++;
+                #endif
+
+                // Add half bond
+                propagator_solver->advance_propagator_discrete_half_bond_step(
+                    _q_junction_start, _propagator[1], monomer_type);
+
+                // Add full segment
+                for(int i=0; i<M; i++)
+                    _propagator[1][i] *= _exp_dw[i];
+                
+                #ifndef NDEBUG
+                if (id >= 0)
+                    propagator_finished[id][1] = true;
+                #endif
+            }
+        }
+    }
+
+    if (n_segment_to == 0)
+        return;
+
+    if (n_segment_from == 0)
+    {
+        // Multiply mask
+        if (q_mask != nullptr)
+        {
+            for(int i=0; i<M; i++)
+                _propagator[1][i] *= q_mask[i];
+        }
+
+        // q(r, 1+1/2)
+        if (_propagator_half_steps[1] != nullptr)
+        {
+            #ifndef NDEBUG
+            if (id >= 0 && propagator_finished[id][1])
+                std::cout << "already finished: " + key + ", " + std::to_string(1) << std::endl;
+            #endif
+
+            #ifndef NDEBUG
+            #pragma omp critical
+            this->time_complexity++;
+            #endif
+
+            propagator_solver->advance_propagator_discrete_half_bond_step(
+                _propagator[1],
+                _propagator_half_steps[1],
+                monomer_type);
+
+            #ifndef NDEBUG
+            if (id >= 0)
+                propagator_half_steps_finished[id][1] = true;
+            #endif
+        }
+        n_segment_from++;
+    }
+
+    // Advance propagator successively
+    // q(r, s)
+    for(int n=n_segment_from; n<n_segment_to; n++)
+    {
         #ifndef NDEBUG
-        std::cout << "time_complexity: " << this->time_complexity << std::endl;
+        if (id >= 0 && !propagator_finished[id][n])
+            std::cout << "unfinished, key: " + key + ", " + std::to_string(n) << std::endl;
+        if (id >= 0 && propagator_finished[id][n+1])
+            std::cout << "already finished: " + key + ", " + std::to_string(n+1) << std::endl;
+        #endif
+
+        // #ifndef NDEBUG
+        // #pragma omp critical
+        // std::cout << job << " q_s, " << n << ", " << 
+        //     std::chrono::duration_cast<std::chrono::microseconds>
+        //     (std::chrono::system_clock::now().time_since_epoch()).count() - start_time << std::endl;
+        // #endif
+
+        #ifndef NDEBUG
+        #pragma omp critical
+        this->time_complexity++;
+        #endif
+
+        propagator_solver->advance_propagator_discrete(
+            _propagator[n], _propagator[n+1],
+            monomer_type, q_mask);
+
+        #ifndef NDEBUG
+        if (id >= 0)
+            propagator_finished[id][n+1] = true;
         #endif
+    }
 
-        // Compute total partition function of each distinct polymers
-        for(const auto& segment_info: single_partition_segment)
+    // q(r, s+1/2)
+    for(int n=n_segment_from; n<n_segment_to; n++)
+    {
+        if (_propagator_half_steps[n+1] != nullptr)
         {
-            int p                    = std::get<0>(segment_info);
-            double *propagator_left  = std::get<1>(segment_info);
-            double *propagator_right = std::get<2>(segment_info);
-            std::string monomer_type = std::get<3>(segment_info);
-            int n_aggregated         = std::get<4>(segment_info);
-            const double *_exp_dw    = propagator_solver->exp_dw[monomer_type];
-
-            single_polymer_partitions[p]= cb->inner_product_inverse_weight(
-                propagator_left, propagator_right, _exp_dw)/n_aggregated/cb->get_volume();
-        }
+            // #ifndef NDEBUG
+            // #pragma omp critical
+            // std::cout << job << " q_s+1/2, " << n << ", " << 
+            //     std::chrono::duration_cast<std::chrono::microseconds>
+            //     (std::chrono::system_clock::now().time_since_epoch()).count() - start_time << std::endl;
+            // #endif
+
+            #ifndef NDEBUG
+            if (id >= 0 && propagator_half_steps_finished[id][n+1])
+                std::cout << "already half_step finished: " + key + ", " + std::to_string(n+1) << std::endl;
+            #endif
 
+            #ifndef NDEBUG
+            #pragma omp critical
+            this->time_complexity++;
+            #endif
+
+            propagator_solver->advance_propagator_discrete_half_bond_step(
+                _propagator[n+1],
+                _propagator_half_steps[n+1],
+                monomer_type);
+
+            #ifndef NDEBUG
+            if (id >= 0)
+                propagator_half_steps_finished[id][n+1] = true;
+            #endif
+        }
     }
-    catch(std::exception& exc)
+
+    // #ifndef NDEBUG
+    // #pragma omp critical
+    // std::cout << job << " finished, " << 
+    //     std::chrono::duration_cast<std::chrono::microseconds>
+    //     (std::chrono::system_clock::now().time_since_epoch()).count() - start_time << std::endl;
+    // #endif
+}
+void CpuComputationDiscrete::allocate_propagator(int id)
+{
+    const int M = cb->get_n_grid();
+    auto allocate_segment = [&]() -> double*
     {
-        throw_without_line_number(exc.what());
+        if (segment_pool.empty())
+            return new double[M];
+        double *segment = segment_pool.back();
+        segment_pool.pop_back();
+        return segment;
+    };
+
+    const ComputationEdge& edge = propagator_analyzer->get_computation_propagator(id);
+    for(int i=1; i<propagator_size[id]; i++)
+        propagator[id][i] = allocate_segment();
+    if (edge.deps.size() > 0)
+        propagator_half_steps[id][0] = allocate_segment();
+    for(int n: edge.junction_ends)
+        propagator_half_steps[id][n] = allocate_segment();
+}
+void CpuComputationDiscrete::release_propagator(int id)
+{
+    for(int i=0; i<propagator_size[id]; i++)
+    {
+        if (propagator[id][i] != nullptr)
+            segment_pool.push_back(propagator[id][i]);
+        if (propagator_half_steps[id][i] != nullptr)
+            segment_pool.push_back(propagator_half_steps[id][i]);
+        propagator[id][i] = nullptr;
+        propagator_half_steps[id][i] = nullptr;
+
+        #ifndef NDEBUG
+        propagator_finished[id][i] = false;
+        propagator_half_steps_finished[id][i] = false;
+        #endif
     }
 }
+void CpuComputationDiscrete::compute_single_partition(const std::tuple<int, std::string, std::string>& key)
+{
+    for(const auto& segment_info: single_partition_segment)
+    {
+        if (std::get<1>(segment_info) != key)
+            continue;
+
+        int p                    = std::get<0>(segment_info);
+        int n_aggregated         = std::get<2>(segment_info);
+        const ComputationBlock& block = propagator_analyzer->get_computation_block(key);
+        const double *_exp_dw    = propagator_solver->exp_dw[block.monomer_type];
 
+        single_polymer_partitions[p]= cb->inner_product_inverse_weight(
+            propagator[block.id_left][block.n_segment_left], propagator[block.id_right][1], _exp_dw)/n_aggregated/cb->get_volume();
+    }
+}
 void CpuComputationDiscrete::compute_concentrations()
 {
     try
@@ -588,54 +918,39 @@ void CpuComputationDiscrete::compute_concentrations()
         const int M = cb->get_n_grid();
 
         // Calculate segment concentrations
+        double trace_start = (tracer != nullptr) ? tracer->now() : 0.0;
         #pragma omp parallel for num_threads(n_streams)
         for(size_t b=0; b<phi_block.size();b++)
         {
             auto block = phi_block.begin();
             advance(block, b);
             const auto& key = block->first;
+            TraceScope trace_scope(tracer, key, "concentration");
 
-            int p                 = std::get<0>(key);
-            std::string key_left  = std::get<1>(key);
-            std::string key_right = std::get<2>(key);
+            int p = std::get<0>(key);
+            const ComputationBlock& computation_block = propagator_analyzer->get_computation_block(key);
+            int n_segment_right = computation_block.n_segment_right;
+            int n_repeated = computation_block.n_repeated;
 
-            int n_segment_right = propagator_analyzer->get_computation_block(key).n_segment_right;
-            int n_segment_left  = propagator_analyzer->get_computation_block(key).n_segment_left;
-            std::string monomer_type = propagator_analyzer->get_computation_block(key).monomer_type;
-            int n_repeated = propagator_analyzer->get_computation_block(key).n_repeated;
-            const double *_exp_dw = propagator_solver->exp_dw[monomer_type];
+            // If reduce_memory_usage is on, concentrations are already computed in compute_propagators()
+            if (!reduce_memory_usage)
+                compute_block_concentration(key);
+            else if (is_phi_block_normalized)
+                continue;
 
             // If there is no segment
             if(n_segment_right == 0)
-            {
-                for(int i=0; i<M;i++)
-                    block->second[i] = 0.0;
                 continue;
-            }
-
-            // Check keys
-            #ifndef NDEBUG
-            if (propagator.find(key_left) == propagator.end())
-                std::cout << "Could not find key_left key'" + key_left + "'. " << std::endl;
-            if (propagator.find(key_right) == propagator.end())
-                std::cout << "Could not find key_right key'" + key_right + "'. " << std::endl;
-            #endif
 
-            // Calculate phi of one block (possibly multiple blocks when using aggregation)
-            calculate_phi_one_block(
-                block->second,          // phi
-                propagator[key_left],   // dependency v
-                propagator[key_right],  // dependency u
-                _exp_dw,                // exp_dw
-                n_segment_right,
-                n_segment_left);
-            
             // Normalize concentration
             Polymer& pc = molecules->get_polymer(p);
             double norm = molecules->get_ds()*pc.get_volume_fraction()/pc.get_alpha()/single_polymer_partitions[p]*n_repeated;
             for(int i=0; i<M; i++)
                 block->second[i] *= norm;
         }
+        is_phi_block_normalized = true;
+        if (tracer != nullptr)
+            tracer->add_phase("compute_concentrations", trace_start);
 
         // Calculate partition functions and concentrations of solvents
         for(int s=0; s<molecules->get_n_solvent_types(); s++)
@@ -655,6 +970,34 @@ void CpuComputationDiscrete::compute_concentrations()
         throw_without_line_number(exc.what());
     }
 }
+void CpuComputationDiscrete::compute_block_concentration(const std::tuple<int, std::string, std::string>& key)
+{
+    const int M = cb->get_n_grid();
+
+    const ComputationBlock& block = propagator_analyzer->get_computation_block(key);
+    int n_segment_right = block.n_segment_right;
+    int n_segment_left  = block.n_segment_left;
+    const double *_exp_dw = propagator_solver->exp_dw[block.monomer_type];
+    double *_phi = phi_block[key];
+
+    // If there is no segment
+    if(n_segment_right == 0)
+    {
+        for(int i=0; i<M;i++)
+            _phi[i] = 0.0;
+        return;
+    }
+
+    // Check keys
+    // Calculate phi of one block (possibly multiple blocks when using aggregation)
+    calculate_phi_one_block(
+        _phi,                   // phi
+        propagator[block.id_left],   // dependency v
+        propagator[block.id_right],  // dependency u
+        _exp_dw,                // exp_dw
+        n_segment_right,
+        n_segment_left);
+}
 void CpuComputationDiscrete::calculate_phi_one_block(
     double *phi, double **q_1, double **q_2, const double *exp_dw, const int N_RIGHT, const int N_LEFT)
 {
@@ -801,12 +1144,17 @@ void CpuComputationDiscrete::get_block_concentration(int p, double *phi)
         if (p < 0 || p > P-1)
             throw_with_line_number("Index (" + std::to_string(p) + ") must be in range [0, " + std::to_string(P-1) + "]");
 
-        if (propagator_analyzer->is_aggregated())
-            throw_with_line_number("Disable 'aggregation' option to obtain concentration of each block.");
-
         Polymer& pc = molecules->get_polymer(p);
         std::vector<Block>& blocks = pc.get_blocks();
 
+        // If propagators are aggregated, blocks are recovered from the propagators before aggregation
+        if (propagator_analyzer->is_aggregated())
+        {
+            if (reduce_memory_usage)
+                throw_with_line_number("Disable 'reduce_memory_usage' option to obtain concentration of each block with aggregation.");
+            recover_original_propagators(p);
+        }
+
         for(size_t b=0; b<blocks.size(); b++)
         {
             std::string key_left  = pc.get_propagator_key(blocks[b].v, blocks[b].u);
@@ -814,9 +1162,29 @@ void CpuComputationDiscrete::get_block_concentration(int p, double *phi)
             if (key_left < key_right)
                 key_left.swap(key_right);
 
-            double* _essential_phi_block = phi_block[std::make_tuple(p, key_left, key_right)];
+            if (!propagator_analyzer->is_aggregated())
+            {
+                double* _essential_phi_block = phi_block[std::make_tuple(p, key_left, key_right)];
+                for(int i=0; i<M; i++)
+                    phi[i+b*M] = _essential_phi_block[i]; 
+                continue;
+            }
+
+            const ComputationBlock& block = propagator_analyzer->get_original_blocks().at(std::make_tuple(p, key_left, key_right));
+            double *_phi = &phi[b*M];
+            if (block.n_segment_right == 0)
+            {
+                for(int i=0; i<M; i++)
+                    _phi[i] = 0.0;
+                continue;
+            }
+            calculate_phi_one_block(_phi, recovered_propagators[key_left].data(), recovered_propagators[key_right].data(),
+                propagator_solver->exp_dw[block.monomer_type], block.n_segment_right, block.n_segment_left);
+
+            // Normalize concentration
+            double norm = molecules->get_ds()*pc.get_volume_fraction()/pc.get_alpha()/single_polymer_partitions[p]*block.n_repeated;
             for(int i=0; i<M; i++)
-                phi[i+b*M] = _essential_phi_block[i]; 
+                _phi[i] *= norm;
         }
     }
     catch(std::exception& exc)
@@ -824,6 +1192,104 @@ void CpuComputationDiscrete::get_block_concentration(int p, double *phi)
         throw_without_line_number(exc.what());
     }
 }
+void CpuComputationDiscrete::recover_original_propagators(int p)
+{
+    const int M = cb->get_n_grid();
+    auto& original_propagators = propagator_analyzer->get_original_propagators();
+    auto& computation_propagators = propagator_analyzer->get_computation_propagators();
+
+    // Find propagators required by the blocks of the polymer that are not recovered yet.
+    // Deps are not required if the propagator is already computed.
+    std::set<std::string, ComparePropagatorKey> required_keys;
+    std::vector<std::string> stack;
+    for(const auto& block: propagator_analyzer->get_original_blocks())
+    {
+        if (std::get<0>(block.first) != p)
+            continue;
+        stack.push_back(std::get<1>(block.first));
+        stack.push_back(std::get<2>(block.first));
+    }
+    while(!stack.empty())
+    {
+        std::string key = stack.back();
+        stack.pop_back();
+        if (recovered_propagators.find(key) != recovered_propagators.end() || !required_keys.insert(key).second)
+            continue;
+        if (computation_propagators.find(key) != computation_propagators.end())
+            continue;
+        for(const auto& dep: original_propagators.at(key).deps)
+            stack.push_back(std::get<0>(dep));
+    }
+
+    // Plans of the segments to be computed, (plan, n_segment_from, n_segment_to)
+    // Deps have lower heights, so they are recovered first
+    std::vector<std::tuple<PropagatorPlan, int, int>> plans;
+    auto new_segment = [&]() -> double*
+    {
+        recovered_segments.push_back(std::vector<double>(M));
+        return recovered_segments.back().data();
+    };
+    for(const std::string& key: required_keys)
+    {
+        const ComputationEdge& edge = original_propagators.at(key);
+        const int N = edge.max_n_segment;
+        std::vector<double *>& _q = recovered_propagators[key];
+        std::vector<double *>& _q_half_steps = recovered_half_steps[key];
+
+        // Reuse segments that are already computed. Index 0 will be not used.
+        int n_computed = 0;
+        auto it = computation_propagators.find(key);
+        if (it != computation_propagators.end())
+        {
+            const int id = propagator_analyzer->get_propagator_id(key);
+            n_computed = std::min(it->second.max_n_segment, N);
+            _q.assign(propagator[id], propagator[id]+n_computed+1);
+            _q_half_steps.assign(propagator_half_steps[id], propagator_half_steps[id]+n_computed+1);
+        }
+        else
+        {
+            _q.push_back(nullptr);
+            _q_half_steps.push_back(edge.deps.size() > 0 ? new_segment() : nullptr);
+        }
+        for(int n=n_computed+1; n<=N; n++)
+        {
+            _q.push_back(new_segment());
+            _q_half_steps.push_back(nullptr);
+        }
+
+        // Half bond steps at the junction ends
+        for(int n: edge.junction_ends)
+        {
+            if (n == 0 || _q_half_steps[n] != nullptr)
+                continue;
+            _q_half_steps[n] = new_segment();
+            // Half bond steps of the computed segments are not computed by the plan
+            if (n <= n_computed)
+                propagator_solver->advance_propagator_discrete_half_bond_step(_q[n], _q_half_steps[n], edge.monomer_type);
+        }
+        if (n_computed == N)
+            continue;
+
+        // Junctions combine half bond steps q(r,n+1/2) of deps
+        PropagatorPlan plan = make_propagator_plan(key, edge, _q.data(), _q_half_steps.data());
+        for(const auto& dep: edge.deps)
+        {
+            plan.junction.push_back(std::make_tuple(-1, recovered_half_steps[std::get<0>(dep)].data(),
+                std::get<1>(dep), std::get<2>(dep)));
+        }
+        plans.push_back(std::make_tuple(plan, n_computed, N));
+    }
+
+    // The arrays of q_init given to compute_propagators may be freed, so their copies are used
+    std::map<std::string, const double*> q_init;
+    for(const auto& item: q_init_copy)
+        q_init[item.first] = item.second.data();
+    q_init_ptr.resize(q_init_names.size());
+    resolve_q_init(q_init);
+
+    for(const auto& item: plans)
+        compute_propagator_segments(std::get<0>(item), -1, std::get<1>(item), std::get<2>(item));
+}
 double CpuComputationDiscrete::get_solvent_partition(int s)
 {
     try
@@ -854,6 +1320,20 @@ void CpuComputationDiscrete::get_solvent_concentration(int s, double *phi_out)
         throw_without_line_number(exc.what());
     }
 }
+std::map<std::tuple<int, std::string, std::string>, const double*> CpuComputationDiscrete::get_block_concentration_ptrs()
+{
+    std::map<std::tuple<int, std::string, std::string>, const double*> ptrs;
+    for(const auto& item: phi_block)
+        ptrs[item.first] = item.second;
+    return ptrs;
+}
+const double* CpuComputationDiscrete::get_solvent_concentration_ptr(int s)
+{
+    const int S = molecules->get_n_solvent_types();
+    if (s < 0 || s > S-1)
+        throw_with_line_number("Index (" + std::to_string(s) + ") must be in range [0, " + std::to_string(S-1) + "]");
+    return phi_solvent[s];
+}
 void CpuComputationDiscrete::compute_stress()
 {
     // This method should be invoked after invoking compute_statistics().
@@ -876,98 +1356,34 @@ void CpuComputationDiscrete::compute_stress()
         }
 
         // Compute stress for each block
-        #pragma omp parallel for num_threads(n_streams)
-        for(size_t b=0; b<phi_block.size();b++)
+        double trace_start = (tracer != nullptr) ? tracer->now() : 0.0;
+        if (!reduce_memory_usage)
         {
-            auto block = phi_block.begin();
-            advance(block, b);
-            const auto& key   = block->first;
-
-            std::string key_left  = std::get<1>(key);
-            std::string key_right = std::get<2>(key);
-
-            const int N_RIGHT = propagator_analyzer->get_computation_block(key).n_segment_right;
-            const int N_LEFT  = propagator_analyzer->get_computation_block(key).n_segment_left;
-            std::string monomer_type = propagator_analyzer->get_computation_block(key).monomer_type;
-            int n_repeated = propagator_analyzer->get_computation_block(key).n_repeated;
-
-            // If there is no segment
-            if(N_RIGHT == 0)
-                continue;
-
-            double **q_1 = propagator[key_left];     // dependency v
-            double **q_2 = propagator[key_right];    // dependency u
-
-            double *q_segment_1;
-            double *q_segment_2;
-
-            bool is_half_bond_length;
-            // std::cout << "key_left, key_right, N_LEFT, N: "
-            //      << key_left << ", " << key_right << ", " << N_LEFT << ", " << N << std::endl;
-
-            std::array<double,3> _block_dq_dl = block_dq_dl[key];
-
-            // Compute stress at each chain bond
-            for(int n=0; n<=N_RIGHT; n++)
+            #pragma omp parallel for num_threads(n_streams)
+            for(size_t b=0; b<phi_block.size();b++)
             {
-                // block_dq_dl[key][0] = 0.0;
-                // At v
-                if (n == N_LEFT)
-                {
-                    // std::cout << "case 1: " << propagator_junction_start[key_left][0] << ", " << q_2[(N-1)*M] << std::endl;
-                    if (propagator_analyzer->get_computation_propagator(key_left).deps.size() == 0) // if v is leaf node, skip
-                        continue;
-                    q_segment_1 = propagator_half_steps[key_left][0];
-                    q_segment_2 = q_2[N_RIGHT];
-                    is_half_bond_length = true;
-                }
-                // At u
-                else if (n == 0 && N_LEFT == N_RIGHT)
-                {
-                    // std::cout << "case 2: " << q_1[(N_LEFT-1)*M] << ", " << propagator_junction_start[key_right][0] << std::endl;
-                    if (propagator_analyzer->get_computation_propagator(key_right).deps.size() == 0) // if u is leaf node, skip
-                        continue;
-                    q_segment_1 = q_1[N_LEFT];
-                    q_segment_2 = propagator_half_steps[key_right][0];
-                    is_half_bond_length = true;
-                }
-                // At aggregation junction
-                else if (n == 0)
-                {
-                    // std::cout << "case 4" << std::endl;
-                    continue;
-                }
-                // Within the blocks
-                else
-                {
-                    // std::cout << "case 5: " << q_1[(N_LEFT-n-1)*M] << ", " << q_2[(n-1)*M] << std::endl;
-
-                    // double temp_sum1=0;
-                    // double temp_sum2=0;
-                    // For (int i=0;i<M;i++)
-                    // {
-                    //     temp_sum1 += q_1[(N_LEFT-n-1)*M+1];
-                    //     temp_sum2 += q_2[(n-1)*M+1];
-                    // }
-                    // std::cout << "\t" << temp_sum1 << ", " << temp_sum2 << std::endl;
-                    q_segment_1 = q_1[N_LEFT-n];
-                    q_segment_2 = q_2[n];
-                    is_half_bond_length = false;
-
-                    // std::cout << "\t" << bond_length_sq << ", " << boltz_bond_now[10] << std::endl;
-                }
-                // Compute 
-                std::vector<double> segment_stress = propagator_solver->compute_single_segment_stress_discrete(
-                    q_segment_1, q_segment_2, monomer_type, is_half_bond_length);
-                for(int d=0; d<DIM; d++)
-                    _block_dq_dl[d] += segment_stress[d]*n_repeated;
-
-                // std::cout << "n: " << n << ", " << is_half_bond_length << ", " << segment_stress[0] << std::endl;
-                // std::cout << "n: " << n << ", " << block_dq_dl[key][0] << std::endl;
+                auto block = phi_block.begin();
+                advance(block, b);
+                TraceScope trace_scope(tracer, block->first, "stress");
+                block_dq_dl[block->first] = compute_block_stress(block->first);
             }
-            block_dq_dl[key] = _block_dq_dl;
+        }
+        // Propagators are already released, so recompute them
+        else
+        {
+            std::map<std::string, const double*> q_init;
+            for(const auto& item: q_init_copy)
+                q_init[item.first] = item.second.data();
+            compute_propagators_by_schedule(q_init,
+                [this, &block_dq_dl](const std::tuple<int, std::string, std::string>& key)
+                {
+                    block_dq_dl[key] = compute_block_stress(key);
+                });
         }
 
+        if (tracer != nullptr)
+            tracer->add_phase("compute_stress", trace_start);
+
         // Compute total stress
         int n_polymer_types = molecules->get_n_polymer_types();
         for(int p=0; p<n_polymer_types; p++)
@@ -994,6 +1410,86 @@ void CpuComputationDiscrete::compute_stress()
         throw_without_line_number(exc.what());
     }
 }
+std::array<double,3> CpuComputationDiscrete::compute_block_stress(const std::tuple<int, std::string, std::string>& key)
+{
+    const int DIM  = cb->get_dim();
+
+    const ComputationBlock& block = propagator_analyzer->get_computation_block(key);
+    const int N_RIGHT = block.n_segment_right;
+    const int N_LEFT  = block.n_segment_left;
+    const std::string& monomer_type = block.monomer_type;
+    int n_repeated = block.n_repeated;
+
+    std::array<double,3> _block_dq_dl = {0.0, 0.0, 0.0};
+
+    // If there is no segment
+    if(N_RIGHT == 0)
+        return _block_dq_dl;
+
+    double **q_1 = propagator[block.id_left];     // dependency v
+    double **q_2 = propagator[block.id_right];    // dependency u
+
+    double *q_segment_1;
+    double *q_segment_2;
+
+    bool is_half_bond_length;
+    // std::cout << "key_left, key_right, N_LEFT, N: "
+    //      << key_left << ", " << key_right << ", " << N_LEFT << ", " << N << std::endl;
+
+    // Compute stress at each chain bond
+    for(int n=0; n<=N_RIGHT; n++)
+    {
+        // block_dq_dl[key][0] = 0.0;
+        // At v
+        if (n == N_LEFT)
+        {
+            // std::cout << "case 1: " << propagator_junction_start[key_left][0] << ", " << q_2[(N-1)*M] << std::endl;
+            if (propagator_analyzer->get_computation_propagator(block.id_left).dep_ids.size() == 0) // if v is leaf node, skip
+                continue;
+            q_segment_1 = propagator_half_steps[block.id_left][0];
+            q_segment_2 = q_2[N_RIGHT];
+            is_half_bond_length = true;
+        }
+        // At u
+        else if (n == 0)
+        {
+            // std::cout << "case 2: " << q_1[(N_LEFT-1)*M] << ", " << propagator_junction_start[key_right][0] << std::endl;
+            if (!propagator_analyzer->is_junction_start(block.id_right)) // if u is leaf node or aggregation of slices, skip
+                continue;
+            q_segment_1 = q_1[N_LEFT];
+            q_segment_2 = propagator_half_steps[block.id_right][0];
+            is_half_bond_length = true;
+        }
+        // Within the blocks
+        else
+        {
+            // std::cout << "case 5: " << q_1[(N_LEFT-n-1)*M] << ", " << q_2[(n-1)*M] << std::endl;
+
+            // double temp_sum1=0;
+            // double temp_sum2=0;
+            // For (int i=0;i<M;i++)
+            // {
+            //     temp_sum1 += q_1[(N_LEFT-n-1)*M+1];
+            //     temp_sum2 += q_2[(n-1)*M+1];
+            // }
+            // std::cout << "\t" << temp_sum1 << ", " << temp_sum2 << std::endl;
+            q_segment_1 = q_1[N_LEFT-n];
+            q_segment_2 = q_2[n];
+            is_half_bond_length = false;
+
+            // std::cout << "\t" << bond_length_sq << ", " << boltz_bond_now[10] << std::endl;
+        }
+        // Compute 
+        std::vector<double> segment_stress = propagator_solver->compute_single_segment_stress_discrete(
+            q_segment_1, q_segment_2, monomer_type, is_half_bond_length);
+        for(int d=0; d<DIM; d++)
+            _block_dq_dl[d] += segment_stress[d]*n_repeated;
+
+        // std::cout << "n: " << n << ", " << is_half_bond_length << ", " << segment_stress[0] << std::endl;
+        // std::cout << "n: " << n << ", " << block_dq_dl[key][0] << std::endl;
+    }
+    return _block_dq_dl;
+}
 void CpuComputationDiscrete::get_chain_propagator(double *q_out, int polymer, int v, int u, int n)
 { 
     // This method should be invoked after invoking compute_statistics()
@@ -1006,6 +1502,9 @@ void CpuComputationDiscrete::get_chain_propagator(double *q_out, int polymer, in
         Polymer& pc = molecules->get_polymer(polymer);
         std::string dep = pc.get_propagator_key(v,u);
 
+        if (reduce_memory_usage)
+            throw_with_line_number("Disable 'reduce_memory_usage' option to invoke 'get_chain_propagator'.");
+
         if (propagator_analyzer->get_computation_propagators().find(dep) == propagator_analyzer->get_computation_propagators().end())
             throw_with_line_number("Could not find the propagator code '" + dep + "'. Disable 'aggregation' option to obtain propagator_analyzer.");
             
@@ -1013,7 +1512,7 @@ void CpuComputationDiscrete::get_chain_propagator(double *q_out, int polymer, in
         if (n < 1 || n > N_RIGHT)
             throw_with_line_number("n (" + std::to_string(n) + ") must be in range [1, " + std::to_string(N_RIGHT) + "]");
 
-        double **partition = propagator[dep];
+        double **partition = propagator[propagator_analyzer->get_propagator_id(dep)];
         for(int i=0; i<M; i++)
             q_out[i] = partition[n][i];
     }
@@ -1022,6 +1521,40 @@ void CpuComputationDiscrete::get_chain_propagator(double *q_out, int polymer, in
         throw_without_line_number(exc.what());
     }
 }
+std::vector<double> CpuComputationDiscrete::compute_block_partitions(const std::tuple<int, std::string, std::string>& key)
+{
+    int p                 = std::get<0>(key);
+    std::string key_left  = std::get<1>(key);
+    std::string key_right = std::get<2>(key);
+
+    const ComputationBlock& block = propagator_analyzer->get_computation_block(key);
+    int n_segment_right = block.n_segment_right;
+    int n_segment_left  = block.n_segment_left;
+    int n_repeated      = block.n_repeated;
+    int n_propagators   = block.v_u.size();
+
+    const double *_exp_dw = propagator_solver->exp_dw[block.monomer_type];
+
+    #ifndef NDEBUG
+    std::cout<< p << ", " << key_left << ", " << key_right << ": " << n_segment_left << ", " << n_segment_right << ", " << n_propagators << ", " << n_repeated << std::endl;
+    #endif
+
+    std::vector<double> block_partitions;
+    for(int n=1;n<=n_segment_right;n++)
+    {
+        double total_partition = cb->inner_product_inverse_weight(
+            propagator[block.id_left][n_segment_left-n+1],
+            propagator[block.id_right][n], _exp_dw)*n_repeated/cb->get_volume();
+        
+        total_partition /= n_propagators;
+        block_partitions.push_back(total_partition);
+        
+        #ifndef NDEBUG
+        std::cout<< p << ", " << n << ": " << total_partition << std::endl;
+        #endif
+    }
+    return block_partitions;
+}
 bool CpuComputationDiscrete::check_total_partition()
 {
     // const int M = cb->get_n_grid();
@@ -1033,38 +1566,32 @@ bool CpuComputationDiscrete::check_total_partition()
         total_partitions.push_back(total_partitions_p);
     }
 
+    std::map<std::tuple<int, std::string, std::string>, std::vector<double>> block_partitions;
     for(const auto& block: phi_block)
-    {
-        const auto& key = block.first;
-        int p                 = std::get<0>(key);
-        std::string key_left  = std::get<1>(key);
-        std::string key_right = std::get<2>(key);
-
-        int n_segment_right = propagator_analyzer->get_computation_block(key).n_segment_right;
-        int n_segment_left  = propagator_analyzer->get_computation_block(key).n_segment_left;
-        int n_repeated      = propagator_analyzer->get_computation_block(key).n_repeated;
-        int n_propagators   = propagator_analyzer->get_computation_block(key).v_u.size();
-
-        std::string monomer_type = propagator_analyzer->get_computation_block(key).monomer_type;
-        const double *_exp_dw = propagator_solver->exp_dw[monomer_type];
+        block_partitions[block.first] = {};
 
-        #ifndef NDEBUG
-        std::cout<< p << ", " << key_left << ", " << key_right << ": " << n_segment_left << ", " << n_segment_right << ", " << n_propagators << ", " << propagator_analyzer->get_computation_block(key).n_repeated << std::endl;
-        #endif
+    if (!reduce_memory_usage)
+    {
+        for(const auto& block: phi_block)
+            block_partitions[block.first] = compute_block_partitions(block.first);
+    }
+    // Propagators are already released, so recompute them
+    else
+    {
+        std::map<std::string, const double*> q_init;
+        for(const auto& item: q_init_copy)
+            q_init[item.first] = item.second.data();
+        compute_propagators_by_schedule(q_init,
+            [this, &block_partitions](const std::tuple<int, std::string, std::string>& key)
+            {
+                block_partitions[key] = compute_block_partitions(key);
+            });
+    }
 
-        for(int n=1;n<=n_segment_right;n++)
-        {
-            double total_partition = cb->inner_product_inverse_weight(
-                propagator[key_left][n_segment_left-n+1],
-                propagator[key_right][n], _exp_dw)*n_repeated/cb->get_volume();
-            
-            total_partition /= n_propagators;
-            total_partitions[p].push_back(total_partition);
-            
-            #ifndef NDEBUG
-            std::cout<< p << ", " << n << ": " << total_partition << std::endl;
-            #endif
-        }
+    for(const auto& item: block_partitions)
+    {
+        int p = std::get<0>(item.first);
+        total_partitions[p].insert(total_partitions[p].end(), item.second.begin(), item.second.end());
     }
 
     // Find minimum and maximum of total_partitions
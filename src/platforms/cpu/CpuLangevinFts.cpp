@@ -0,0 +1,53 @@
+#include <iostream>
+
+#include "CpuLangevinFts.h"
+#include "MklFFT3D.h"
+#include "MklFFT2D.h"
+#include "MklFFT1D.h"
+
+CpuLangevinFts::CpuLangevinFts(ComputationBox *cb, Molecules *molecules, PropagatorComputation *solver,
+    AndersonMixing *compressor,
+    std::vector<std::string> monomer_types,
+    std::vector<std::vector<double>> matrix_a,
+    std::vector<std::vector<double>> matrix_a_inv,
+    std::vector<double> eigenvalues,
+    std::vector<int> aux_fields_real_idx,
+    std::vector<int> aux_fields_imag_idx,
+    double h_const,
+    std::vector<double> h_coef_mu1,
+    std::vector<double> h_coef_mu2,
+    std::vector<double> dt_scaling,
+    double langevin_dt, double langevin_sigma,
+    int saddle_max_iter, double saddle_tolerance,
+    int sf_computing_period, int verbose_level,
+    std::map<std::string, std::map<std::string, double>> random_fractions,
+    long random_seed)
+    :LangevinFts(cb, molecules, solver, compressor, monomer_types, matrix_a, matrix_a_inv, eigenvalues,
+        aux_fields_real_idx, aux_fields_imag_idx, h_const, h_coef_mu1, h_coef_mu2, dt_scaling,
+        langevin_dt, langevin_sigma, saddle_max_iter, saddle_tolerance, sf_computing_period, verbose_level,
+        random_fractions, random_seed)
+{
+    try
+    {
+        std::vector<int> nx = cb->get_nx();
+        const int DIM = cb->get_dim();
+        if (DIM == 3)
+            fft = new MklFFT3D({nx[0], nx[1], nx[2]});
+        else if (DIM == 2)
+            fft = new MklFFT2D({nx[0], nx[1]});
+        else
+            fft = new MklFFT1D(nx[0]);
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+CpuLangevinFts::~CpuLangevinFts()
+{
+    delete fft;
+}
+void CpuLangevinFts::forward_fft(double *rdata, std::complex<double> *cdata)
+{
+    fft->forward(rdata, cdata);
+}
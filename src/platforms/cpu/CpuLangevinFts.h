@@ -0,0 +1,40 @@
+/*-------------------------------------------------------------
+* This is a derived CpuLangevinFts class.
+* The Fourier transforms of the structure functions are performed by MKL.
+*------------------------------------------------------------*/
+
+#ifndef CPU_LANGEVIN_FTS_H_
+#define CPU_LANGEVIN_FTS_H_
+
+#include <complex>
+
+#include "LangevinFts.h"
+#include "FFT.h"
+
+class CpuLangevinFts : public LangevinFts
+{
+private:
+    FFT *fft;
+protected:
+    void forward_fft(double *rdata, std::complex<double> *cdata) override;
+public:
+    CpuLangevinFts(ComputationBox *cb, Molecules *molecules, PropagatorComputation *solver,
+        AndersonMixing *compressor,
+        std::vector<std::string> monomer_types,
+        std::vector<std::vector<double>> matrix_a,
+        std::vector<std::vector<double>> matrix_a_inv,
+        std::vector<double> eigenvalues,
+        std::vector<int> aux_fields_real_idx,
+        std::vector<int> aux_fields_imag_idx,
+        double h_const,
+        std::vector<double> h_coef_mu1,
+        std::vector<double> h_coef_mu2,
+        std::vector<double> dt_scaling,
+        double langevin_dt, double langevin_sigma,
+        int saddle_max_iter, double saddle_tolerance,
+        int sf_computing_period, int verbose_level,
+        std::map<std::string, std::map<std::string, double>> random_fractions,
+        long random_seed);
+    ~CpuLangevinFts();
+};
+#endif
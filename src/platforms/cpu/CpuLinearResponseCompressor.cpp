@@ -0,0 +1,176 @@
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+
+#include "CpuLinearResponseCompressor.h"
+#include "CpuSemiImplicitMixing.h"
+#include "CpuAndersonMixingKernels.h"
+#include "MklFFT3D.h"
+#include "MklFFT2D.h"
+#include "MklFFT1D.h"
+#include "Pseudo.h"
+#include "Rpa.h"
+
+CpuLinearResponseCompressor::CpuLinearResponseCompressor(ComputationBox *cb, Molecules *molecules,
+    std::vector<std::string> monomer_types,
+    std::vector<std::vector<double>> matrix_a,
+    std::vector<double> vector_d,
+    AndersonMixing *anderson_mixing,
+    std::map<std::string, std::map<std::string, double>> random_fractions)
+    :LinearResponseCompressor(cb, molecules, monomer_types, matrix_a, vector_d, anderson_mixing, random_fractions)
+{
+    try
+    {
+        const int I = vector_d.size();
+        std::vector<int> nx = cb->get_nx();
+        const int DIM = cb->get_dim();
+        if (DIM == 3)
+            fft = new MklFFT3D({nx[0], nx[1], nx[2]});
+        else if (DIM == 2)
+            fft = new MklFFT2D({nx[0], nx[1]});
+        else
+            fft = new MklFFT1D(nx[0]);
+
+        n_grid = cb->get_n_grid();
+        n_complex_grid = Pseudo::get_n_complex_grid(nx);
+        kernel.resize(I*I*n_complex_grid);
+        work_k.resize(I*n_complex_grid);
+        work_k_out.resize(n_complex_grid);
+        w_deriv_precond = new double[n_var];
+
+        update_kernels();
+        reset_count();
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+CpuLinearResponseCompressor::~CpuLinearResponseCompressor()
+{
+    delete fft;
+    delete[] w_deriv_precond;
+}
+void CpuLinearResponseCompressor::reset_count()
+{
+    mix = mix_init;
+    if (anderson_mixing != nullptr)
+        anderson_mixing->reset_count();
+}
+std::size_t CpuLinearResponseCompressor::get_memory_usage()
+{
+    std::size_t memory = sizeof(double)*(kernel.size() + static_cast<std::size_t>(n_var))
+                       + sizeof(std::complex<double>)*(work_k.size() + work_k_out.size());
+    if (anderson_mixing != nullptr)
+        memory += anderson_mixing->get_memory_usage();
+    return memory;
+}
+void CpuLinearResponseCompressor::update_kernels()
+{
+    try
+    {
+        const int S = monomer_types.size();
+        const int I = vector_d.size();
+
+        // Random copolymers are added to the monomer types, and their concentrations and fields
+        // are distributed by fractions, i.e., phi_i += f_Ri*phi_R and w_R = sum_i f_Ri*w_i.
+        std::vector<std::string> monomer_types_ext = monomer_types;
+        std::vector<std::vector<double>> fractions;
+        for(int i=0; i<S; i++)
+        {
+            fractions.push_back(std::vector<double>(S, 0.0));
+            fractions[i][i] = 1.0;
+        }
+        for(const auto& item : random_fractions)
+        {
+            monomer_types_ext.push_back(item.first);
+            fractions.push_back(std::vector<double>(S, 0.0));
+            for(const auto& fraction : item.second)
+            {
+                auto it = std::find(monomer_types.begin(), monomer_types.end(), fraction.first);
+                if (it == monomer_types.end())
+                    throw_with_line_number("Monomer type '" + fraction.first + "' of random copolymer '" + item.first + "' is not in the list of monomer types.");
+                fractions.back()[it - monomer_types.begin()] = fraction.second;
+            }
+        }
+        const int E = monomer_types_ext.size();
+
+        std::vector<double> k_square(n_complex_grid);
+        std::vector<double> s_ef(E*E*n_complex_grid);
+        Rpa::get_k_square(cb->get_boundary_conditions(), k_square.data(), cb->get_nx(), cb->get_dx());
+        Rpa::get_correlation_functions(molecules, monomer_types_ext, k_square.data(), n_complex_grid, s_ef.data());
+
+        // Response of the imaginary fields, B_em = sum_i f_ei*A_im
+        std::vector<double> b(E*I, 0.0);
+        for(int e=0; e<E; e++)
+            for(int m=0; m<I; m++)
+                for(int i=0; i<S; i++)
+                    b[e*I+m] += fractions[e][i]*matrix_a[i][m];
+
+        // (B^T*S(k)*B - D)^{-1}
+        std::vector<double> a(I*I), a_inv(I*I);
+        for(int k=0; k<n_complex_grid; k++)
+        {
+            for(int m=0; m<I; m++)
+            {
+                for(int n=0; n<I; n++)
+                {
+                    double sum = (m == n ? -vector_d[m] : 0.0);
+                    for(int e=0; e<E; e++)
+                        for(int f=0; f<E; f++)
+                            sum += b[e*I+m]*s_ef[(e*E+f)*n_complex_grid + k]*b[f*I+n];
+                    a[m*I+n] = sum;
+                }
+            }
+            if (!CpuSemiImplicitMixing::invert_matrix(a, a_inv, I))
+                throw_with_line_number("The linear response matrix of the imaginary fields is singular.");
+            for(int i=0; i<I*I; i++)
+                kernel[i*n_complex_grid + k] = a_inv[i];
+        }
+        lx_kernel = cb->get_lx();
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+void CpuLinearResponseCompressor::calculate_new_fields(
+    double *w_new,
+    double *w_current,
+    double *w_deriv,
+    double old_error_level,
+    double error_level)
+{
+    try
+    {
+        const int I = vector_d.size();
+
+        // Rebuild the kernels if the box has been changed
+        if (cb->get_lx() != lx_kernel)
+            update_kernels();
+
+        // Precondition w_deriv in Fourier space
+        for(int n=0; n<I; n++)
+            fft->forward(&w_deriv[n*n_grid], &work_k[n*n_complex_grid]);
+        for(int m=0; m<I; m++)
+        {
+            for(int k=0; k<n_complex_grid; k++)
+            {
+                std::complex<double> sum = 0.0;
+                for(int n=0; n<I; n++)
+                    sum += kernel[(m*I+n)*n_complex_grid + k]*work_k[n*n_complex_grid + k];
+                work_k_out[k] = sum;
+            }
+            fft->backward(work_k_out.data(), &w_deriv_precond[m*n_grid]);
+        }
+
+        if (anderson_mixing != nullptr)
+            anderson_mixing->calculate_new_fields(w_new, w_current, w_deriv_precond, old_error_level, error_level);
+        else
+            CpuAndersonMixingKernels::simple_mixing(n_var, mix, w_current, w_deriv_precond, w_new);
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
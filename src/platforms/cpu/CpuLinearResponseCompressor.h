@@ -0,0 +1,45 @@
+/*-------------------------------------------------------------
+* This is a derived CpuLinearResponseCompressor class.
+* For each wavevector, the I x I matrix (A^T*S(k)*A - D)^{-1}
+* is computed once when the box lengths are changed, and multiplied to the Fourier
+* components of the residual.
+*------------------------------------------------------------*/
+
+#ifndef CPU_LINEAR_RESPONSE_COMPRESSOR_H_
+#define CPU_LINEAR_RESPONSE_COMPRESSOR_H_
+
+#include <complex>
+#include <vector>
+
+#include "LinearResponseCompressor.h"
+#include "FFT.h"
+
+class CpuLinearResponseCompressor : public LinearResponseCompressor
+{
+private:
+    FFT *fft;
+    int n_grid, n_complex_grid;
+    // Box lengths for which the kernels were built
+    std::vector<double> lx_kernel;
+    // (A^T*S(k)*A - D)^{-1}, stored at [(m*I+n)*n_complex_grid + k]
+    std::vector<double> kernel;
+    std::vector<std::complex<double>> work_k, work_k_out;
+    // Preconditioned residual
+    double *w_deriv_precond;
+public:
+    CpuLinearResponseCompressor(ComputationBox *cb, Molecules *molecules,
+        std::vector<std::string> monomer_types,
+        std::vector<std::vector<double>> matrix_a,
+        std::vector<double> vector_d,
+        AndersonMixing *anderson_mixing,
+        std::map<std::string, std::map<std::string, double>> random_fractions);
+    ~CpuLinearResponseCompressor();
+
+    void reset_count() override;
+    std::size_t get_memory_usage() override;
+    void update_kernels() override;
+    void calculate_new_fields(
+        double *w_new, double *w_current, double *w_deriv,
+        double old_error_level, double error_level) override;
+};
+#endif
@@ -0,0 +1,339 @@
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "CpuNewtonKrylov.h"
+#include "CpuAndersonMixingKernels.h"
+#include "MklFFT3D.h"
+#include "MklFFT2D.h"
+#include "MklFFT1D.h"
+#include "Pseudo.h"
+
+CpuNewtonKrylov::CpuNewtonKrylov(int n_var, int max_krylov,
+    double start_error, double mix_min, double mix_init, double forcing_term)
+    :NewtonKrylov(n_var, max_krylov, start_error, mix_min, mix_init, forcing_term)
+{
+    try
+    {
+        w_base = new double[n_var];
+        w_deriv_base = new double[n_var];
+        work = new double[n_var];
+        dw = new double[n_var];
+
+        v_krylov = new double*[max_krylov+1];
+        for(int i=0; i<max_krylov+1; i++)
+            v_krylov[i] = new double[n_var];
+
+        // Columns of the Hessenberg matrix
+        h_nm = new double*[max_krylov];
+        for(int i=0; i<max_krylov; i++)
+            h_nm[i] = new double[max_krylov+1];
+        cs = new double[max_krylov];
+        sn = new double[max_krylov];
+        g = new double[max_krylov+1];
+        y = new double[max_krylov];
+        h_dots = new double[max_krylov+1];
+
+        fft = nullptr;
+        n_comp = 0;
+        n_grid = 0;
+        n_complex_grid = 0;
+
+        reset_count();
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+CpuNewtonKrylov::~CpuNewtonKrylov()
+{
+    delete[] w_base;
+    delete[] w_deriv_base;
+    delete[] work;
+    delete[] dw;
+
+    for(int i=0; i<max_krylov+1; i++)
+        delete[] v_krylov[i];
+    delete[] v_krylov;
+    for(int i=0; i<max_krylov; i++)
+        delete[] h_nm[i];
+    delete[] h_nm;
+    delete[] cs;
+    delete[] sn;
+    delete[] g;
+    delete[] y;
+    delete[] h_dots;
+
+    delete fft;
+}
+void CpuNewtonKrylov::reset_count()
+{
+    // Initialize mixing parameter
+    mix = mix_init;
+    state = State::SIMPLE_MIXING;
+    n_krylov = 0;
+    n_evaluations = 0;
+    n_newton_steps = 0;
+}
+std::size_t CpuNewtonKrylov::get_memory_usage()
+{
+    return sizeof(double)*static_cast<std::size_t>(max_krylov+5)*n_var
+         + sizeof(double)*kernel.size()
+         + sizeof(std::complex<double>)*(work_k.size() + work_k_out.size());
+}
+void CpuNewtonKrylov::set_fourier_preconditioner(std::vector<int> nx, int n_comp, std::vector<double> kernel)
+{
+    try
+    {
+        const int DIM = nx.size();
+        if (DIM < 1 || DIM > 3)
+            throw_with_line_number("The dimension of grid (" + std::to_string(DIM) + ") must be 1, 2 or 3.");
+        if (n_comp < 1)
+            throw_with_line_number("n_comp (" + std::to_string(n_comp) + ") must be a positive integer.");
+
+        int n_grid = 1;
+        for(int d=0; d<DIM; d++)
+            n_grid *= nx[d];
+        if (n_comp*n_grid > n_var)
+            throw_with_line_number("n_comp*prod(nx) (" + std::to_string(n_comp*n_grid) + ") is larger than n_var (" + std::to_string(n_var) + ").");
+
+        const int n_complex_grid = Pseudo::get_n_complex_grid(nx);
+        if (kernel.size() != static_cast<size_t>(n_comp*n_comp*n_complex_grid))
+            throw_with_line_number("Size of kernel (" + std::to_string(kernel.size()) + ") must be n_comp*n_comp*n_complex_grid (" + std::to_string(n_comp*n_comp*n_complex_grid) + ").");
+
+        delete fft;
+        if (DIM == 3)
+            fft = new MklFFT3D({nx[0], nx[1], nx[2]});
+        else if (DIM == 2)
+            fft = new MklFFT2D({nx[0], nx[1]});
+        else
+            fft = new MklFFT1D(nx[0]);
+
+        this->n_comp = n_comp;
+        this->n_grid = n_grid;
+        this->n_complex_grid = n_complex_grid;
+        this->kernel = kernel;
+        work_k.resize(n_comp*n_complex_grid);
+        work_k_out.resize(n_complex_grid);
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+double CpuNewtonKrylov::norm(double *a)
+{
+    double dot;
+    CpuAndersonMixingKernels::multi_dot_products(n_var, 1, a, &a, &dot);
+    return std::sqrt(dot);
+}
+void CpuNewtonKrylov::apply_preconditioner(double *in, double *out)
+{
+    if (fft == nullptr)
+    {
+        if (out != in)
+            std::copy(in, in+n_var, out);
+        return;
+    }
+    for(int j=0; j<n_comp; j++)
+        fft->forward(&in[j*n_grid], &work_k[j*n_complex_grid]);
+    for(int i=n_comp*n_grid; i<n_var; i++)
+        out[i] = in[i];
+    for(int i=0; i<n_comp; i++)
+    {
+        for(int k=0; k<n_complex_grid; k++)
+        {
+            std::complex<double> sum = 0.0;
+            for(int j=0; j<n_comp; j++)
+                sum += kernel[(i*n_comp+j)*n_complex_grid + k]*work_k[j*n_complex_grid + k];
+            work_k_out[k] = sum;
+        }
+        fft->backward(work_k_out.data(), &out[i*n_grid]);
+    }
+}
+void CpuNewtonKrylov::perturb(double *w_new)
+{
+    // work = M^{-1} v
+    apply_preconditioner(v_krylov[n_krylov], work);
+
+    // Step size of finite differences
+    const double EPS_MACHINE = std::numeric_limits<double>::epsilon();
+    eps = std::sqrt((1.0 + norm(w_base))*EPS_MACHINE)/std::max(norm(work), EPS_MACHINE);
+
+    CpuAndersonMixingKernels::simple_mixing(n_var, eps, w_base, work, w_new);
+}
+void CpuNewtonKrylov::start_newton_step(double *w_new, double *w, double *w_deriv)
+{
+    // 'w_new' can be the same array as 'w'
+    std::copy(w, w+n_var, w_base);
+    std::copy(w_deriv, w_deriv+n_var, w_deriv_base);
+    const double w_deriv_norm = norm(w_deriv_base);
+
+    // Choose the relative tolerance of GMRES, eta = 0.9*(|w_deriv_k|/|w_deriv_{k-1}|)^2.
+    // Linear systems are not solved accurately when Newton iterations are far from the solution.
+    // (Eisenstat and Walker, SIAM J. Sci. Comput. 17, 16 (1996))
+    if (n_newton_steps == 0)
+        eta = forcing_term;
+    else
+    {
+        double eta_new = 0.9*std::pow(w_deriv_norm/w_deriv_norm_base, 2);
+        // Safeguard to prevent eta from decreasing too fast
+        if (0.9*eta*eta > 0.1)
+            eta_new = std::max(eta_new, 0.9*eta*eta);
+        eta = std::min(eta_new, forcing_term);
+    }
+    w_deriv_norm_base = w_deriv_norm;
+
+    // Solve J*dw = -w_deriv, starting from dw = 0
+    for(int i=0; i<n_var; i++)
+        v_krylov[0][i] = -w_deriv_base[i]/w_deriv_norm_base;
+    for(int i=0; i<max_krylov+1; i++)
+        g[i] = 0.0;
+    g[0] = w_deriv_norm_base;
+    n_krylov = 0;
+
+    state = State::KRYLOV;
+    n_newton_steps++;
+    perturb(w_new);
+}
+void CpuNewtonKrylov::calculate_new_fields(
+    double *w_new,
+    double *w_current,
+    double *w_deriv,
+    double old_error_level,
+    double error_level)
+{
+    try
+    {
+        n_evaluations++;
+
+        if (state == State::SIMPLE_MIXING)
+        {
+            // Condition to start Newton iterations
+            if (error_level < start_error)
+            {
+                start_newton_step(w_new, w_current, w_deriv);
+                return;
+            }
+
+            // dynamically change mixing parameter
+            if (old_error_level < error_level)
+                mix = std::max(mix*0.7, mix_min);
+            else
+                mix = mix*1.01;
+
+            // Make a simple mixing of input and output fields for the next iteration
+            CpuAndersonMixingKernels::simple_mixing(n_var, mix, w_current, w_deriv, w_new);
+        }
+        else if (state == State::KRYLOV)
+        {
+            const int j = n_krylov;
+
+            // J*M^{-1}*v_j
+            #pragma omp parallel for simd if(n_var > CpuAndersonMixingKernels::BLOCK_SIZE)
+            for(int i=0; i<n_var; i++)
+                work[i] = (w_deriv[i] - w_deriv_base[i])/eps;
+            const double work_norm = norm(work);
+
+            // Orthogonalize using the classical Gram-Schmidt process with reorthogonalization
+            double *h = h_nm[j];
+            for(int i=0; i<=j+1; i++)
+                h[i] = 0.0;
+            for(int pass=0; pass<2; pass++)
+            {
+                CpuAndersonMixingKernels::multi_dot_products(n_var, j+1, work, v_krylov, h_dots);
+                for(int k=0; k<=j; k++)
+                {
+                    h[k] += h_dots[k];
+                    const double c = h_dots[k];
+                    const double *v_k = v_krylov[k];
+                    #pragma omp parallel for simd if(n_var > CpuAndersonMixingKernels::BLOCK_SIZE)
+                    for(int i=0; i<n_var; i++)
+                        work[i] -= c*v_k[i];
+                }
+            }
+            h[j+1] = norm(work);
+
+            // Apply the previous Givens rotations to the new column, and make a new rotation
+            for(int k=0; k<j; k++)
+            {
+                double temp = cs[k]*h[k] + sn[k]*h[k+1];
+                h[k+1] = -sn[k]*h[k] + cs[k]*h[k+1];
+                h[k] = temp;
+            }
+            const double r = std::sqrt(h[j]*h[j] + h[j+1]*h[j+1]);
+            const bool is_breakdown = (h[j+1] <= 1e-14*work_norm);
+            if (r == 0.0)
+            {
+                cs[j] = 1.0;
+                sn[j] = 0.0;
+            }
+            else
+            {
+                cs[j] = h[j]/r;
+                sn[j] = h[j+1]/r;
+            }
+            const double h_next = h[j+1];
+            h[j] = r;
+            h[j+1] = 0.0;
+            g[j+1] = -sn[j]*g[j];
+            g[j] = cs[j]*g[j];
+            n_krylov++;
+
+            // Continue GMRES iterations
+            if (std::abs(g[j+1]) > eta*w_deriv_norm_base && n_krylov < max_krylov && !is_breakdown && r != 0.0)
+            {
+                for(int i=0; i<n_var; i++)
+                    v_krylov[n_krylov][i] = work[i]/h_next;
+                perturb(w_new);
+                return;
+            }
+
+            // Solve the upper triangular system, H*y = g
+            for(int k=n_krylov-1; k>=0; k--)
+            {
+                double sum = g[k];
+                for(int l=k+1; l<n_krylov; l++)
+                    sum -= h_nm[l][k]*y[l];
+                y[k] = (h_nm[k][k] == 0.0) ? 0.0 : sum/h_nm[k][k];
+            }
+            // dw = M^{-1}*V*y
+            #pragma omp parallel for simd if(n_var > CpuAndersonMixingKernels::BLOCK_SIZE)
+            for(int i=0; i<n_var; i++)
+                work[i] = 0.0;
+            for(int k=0; k<n_krylov; k++)
+            {
+                const double c = y[k];
+                const double *v_k = v_krylov[k];
+                #pragma omp parallel for simd if(n_var > CpuAndersonMixingKernels::BLOCK_SIZE)
+                for(int i=0; i<n_var; i++)
+                    work[i] += c*v_k[i];
+            }
+            apply_preconditioner(work, dw);
+
+            // Newton update
+            state = State::LINE_SEARCH;
+            lambda = 1.0;
+            CpuAndersonMixingKernels::simple_mixing(n_var, lambda, w_base, dw, w_new);
+        }
+        else if (state == State::LINE_SEARCH)
+        {
+            // Minimum step length of line search
+            const double MIN_LAMBDA = 1.0/64;
+            // Accept the step if the norm of w_deriv decreases enough
+            if (norm(w_deriv) <= (1.0 - 1e-4*lambda)*w_deriv_norm_base || lambda <= MIN_LAMBDA)
+            {
+                start_newton_step(w_new, w_current, w_deriv);
+                return;
+            }
+            lambda *= 0.5;
+            CpuAndersonMixingKernels::simple_mixing(n_var, lambda, w_base, dw, w_new);
+        }
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
@@ -0,0 +1,67 @@
+/*-------------------------------------------------------------
+* This is a derived CpuNewtonKrylov class.
+* The linear system of each Newton step, J*dw = -w_deriv, is solved using GMRES,
+* and J*v is approximated by (w_deriv(w + eps*v) - w_deriv(w))/eps.
+* If the norm of w_deriv does not decrease enough at the Newton update,
+* the step is halved (backtracking line search).
+*------------------------------------------------------------*/
+
+#ifndef CPU_NEWTON_KRYLOV_H_
+#define CPU_NEWTON_KRYLOV_H_
+
+#include <complex>
+#include <vector>
+
+#include "NewtonKrylov.h"
+#include "FFT.h"
+
+class CpuNewtonKrylov : public NewtonKrylov
+{
+private:
+    // SIMPLE_MIXING: before error_level becomes less than start_error
+    // KRYLOV: w_deriv at a perturbed field is given
+    // LINE_SEARCH: w_deriv at the Newton update is given
+    enum class State { SIMPLE_MIXING, KRYLOV, LINE_SEARCH };
+    State state;
+
+    // Field and w_deriv at the beginning of the Newton step
+    double *w_base, *w_deriv_base;
+    double w_deriv_norm_base;
+    // Relative tolerance of GMRES for the current Newton step (Eisenstat-Walker)
+    double eta;
+    // Orthonormal basis of Krylov subspace, (max_krylov+1) x n_var
+    double **v_krylov;
+    int n_krylov;
+    // Hessenberg matrix, Givens rotations, and the right-hand side of the least squares problem
+    double **h_nm, *cs, *sn, *g, *y;
+    double *h_dots;
+    // Temporary array, and Newton update
+    double *work, *dw;
+    // Step size of finite differences, and step length of line search
+    double eps, lambda;
+
+    // Fourier-space preconditioner
+    FFT *fft;
+    int n_comp, n_grid, n_complex_grid;
+    std::vector<double> kernel;
+    std::vector<std::complex<double>> work_k, work_k_out;
+
+    double norm(double *a);
+    void apply_preconditioner(double *in, double *out);
+    // Start a new Newton step at w, and return the first perturbed field
+    void start_newton_step(double *w_new, double *w, double *w_deriv);
+    // Return the field perturbed along the preconditioned v_krylov[n_krylov]
+    void perturb(double *w_new);
+public:
+    CpuNewtonKrylov(int n_var, int max_krylov,
+        double start_error, double mix_min, double mix_init, double forcing_term);
+    ~CpuNewtonKrylov();
+
+    void reset_count() override;
+    std::size_t get_memory_usage() override;
+    void set_fourier_preconditioner(std::vector<int> nx, int n_comp, std::vector<double> kernel) override;
+    void calculate_new_fields(
+        double *w_new, double *w_current, double *w_deriv,
+        double old_error_level, double error_level) override;
+};
+#endif
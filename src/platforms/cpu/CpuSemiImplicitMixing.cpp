@@ -0,0 +1,328 @@
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+#include "CpuSemiImplicitMixing.h"
+#include "CpuAndersonMixingKernels.h"
+#include "MklFFT3D.h"
+#include "MklFFT2D.h"
+#include "MklFFT1D.h"
+#include "Pseudo.h"
+#include "Rpa.h"
+
+CpuSemiImplicitMixing::CpuSemiImplicitMixing(ComputationBox *cb, Molecules *molecules,
+    std::vector<std::string> monomer_types,
+    std::vector<std::vector<double>> matrix_chi,
+    std::vector<std::vector<double>> matrix_p,
+    int n_var, double lambda, AndersonMixing *anderson_mixing)
+    :SemiImplicitMixing(cb, molecules, monomer_types, matrix_chi, matrix_p, n_var, lambda, anderson_mixing)
+{
+    try
+    {
+        const int S = monomer_types.size();
+        std::vector<int> nx = cb->get_nx();
+        const int DIM = cb->get_dim();
+        if (DIM == 3)
+            fft = new MklFFT3D({nx[0], nx[1], nx[2]});
+        else if (DIM == 2)
+            fft = new MklFFT2D({nx[0], nx[1]});
+        else
+            fft = new MklFFT1D(nx[0]);
+
+        n_grid = cb->get_n_grid();
+        n_complex_grid = Pseudo::get_n_complex_grid(nx);
+        kernel.resize(S*S*n_complex_grid);
+        linear_response.resize(S*S*n_complex_grid);
+        work_k.resize(S*n_complex_grid);
+        work_k_out.resize(n_complex_grid);
+        w_deriv_precond = new double[n_var];
+
+        // Positive part of chi, sum of lambda_n*v_n*v_n^T for positive eigenvalues lambda_n.
+        // Eigenvalues and eigenvectors are computed by the Jacobi eigenvalue algorithm.
+        std::vector<std::vector<double>> a = matrix_chi;
+        std::vector<std::vector<double>> v(S, std::vector<double>(S, 0.0));
+        for(int i=0; i<S; i++)
+            v[i][i] = 1.0;
+        for(int sweep=0; sweep<100; sweep++)
+        {
+            double off_diagonal = 0.0;
+            for(int p=0; p<S; p++)
+                for(int q=p+1; q<S; q++)
+                    off_diagonal += a[p][q]*a[p][q];
+            if (off_diagonal < 1e-30)
+                break;
+            for(int p=0; p<S; p++)
+            {
+                for(int q=p+1; q<S; q++)
+                {
+                    if (a[p][q] == 0.0)
+                        continue;
+                    const double theta = (a[q][q]-a[p][p])/(2.0*a[p][q]);
+                    const double t = (theta >= 0.0 ? 1.0 : -1.0)/(std::abs(theta) + std::sqrt(theta*theta + 1.0));
+                    const double c = 1.0/std::sqrt(t*t + 1.0);
+                    const double s = t*c;
+                    for(int k=0; k<S; k++)
+                    {
+                        const double a_kp = a[k][p], a_kq = a[k][q];
+                        a[k][p] = c*a_kp - s*a_kq;
+                        a[k][q] = s*a_kp + c*a_kq;
+                    }
+                    for(int k=0; k<S; k++)
+                    {
+                        const double a_pk = a[p][k], a_qk = a[q][k];
+                        a[p][k] = c*a_pk - s*a_qk;
+                        a[q][k] = s*a_pk + c*a_qk;
+                    }
+                    for(int k=0; k<S; k++)
+                    {
+                        const double v_kp = v[k][p], v_kq = v[k][q];
+                        v[k][p] = c*v_kp - s*v_kq;
+                        v[k][q] = s*v_kp + c*v_kq;
+                    }
+                }
+            }
+        }
+        matrix_chi_plus.assign(S, std::vector<double>(S, 0.0));
+        for(int n=0; n<S; n++)
+        {
+            if (a[n][n] <= 0.0)
+                continue;
+            for(int i=0; i<S; i++)
+                for(int j=0; j<S; j++)
+                    matrix_chi_plus[i][j] += a[n][n]*v[i][n]*v[j][n];
+        }
+
+        update_kernels();
+        reset_count();
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+CpuSemiImplicitMixing::~CpuSemiImplicitMixing()
+{
+    delete fft;
+    delete[] w_deriv_precond;
+}
+void CpuSemiImplicitMixing::reset_count()
+{
+    mix = mix_init;
+    is_anderson_started = false;
+    if (anderson_mixing != nullptr)
+        anderson_mixing->reset_count();
+}
+std::size_t CpuSemiImplicitMixing::get_memory_usage()
+{
+    std::size_t memory = sizeof(double)*(kernel.size() + linear_response.size() + static_cast<std::size_t>(n_var))
+                       + sizeof(std::complex<double>)*(work_k.size() + work_k_out.size());
+    if (anderson_mixing != nullptr)
+        memory += anderson_mixing->get_memory_usage();
+    return memory;
+}
+bool CpuSemiImplicitMixing::invert_matrix(std::vector<double> a, std::vector<double>& a_inv, int n)
+{
+    // Gauss-Jordan elimination with partial pivoting
+    double max_element = 0.0;
+    for(int i=0; i<n*n; i++)
+    {
+        max_element = std::max(max_element, std::abs(a[i]));
+        a_inv[i] = 0.0;
+    }
+    for(int i=0; i<n; i++)
+        a_inv[i*n+i] = 1.0;
+
+    for(int i=0; i<n; i++)
+    {
+        int i_max = i;
+        for(int j=i+1; j<n; j++)
+        {
+            if (std::abs(a[j*n+i]) > std::abs(a[i_max*n+i]))
+                i_max = j;
+        }
+        if (std::abs(a[i_max*n+i]) <= 1e-12*max_element)
+            return false;
+        if (i_max != i)
+        {
+            for(int j=0; j<n; j++)
+            {
+                std::swap(a[i*n+j], a[i_max*n+j]);
+                std::swap(a_inv[i*n+j], a_inv[i_max*n+j]);
+            }
+        }
+        const double pivot = a[i*n+i];
+        for(int j=0; j<n; j++)
+        {
+            a[i*n+j] /= pivot;
+            a_inv[i*n+j] /= pivot;
+        }
+        for(int l=0; l<n; l++)
+        {
+            if (l == i)
+                continue;
+            const double factor = a[l*n+i];
+            for(int j=0; j<n; j++)
+            {
+                a[l*n+j] -= factor*a[i*n+j];
+                a_inv[l*n+j] -= factor*a_inv[i*n+j];
+            }
+        }
+    }
+    return true;
+}
+void CpuSemiImplicitMixing::update_kernels()
+{
+    try
+    {
+        const int S = monomer_types.size();
+        std::vector<double> k_square(n_complex_grid);
+        std::vector<double> s_ij(S*S*n_complex_grid);
+        Rpa::get_k_square(cb->get_boundary_conditions(), k_square.data(), cb->get_nx(), cb->get_dx());
+        Rpa::get_correlation_functions(molecules, monomer_types, k_square.data(), n_complex_grid, s_ij.data());
+
+        // Use chi if the disordered state is stable, i.e., S^{-1}(k) - chi is positive definite for the
+        // fluctuations that keep the total concentration, for all wavevectors. Otherwise, the linear response
+        // of the disordered state amplifies the errors of ordered phases, and only chi_+ is used.
+        is_disordered_stable = true;
+        std::vector<double> s_k(S*S), s_k_inv(S*S), g(S*S);
+        for(int k=1; k<n_complex_grid && is_disordered_stable; k++)
+        {
+            for(int i=0; i<S*S; i++)
+                s_k[i] = s_ij[i*n_complex_grid + k];
+            if (!invert_matrix(s_k, s_k_inv, S))
+            {
+                is_disordered_stable = false;
+                break;
+            }
+
+            // Projection onto sum_i delta_phi_i = 0, using basis vectors e_i - e_{S-1}
+            const int L = S-1;
+            for(int i=0; i<L; i++)
+                for(int j=0; j<L; j++)
+                    g[i*L+j] = (s_k_inv[i*S+j] - matrix_chi[i][j])
+                             - (s_k_inv[i*S+L] - matrix_chi[i][L])
+                             - (s_k_inv[L*S+j] - matrix_chi[L][j])
+                             + (s_k_inv[L*S+L] - matrix_chi[L][L]);
+            // Cholesky decomposition
+            for(int j=0; j<L; j++)
+            {
+                double diagonal = g[j*L+j];
+                for(int l=0; l<j; l++)
+                    diagonal -= g[j*L+l]*g[j*L+l];
+                if (diagonal <= 0.0)
+                {
+                    is_disordered_stable = false;
+                    break;
+                }
+                g[j*L+j] = std::sqrt(diagonal);
+                for(int i=j+1; i<L; i++)
+                {
+                    double sum = g[i*L+j];
+                    for(int l=0; l<j; l++)
+                        sum -= g[i*L+l]*g[j*L+l];
+                    g[i*L+j] = sum/g[j*L+j];
+                }
+            }
+        }
+        const std::vector<std::vector<double>>& _matrix_chi = is_disordered_stable ? matrix_chi : matrix_chi_plus;
+
+        // chi*S(k) + P
+        for(int k=0; k<n_complex_grid; k++)
+        {
+            for(int i=0; i<S; i++)
+            {
+                for(int j=0; j<S; j++)
+                {
+                    double chi_s = 0.0;
+                    for(int l=0; l<S; l++)
+                        chi_s += _matrix_chi[i][l]*s_ij[(l*S+j)*n_complex_grid + k];
+                    linear_response[(i*S+j)*n_complex_grid + k] = chi_s + matrix_p[i][j];
+                }
+            }
+        }
+        lx_kernel = cb->get_lx();
+        build_kernel(mix);
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+void CpuSemiImplicitMixing::build_kernel(double step)
+{
+    try
+    {
+        const int S = monomer_types.size();
+        std::vector<double> a(S*S), a_inv(S*S);
+        for(int k=0; k<n_complex_grid; k++)
+        {
+            for(int i=0; i<S; i++)
+                for(int j=0; j<S; j++)
+                    a[i*S+j] = (i == j ? 1.0 : 0.0) + step*linear_response[(i*S+j)*n_complex_grid + k];
+            if (!invert_matrix(a, a_inv, S))
+                throw_with_line_number("I + lambda*(chi*S(k) + P) is singular. Use a smaller lambda (" + std::to_string(step) + ").");
+            for(int i=0; i<S*S; i++)
+                kernel[i*n_complex_grid + k] = a_inv[i];
+        }
+        step_kernel = step;
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
+void CpuSemiImplicitMixing::calculate_new_fields(
+    double *w_new,
+    double *w_current,
+    double *w_deriv,
+    double old_error_level,
+    double error_level)
+{
+    try
+    {
+        const int S = monomer_types.size();
+
+        // Switch to Anderson mixing
+        if (anderson_mixing != nullptr && (is_anderson_started || error_level < anderson_mixing->get_start_error()))
+        {
+            is_anderson_started = true;
+            anderson_mixing->calculate_new_fields(w_new, w_current, w_deriv, old_error_level, error_level);
+            return;
+        }
+
+        // Rebuild the kernels if the box has been changed
+        if (cb->get_lx() != lx_kernel)
+            update_kernels();
+
+        // Dynamically change the step size, not exceeding lambda
+        if (old_error_level < error_level)
+            mix = std::max(mix*0.7, mix_min);
+        else
+            mix = std::min(mix*1.01, lambda);
+        if (mix != step_kernel)
+            build_kernel(mix);
+
+        // Precondition w_deriv in Fourier space
+        for(int j=0; j<S; j++)
+            fft->forward(&w_deriv[j*n_grid], &work_k[j*n_complex_grid]);
+        for(int i=0; i<S; i++)
+        {
+            for(int k=0; k<n_complex_grid; k++)
+            {
+                std::complex<double> sum = 0.0;
+                for(int j=0; j<S; j++)
+                    sum += kernel[(i*S+j)*n_complex_grid + k]*work_k[j*n_complex_grid + k];
+                work_k_out[k] = sum;
+            }
+            fft->backward(work_k_out.data(), &w_deriv_precond[i*n_grid]);
+        }
+        for(int i=S*n_grid; i<n_var; i++)
+            w_deriv_precond[i] = w_deriv[i];
+
+        CpuAndersonMixingKernels::simple_mixing(n_var, mix, w_current, w_deriv_precond, w_new);
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
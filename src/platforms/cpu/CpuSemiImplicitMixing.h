@@ -0,0 +1,59 @@
+/*-------------------------------------------------------------
+* This is a derived CpuSemiImplicitMixing class.
+* For each wavevector, the S x S matrix (I + lambda*(chi*S(k) + P))^{-1}
+* is computed once when the box lengths are changed, and multiplied to the Fourier
+* components of w_deriv. If the disordered state is unstable at any wavevector
+* (e.g., ordered phases beyond the spinodal), the linear response of the disordered
+* state amplifies the errors, so only the positive part of chi, chi_+, is used.
+*------------------------------------------------------------*/
+
+#ifndef CPU_SEMI_IMPLICIT_MIXING_H_
+#define CPU_SEMI_IMPLICIT_MIXING_H_
+
+#include <complex>
+#include <vector>
+
+#include "SemiImplicitMixing.h"
+#include "FFT.h"
+
+class CpuSemiImplicitMixing : public SemiImplicitMixing
+{
+private:
+    FFT *fft;
+    int n_grid, n_complex_grid;
+    // Box lengths for which the kernels were built
+    std::vector<double> lx_kernel;
+    // Positive part of matrix_chi
+    std::vector<std::vector<double>> matrix_chi_plus;
+    // chi*S(k) + P, and (I + step*(chi*S(k) + P))^{-1}, stored at [(i*S+j)*n_complex_grid + k]
+    std::vector<double> linear_response, kernel;
+    double step_kernel;
+    // Whether the disordered state is stable at all wavevectors
+    bool is_disordered_stable;
+    // Whether the fields are updated by Anderson mixing
+    bool is_anderson_started;
+    std::vector<std::complex<double>> work_k, work_k_out;
+    // Preconditioned residual
+    double *w_deriv_precond;
+
+    // Compute 'kernel' for the step size
+    void build_kernel(double step);
+public:
+    CpuSemiImplicitMixing(ComputationBox *cb, Molecules *molecules,
+        std::vector<std::string> monomer_types,
+        std::vector<std::vector<double>> matrix_chi,
+        std::vector<std::vector<double>> matrix_p,
+        int n_var, double lambda, AndersonMixing *anderson_mixing);
+    ~CpuSemiImplicitMixing();
+
+    // Inverse of n x n matrix. Return false if the matrix is singular.
+    static bool invert_matrix(std::vector<double> a, std::vector<double>& a_inv, int n);
+
+    void reset_count() override;
+    std::size_t get_memory_usage() override;
+    void update_kernels() override;
+    void calculate_new_fields(
+        double *w_new, double *w_current, double *w_deriv,
+        double old_error_level, double error_level) override;
+};
+#endif
@@ -13,6 +13,7 @@
 #include "Molecules.h"
 #include "ComputationBox.h"
 #include "FFT.h"
+#include "Tracer.h"
 
 class CpuSolver
 {
@@ -26,13 +27,16 @@ public:
     virtual void update_laplacian_operator() = 0;
     virtual void update_dw(std::map<std::string, const double*> w_input) = 0;
 
+    // Record FFT calls if tracer is not nullptr
+    virtual void set_tracer(Tracer *) {}
+
     //---------- Continuous chain model -------------
     // Advance propagator by one contour step
     virtual void advance_propagator_continuous(
-                double *q_in, double *q_out, std::string monomer_type, const double *q_mask) = 0;
+                double *q_in, double *q_out, const std::string& monomer_type, const double *q_mask) = 0;
     
     // Compute stress of single segment
     virtual std::vector<double> compute_single_segment_stress_continuous(
-                double *q_1, double *q_2, std::string monomer_type) = 0;
+                double *q_1, double *q_2, const std::string& monomer_type) = 0;
 };
 #endif
@@ -10,15 +10,25 @@ CpuSolverPseudo::CpuSolverPseudo(ComputationBox *cb, Molecules *molecules)
 {
     try{
         if (cb->get_dim() == 3)
-            this->fft = new MklFFT3D({cb->get_nx(0),cb->get_nx(1),cb->get_nx(2)});
+        {
+            this->fft        = new MklFFT3D({cb->get_nx(0),cb->get_nx(1),cb->get_nx(2)});
+            this->fft_double = new MklFFT3D({cb->get_nx(0),cb->get_nx(1),cb->get_nx(2)}, 2);
+        }
         else if (cb->get_dim() == 2)
-            this->fft = new MklFFT2D({cb->get_nx(0),cb->get_nx(1)});
+        {
+            this->fft        = new MklFFT2D({cb->get_nx(0),cb->get_nx(1)});
+            this->fft_double = new MklFFT2D({cb->get_nx(0),cb->get_nx(1)}, 2);
+        }
         else if (cb->get_dim() == 1)
-            this->fft = new MklFFT1D(cb->get_nx(0));
+        {
+            this->fft        = new MklFFT1D(cb->get_nx(0));
+            this->fft_double = new MklFFT1D(cb->get_nx(0), 2);
+        }
 
         this->cb = cb;
         this->molecules = molecules;
         this->chain_model = molecules->get_model_name();
+        this->tracer = nullptr;
 
         const int M = cb->get_n_grid();
         const int M_COMPLEX = Pseudo::get_n_complex_grid(cb->get_nx());
@@ -49,6 +59,7 @@ CpuSolverPseudo::CpuSolverPseudo(ComputationBox *cb, Molecules *molecules)
 CpuSolverPseudo::~CpuSolverPseudo()
 {
     delete fft;
+    delete fft_double;
 
     delete[] fourier_basis_x;
     delete[] fourier_basis_y;
@@ -117,77 +128,118 @@ void CpuSolverPseudo::update_dw(std::map<std::string, const double*> w_input)
         }
     }
 }
+void CpuSolverPseudo::set_tracer(Tracer *tracer)
+{
+    this->tracer = tracer;
+}
+void CpuSolverPseudo::fft_forward(double *rdata, std::complex<double> *cdata)
+{
+    static const std::string name = "forward";
+    TraceScope trace_scope(tracer, name, "fft");
+    fft->forward(rdata, cdata);
+}
+void CpuSolverPseudo::fft_backward(std::complex<double> *cdata, double *rdata)
+{
+    static const std::string name = "backward";
+    TraceScope trace_scope(tracer, name, "fft");
+    fft->backward(cdata, rdata);
+}
 void CpuSolverPseudo::advance_propagator_continuous(
-    double *q_in, double *q_out, std::string monomer_type, const double *q_mask)
+    double *q_in, double *q_out, const std::string& monomer_type, const double *q_mask)
 {
     try
     {
         const int M = cb->get_n_grid();
         const int M_COMPLEX = Pseudo::get_n_complex_grid(cb->get_nx());
-        double q_out1[M], q_out2[M];
-        std::complex<double> k_q_in1[M_COMPLEX], k_q_in2[M_COMPLEX];
-
-        double *_exp_dw = exp_dw[monomer_type];
-        double *_exp_dw_half = exp_dw_half[monomer_type];
-        double *_boltz_bond = boltz_bond[monomer_type];
-        double *_boltz_bond_half = boltz_bond_half[monomer_type];
-
-        // step 1
-        for(int i=0; i<M; i++)
-            q_out1[i] = _exp_dw[i]*q_in[i];
-        // 3D fourier discrete transform, forward and inplace
-        fft->forward(q_out1,k_q_in1);
-        // Multiply exp(-k^2 ds/6) in fourier space, in all 3 directions
-        for(int i=0; i<M_COMPLEX; i++)
-            k_q_in1[i] *= _boltz_bond[i];
-        // 3D fourier discrete transform, backward and inplace
-        fft->backward(k_q_in1,q_out1);
-        // Evaluate exp(-w*ds/2) in real space
-        for(int i=0; i<M; i++)
-            q_out1[i] *= _exp_dw[i];
-
-        // step 2
-        // Evaluate exp(-w*ds/4) in real space
-        for(int i=0; i<M; i++)
-            q_out2[i] = _exp_dw_half[i]*q_in[i];
-        // 3D fourier discrete transform, forward and inplace
-        fft->forward(q_out2,k_q_in2);
-        // Multiply exp(-k^2 ds/12) in fourier space, in all 3 directions
-        for(int i=0; i<M_COMPLEX; i++)
-            k_q_in2[i] *= _boltz_bond_half[i];
-        // 3D fourier discrete transform, backward and inplace
-        fft->backward(k_q_in2,q_out2);
-        // Normalization calculation and evaluate exp(-w*ds/2) in real space
-        for(int i=0; i<M; i++)
-            q_out2[i] *= _exp_dw[i];
-        // 3D fourier discrete transform, forward and inplace
-        fft->forward(q_out2,k_q_in2);
-        // Multiply exp(-k^2 ds/12) in fourier space, in all 3 directions
-        for(int i=0; i<M_COMPLEX; i++)
-            k_q_in2[i] *= _boltz_bond_half[i];
-        // 3D fourier discrete transform, backward and inplace
-        fft->backward(k_q_in2,q_out2);
-        // Evaluate exp(-w*ds/4) in real space
-        for(int i=0; i<M; i++)
-            q_out2[i] *= _exp_dw_half[i];
+        double q_work[2*M];
+        std::complex<double> k_q_work[2*M_COMPLEX];
 
-        for(int i=0; i<M; i++)
-            q_out[i] = (4.0*q_out2[i] - q_out1[i])/3.0;
-
-        // Multiply mask
-        if (q_mask != nullptr)
-        {
-            for(int i=0; i<M; i++)
-                q_out[i] *= q_mask[i];
-        }
+        advance_propagator_continuous_fields(fft, fft_double, tracer, 1, M, M_COMPLEX,
+            exp_dw[monomer_type], exp_dw_half[monomer_type], boltz_bond[monomer_type], boltz_bond_half[monomer_type],
+            q_in, q_out, q_mask, q_work, k_q_work);
     }
     catch(std::exception& exc)
     {
         throw_without_line_number(exc.what());
     }
 }
+void CpuSolverPseudo::advance_propagator_continuous_fields(
+    FFT *fft, FFT *fft_double, Tracer *tracer, const int n_fields, const int M, const int M_COMPLEX,
+    const double *exp_dw, const double *exp_dw_half, const double *boltz_bond, const double *boltz_bond_half,
+    double *q_in, double *q_out, const double *q_mask, double *q_work, std::complex<double> *k_q_work)
+{
+    static const std::string name_forward = "forward";
+    static const std::string name_backward = "backward";
+    const int B = n_fields;
+
+    // q_out1 (full step) and q_out2 (two half steps) of all fields
+    double *q_out1 = &q_work[0];
+    double *q_out2 = &q_work[B*M];
+    std::complex<double> *k_q_in1 = &k_q_work[0];
+    std::complex<double> *k_q_in2 = &k_q_work[B*M_COMPLEX];
+
+    // Evaluate exp(-w*ds/2) and exp(-w*ds/4) in real space
+    for(int i=0; i<B*M; i++)
+    {
+        q_out1[i] = exp_dw[i]*q_in[i];
+        q_out2[i] = exp_dw_half[i]*q_in[i];
+    }
+    // Both steps start from q_in, so they are transformed by one batched FFT
+    {
+        TraceScope trace_scope(tracer, name_forward, "fft");
+        fft_double->forward(q_out1, k_q_in1);
+    }
+    // Multiply exp(-k^2 ds/6) and exp(-k^2 ds/12) in fourier space
+    for(int b=0; b<B; b++)
+    {
+        for(int k=0; k<M_COMPLEX; k++)
+        {
+            k_q_in1[b*M_COMPLEX+k] *= boltz_bond[k];
+            k_q_in2[b*M_COMPLEX+k] *= boltz_bond_half[k];
+        }
+    }
+    {
+        TraceScope trace_scope(tracer, name_backward, "fft");
+        fft_double->backward(k_q_in1, q_out1);
+    }
+    // Evaluate exp(-w*ds/2) in real space
+    for(int i=0; i<B*M; i++)
+    {
+        q_out1[i] *= exp_dw[i];
+        q_out2[i] *= exp_dw[i];
+    }
+
+    // The second half step
+    {
+        TraceScope trace_scope(tracer, name_forward, "fft");
+        fft->forward(q_out2, k_q_in2);
+    }
+    for(int b=0; b<B; b++)
+    {
+        for(int k=0; k<M_COMPLEX; k++)
+            k_q_in2[b*M_COMPLEX+k] *= boltz_bond_half[k];
+    }
+    {
+        TraceScope trace_scope(tracer, name_backward, "fft");
+        fft->backward(k_q_in2, q_out2);
+    }
+    // Evaluate exp(-w*ds/4) in real space
+    for(int i=0; i<B*M; i++)
+        q_out2[i] *= exp_dw_half[i];
+
+    for(int i=0; i<B*M; i++)
+        q_out[i] = (4.0*q_out2[i] - q_out1[i])/3.0;
+
+    // Multiply mask
+    if (q_mask != nullptr)
+    {
+        for(int b=0; b<B; b++)
+            for(int i=0; i<M; i++)
+                q_out[b*M+i] *= q_mask[i];
+    }
+}
 void CpuSolverPseudo::advance_propagator_discrete(
-    double *q_in, double *q_out, std::string monomer_type, const double *q_mask)
+    double *q_in, double *q_out, const std::string& monomer_type, const double *q_mask)
 {
     try
     {
@@ -199,12 +251,12 @@ void CpuSolverPseudo::advance_propagator_discrete(
         double *_boltz_bond = boltz_bond[monomer_type];
 
         // 3D fourier discrete transform, forward and inplace
-        fft->forward(q_in,k_q_in);
+        fft_forward(q_in,k_q_in);
         // Multiply exp(-k^2 ds/6) in fourier space, in all 3 directions
         for(int i=0; i<M_COMPLEX; i++)
             k_q_in[i] *= _boltz_bond[i];
         // 3D fourier discrete transform, backward and inplace
-        fft->backward(k_q_in,q_out);
+        fft_backward(k_q_in,q_out);
         // Normalization calculation and evaluate exp(-w*ds) in real space
         for(int i=0; i<M; i++)
             q_out[i] *= _exp_dw[i];
@@ -223,7 +275,7 @@ void CpuSolverPseudo::advance_propagator_discrete(
 }
 
 void CpuSolverPseudo::advance_propagator_discrete_half_bond_step(
-    double *q_in, double *q_out, std::string monomer_type)
+    double *q_in, double *q_out, const std::string& monomer_type)
 {
     try
     {
@@ -234,12 +286,12 @@ void CpuSolverPseudo::advance_propagator_discrete_half_bond_step(
         double *_boltz_bond_half = boltz_bond_half[monomer_type];
 
         // 3D fourier discrete transform, forward and inplace
-        fft->forward(q_in,k_q_in);
+        fft_forward(q_in,k_q_in);
         // Multiply exp(-k^2 ds/12) in fourier space, in all 3 directions
         for(int i=0; i<M_COMPLEX; i++)
             k_q_in[i] *= _boltz_bond_half[i];
         // 3D fourier discrete transform, backward and inplace
-        fft->backward(k_q_in,q_out);
+        fft_backward(k_q_in,q_out);
     }
     catch(std::exception& exc)
     {
@@ -248,7 +300,7 @@ void CpuSolverPseudo::advance_propagator_discrete_half_bond_step(
 }
 
 std::vector<double> CpuSolverPseudo::compute_single_segment_stress_continuous(
-                double *q_1, double *q_2, std::string monomer_type)
+                double *q_1, double *q_2, const std::string& monomer_type)
 {
     const int DIM  = cb->get_dim();
     // const int M    = cb->get_n_grid();
@@ -261,8 +313,8 @@ std::vector<double> CpuSolverPseudo::compute_single_segment_stress_continuous(
     std::complex<double> qk_1[M_COMPLEX];
     std::complex<double> qk_2[M_COMPLEX];
 
-    fft->forward(q_1, qk_1);
-    fft->forward(q_2, qk_2);
+    fft_forward(q_1, qk_1);
+    fft_forward(q_2, qk_2);
 
     for(int d=0; d<DIM; d++)
         stress[d] = 0.0;
@@ -296,7 +348,7 @@ std::vector<double> CpuSolverPseudo::compute_single_segment_stress_continuous(
 }
 
 std::vector<double> CpuSolverPseudo::compute_single_segment_stress_discrete(
-                double *q_1, double *q_2, std::string monomer_type, bool is_half_bond_length)
+                double *q_1, double *q_2, const std::string& monomer_type, bool is_half_bond_length)
 {
     const int DIM  = cb->get_dim();
     // const int M    = cb->get_n_grid();
@@ -322,8 +374,8 @@ std::vector<double> CpuSolverPseudo::compute_single_segment_stress_discrete(
         _boltz_bond = boltz_bond[monomer_type];
     }
 
-    fft->forward(q_1, qk_1);
-    fft->forward(q_2, qk_2);
+    fft_forward(q_1, qk_1);
+    fft_forward(q_2, qk_2);
 
     for(int d=0; d<DIM; d++)
         stress[d] = 0.0;
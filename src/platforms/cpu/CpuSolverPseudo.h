@@ -23,8 +23,15 @@ private:
     Molecules *molecules;
     
     FFT *fft;
+    // FFT of two fields, for the two Richardson steps from the same q_in
+    FFT *fft_double;
     std::string chain_model;
 
+    // Tracer for FFT calls
+    Tracer *tracer;
+    void fft_forward(double *rdata, std::complex<double> *cdata);
+    void fft_backward(std::complex<double> *cdata, double *rdata);
+
     // For stress calculation: compute_stress()
     double *fourier_basis_x;
     double *fourier_basis_y;
@@ -39,25 +46,34 @@ public:
     ~CpuSolverPseudo();
     void update_laplacian_operator() override;
     void update_dw(std::map<std::string, const double*> w_input) override;
+    void set_tracer(Tracer *tracer) override;
 
     //---------- Continuous chain model -------------
     // Advance propagator by one contour step
     void advance_propagator_continuous(
-                double *q_in, double *q_out, std::string monomer_type, const double *q_mask) override;
+                double *q_in, double *q_out, const std::string& monomer_type, const double *q_mask) override;
+
+    // Advance 'n_fields' propagators stored contiguously by one contour step with Richardson extrapolation.
+    // 'fft' and 'fft_double' transform n_fields and 2*n_fields fields. exp_dw and exp_dw_half are given for each field,
+    // and the Boltzmann factors of bonds are shared. 'q_work' and 'k_q_work' hold 2*n_fields fields.
+    static void advance_propagator_continuous_fields(
+                FFT *fft, FFT *fft_double, Tracer *tracer, const int n_fields, const int M, const int M_COMPLEX,
+                const double *exp_dw, const double *exp_dw_half, const double *boltz_bond, const double *boltz_bond_half,
+                double *q_in, double *q_out, const double *q_mask, double *q_work, std::complex<double> *k_q_work);
     
     // Compute stress of single segment
     std::vector<double> compute_single_segment_stress_continuous(
-                double *q_1, double *q_2, std::string monomer_type) override;
+                double *q_1, double *q_2, const std::string& monomer_type) override;
 
     //---------- Discrete chain model -------------
     // Advance propagator by one segment step
-    void advance_propagator_discrete(double *q_in, double *q_out, std::string monomer_type, const double* q_mask);
+    void advance_propagator_discrete(double *q_in, double *q_out, const std::string& monomer_type, const double* q_mask);
 
     // Advance propagator by half bond step
-    void advance_propagator_discrete_half_bond_step(double *q_in, double *q_out, std::string monomer_type);
+    void advance_propagator_discrete_half_bond_step(double *q_in, double *q_out, const std::string& monomer_type);
 
     // Compute stress of single segment
     std::vector<double> compute_single_segment_stress_discrete(
-                double *q_1, double *q_2, std::string monomer_type, bool is_half_bond_length);
+                double *q_1, double *q_2, const std::string& monomer_type, bool is_half_bond_length);
 };
 #endif
@@ -133,7 +133,7 @@ void CpuSolverReal::update_dw(std::map<std::string, const double*> w_input)
     }
 }
 void CpuSolverReal::advance_propagator_continuous(
-    double *q_in, double *q_out, std::string monomer_type, const double *q_mask)
+    double *q_in, double *q_out, const std::string& monomer_type, const double *q_mask)
 {
     try
     {
@@ -173,7 +173,7 @@ void CpuSolverReal::advance_propagator_continuous(
 
 void CpuSolverReal::advance_propagator_3d(
     std::vector<BoundaryCondition> bc,
-    double *q_in, double *q_out, std::string monomer_type)
+    double *q_in, double *q_out, const std::string& monomer_type)
 {
     try
     {
@@ -323,7 +323,7 @@ void CpuSolverReal::advance_propagator_3d(
 }
 void CpuSolverReal::advance_propagator_2d(
     std::vector<BoundaryCondition> bc,
-    double *q_in, double *q_out, std::string monomer_type)
+    double *q_in, double *q_out, const std::string& monomer_type)
 {
     try
     {
@@ -420,7 +420,7 @@ void CpuSolverReal::advance_propagator_2d(
 }
 void CpuSolverReal::advance_propagator_1d(
     std::vector<BoundaryCondition> bc,
-    double *q_in, double *q_out, std::string monomer_type)
+    double *q_in, double *q_out, const std::string& monomer_type)
 {
     try
     {
@@ -459,7 +459,7 @@ void CpuSolverReal::advance_propagator_1d(
     }
 }
 std::vector<double> CpuSolverReal::compute_single_segment_stress_continuous(
-    double *q_1, double *q_2, std::string monomer_type)
+    double *q_1, double *q_2, const std::string& monomer_type)
 {
     try
     {
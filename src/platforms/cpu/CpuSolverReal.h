@@ -41,13 +41,13 @@ private:
 
     void advance_propagator_3d(
         std::vector<BoundaryCondition> bc,
-        double *q_in, double *q_out, std::string monomer_type);
+        double *q_in, double *q_out, const std::string& monomer_type);
     void advance_propagator_2d(
         std::vector<BoundaryCondition> bc,
-        double *q_in, double *q_out, std::string monomer_type);
+        double *q_in, double *q_out, const std::string& monomer_type);
     void advance_propagator_1d(
         std::vector<BoundaryCondition> bc,
-        double *q_in, double *q_out, std::string monomer_type);
+        double *q_in, double *q_out, const std::string& monomer_type);
 public:
 
     CpuSolverReal(ComputationBox *cb, Molecules *molecules);
@@ -66,10 +66,10 @@ public:
     //---------- Continuous chain model -------------
     // Advance propagator by one contour step
     void advance_propagator_continuous(
-                double *q_in, double *q_out, std::string monomer_type, const double *q_mask) override;
+                double *q_in, double *q_out, const std::string& monomer_type, const double *q_mask) override;
     
     // Compute stress of single segment
     std::vector<double> compute_single_segment_stress_continuous(
-                double *q_1, double *q_2, std::string monomer_type) override;
+                double *q_1, double *q_2, const std::string& monomer_type) override;
 };
 #endif
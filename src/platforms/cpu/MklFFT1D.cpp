@@ -4,12 +4,14 @@
 
 #include "MklFFT1D.h"
 
-MklFFT1D::MklFFT1D(int nx)
+MklFFT1D::MklFFT1D(int nx, int n_batch)
 {
     try
     {
         MKL_LONG NX = nx;
         this->n_grid = nx;
+        this->n_batch = n_batch;
+        const MKL_LONG N_COMPLEX_GRID = nx/2+1;
         
         // Execution status
         MKL_LONG status{0};
@@ -17,11 +19,23 @@ MklFFT1D::MklFFT1D(int nx)
         status = DftiCreateDescriptor(&hand_forward,  DFTI_DOUBLE, DFTI_REAL, 1, NX );
         status = DftiSetValue(hand_forward, DFTI_PLACEMENT, DFTI_NOT_INPLACE);
         status = DftiSetValue(hand_forward, DFTI_CONJUGATE_EVEN_STORAGE, DFTI_COMPLEX_COMPLEX);
+        if (n_batch > 1)
+        {
+            status = DftiSetValue(hand_forward, DFTI_NUMBER_OF_TRANSFORMS, (MKL_LONG) n_batch);
+            status = DftiSetValue(hand_forward, DFTI_INPUT_DISTANCE, (MKL_LONG) n_grid);
+            status = DftiSetValue(hand_forward, DFTI_OUTPUT_DISTANCE, (MKL_LONG) N_COMPLEX_GRID);
+        }
         status = DftiCommitDescriptor(hand_forward);
 
         status = DftiCreateDescriptor(&hand_backward, DFTI_DOUBLE, DFTI_REAL, 1, NX );
         status = DftiSetValue(hand_backward, DFTI_PLACEMENT, DFTI_NOT_INPLACE);
         status = DftiSetValue(hand_backward, DFTI_CONJUGATE_EVEN_STORAGE, DFTI_COMPLEX_COMPLEX);
+        if (n_batch > 1)
+        {
+            status = DftiSetValue(hand_backward, DFTI_NUMBER_OF_TRANSFORMS, (MKL_LONG) n_batch);
+            status = DftiSetValue(hand_backward, DFTI_INPUT_DISTANCE, (MKL_LONG) N_COMPLEX_GRID);
+            status = DftiSetValue(hand_backward, DFTI_OUTPUT_DISTANCE, (MKL_LONG) n_grid);
+        }
         status = DftiCommitDescriptor(hand_backward);
 
         if (status !=0)
@@ -60,6 +74,6 @@ void MklFFT1D::backward(std::complex<double> *cdata, double *rdata)
     if (status !=0)
         std::cout << "MKL status: " << status << std::endl;
         
-    for(int i=0; i<n_grid; i++)
+    for(int i=0; i<n_grid*n_batch; i++)
         rdata[i] /= fft_normal_factor;
 }
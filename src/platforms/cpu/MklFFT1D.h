@@ -15,11 +15,13 @@ class MklFFT1D : public FFT
 private:
     double fft_normal_factor; //normalization factor FFT
     int n_grid; // the number of grids
+    int n_batch; // the number of fields transformed at once
     // Pointers for forward and backward transform
     DFTI_DESCRIPTOR_HANDLE hand_forward = NULL;
     DFTI_DESCRIPTOR_HANDLE hand_backward = NULL;
 public:
-    MklFFT1D(int nx);
+    // n_batch fields are stored contiguously, i.e., rdata[b*n_grid + i] and cdata[b*n_complex_grid + k]
+    MklFFT1D(int nx, int n_batch=1);
     ~MklFFT1D();
 
     void forward (double *rdata, std::complex<double> *cdata) override;
@@ -4,12 +4,14 @@
 
 #include "MklFFT2D.h"
 
-MklFFT2D::MklFFT2D(std::array<int,2> nx)
+MklFFT2D::MklFFT2D(std::array<int,2> nx, int n_batch)
 {
     try
     {
         MKL_LONG NX[2] = {nx[0],nx[1]};
         this->n_grid = nx[0]*nx[1];
+        this->n_batch = n_batch;
+        const MKL_LONG N_COMPLEX_GRID = nx[0]*(nx[1]/2+1);
         
         // Execution status
         MKL_LONG status{0};
@@ -23,6 +25,12 @@ MklFFT2D::MklFFT2D(std::array<int,2> nx)
         status = DftiSetValue(hand_forward, DFTI_CONJUGATE_EVEN_STORAGE, DFTI_COMPLEX_COMPLEX);
         status = DftiSetValue(hand_forward, DFTI_INPUT_STRIDES, rs);
         status = DftiSetValue(hand_forward, DFTI_OUTPUT_STRIDES, cs);
+        if (n_batch > 1)
+        {
+            status = DftiSetValue(hand_forward, DFTI_NUMBER_OF_TRANSFORMS, (MKL_LONG) n_batch);
+            status = DftiSetValue(hand_forward, DFTI_INPUT_DISTANCE, (MKL_LONG) n_grid);
+            status = DftiSetValue(hand_forward, DFTI_OUTPUT_DISTANCE, (MKL_LONG) N_COMPLEX_GRID);
+        }
         status = DftiCommitDescriptor(hand_forward);
 
         status = DftiCreateDescriptor(&hand_backward, DFTI_DOUBLE, DFTI_REAL, 2, NX );
@@ -30,6 +38,12 @@ MklFFT2D::MklFFT2D(std::array<int,2> nx)
         status = DftiSetValue(hand_backward, DFTI_CONJUGATE_EVEN_STORAGE, DFTI_COMPLEX_COMPLEX);
         status = DftiSetValue(hand_backward, DFTI_INPUT_STRIDES, cs);
         status = DftiSetValue(hand_backward, DFTI_OUTPUT_STRIDES, rs);
+        if (n_batch > 1)
+        {
+            status = DftiSetValue(hand_backward, DFTI_NUMBER_OF_TRANSFORMS, (MKL_LONG) n_batch);
+            status = DftiSetValue(hand_backward, DFTI_INPUT_DISTANCE, (MKL_LONG) N_COMPLEX_GRID);
+            status = DftiSetValue(hand_backward, DFTI_OUTPUT_DISTANCE, (MKL_LONG) n_grid);
+        }
         status = DftiCommitDescriptor(hand_backward);
 
         if (status !=0)
@@ -68,6 +82,6 @@ void MklFFT2D::backward(std::complex<double> *cdata, double *rdata)
     if (status !=0)
         std::cout << "MKL status: " << status << std::endl;
         
-    for(int i=0; i<n_grid; i++)
+    for(int i=0; i<n_grid*n_batch; i++)
         rdata[i] /= fft_normal_factor;
 }
@@ -15,13 +15,15 @@ class MklFFT3D : public FFT
 private:
     double fft_normal_factor; //normalization factor FFT
     int n_grid; // the number of grids
+    int n_batch; // the number of fields transformed at once
     // Pointers for forward and backward transform
     DFTI_DESCRIPTOR_HANDLE hand_forward = NULL;
     DFTI_DESCRIPTOR_HANDLE hand_backward = NULL;
 public:
 
-    MklFFT3D(std::array<int,3> nx);
-    MklFFT3D(int *nx) : MklFFT3D({nx[0],nx[1],nx[2]}){};
+    // n_batch fields are stored contiguously, i.e., rdata[b*n_grid + i] and cdata[b*n_complex_grid + k]
+    MklFFT3D(std::array<int,3> nx, int n_batch=1);
+    MklFFT3D(int *nx, int n_batch=1) : MklFFT3D({nx[0],nx[1],nx[2]}, n_batch){};
     ~MklFFT3D();
 
     void forward (double *rdata, std::complex<double> *cdata) override;
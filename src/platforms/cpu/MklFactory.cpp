@@ -13,16 +13,18 @@
 #include "CpuComputationBox.h"
 #include "CpuComputationContinuous.h"
 #include "CpuComputationDiscrete.h"
+#include "CpuComputationBatchContinuous.h"
 #include "CpuAndersonMixing.h"
+#include "CpuAndersonMixingQR.h"
+#include "CpuNewtonKrylov.h"
+#include "CpuSemiImplicitMixing.h"
+#include "CpuLinearResponseCompressor.h"
+#include "CpuLangevinFts.h"
 #include "MklFactory.h"
 
 MklFactory::MklFactory(bool reduce_memory_usage)
 {
     this->reduce_memory_usage = reduce_memory_usage;
-
-    if (this->reduce_memory_usage)
-        std::cout << "(warning) Reducing memory usage option only works for CUDA. This option will be ignored in MKL." << std::endl;
-
 }
 Array* MklFactory::create_array(
     unsigned int size)
@@ -51,11 +53,11 @@ PropagatorComputation* MklFactory::create_pseudospectral_solver(ComputationBox *
     std::string chain_model = molecules->get_model_name();
     if ( chain_model == "continuous" )
     {
-        return new CpuComputationContinuous(cb, molecules, propagator_analyzer, "pseudospectral");
+        return new CpuComputationContinuous(cb, molecules, propagator_analyzer, "pseudospectral", reduce_memory_usage);
     }
     else if ( chain_model == "discrete" )
     {
-        return new CpuComputationDiscrete(cb, molecules, propagator_analyzer);
+        return new CpuComputationDiscrete(cb, molecules, propagator_analyzer, reduce_memory_usage);
     }
     return NULL;
 }
@@ -66,7 +68,7 @@ PropagatorComputation* MklFactory::create_realspace_solver(ComputationBox *cb, M
         std::string chain_model = molecules->get_model_name();
         if ( chain_model == "continuous" )
         {
-            return new CpuComputationContinuous(cb, molecules, propagator_analyzer, "realspace");
+            return new CpuComputationContinuous(cb, molecules, propagator_analyzer, "realspace", reduce_memory_usage);
         }
         else if ( chain_model == "discrete" )
         {
@@ -79,12 +81,105 @@ PropagatorComputation* MklFactory::create_realspace_solver(ComputationBox *cb, M
         throw_without_line_number(exc.what());
     }
 }
+PropagatorComputationBatch* MklFactory::create_pseudospectral_solver_batch(ComputationBox *cb, Molecules *molecules, PropagatorAnalyzer* propagator_analyzer, int n_replicas, int n_replica_groups)
+{
+    try
+    {
+        std::string chain_model = molecules->get_model_name();
+        if ( chain_model == "continuous" )
+        {
+            return new CpuComputationBatchContinuous(cb, molecules, propagator_analyzer, n_replicas, n_replica_groups);
+        }
+        else if ( chain_model == "discrete" )
+        {
+            throw_with_line_number("The batch solver does not support discrete chain model yet.");
+        }
+        return NULL;
+    }
+    catch(std::exception& exc)
+    {
+        throw_without_line_number(exc.what());
+    }
+}
 AndersonMixing* MklFactory::create_anderson_mixing(
     int n_var, int max_hist, double start_error,
-    double mix_min, double mix_init)
+    double mix_min, double mix_init,
+    std::string history_precision)
+{
+    if (history_precision == "double")
+        return new CpuAndersonMixing<double>(
+            n_var, max_hist, start_error, mix_min, mix_init);
+    else if (history_precision == "single")
+        return new CpuAndersonMixing<float>(
+            n_var, max_hist, start_error, mix_min, mix_init);
+    else
+        throw_with_line_number("Invalid precision of histories (" + history_precision + "). This must be 'double' or 'single'.");
+}
+AndersonMixing* MklFactory::create_anderson_mixing_qr(
+    int n_var, int max_hist, double start_error,
+    double mix_min, double mix_init,
+    std::string type, double max_condition)
+{
+    return new CpuAndersonMixingQR(
+        n_var, max_hist, start_error, mix_min, mix_init, type, max_condition);
+}
+NewtonKrylov* MklFactory::create_newton_krylov(
+    int n_var, int max_krylov, double start_error,
+    double mix_min, double mix_init, double forcing_term)
+{
+    return new CpuNewtonKrylov(
+        n_var, max_krylov, start_error, mix_min, mix_init, forcing_term);
+}
+SemiImplicitMixing* MklFactory::create_semi_implicit_mixing(
+    ComputationBox *cb, Molecules *molecules,
+    std::vector<std::string> monomer_types,
+    std::vector<std::vector<double>> matrix_chi,
+    std::vector<std::vector<double>> matrix_p,
+    int n_var, double lambda, AndersonMixing *anderson_mixing)
+{
+    return new CpuSemiImplicitMixing(
+        cb, molecules, monomer_types, matrix_chi, matrix_p, n_var, lambda, anderson_mixing);
+}
+LinearResponseCompressor* MklFactory::create_linear_response_compressor(
+    ComputationBox *cb, Molecules *molecules,
+    std::vector<std::string> monomer_types,
+    std::vector<std::vector<double>> matrix_a,
+    std::vector<double> vector_d,
+    AndersonMixing *anderson_mixing,
+    std::map<std::string, std::map<std::string, double>> random_fractions)
+{
+    return new CpuLinearResponseCompressor(
+        cb, molecules, monomer_types, matrix_a, vector_d, anderson_mixing, random_fractions);
+}
+LangevinFts* MklFactory::create_langevin_fts(
+    ComputationBox *cb, Molecules *molecules, PropagatorComputation *solver,
+    AndersonMixing *compressor,
+    std::vector<std::string> monomer_types,
+    std::vector<std::vector<double>> matrix_a,
+    std::vector<std::vector<double>> matrix_a_inv,
+    std::vector<double> eigenvalues,
+    std::vector<int> aux_fields_real_idx,
+    std::vector<int> aux_fields_imag_idx,
+    double h_const,
+    std::vector<double> h_coef_mu1,
+    std::vector<double> h_coef_mu2,
+    std::vector<double> dt_scaling,
+    double langevin_dt, double langevin_sigma,
+    int saddle_max_iter, double saddle_tolerance,
+    int sf_computing_period, int verbose_level,
+    std::map<std::string, std::map<std::string, double>> random_fractions,
+    long random_seed)
+{
+    return new CpuLangevinFts(
+        cb, molecules, solver, compressor, monomer_types, matrix_a, matrix_a_inv, eigenvalues,
+        aux_fields_real_idx, aux_fields_imag_idx, h_const, h_coef_mu1, h_coef_mu2, dt_scaling,
+        langevin_dt, langevin_sigma, saddle_max_iter, saddle_tolerance, sf_computing_period, verbose_level,
+        random_fractions, random_seed);
+}
+bool MklFactory::is_memory_aware_scheduling()
 {
-    return new CpuAndersonMixing(
-        n_var, max_hist, start_error, mix_min, mix_init);
+    // CPU solvers schedule propagators with the memory budget only if they reduce memory usage
+    return reduce_memory_usage;
 }
 void MklFactory::display_info()
 {
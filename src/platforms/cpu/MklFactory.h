@@ -37,11 +37,57 @@ public :
     PropagatorComputation* create_pseudospectral_solver(ComputationBox *cb, Molecules *molecules, PropagatorAnalyzer* propagator_analyzer) override;
 
     PropagatorComputation* create_realspace_solver     (ComputationBox *cb, Molecules *molecules, PropagatorAnalyzer* propagator_analyzer) override;
+    PropagatorComputationBatch* create_pseudospectral_solver_batch(ComputationBox *cb, Molecules *molecules, PropagatorAnalyzer* propagator_analyzer, int n_replicas, int n_replica_groups=0) override;
 
     AndersonMixing* create_anderson_mixing(
         int n_var, int max_hist, double start_error,
-        double mix_min, double mix_init) override;
+        double mix_min, double mix_init,
+        std::string history_precision="double") override;
 
+    AndersonMixing* create_anderson_mixing_qr(
+        int n_var, int max_hist, double start_error,
+        double mix_min, double mix_init,
+        std::string type, double max_condition) override;
+
+    NewtonKrylov* create_newton_krylov(
+        int n_var, int max_krylov, double start_error,
+        double mix_min, double mix_init, double forcing_term) override;
+
+    SemiImplicitMixing* create_semi_implicit_mixing(
+        ComputationBox *cb, Molecules *molecules,
+        std::vector<std::string> monomer_types,
+        std::vector<std::vector<double>> matrix_chi,
+        std::vector<std::vector<double>> matrix_p,
+        int n_var, double lambda, AndersonMixing *anderson_mixing=nullptr) override;
+
+    LinearResponseCompressor* create_linear_response_compressor(
+        ComputationBox *cb, Molecules *molecules,
+        std::vector<std::string> monomer_types,
+        std::vector<std::vector<double>> matrix_a,
+        std::vector<double> vector_d,
+        AndersonMixing *anderson_mixing=nullptr,
+        std::map<std::string, std::map<std::string, double>> random_fractions={}) override;
+
+    LangevinFts* create_langevin_fts(
+        ComputationBox *cb, Molecules *molecules, PropagatorComputation *solver,
+        AndersonMixing *compressor,
+        std::vector<std::string> monomer_types,
+        std::vector<std::vector<double>> matrix_a,
+        std::vector<std::vector<double>> matrix_a_inv,
+        std::vector<double> eigenvalues,
+        std::vector<int> aux_fields_real_idx,
+        std::vector<int> aux_fields_imag_idx,
+        double h_const,
+        std::vector<double> h_coef_mu1,
+        std::vector<double> h_coef_mu2,
+        std::vector<double> dt_scaling,
+        double langevin_dt, double langevin_sigma,
+        int saddle_max_iter, double saddle_tolerance,
+        int sf_computing_period, int verbose_level=1,
+        std::map<std::string, std::map<std::string, double>> random_fractions={},
+        long random_seed=-1) override;
+
+    bool is_memory_aware_scheduling() override;
     void display_info() override;
 };
 #endif
@@ -117,6 +117,12 @@ CudaAndersonMixing::~CudaAndersonMixing()
         cudaStreamDestroy(streams[gpu][1]);
     }
 }
+std::size_t CudaAndersonMixing::get_memory_usage()
+{
+    // Histories of w and w_deriv in GPU memory
+    return 2*sizeof(double)*static_cast<std::size_t>(max_hist+1)*n_var
+         + cb_w_deriv_dots->get_memory_usage();
+}
 void CudaAndersonMixing::reset_count()
 {
     try
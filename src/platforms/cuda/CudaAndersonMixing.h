@@ -44,6 +44,7 @@ public:
     ~CudaAndersonMixing();
 
     void reset_count() override;
+    std::size_t get_memory_usage() override;
     void calculate_new_fields(
         double *w_new, double *w_current, double *w_deriv,
         double old_error_level, double error_level) override;
@@ -78,6 +78,12 @@ CudaAndersonMixingReduceMemory::~CudaAndersonMixingReduceMemory()
     cudaFree(d_w_deriv_hist2);
 
 }
+std::size_t CudaAndersonMixingReduceMemory::get_memory_usage()
+{
+    // Histories of w and w_deriv in pinned host memory
+    return 2*sizeof(double)*static_cast<std::size_t>(max_hist+1)*n_var
+         + cb_w_deriv_dots->get_memory_usage();
+}
 void CudaAndersonMixingReduceMemory::reset_count()
 {
     try
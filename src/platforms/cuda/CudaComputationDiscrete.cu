@@ -173,8 +173,8 @@ CudaComputationDiscrete::CudaComputationDiscrete(
                     is_half_bond_length = true;
                 }
                 // At u
-                else if (n == 0 && N_LEFT == N_RIGHT){
-                    if (propagator_analyzer->get_computation_propagator(key_right).deps.size() == 0) // if u is leaf node, skip
+                else if (n == 0){
+                    if (!propagator_analyzer->is_junction_start(key_right)) // if u is leaf node or aggregation of slices, skip
                     {
                         _block_stress_compuation_key.push_back(std::make_tuple(d_propagator_left, d_propagator_right, is_half_bond_length));
                         continue;
@@ -184,12 +184,6 @@ CudaComputationDiscrete::CudaComputationDiscrete(
                     d_propagator_right = d_propagator_half_steps[key_right][0];
                     is_half_bond_length = true;
                 }
-                // At aggregation junction
-                else if (n == 0)
-                {
-                    _block_stress_compuation_key.push_back(std::make_tuple(d_propagator_left, d_propagator_right, is_half_bond_length));
-                    continue;
-                }
                 // Within the blocks
                 else
                 {
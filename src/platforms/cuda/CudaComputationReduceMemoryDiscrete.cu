@@ -172,8 +172,8 @@ CudaComputationReduceMemoryDiscrete::CudaComputationReduceMemoryDiscrete(
                     is_half_bond_length = true;
                 }
                 // At u
-                else if (n == 0 && N_LEFT == N_RIGHT){
-                    if (propagator_analyzer->get_computation_propagator(key_right).deps.size() == 0) // if u is leaf node, skip
+                else if (n == 0){
+                    if (!propagator_analyzer->is_junction_start(key_right)) // if u is leaf node or aggregation of slices, skip
                     {
                         _block_stress_compuation_key.push_back(std::make_tuple(propagator_left, propagator_right, is_half_bond_length));
                         continue;
@@ -183,12 +183,6 @@ CudaComputationReduceMemoryDiscrete::CudaComputationReduceMemoryDiscrete(
                     propagator_right = propagator_half_steps[key_right][0];
                     is_half_bond_length = true;
                 }
-                // At aggregation junction
-                else if (n == 0)
-                {
-                    _block_stress_compuation_key.push_back(std::make_tuple(propagator_left, propagator_right, is_half_bond_length));
-                    continue;
-                }
                 // Within the blocks
                 else
                 {
@@ -77,10 +77,17 @@ PropagatorComputation* CudaFactory::create_realspace_solver(ComputationBox *cb,
         throw_without_line_number(exc.what());
     }
 }
+PropagatorComputationBatch* CudaFactory::create_pseudospectral_solver_batch(ComputationBox *cb, Molecules *molecules, PropagatorAnalyzer* propagator_analyzer, int n_replicas, int n_replica_groups)
+{
+    throw_with_line_number("Batch solver of replicas is not implemented for CUDA yet. Use 'create_pseudospectral_solver' for each replica instead.");
+}
 AndersonMixing* CudaFactory::create_anderson_mixing(
     int n_var, int max_hist, double start_error,
-    double mix_min, double mix_init)
+    double mix_min, double mix_init,
+    std::string history_precision)
 {
+    if (history_precision != "double")
+        throw_with_line_number("Precision of histories (" + history_precision + ") is not supported for CUDA yet. Use 'double' instead.");
 
     if(this->reduce_memory_usage)
     {
@@ -93,6 +100,64 @@ AndersonMixing* CudaFactory::create_anderson_mixing(
             n_var, max_hist, start_error, mix_min, mix_init);
     }
 }
+AndersonMixing* CudaFactory::create_anderson_mixing_qr(
+    int n_var, int max_hist, double start_error,
+    double mix_min, double mix_init,
+    std::string type, double max_condition)
+{
+    throw_with_line_number("Anderson mixing with QR factorization is not implemented for CUDA yet. Use 'create_anderson_mixing' instead.");
+}
+NewtonKrylov* CudaFactory::create_newton_krylov(
+    int n_var, int max_krylov, double start_error,
+    double mix_min, double mix_init, double forcing_term)
+{
+    throw_with_line_number("Newton-Krylov method is not implemented for CUDA yet. Use 'create_anderson_mixing' instead.");
+}
+SemiImplicitMixing* CudaFactory::create_semi_implicit_mixing(
+    ComputationBox *cb, Molecules *molecules,
+    std::vector<std::string> monomer_types,
+    std::vector<std::vector<double>> matrix_chi,
+    std::vector<std::vector<double>> matrix_p,
+    int n_var, double lambda, AndersonMixing *anderson_mixing)
+{
+    throw_with_line_number("Semi-implicit mixing is not implemented for CUDA yet. Use 'create_anderson_mixing' instead.");
+}
+LinearResponseCompressor* CudaFactory::create_linear_response_compressor(
+    ComputationBox *cb, Molecules *molecules,
+    std::vector<std::string> monomer_types,
+    std::vector<std::vector<double>> matrix_a,
+    std::vector<double> vector_d,
+    AndersonMixing *anderson_mixing,
+    std::map<std::string, std::map<std::string, double>> random_fractions)
+{
+    throw_with_line_number("Linear-response compressor is not implemented for CUDA yet. Use 'create_anderson_mixing' instead.");
+}
+LangevinFts* CudaFactory::create_langevin_fts(
+    ComputationBox *cb, Molecules *molecules, PropagatorComputation *solver,
+    AndersonMixing *compressor,
+    std::vector<std::string> monomer_types,
+    std::vector<std::vector<double>> matrix_a,
+    std::vector<std::vector<double>> matrix_a_inv,
+    std::vector<double> eigenvalues,
+    std::vector<int> aux_fields_real_idx,
+    std::vector<int> aux_fields_imag_idx,
+    double h_const,
+    std::vector<double> h_coef_mu1,
+    std::vector<double> h_coef_mu2,
+    std::vector<double> dt_scaling,
+    double langevin_dt, double langevin_sigma,
+    int saddle_max_iter, double saddle_tolerance,
+    int sf_computing_period, int verbose_level,
+    std::map<std::string, std::map<std::string, double>> random_fractions,
+    long random_seed)
+{
+    throw_with_line_number("Langevin FTS engine is not implemented for CUDA yet. Use the Python driver of lfts.py instead.");
+}
+bool CudaFactory::is_memory_aware_scheduling()
+{
+    // CUDA solvers always use the height-based scheduler
+    return false;
+}
 void CudaFactory::display_info()
 {
     int device;
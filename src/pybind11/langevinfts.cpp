@@ -5,13 +5,20 @@
 #include <pybind11/stl.h>
 #include <pybind11/stl_bind.h>
 #include <pybind11/numpy.h>
+#include <pybind11/complex.h>
 
 #include "Array.h"
 #include "Polymer.h"
 #include "PropagatorAnalyzer.h"
 #include "ComputationBox.h"
 #include "PropagatorComputation.h"
+#include "PropagatorComputationBatch.h"
 #include "AndersonMixing.h"
+#include "NewtonKrylov.h"
+#include "SemiImplicitMixing.h"
+#include "LinearResponseCompressor.h"
+#include "ScftSolver.h"
+#include "LangevinFts.h"
 #include "AbstractFactory.h"
 #include "PlatformSelector.h"
 #include "Exception.h"
@@ -21,15 +28,48 @@ namespace py = pybind11;
 template <typename... Args>
 using overload_cast_ = py::detail::overload_cast_impl<Args...>;
 
+// Input arrays must be C-contiguous float64 NumPy arrays, which are passed without copy. The others (e.g., strided views,
+// other dtypes, lists) are rejected by request_input instead of being converted silently.
+using input_array = py::object;
+
+// Buffer of an input array, which must be a C-contiguous float64 NumPy array
+static py::buffer_info request_input(py::handle in, const std::string& name)
+{
+    if (!py::isinstance<py::array_t<double, py::array::c_style>>(in))
+        throw_with_line_number("Input '" + name + "' must be a C-contiguous float64 NumPy array (e.g., numpy.ascontiguousarray(" + name + ", dtype=numpy.float64))");
+    return py::reinterpret_borrow<py::array>(in).request();
+}
+
+// Pointer to a caller-provided output array, which must be a writeable C-contiguous float64 array of the given size
+static double* get_output_ptr(py::object out, py::ssize_t size, const std::string& name)
+{
+    if (!py::isinstance<py::array_t<double, py::array::c_style>>(out))
+        throw_with_line_number("Output '" + name + "' must be a C-contiguous float64 NumPy array");
+    py::array out_array = py::reinterpret_borrow<py::array>(out);
+    if (!out_array.writeable())
+        throw_with_line_number("Output '" + name + "' must be writeable");
+    if (out_array.size() != size)
+        throw_with_line_number("Size of output '" + name + "' (" + std::to_string(out_array.size()) + ") and required size (" + std::to_string(size) + ") must match");
+    return (double*) out_array.mutable_data();
+}
+
+// Read-only view over memory owned by 'owner'. The view holds a reference to 'owner', so the memory outlives the view.
+static py::array get_read_only_view(const double *ptr, py::ssize_t size, py::object owner)
+{
+    py::array_t<double> view({size}, {(py::ssize_t) sizeof(double)}, ptr, owner);
+    view.attr("setflags")(py::arg("write") = false);
+    return view;
+}
+
 PYBIND11_MODULE(langevinfts, m)
 {
     py::class_<Array>(m, "Array")
-        .def("set_data", [](Array& obj, py::array_t<const double> data)
+        .def("set_data", [](Array& obj, input_array data)
         {
             try
             {
                 int size = obj.get_size();
-                py::buffer_info buf = data.request();
+                py::buffer_info buf = request_input(data, "data");
                 if (buf.size != size) {
                     throw_with_line_number("Size of input (" + std::to_string(buf.size) + ") and 'n_grid' (" + std::to_string(size) + ") must match");
                 }
@@ -59,20 +99,20 @@ PYBIND11_MODULE(langevinfts, m)
         .def("get_n_grid", &ComputationBox::get_n_grid)
         .def("get_volume", &ComputationBox::get_volume)
         .def("set_lx", &ComputationBox::set_lx)
-        .def("integral", [](ComputationBox& obj, py::array_t<double> g)
+        .def("integral", [](ComputationBox& obj, input_array g)
         {
             const int M = obj.get_n_grid();
-            py::buffer_info buf_g = g.request();
+            py::buffer_info buf_g = request_input(g, "g");
             if (buf_g.size != M) {
                 throw_with_line_number("Size of input (" + std::to_string(buf_g.size) + ") and 'n_grid' (" + std::to_string(M) + ") must match");
             }
             return obj.integral((double*) buf_g.ptr);
         })
-        .def("inner_product", [](ComputationBox& obj, py::array_t<double> g, py::array_t<double> h)
+        .def("inner_product", [](ComputationBox& obj, input_array g, input_array h)
         {
             const int M = obj.get_n_grid();
-            py::buffer_info buf_g = g.request();
-            py::buffer_info buf_h = h.request();
+            py::buffer_info buf_g = request_input(g, "g");
+            py::buffer_info buf_h = request_input(h, "h");
             if (buf_g.size != M) {
                 throw_with_line_number("Size of input (" + std::to_string(buf_g.size) + ") and 'n_grid' (" + std::to_string(M) + ") must match");
             }
@@ -150,13 +190,36 @@ PYBIND11_MODULE(langevinfts, m)
             }
             obj.add_polymer(volume_fraction, block_inputs, chain_end_to_q_init);
         })
+        .def("add_polymer_length_distribution", [](Molecules& obj, double volume_fraction, std::vector<std::vector<py::object>> block_list,
+            int block_index, std::vector<double> contour_lengths, std::vector<double> weights, std::map<int, std::string> chain_end_to_q_init)
+        {
+            std::vector<BlockInput> block_inputs;
+            for (const auto& py_block : block_list) {
+                BlockInput block;
+                block.monomer_type = py::cast<std::string>(py_block[0]);
+                block.contour_length = py::cast<double>(py_block[1]);
+                block.v = py::cast<int>(py_block[2]);
+                block.u = py::cast<int>(py_block[3]);
+                block_inputs.push_back(block);
+            }
+            return obj.add_polymer_length_distribution(volume_fraction, block_inputs, block_index, contour_lengths, weights, chain_end_to_q_init);
+        }, py::arg("volume_fraction"), py::arg("block_list"), py::arg("block_index"), py::arg("contour_lengths"), py::arg("weights"),
+           py::arg("chain_end_to_q_init") = std::map<int, std::string>())
         .def("get_polymer", &Molecules::get_polymer)
         .def("get_n_solvent_types", &Molecules::get_n_solvent_types)
         .def("add_solvent", &Molecules::add_solvent);
         
+    py::class_<AggregationCost>(m, "AggregationCost")
+        .def_readonly("n_steps", &AggregationCost::n_steps)
+        .def_readonly("makespan", &AggregationCost::makespan)
+        .def_readonly("peak_live_segments", &AggregationCost::peak_live_segments);
+
     py::class_<PropagatorAnalyzer>(m, "PropagatorAnalyzer")
+        .def("get_aggregation_plan", &PropagatorAnalyzer::get_aggregation_plan)
+        .def("get_aggregation_costs", &PropagatorAnalyzer::get_aggregation_costs)
+        .def("get_n_segment_steps", &PropagatorAnalyzer::get_n_segment_steps)
         .def("get_computation_propagators()", &PropagatorAnalyzer::get_computation_propagators)
-        .def("get_computation_propagator", &PropagatorAnalyzer::get_computation_propagator)
+        .def("get_computation_propagator", overload_cast_<std::string>()(&PropagatorAnalyzer::get_computation_propagator))
         .def("get_computation_blocks", &PropagatorAnalyzer::get_computation_blocks)
         .def("get_computation_block", &PropagatorAnalyzer::get_computation_block)
         .def("display_propagators", &PropagatorAnalyzer::display_propagators)
@@ -166,7 +229,7 @@ PYBIND11_MODULE(langevinfts, m)
 
     py::class_<PropagatorComputation>(m, "PropagatorComputation")
         .def("update_laplacian_operator", &PropagatorComputation::update_laplacian_operator)
-        .def("compute_propagators", [](PropagatorComputation& obj, std::map<std::string,py::array_t<const double>> w_input, py::object q_init)
+        .def("compute_propagators", [](PropagatorComputation& obj, std::map<std::string,input_array> w_input, py::object q_init)
         {
             try{
                 const int M = obj.get_n_grid();
@@ -176,7 +239,7 @@ PYBIND11_MODULE(langevinfts, m)
                 //buf_w_input
                 for (auto it = w_input.begin(); it != w_input.end(); ++it)
                 {
-                    py::buffer_info buf_w_input = it->second.request();
+                    py::buffer_info buf_w_input = request_input(it->second, "w[" + it->first + "]");
                     if (buf_w_input.size != M) {
                         throw_with_line_number("Size of input w[" + it->first + "] (" + std::to_string(buf_w_input.size) + ") and 'n_grid' (" + std::to_string(M) + ") must match");
                     }
@@ -188,11 +251,11 @@ PYBIND11_MODULE(langevinfts, m)
 
                 //buf_q_init
                 if (!q_init.is_none()) {
-                    std::map<std::string, py::array_t<const double>> q_init_map = q_init.cast<std::map<std::string, py::array_t<const double>>>();
+                    std::map<std::string, input_array> q_init_map = q_init.cast<std::map<std::string, input_array>>();
 
                     for (auto it = q_init_map.begin(); it != q_init_map.end(); ++it)
                     {
-                        py::buffer_info buf_q_init = it->second.request();
+                        py::buffer_info buf_q_init = request_input(it->second, "q[" + it->first + "]");
                         if (buf_q_init.size != M) {
                             throw_with_line_number("Size of input q[" + it->first + "] (" + std::to_string(buf_q_init.size) + ") and 'n_grid' (" + std::to_string(M) + ") must match");
                         }
@@ -211,7 +274,7 @@ PYBIND11_MODULE(langevinfts, m)
             }
         }, py::arg("w_input"), py::arg("q_init") = py::none())
         .def("compute_concentrations", &PropagatorComputation::compute_concentrations)
-        .def("compute_statistics", [](PropagatorComputation& obj, std::map<std::string,py::array_t<const double>> w_input, py::object q_init)
+        .def("compute_statistics", [](PropagatorComputation& obj, std::map<std::string,input_array> w_input, py::object q_init)
         {
             try{
                 const int M = obj.get_n_grid();
@@ -221,7 +284,7 @@ PYBIND11_MODULE(langevinfts, m)
                 //buf_w_input
                 for (auto it = w_input.begin(); it != w_input.end(); ++it)
                 {
-                    py::buffer_info buf_w_input = it->second.request();
+                    py::buffer_info buf_w_input = request_input(it->second, "w[" + it->first + "]");
                     if (buf_w_input.size != M) {
                         throw_with_line_number("Size of input w[" + it->first + "] (" + std::to_string(buf_w_input.size) + ") and 'n_grid' (" + std::to_string(M) + ") must match");
                     }
@@ -233,11 +296,11 @@ PYBIND11_MODULE(langevinfts, m)
 
                 //buf_q_init
                 if (!q_init.is_none()) {
-                    std::map<std::string, py::array_t<const double>> q_init_map = q_init.cast<std::map<std::string, py::array_t<const double>>>();
+                    std::map<std::string, input_array> q_init_map = q_init.cast<std::map<std::string, input_array>>();
 
                     for (auto it = q_init_map.begin(); it != q_init_map.end(); ++it)
                     {
-                        py::buffer_info buf_q_init = it->second.request();
+                        py::buffer_info buf_q_init = request_input(it->second, "q[" + it->first + "]");
                         if (buf_q_init.size != M) {
                             throw_with_line_number("Size of input q[" + it->first + "] (" + std::to_string(buf_q_init.size) + ") and 'n_grid' (" + std::to_string(M) + ") must match");
                         }
@@ -255,6 +318,57 @@ PYBIND11_MODULE(langevinfts, m)
                 throw_without_line_number(exc.what());
             }
         }, py::arg("w_input"), py::arg("q_init") = py::none())
+        // Return partition functions of shape (K, n_polymer_types) and concentrations of shape (K, len(monomer_types), n_grid)
+        .def("compute_statistics_batch", [](PropagatorComputation& obj, std::vector<std::map<std::string,input_array>> w_inputs,
+            std::vector<std::string> monomer_types, int batch_size, py::object q_init)
+        {
+            try{
+                const int M = obj.get_n_grid();
+                const int K = w_inputs.size();
+                const int P = obj.get_n_polymer_types();
+                const int S = monomer_types.size();
+                std::vector<std::map<std::string, const double*>> vec_buf_w_inputs(K);
+                std::map<std::string, const double*> map_buf_q_init;
+
+                //buf_w_inputs
+                for(int k=0; k<K; k++)
+                {
+                    for (auto it = w_inputs[k].begin(); it != w_inputs[k].end(); ++it)
+                    {
+                        py::buffer_info buf_w_input = request_input(it->second, "w[" + it->first + "]");
+                        if (buf_w_input.size != M)
+                            throw_with_line_number("Size of input w_inputs[" + std::to_string(k) + "][" + it->first + "] (" + std::to_string(buf_w_input.size) + ") and 'n_grid' (" + std::to_string(M) + ") must match");
+                        vec_buf_w_inputs[k].insert(std::pair<std::string, const double*>(it->first, (const double*)buf_w_input.ptr));
+                    }
+                }
+
+                //buf_q_init
+                if (!q_init.is_none()) {
+                    std::map<std::string, input_array> q_init_map = q_init.cast<std::map<std::string, input_array>>();
+                    for (auto it = q_init_map.begin(); it != q_init_map.end(); ++it)
+                    {
+                        py::buffer_info buf_q_init = request_input(it->second, "q[" + it->first + "]");
+                        if (buf_q_init.size != M)
+                            throw_with_line_number("Size of input q[" + it->first + "] (" + std::to_string(buf_q_init.size) + ") and 'n_grid' (" + std::to_string(M) + ") must match");
+                        map_buf_q_init.insert(std::pair<std::string, const double*>(it->first, (const double*)buf_q_init.ptr));
+                    }
+                }
+
+                py::array_t<double> partitions = py::array_t<double>({K, P});
+                py::array_t<double> phi = py::array_t<double>({K, S, M});
+                double *ptr_partitions = (double*) partitions.request().ptr;
+                double *ptr_phi = (double*) phi.request().ptr;
+                {
+                    py::gil_scoped_release release;
+                    obj.compute_statistics_batch(vec_buf_w_inputs, monomer_types, ptr_partitions, ptr_phi, batch_size, map_buf_q_init);
+                }
+                return py::make_tuple(partitions, phi);
+            }
+            catch(std::exception& exc)
+            {
+                throw_without_line_number(exc.what());
+            }
+        }, py::arg("w_inputs"), py::arg("monomer_types"), py::arg("batch_size") = 1, py::arg("q_init") = py::none())
         // .def("compute_statistics_device", [](PropagatorComputation& obj, std::map<std::string, const long int> d_w_input, std::map<std::string, const long int> d_q_init)
         // {
         //     try{
@@ -281,34 +395,35 @@ PYBIND11_MODULE(langevinfts, m)
         //         throw_without_line_number(exc.what());
         //     }
         // })
-        .def("get_total_concentration", [](PropagatorComputation& obj, std::string monomer_type)
+        // Getters of arrays write into 'out' if it is given, instead of allocating a new array
+        .def("get_total_concentration", [](PropagatorComputation& obj, std::string monomer_type, py::object out)
         {
             try{
                 const int M = obj.get_n_grid();
-                py::array_t<double> phi = py::array_t<double>(M);
-                py::buffer_info buf_phi = phi.request();
-                obj.get_total_concentration(monomer_type, (double*) buf_phi.ptr);
-                return phi;
+                if (out.is_none())
+                    out = py::array_t<double>(M);
+                obj.get_total_concentration(monomer_type, get_output_ptr(out, M, "out"));
+                return out;
             }
             catch(std::exception& exc)
             {
                 throw_with_line_number(exc.what());
             }
-        })
-        .def("get_total_concentration", [](PropagatorComputation& obj, int polymer, std::string monomer_type)
+        }, py::arg("monomer_type"), py::arg("out") = py::none())
+        .def("get_total_concentration", [](PropagatorComputation& obj, int polymer, std::string monomer_type, py::object out)
         {
             try{
                 const int M = obj.get_n_grid();
-                py::array_t<double> phi = py::array_t<double>(M);
-                py::buffer_info buf_phi = phi.request();
-                obj.get_total_concentration(polymer, monomer_type, (double*) buf_phi.ptr);
-                return phi;
+                if (out.is_none())
+                    out = py::array_t<double>(M);
+                obj.get_total_concentration(polymer, monomer_type, get_output_ptr(out, M, "out"));
+                return out;
             }
             catch(std::exception& exc)
             {
                 throw_with_line_number(exc.what());
             }
-        })
+        }, py::arg("polymer"), py::arg("monomer_type"), py::arg("out") = py::none())
         .def("get_total_concentration_gce", [](PropagatorComputation& obj, double fugacity, int polymer, std::string monomer_type)
         {
             try{
@@ -323,88 +438,401 @@ PYBIND11_MODULE(langevinfts, m)
                 throw_with_line_number(exc.what());
             }
         })
-        .def("get_block_concentration", [](PropagatorComputation& obj, int polymer)
+        .def("get_block_concentration", [](PropagatorComputation& obj, int polymer, py::object out)
         {
             try{
                 const int M = obj.get_n_grid();
                 const int N_B = obj.get_n_blocks(polymer);
 
-                py::array_t<double> phi = py::array_t<double>({N_B,M});
-                py::buffer_info buf_phi = phi.request();
-                obj.get_block_concentration(polymer, (double*) buf_phi.ptr);
-                return phi;
+                if (out.is_none())
+                    out = py::array_t<double>({N_B,M});
+                obj.get_block_concentration(polymer, get_output_ptr(out, N_B*M, "out"));
+                return out;
             }
             catch(std::exception& exc)
             {
                 throw_with_line_number(exc.what());
             }
-        })
+        }, py::arg("polymer"), py::arg("out") = py::none())
         .def("get_total_partition", &PropagatorComputation::get_total_partition)
         .def("get_solvent_partition", &PropagatorComputation::get_solvent_partition)
-        .def("get_solvent_concentration", [](PropagatorComputation& obj, int s)
+        .def("get_solvent_concentration", [](PropagatorComputation& obj, int s, py::object out)
         {
             try{
                 const int M = obj.get_n_grid();
 
-                py::array_t<double> phi = py::array_t<double>({M});
-                py::buffer_info buf_phi = phi.request();
-                obj.get_solvent_concentration(s, (double*) buf_phi.ptr);
-                return phi;
+                if (out.is_none())
+                    out = py::array_t<double>(M);
+                obj.get_solvent_concentration(s, get_output_ptr(out, M, "out"));
+                return out;
             }
             catch(std::exception& exc)
             {
                 throw_with_line_number(exc.what());
             }
+        }, py::arg("s"), py::arg("out") = py::none())
+        // Read-only views over the concentrations owned by the solver, without copy. The views keep the solver alive,
+        // and their values are overwritten by the next compute_concentrations().
+        .def("get_block_concentration_views", [](py::object self)
+        {
+            try{
+                PropagatorComputation& obj = self.cast<PropagatorComputation&>();
+                const int M = obj.get_n_grid();
+                py::dict views;
+                for(const auto& item: obj.get_block_concentration_ptrs())
+                    views[py::cast(item.first)] = get_read_only_view(item.second, M, self);
+                return views;
+            }
+            catch(std::exception& exc)
+            {
+                throw_without_line_number(exc.what());
+            }
         })
-        .def("get_chain_propagator", [](PropagatorComputation& obj, int polymer, int v, int u, int n)
+        .def("get_solvent_concentration_view", [](py::object self, int s)
+        {
+            try{
+                PropagatorComputation& obj = self.cast<PropagatorComputation&>();
+                return get_read_only_view(obj.get_solvent_concentration_ptr(s), obj.get_n_grid(), self);
+            }
+            catch(std::exception& exc)
+            {
+                throw_without_line_number(exc.what());
+            }
+        }, py::arg("s"))
+        .def("get_chain_propagator", [](PropagatorComputation& obj, int polymer, int v, int u, int n, py::object out)
         {
             try{
                 const int M = obj.get_n_grid();
-                py::array_t<double> q1 = py::array_t<double>(M);
-                py::buffer_info buf_q1 = q1.request();
-                obj.get_chain_propagator((double*) buf_q1.ptr, polymer, v, u, n);
-                return q1;
+                if (out.is_none())
+                    out = py::array_t<double>(M);
+                obj.get_chain_propagator(get_output_ptr(out, M, "out"), polymer, v, u, n);
+                return out;
             }
             catch(std::exception& exc)
             {
                 throw_with_line_number(exc.what());
             }
-        })
+        }, py::arg("polymer"), py::arg("v"), py::arg("u"), py::arg("n"), py::arg("out") = py::none())
         .def("compute_stress", &PropagatorComputation::compute_stress)
         .def("get_stress", &PropagatorComputation::get_stress)
         .def("get_stress_gce", &PropagatorComputation::get_stress_gce)
         .def("check_total_partition", &PropagatorComputation::check_total_partition);
 
+    // Fields, initial conditions, propagators and concentrations of the replicas are arrays of shape (n_replicas, n_grid)
+    py::class_<PropagatorComputationBatch>(m, "PropagatorComputationBatch")
+        .def("get_n_replicas", &PropagatorComputationBatch::get_n_replicas)
+        .def("update_laplacian_operator", &PropagatorComputationBatch::update_laplacian_operator)
+        .def("compute_statistics", [](PropagatorComputationBatch& obj, std::map<std::string,input_array> w_input, py::object q_init)
+        {
+            try{
+                const int RM = obj.get_n_replicas()*obj.get_n_grid();
+                std::map<std::string, const double*> map_buf_w_input;
+                std::map<std::string, const double*> map_buf_q_init;
+
+                //buf_w_input
+                for (auto it = w_input.begin(); it != w_input.end(); ++it)
+                {
+                    py::buffer_info buf_w_input = request_input(it->second, "w[" + it->first + "]");
+                    if (buf_w_input.size != RM)
+                        throw_with_line_number("Size of input w[" + it->first + "] (" + std::to_string(buf_w_input.size) + ") and 'n_replicas*n_grid' (" + std::to_string(RM) + ") must match");
+                    map_buf_w_input.insert(std::pair<std::string, const double*>(it->first, (const double*)buf_w_input.ptr));
+                }
+
+                //buf_q_init
+                if (!q_init.is_none()) {
+                    std::map<std::string, input_array> q_init_map = q_init.cast<std::map<std::string, input_array>>();
+                    for (auto it = q_init_map.begin(); it != q_init_map.end(); ++it)
+                    {
+                        py::buffer_info buf_q_init = request_input(it->second, "q[" + it->first + "]");
+                        if (buf_q_init.size != RM)
+                            throw_with_line_number("Size of input q[" + it->first + "] (" + std::to_string(buf_q_init.size) + ") and 'n_replicas*n_grid' (" + std::to_string(RM) + ") must match");
+                        map_buf_q_init.insert(std::pair<std::string, const double*>(it->first, (const double*)buf_q_init.ptr));
+                    }
+                }
+
+                py::gil_scoped_release release;
+                obj.compute_statistics(map_buf_w_input, map_buf_q_init);
+            }
+            catch(std::exception& exc)
+            {
+                throw_without_line_number(exc.what());
+            }
+        }, py::arg("w_input"), py::arg("q_init") = py::none())
+        .def("compute_statistics_multi_source", [](PropagatorComputationBatch& obj, std::map<std::string,input_array> w_input,
+            std::string q_init_source, input_array q_init_batch, py::object q_init)
+        {
+            try{
+                const int M = obj.get_n_grid();
+                const int RM = obj.get_n_replicas()*M;
+                std::map<std::string, const double*> map_buf_w_input;
+                std::map<std::string, const double*> map_buf_q_init;
+
+                //buf_w_input
+                for (auto it = w_input.begin(); it != w_input.end(); ++it)
+                {
+                    py::buffer_info buf_w_input = request_input(it->second, "w[" + it->first + "]");
+                    if (buf_w_input.size != M)
+                        throw_with_line_number("Size of input w[" + it->first + "] (" + std::to_string(buf_w_input.size) + ") and 'n_grid' (" + std::to_string(M) + ") must match");
+                    map_buf_w_input.insert(std::pair<std::string, const double*>(it->first, (const double*)buf_w_input.ptr));
+                }
+
+                //buf_q_init_batch
+                py::buffer_info buf_q_init_batch = request_input(q_init_batch, "q_init_batch");
+                if (buf_q_init_batch.size != RM)
+                    throw_with_line_number("Size of input q_init_batch (" + std::to_string(buf_q_init_batch.size) + ") and 'n_replicas*n_grid' (" + std::to_string(RM) + ") must match");
+
+                //buf_q_init
+                if (!q_init.is_none()) {
+                    std::map<std::string, input_array> q_init_map = q_init.cast<std::map<std::string, input_array>>();
+                    for (auto it = q_init_map.begin(); it != q_init_map.end(); ++it)
+                    {
+                        py::buffer_info buf_q_init = request_input(it->second, "q[" + it->first + "]");
+                        if (buf_q_init.size != M)
+                            throw_with_line_number("Size of input q[" + it->first + "] (" + std::to_string(buf_q_init.size) + ") and 'n_grid' (" + std::to_string(M) + ") must match");
+                        map_buf_q_init.insert(std::pair<std::string, const double*>(it->first, (const double*)buf_q_init.ptr));
+                    }
+                }
+
+                py::gil_scoped_release release;
+                obj.compute_statistics_multi_source(map_buf_w_input, q_init_source, (const double*)buf_q_init_batch.ptr, map_buf_q_init);
+            }
+            catch(std::exception& exc)
+            {
+                throw_without_line_number(exc.what());
+            }
+        }, py::arg("w_input"), py::arg("q_init_source"), py::arg("q_init_batch"), py::arg("q_init") = py::none())
+        .def("get_total_partition", &PropagatorComputationBatch::get_total_partition, py::arg("replica"), py::arg("polymer"))
+        .def("get_solvent_partition", &PropagatorComputationBatch::get_solvent_partition, py::arg("replica"), py::arg("s"))
+        .def("get_total_concentration", [](PropagatorComputationBatch& obj, std::string monomer_type)
+        {
+            py::array_t<double> phi = py::array_t<double>({obj.get_n_replicas(), obj.get_n_grid()});
+            py::buffer_info buf_phi = phi.request();
+            obj.get_total_concentration(monomer_type, (double*) buf_phi.ptr);
+            return phi;
+        })
+        .def("get_total_concentration", [](PropagatorComputationBatch& obj, int polymer, std::string monomer_type)
+        {
+            py::array_t<double> phi = py::array_t<double>({obj.get_n_replicas(), obj.get_n_grid()});
+            py::buffer_info buf_phi = phi.request();
+            obj.get_total_concentration(polymer, monomer_type, (double*) buf_phi.ptr);
+            return phi;
+        })
+        .def("get_solvent_concentration", [](PropagatorComputationBatch& obj, int s)
+        {
+            py::array_t<double> phi = py::array_t<double>({obj.get_n_replicas(), obj.get_n_grid()});
+            py::buffer_info buf_phi = phi.request();
+            obj.get_solvent_concentration(s, (double*) buf_phi.ptr);
+            return phi;
+        })
+        .def("get_chain_propagator", [](PropagatorComputationBatch& obj, int polymer, int v, int u, int n)
+        {
+            py::array_t<double> q = py::array_t<double>({obj.get_n_replicas(), obj.get_n_grid()});
+            py::buffer_info buf_q = q.request();
+            obj.get_chain_propagator((double*) buf_q.ptr, polymer, v, u, n);
+            return q;
+        })
+        .def("check_total_partition", &PropagatorComputationBatch::check_total_partition);
+
     py::class_<AndersonMixing>(m, "AndersonMixing")
         .def("reset_count", &AndersonMixing::reset_count)
+        .def("get_memory_usage", &AndersonMixing::get_memory_usage)
+        .def("display_info", &AndersonMixing::display_info)
         .def("calculate_new_fields", [](AndersonMixing &obj,
-                py::array_t<double> w_current, py::array_t<double> w_deriv,
-                double old_error_level, double error_level)
+                input_array w_current, input_array w_deriv,
+                double old_error_level, double error_level, py::object out)
         {
             try{
 
                 int n_var = obj.get_n_var();
-                py::array_t<double> w_new = py::array_t<double>(n_var);
+                if (out.is_none())
+                    out = py::array_t<double>(n_var);
+                double *w_new = get_output_ptr(out, n_var, "out");
 
-                py::buffer_info buf_w_new = w_new.request();
-                py::buffer_info buf_w_current = w_current.request();
-                py::buffer_info buf_w_deriv = w_deriv.request();
+                py::buffer_info buf_w_current = request_input(w_current, "w_current");
+                py::buffer_info buf_w_deriv = request_input(w_deriv, "w_deriv");
 
-                if (buf_w_new.size != n_var)
-                    throw_with_line_number("Size of input w_new (" + std::to_string(buf_w_new.size) + ") and 'n_var' (" + std::to_string(n_var) + ") must match");
                 if (buf_w_current.size != n_var)
                     throw_with_line_number("Size of input w_current (" + std::to_string(buf_w_current.size) + ") and 'n_var' (" + std::to_string(n_var) + ") must match");
                 if (buf_w_deriv.size != n_var)
                     throw_with_line_number("Size of input w_deriv (" + std::to_string(buf_w_deriv.size) + ") and 'n_var' (" + std::to_string(n_var) + ") must match");
 
-                obj.calculate_new_fields((double *) buf_w_new.ptr, (double *) buf_w_current.ptr, (double *) buf_w_deriv.ptr, old_error_level, error_level);
-                return w_new;
+                obj.calculate_new_fields(w_new, (double *) buf_w_current.ptr, (double *) buf_w_deriv.ptr, old_error_level, error_level);
+                return out;
             }
             catch(std::exception& exc)
             {
                 throw_without_line_number(exc.what());
             }
-        });
+        }, py::arg("w_current"), py::arg("w_deriv"), py::arg("old_error_level"), py::arg("error_level"), py::arg("out") = py::none());
+
+    py::class_<NewtonKrylov, AndersonMixing>(m, "NewtonKrylov")
+        .def("get_n_evaluations", &NewtonKrylov::get_n_evaluations)
+        .def("get_n_newton_steps", &NewtonKrylov::get_n_newton_steps)
+        .def("set_fourier_preconditioner", [](NewtonKrylov& obj, std::vector<int> nx, int n_comp, input_array kernel)
+        {
+            try{
+                py::buffer_info buf_kernel = request_input(kernel, "kernel");
+                double* ptr = (double *) buf_kernel.ptr;
+                obj.set_fourier_preconditioner(nx, n_comp, std::vector<double>(ptr, ptr+buf_kernel.size));
+            }
+            catch(std::exception& exc)
+            {
+                throw_without_line_number(exc.what());
+            }
+        }, py::arg("nx"), py::arg("n_comp"), py::arg("kernel"));
+
+    py::class_<SemiImplicitMixing, AndersonMixing>(m, "SemiImplicitMixing")
+        .def("get_lambda", &SemiImplicitMixing::get_lambda)
+        .def("update_kernels", &SemiImplicitMixing::update_kernels);
+
+    py::class_<LinearResponseCompressor, AndersonMixing>(m, "LinearResponseCompressor")
+        .def("update_kernels", &LinearResponseCompressor::update_kernels);
+
+    py::class_<ScftSolver>(m, "ScftSolver")
+        .def(py::init<ComputationBox*, Molecules*, PropagatorComputation*, AndersonMixing*,
+            std::vector<std::string>, std::vector<std::vector<double>>, std::vector<std::vector<double>>,
+            bool, int, double, double, int, std::map<std::string, std::map<std::string, double>>>(),
+            py::arg("cb"), py::arg("molecules"), py::arg("solver"), py::arg("optimizer"),
+            py::arg("monomer_types"), py::arg("matrix_chi"), py::arg("matrix_p"),
+            py::arg("box_is_altering"), py::arg("max_iter"), py::arg("tolerance"),
+            py::arg("scale_stress") = 1.0, py::arg("verbose_level") = 2,
+            py::arg("random_fractions") = std::map<std::string, std::map<std::string, double>>{},
+            py::keep_alive<1,2>(), py::keep_alive<1,3>(), py::keep_alive<1,4>(), py::keep_alive<1,5>())
+        .def("set_fields", [](ScftSolver& obj, input_array w)
+        {
+            try
+            {
+                const int S = obj.get_monomer_types().size();
+                const int M = obj.get_n_grid();
+                py::buffer_info buf = request_input(w, "w");
+                if (buf.size != S*M) {
+                    throw_with_line_number("Size of input (" + std::to_string(buf.size) + ") and 'n_monomer_types*n_grid' (" + std::to_string(S*M) + ") must match");
+                }
+                obj.set_fields((double*) buf.ptr);
+            }
+            catch(std::exception& exc)
+            {
+                throw_without_line_number(exc.what());
+            }
+        })
+        .def("get_fields", [](ScftSolver& obj)
+        {
+            const int S = obj.get_monomer_types().size();
+            const int M = obj.get_n_grid();
+            py::array_t<double> w = py::array_t<double>({S,M});
+            py::buffer_info buf = w.request();
+            obj.get_fields((double*) buf.ptr);
+            return w;
+        })
+        .def("get_concentrations", [](ScftSolver& obj)
+        {
+            const int S = obj.get_monomer_types().size();
+            const int M = obj.get_n_grid();
+            py::array_t<double> phi = py::array_t<double>({S,M});
+            py::buffer_info buf = phi.request();
+            obj.get_concentrations((double*) buf.ptr);
+            return phi;
+        })
+        .def("run", &ScftSolver::run, py::call_guard<py::gil_scoped_release>())
+        .def("get_monomer_types", &ScftSolver::get_monomer_types)
+        .def("get_free_energy", &ScftSolver::get_free_energy)
+        .def("get_error_level", &ScftSolver::get_error_level);
+
+    py::class_<LangevinFts>(m, "LangevinFts")
+        .def("add_chi_n_derivative", &LangevinFts::add_chi_n_derivative,
+            py::arg("key"), py::arg("h_const_deriv"), py::arg("h_coef_mu1_deriv"), py::arg("h_coef_mu2_deriv"))
+        .def("set_fields", [](LangevinFts& obj, input_array w_aux)
+        {
+            try
+            {
+                const int S = obj.get_monomer_types().size();
+                const int M = obj.get_n_grid();
+                py::buffer_info buf = request_input(w_aux, "w_aux");
+                if (buf.size != S*M) {
+                    throw_with_line_number("Size of input (" + std::to_string(buf.size) + ") and 'n_monomer_types*n_grid' (" + std::to_string(S*M) + ") must match");
+                }
+                obj.set_fields((double*) buf.ptr);
+            }
+            catch(std::exception& exc)
+            {
+                throw_without_line_number(exc.what());
+            }
+        })
+        .def("get_fields", [](LangevinFts& obj)
+        {
+            const int S = obj.get_monomer_types().size();
+            const int M = obj.get_n_grid();
+            py::array_t<double> w_aux = py::array_t<double>({S,M});
+            py::buffer_info buf = w_aux.request();
+            obj.get_fields((double*) buf.ptr);
+            return w_aux;
+        })
+        .def("get_concentrations", [](LangevinFts& obj)
+        {
+            const int S = obj.get_monomer_types().size();
+            const int M = obj.get_n_grid();
+            py::array_t<double> phi = py::array_t<double>({S,M});
+            py::buffer_info buf = phi.request();
+            obj.get_concentrations((double*) buf.ptr);
+            return phi;
+        })
+        .def("set_normal_noise_prev", [](LangevinFts& obj, input_array noise)
+        {
+            try
+            {
+                const int R = obj.get_n_real_fields();
+                const int M = obj.get_n_grid();
+                py::buffer_info buf = request_input(noise, "noise");
+                if (buf.size != R*M) {
+                    throw_with_line_number("Size of input (" + std::to_string(buf.size) + ") and 'n_real_fields*n_grid' (" + std::to_string(R*M) + ") must match");
+                }
+                obj.set_normal_noise_prev((double*) buf.ptr);
+            }
+            catch(std::exception& exc)
+            {
+                throw_without_line_number(exc.what());
+            }
+        })
+        .def("get_normal_noise_prev", [](LangevinFts& obj)
+        {
+            const int R = obj.get_n_real_fields();
+            const int M = obj.get_n_grid();
+            py::array_t<double> noise = py::array_t<double>({R,M});
+            py::buffer_info buf = noise.request();
+            obj.get_normal_noise_prev((double*) buf.ptr);
+            return noise;
+        })
+        .def("get_random_state", &LangevinFts::get_random_state)
+        .def("set_random_state", &LangevinFts::set_random_state)
+        .def("find_saddle_point", overload_cast_<>()(&LangevinFts::find_saddle_point), py::call_guard<py::gil_scoped_release>())
+        .def("run", &LangevinFts::run, py::arg("start_langevin_step"), py::arg("end_langevin_step"),
+            py::call_guard<py::gil_scoped_release>())
+        .def("get_monomer_types", &LangevinFts::get_monomer_types)
+        .def("get_total_saddle_iter", &LangevinFts::get_total_saddle_iter)
+        .def("get_total_error_level", &LangevinFts::get_total_error_level)
+        .def("get_saddle_fail_count", &LangevinFts::get_saddle_fail_count)
+        .def("get_hamiltonian_history", &LangevinFts::get_hamiltonian_history)
+        .def("get_dh_history", &LangevinFts::get_dh_history)
+        .def("clear_history", &LangevinFts::clear_history)
+        .def("get_structure_function", [](LangevinFts& obj, int i, int j)
+        {
+            try
+            {
+                // The same shape as numpy.fft.rfftn
+                std::vector<int> nx = obj.get_nx();
+                std::vector<int> shape = nx;
+                shape.back() = nx.back()/2 + 1;
+                py::array_t<std::complex<double>> sf = py::array_t<std::complex<double>>(shape);
+                py::buffer_info buf = sf.request();
+                obj.get_structure_function(i, j, (std::complex<double>*) buf.ptr);
+                return sf;
+            }
+            catch(std::exception& exc)
+            {
+                throw_without_line_number(exc.what());
+            }
+        }, py::arg("i"), py::arg("j"))
+        .def("reset_structure_function", &LangevinFts::reset_structure_function);
 
     py::class_<AbstractFactory>(m, "AbstractFactory")
         .def("create_array", overload_cast_<unsigned int>()(&AbstractFactory::create_array))
@@ -434,8 +862,7 @@ PYBIND11_MODULE(langevinfts, m)
                 // Check if mask is not None
                 if (!mask.is_none())
                 {
-                    py::array_t<const double> mask_cast = mask.cast<py::array_t<const double>>();
-                    buf_mask = mask_cast.request();
+                    buf_mask = request_input(mask, "mask");
                     if (buf_mask.size != M) {
                         throw_with_line_number("Size of input (" + std::to_string(buf_mask.size) + ") and 'n_grid' (" + std::to_string(M) + ") must match");
                     }
@@ -448,10 +875,39 @@ PYBIND11_MODULE(langevinfts, m)
             }
         }, py::arg("nx"), py::arg("lx"), py::arg("bc") = py::none(), py::arg("mask") = py::none())
         .def("create_molecules_information", &AbstractFactory::create_molecules_information)
-        .def("create_propagator_analyzer", &AbstractFactory::create_propagator_analyzer)
+        .def("create_propagator_analyzer", overload_cast_<Molecules*, bool, bool>()(&AbstractFactory::create_propagator_analyzer),
+            py::arg("molecules"), py::arg("aggregate_propagator_computation"), py::arg("is_sorted_merge") = false)
+        .def("create_propagator_analyzer", overload_cast_<Molecules*, int, int>()(&AbstractFactory::create_propagator_analyzer))
         .def("create_pseudospectral_solver", &AbstractFactory::create_pseudospectral_solver)
         .def("create_realspace_solver", &AbstractFactory::create_realspace_solver)
-        .def("create_anderson_mixing", &AbstractFactory::create_anderson_mixing)
+        .def("create_pseudospectral_solver_batch", &AbstractFactory::create_pseudospectral_solver_batch,
+            py::arg("cb"), py::arg("molecules"), py::arg("propagator_analyzer"), py::arg("n_replicas"), py::arg("n_replica_groups") = 0)
+        .def("create_anderson_mixing", &AbstractFactory::create_anderson_mixing,
+            py::arg("n_var"), py::arg("max_hist"), py::arg("start_error"), py::arg("mix_min"), py::arg("mix_init"),
+            py::arg("history_precision") = "double")
+        .def("create_anderson_mixing_qr", &AbstractFactory::create_anderson_mixing_qr,
+            py::arg("n_var"), py::arg("max_hist"), py::arg("start_error"), py::arg("mix_min"), py::arg("mix_init"),
+            py::arg("type") = "II", py::arg("max_condition") = 1e10)
+        .def("create_newton_krylov", &AbstractFactory::create_newton_krylov,
+            py::arg("n_var"), py::arg("max_krylov"), py::arg("start_error"), py::arg("mix_min"), py::arg("mix_init"),
+            py::arg("forcing_term") = 0.1)
+        .def("create_semi_implicit_mixing", &AbstractFactory::create_semi_implicit_mixing,
+            py::arg("cb"), py::arg("molecules"), py::arg("monomer_types"), py::arg("matrix_chi"), py::arg("matrix_p"),
+            py::arg("n_var"), py::arg("lambda"), py::arg("anderson_mixing") = py::none())
+        .def("create_linear_response_compressor", &AbstractFactory::create_linear_response_compressor,
+            py::arg("cb"), py::arg("molecules"), py::arg("monomer_types"), py::arg("matrix_a"), py::arg("vector_d"),
+            py::arg("anderson_mixing") = py::none(),
+            py::arg("random_fractions") = std::map<std::string, std::map<std::string, double>>{})
+        .def("create_langevin_fts", &AbstractFactory::create_langevin_fts,
+            py::arg("cb"), py::arg("molecules"), py::arg("solver"), py::arg("compressor"),
+            py::arg("monomer_types"), py::arg("matrix_a"), py::arg("matrix_a_inv"), py::arg("eigenvalues"),
+            py::arg("aux_fields_real_idx"), py::arg("aux_fields_imag_idx"),
+            py::arg("h_const"), py::arg("h_coef_mu1"), py::arg("h_coef_mu2"), py::arg("dt_scaling"),
+            py::arg("langevin_dt"), py::arg("langevin_sigma"), py::arg("saddle_max_iter"), py::arg("saddle_tolerance"),
+            py::arg("sf_computing_period"), py::arg("verbose_level") = 1,
+            py::arg("random_fractions") = std::map<std::string, std::map<std::string, double>>{},
+            py::arg("random_seed") = -1,
+            py::keep_alive<0,2>(), py::keep_alive<0,3>(), py::keep_alive<0,4>(), py::keep_alive<0,5>())
         .def("display_info", &AbstractFactory::display_info)
         .def("get_model_name", &AbstractFactory::get_model_name);
 
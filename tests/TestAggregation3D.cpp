@@ -123,10 +123,6 @@ int main()
                 {
                     for(bool reduce_memory_usage : reduce_memory_usages)
                     {
-                        // 'cpu-mkl' does not support reduce_gpu_memory_usage
-                        if(reduce_memory_usage == true && platform == "cpu-mkl")
-                                continue;
-                        
                         AbstractFactory *factory = PlatformSelector::create_factory(platform, reduce_memory_usage);
                         // factory->display_info();
 
@@ -0,0 +1,213 @@
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <map>
+
+#include "Exception.h"
+#include "ComputationBox.h"
+#include "Polymer.h"
+#include "Molecules.h"
+#include "PropagatorAnalyzer.h"
+#include "Scheduler.h"
+#include "PropagatorComputation.h"
+#include "AbstractFactory.h"
+#include "PlatformSelector.h"
+
+int main()
+{
+    try
+    {
+        // Math constants
+        const double PI = 3.14159265358979323846;
+
+        std::vector<int> nx = {12,12,12};
+        std::vector<double> lx = {3.0,3.0,3.0};
+        double ds = 0.05;
+
+        std::map<std::string, double> bond_lengths = {{"A",1.0}, {"B",1.2}};
+
+        // Gradient bottlebrush. Lengths of side chains increase along the backbone.
+        const int N_SIDE_CHAINS = 10;
+        std::vector<BlockInput> blocks;
+        for(int i=0; i<N_SIDE_CHAINS+1; i++)
+            blocks.push_back({"A", 0.1, i, i+1});
+        for(int i=1; i<=N_SIDE_CHAINS; i++)
+            blocks.push_back({"B", 0.05*(i+2), i, N_SIDE_CHAINS+1+i});
+
+        const int M = nx[0]*nx[1]*nx[2];
+
+        //-------------- Allocate array ------------
+        double w_a[M];
+        double w_b[M];
+        double phi_a[M];
+        double phi_b[M];
+
+        for(int i=0; i<nx[0]; i++)
+        {
+            double xx = (i+1)*2*PI/nx[0];
+            for(int j=0; j<nx[1]; j++)
+            {
+                double yy = (j+1)*2*PI/nx[1];
+                for(int k=0; k<nx[2]; k++)
+                {
+                    double zz = (k+1)*2*PI/nx[2];
+                    int idx = i*nx[1]*nx[2] + j*nx[2] + k;
+                    w_a[idx] = 0.5*cos(xx)*sin(yy) + 0.2*cos(2.0*zz);
+                    w_b[idx] = -w_a[idx] + 0.1*sin(xx+zz);
+                }
+            }
+        }
+
+        std::vector<std::string> chain_models = {"Continuous", "Discrete"};
+        std::vector<std::string> avail_platforms = PlatformSelector::avail_platforms();
+        for(std::string chain_model : chain_models)
+        {
+            // Total number of propagator steps
+            std::map<bool, int> n_steps;
+            for(bool aggregate_propagator_computation : {false, true})
+            {
+                Molecules molecules(chain_model, ds, bond_lengths);
+                molecules.add_polymer(1.0, blocks, {});
+                PropagatorAnalyzer propagator_analyzer(&molecules, aggregate_propagator_computation, true);
+                propagator_analyzer.display_propagators();
+
+                n_steps[aggregate_propagator_computation] = 0;
+                for(const auto& item: propagator_analyzer.get_computation_propagators())
+                    n_steps[aggregate_propagator_computation] += item.second.max_n_segment;
+            }
+            std::cout << "Chain Model: " << chain_model << std::endl;
+            std::cout << "Propagator steps without and with aggregation: " << n_steps[false] << ", " << n_steps[true] << std::endl;
+
+            // Side chains of different lengths are aggregated
+            if (n_steps[true] >= n_steps[false]*3/4)
+            {
+                std::cout << "Side chains of different lengths are not aggregated." << std::endl;
+                return -1;
+            }
+
+            // Cost-based planner. With a single stream, the plan with the smallest number of steps is chosen.
+            {
+                Molecules molecules(chain_model, ds, bond_lengths);
+                molecules.add_polymer(1.0, blocks, {});
+                PropagatorAnalyzer propagator_analyzer(&molecules, 1, 0, false);
+                for(const auto& item: propagator_analyzer.get_aggregation_costs())
+                {
+                    std::cout << "Plan '" << item.first << "': steps, makespan, peak live segments: " << item.second.n_steps
+                        << ", " << item.second.makespan << ", " << item.second.peak_live_segments << std::endl;
+                }
+                std::cout << "Chosen plan: " << propagator_analyzer.get_aggregation_plan() << std::endl;
+                if (propagator_analyzer.get_aggregation_plan() != "sorted_merge" || !propagator_analyzer.is_aggregated())
+                    return -1;
+                if (propagator_analyzer.get_aggregation_costs().at("sorted_merge").n_steps != propagator_analyzer.get_n_segment_steps())
+                    return -1;
+
+                // The predicted makespan is that of the scheduler used by the solver
+                for(bool is_memory_aware_scheduling : {false, true})
+                {
+                    PropagatorAnalyzer propagator_analyzer_streams(&molecules, 4, 0, is_memory_aware_scheduling);
+                    const std::string& plan = propagator_analyzer_streams.get_aggregation_plan();
+                    int makespan;
+                    if (is_memory_aware_scheduling)
+                        makespan = Scheduler(propagator_analyzer_streams.get_computation_propagators(),
+                            propagator_analyzer_streams.get_computation_blocks(), 4, 0).get_planned_makespan();
+                    else
+                        makespan = Scheduler(propagator_analyzer_streams.get_computation_propagators(), 4).get_planned_makespan();
+                    if (propagator_analyzer_streams.get_aggregation_costs().at(plan).makespan != makespan)
+                        return -1;
+                }
+
+                // Nothing to aggregate in a diblock copolymer, so the plan without aggregation is chosen
+                Molecules molecules_diblock(chain_model, ds, bond_lengths);
+                molecules_diblock.add_polymer(1.0, {{"A", 0.5, 0, 1}, {"B", 0.5, 1, 2}}, {});
+                PropagatorAnalyzer propagator_analyzer_diblock(&molecules_diblock, 4, 0, false);
+                if (propagator_analyzer_diblock.get_aggregation_plan() != "none" || propagator_analyzer_diblock.is_aggregated())
+                    return -1;
+            }
+
+            // Aggregation should not change the results
+            std::vector<double> q_list;
+            std::vector<std::vector<double>> phi_list;
+            std::vector<std::vector<double>> stress_list;
+            std::vector<std::vector<double>> phi_block_list;
+            for(std::string platform : avail_platforms)
+            {
+                for(bool aggregate_propagator_computation : {false, true})
+                {
+                    for(bool reduce_memory_usage : {false, true})
+                    {
+                        AbstractFactory *factory = PlatformSelector::create_factory(platform, reduce_memory_usage);
+                        ComputationBox *cb = factory->create_computation_box(nx, lx, {});
+                        Molecules* molecules = factory->create_molecules_information(chain_model, ds, bond_lengths);
+                        molecules->add_polymer(1.0, blocks, {});
+                        PropagatorAnalyzer* propagator_analyzer= new PropagatorAnalyzer(molecules, aggregate_propagator_computation, true);
+                        PropagatorComputation *solver = factory->create_pseudospectral_solver(cb, molecules, propagator_analyzer);
+
+                        solver->compute_propagators({{"A",w_a},{"B",w_b}},{});
+                        solver->compute_concentrations();
+                        solver->get_total_concentration("A", phi_a);
+                        solver->get_total_concentration("B", phi_b);
+                        solver->compute_stress();
+
+                        // Concentrations of each block are recovered from the aggregated propagators (only for CPU)
+                        if (platform == "cpu-mkl" && !(aggregate_propagator_computation && reduce_memory_usage))
+                        {
+                            std::vector<double> phi_block(blocks.size()*M);
+                            solver->get_block_concentration(0, phi_block.data());
+                            phi_block_list.push_back(phi_block);
+                        }
+
+                        std::vector<double> phi(phi_a, phi_a+M);
+                        phi.insert(phi.end(), phi_b, phi_b+M);
+                        q_list.push_back(solver->get_total_partition(0));
+                        phi_list.push_back(phi);
+                        stress_list.push_back(solver->get_stress());
+
+                        std::cout << std::boolalpha;
+                        std::cout << "Platform: " << platform << ", Using Aggregation: " << aggregate_propagator_computation;
+                        std::cout << ", Reducing Memory Usage: " << reduce_memory_usage << std::endl;
+                        std::cout << std::setprecision(10) << std::scientific;
+                        std::cout << "\tQ: " << q_list.back() << ", stress: " << stress_list.back()[0] << ", " << stress_list.back()[1] << ", " << stress_list.back()[2] << std::endl;
+                        std::cout << std::defaultfloat;
+
+                        delete factory;
+                        delete cb;
+                        delete molecules;
+                        delete propagator_analyzer;
+                        delete solver;
+                    }
+                }
+            }
+
+            for(size_t r=1; r<phi_block_list.size(); r++)
+            {
+                double error = 0.0;
+                for(size_t i=0; i<phi_block_list[r].size(); i++)
+                    error = std::max(error, std::abs(phi_block_list[r][i]-phi_block_list[0][i]));
+                std::cout << "Max error of block concentrations: " << std::scientific << error << std::defaultfloat << std::endl;
+                if (!std::isfinite(error) || error > 1e-9)
+                    return -1;
+            }
+
+            for(size_t r=1; r<q_list.size(); r++)
+            {
+                double error = std::abs(q_list[r]/q_list[0]-1.0);
+                for(int i=0; i<2*M; i++)
+                    error = std::max(error, std::abs(phi_list[r][i]-phi_list[0][i]));
+                for(int d=0; d<3; d++)
+                    error = std::max(error, std::abs(stress_list[r][d]-stress_list[0][d]));
+                std::cout << "Max error: " << std::scientific << error << std::defaultfloat << std::endl;
+                if (!std::isfinite(error) || error > 1e-9)
+                    return -1;
+            }
+        }
+        return 0;
+    }
+    catch(std::exception& exc)
+    {
+        std::cout << exc.what() << std::endl;
+        return -1;
+    }
+}
@@ -0,0 +1,199 @@
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "Exception.h"
+#include "ComputationBox.h"
+#include "Polymer.h"
+#include "Molecules.h"
+#include "PropagatorAnalyzer.h"
+#include "PropagatorComputation.h"
+#include "AndersonMixing.h"
+#include "AbstractFactory.h"
+#include "PlatformSelector.h"
+
+int main()
+{
+    try
+    {
+        // Math constants
+        const double PI = 3.14159265358979323846;
+
+        const int max_scft_iter = 300;
+        const double tolerance = 1e-8;
+
+        double f = 0.3;
+        double chi_n = 25.0;
+        std::vector<int> nx = {32};
+        std::vector<double> lx = {1.6};
+        double ds = 1.0/20;
+
+        int am_max_hist = 20;
+        double am_start_error = 8e-1;
+        double am_mix_min = 0.1;
+        double am_mix_init = 0.1;
+
+        std::vector<BlockInput> blocks =
+        {
+            {"A",    f, 0, 1},
+            {"B",1.0-f, 1, 2},
+        };
+
+        AbstractFactory *factory = PlatformSelector::create_factory("cpu-mkl", false);
+        ComputationBox *cb = factory->create_computation_box(nx, lx, {});
+        Molecules* molecules = factory->create_molecules_information("Continuous", ds, {{"A",1.0}, {"B",1.0}});
+        molecules->add_polymer(1.0, blocks, {});
+        PropagatorAnalyzer* propagator_analyzer = new PropagatorAnalyzer(molecules, false);
+        PropagatorComputation *solver = factory->create_pseudospectral_solver(cb, molecules, propagator_analyzer);
+
+        const int M = cb->get_n_grid();
+        std::vector<double> w(2*M), w_out(2*M), w_diff(2*M), phi_a(M), phi_b(M);
+
+        // Anderson mixing using normal equations, and using QR factorization (Type-II and Type-I)
+        // Histories of the normal equations are also stored in single precision.
+        std::vector<std::string> methods = {"normal equations", "QR, Type-II", "QR, Type-I", "normal equations, single precision histories"};
+        std::vector<int> n_iters;
+        std::vector<double> free_energies;
+        for(const std::string& method : methods)
+        {
+            AndersonMixing *am;
+            if (method == "normal equations")
+                am = factory->create_anderson_mixing(2*M, am_max_hist, am_start_error, am_mix_min, am_mix_init);
+            else if (method == "normal equations, single precision histories")
+                am = factory->create_anderson_mixing(2*M, am_max_hist, am_start_error, am_mix_min, am_mix_init, "single");
+            else if (method == "QR, Type-II")
+                am = factory->create_anderson_mixing_qr(2*M, am_max_hist, am_start_error, am_mix_min, am_mix_init, "II", 1e10);
+            else
+                am = factory->create_anderson_mixing_qr(2*M, am_max_hist, am_start_error, am_mix_min, am_mix_init, "I", 1e10);
+
+            for(int i=0; i<M; i++)
+            {
+                phi_a[i] = cos(2.0*PI*i/M)*0.2;
+                phi_b[i] = 1.0 - phi_a[i];
+                w[i]   = chi_n*phi_b[i];
+                w[i+M] = chi_n*phi_a[i];
+            }
+            cb->zero_mean(&w[0]);
+            cb->zero_mean(&w[M]);
+
+            double error_level = 1.0e20, old_error_level;
+            double energy_total = 0.0;
+            int iter;
+            auto chrono_start = std::chrono::system_clock::now();
+            for(iter=0; iter<max_scft_iter; iter++)
+            {
+                solver->compute_propagators({{"A",&w[0]},{"B",&w[M]}},{});
+                solver->compute_concentrations();
+                solver->get_total_concentration("A", phi_a.data());
+                solver->get_total_concentration("B", phi_b.data());
+
+                energy_total = -log(solver->get_total_partition(0));
+                for(int i=0; i<M; i++)
+                {
+                    double w_minus = (w[i]-w[i+M])/2;
+                    double w_plus  = (w[i]+w[i+M])/2;
+                    energy_total += (w_minus*w_minus/chi_n - w_plus)/M;
+
+                    double xi = 0.5*(w[i]+w[i+M]-chi_n);
+                    w_out[i]   = chi_n*phi_b[i] + xi;
+                    w_out[i+M] = chi_n*phi_a[i] + xi;
+                }
+                cb->zero_mean(&w_out[0]);
+                cb->zero_mean(&w_out[M]);
+
+                old_error_level = error_level;
+                for(int i=0; i<2*M; i++)
+                    w_diff[i] = w_out[i]- w[i];
+                error_level = sqrt(cb->multi_inner_product(2,w_diff.data(),w_diff.data())/
+                                (cb->multi_inner_product(2,w.data(),w.data())+1.0));
+
+                if(error_level < tolerance) break;
+                am->calculate_new_fields(w.data(), w.data(), w_diff.data(), old_error_level, error_level);
+            }
+            std::chrono::duration<double> time_duration = std::chrono::system_clock::now() - chrono_start;
+            std::cout << "Anderson mixing (" << method << "): iterations, error level, free energy, time (s): "
+                << iter << ", " << std::scientific << error_level << ", " << std::setprecision(12) << energy_total << ", "
+                << std::defaultfloat << time_duration.count() << std::endl;
+
+            am->display_info();
+
+            n_iters.push_back(iter);
+            free_energies.push_back(energy_total);
+            delete am;
+
+            if (!std::isfinite(error_level) || error_level >= tolerance)
+                return -1;
+        }
+
+        // All methods should converge to the same solution with comparable numbers of iterations
+        for(size_t m=1; m<methods.size(); m++)
+        {
+            if (std::abs(free_energies[m]-free_energies[0]) > 1e-7)
+                return -1;
+            if (n_iters[m] > n_iters[0]*5/4 + 2)
+                return -1;
+        }
+
+        // Single precision histories use less memory
+        {
+            AndersonMixing *am_double = factory->create_anderson_mixing(2*M, am_max_hist, am_start_error, am_mix_min, am_mix_init, "double");
+            AndersonMixing *am_single = factory->create_anderson_mixing(2*M, am_max_hist, am_start_error, am_mix_min, am_mix_init, "single");
+            std::cout << "Memory usage for histories (double, single): " << am_double->get_memory_usage() << ", " << am_single->get_memory_usage() << std::endl;
+            if (am_single->get_memory_usage() >= am_double->get_memory_usage())
+                return -1;
+            delete am_double;
+            delete am_single;
+        }
+
+        // The difference of the same residuals is a dependent column, and it must be rejected
+        for(std::string type : {"II", "I"})
+        {
+            AndersonMixing *am = factory->create_anderson_mixing_qr(2*M, am_max_hist, am_start_error, am_mix_min, am_mix_init, type, 1e10);
+            std::vector<double> w_in(2*M), w_new(2*M);
+            for(int iter=0; iter<6; iter++)
+            {
+                for(int i=0; i<2*M; i++)
+                {
+                    w_in[i] = cos(2.0*PI*(iter+1)*i/(2*M));
+                    // The last two residuals are the same
+                    w_diff[i] = sin(2.0*PI*(std::min(iter,4)+1)*i/(2*M));
+                }
+                am->calculate_new_fields(w_new.data(), w_in.data(), w_diff.data(), 1.0, 0.1);
+            }
+            for(int i=0; i<2*M; i++)
+            {
+                if (!std::isfinite(w_new[i]))
+                    return -1;
+            }
+            delete am;
+        }
+
+        // Invalid type
+        try
+        {
+            AndersonMixing *am = factory->create_anderson_mixing_qr(2*M, am_max_hist, am_start_error, am_mix_min, am_mix_init, "III", 1e10);
+            delete am;
+            return -1;
+        }
+        catch(std::exception& exc)
+        {
+            std::cout << exc.what() << std::endl;
+        }
+
+        delete molecules;
+        delete propagator_analyzer;
+        delete cb;
+        delete solver;
+        delete factory;
+        return 0;
+    }
+    catch(std::exception& exc)
+    {
+        std::cout << exc.what() << std::endl;
+        return -1;
+    }
+}
@@ -0,0 +1,157 @@
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <map>
+#include <random>
+#include <chrono>
+
+#include "Exception.h"
+#include "ComputationBox.h"
+#include "Polymer.h"
+#include "Molecules.h"
+#include "PropagatorAnalyzer.h"
+#include "PropagatorComputation.h"
+#include "PropagatorComputationBatch.h"
+#include "AbstractFactory.h"
+#include "PlatformSelector.h"
+
+int main()
+{
+    try
+    {
+        const int R = 4;
+        double ds = 1.0/20;
+
+        std::map<std::string, double> bond_lengths = {{"A",1.0}, {"B",1.5}};
+        // Star of three arms, linear diblock, grafted homopolymer and solvent
+        std::vector<BlockInput> blocks_star = {{"A",0.4,0,1}, {"A",0.4,0,2}, {"B",0.4,0,3}};
+        std::vector<BlockInput> blocks_linear = {{"A",0.6,0,1}, {"B",0.4,1,2}};
+        std::vector<BlockInput> blocks_grafted = {{"B",0.5,0,1}};
+
+        std::mt19937_64 random_generator(1234);
+        std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+
+        std::vector<std::vector<int>> nx_list = {{8,8,8}, {12,10}, {32}};
+        std::vector<std::vector<double>> lx_list = {{2.0,2.5,3.0}, {3.0,2.5}, {4.0}};
+        // The number of replica groups, i.e., R/group_size batched FFTs for each contour step
+        std::vector<int> replica_groups = {2, 1, 4};
+        for(size_t t=0; t<nx_list.size(); t++)
+        {
+            for(bool aggregate_propagator_computation : {false, true})
+            {
+                AbstractFactory *factory = PlatformSelector::create_factory("cpu-mkl", false);
+                ComputationBox *cb = factory->create_computation_box(nx_list[t], lx_list[t], {});
+                Molecules* molecules = factory->create_molecules_information("Continuous", ds, bond_lengths);
+                molecules->add_polymer(0.3, blocks_star, {});
+                molecules->add_polymer(0.3, blocks_linear, {});
+                molecules->add_polymer(0.2, blocks_grafted, {{0,"G"}});
+                molecules->add_solvent(0.2, "B");
+                PropagatorAnalyzer* propagator_analyzer = factory->create_propagator_analyzer(molecules, aggregate_propagator_computation);
+
+                const int M = cb->get_n_grid();
+                const int P = molecules->get_n_polymer_types();
+
+                // Random fields and initial conditions of the replicas
+                std::vector<double> w_a(R*M), w_b(R*M), q_init(R*M);
+                for(int i=0; i<R*M; i++)
+                {
+                    w_a[i] = uniform(random_generator);
+                    w_b[i] = uniform(random_generator);
+                    q_init[i] = 1.0 + 0.5*uniform(random_generator);
+                }
+
+                //-------------- Independent solvers --------------
+                std::vector<double> q_ref(R*M), phi_a_ref(R*M), phi_b_ref(R*M), phi_s_ref(R*M);
+                std::vector<double> partitions_ref(R*P), solvent_partitions_ref(R);
+                PropagatorComputation *solver = factory->create_pseudospectral_solver(cb, molecules, propagator_analyzer);
+                auto chrono_start = std::chrono::system_clock::now();
+                for(int r=0; r<R; r++)
+                {
+                    solver->compute_statistics({{"A",&w_a[r*M]},{"B",&w_b[r*M]}}, {{"G",&q_init[r*M]}});
+                    solver->get_total_concentration("A", &phi_a_ref[r*M]);
+                    solver->get_total_concentration("B", &phi_b_ref[r*M]);
+                    solver->get_solvent_concentration(0, &phi_s_ref[r*M]);
+                    if (!aggregate_propagator_computation)
+                        solver->get_chain_propagator(&q_ref[r*M], 0, 1, 0, 4);
+                    for(int p=0; p<P; p++)
+                        partitions_ref[r*P+p] = solver->get_total_partition(p);
+                    solvent_partitions_ref[r] = solver->get_solvent_partition(0);
+                }
+                std::chrono::duration<double> time_ref = std::chrono::system_clock::now() - chrono_start;
+
+                //-------------- Batch solver --------------
+                std::vector<double> q(R*M), phi_a(R*M), phi_b(R*M), phi_s(R*M), phi_star_a(R*M), phi_star_a_ref(M);
+                PropagatorComputationBatch *solver_batch = factory->create_pseudospectral_solver_batch(cb, molecules, propagator_analyzer, R, replica_groups[t]);
+                chrono_start = std::chrono::system_clock::now();
+                solver_batch->compute_statistics({{"A",w_a.data()},{"B",w_b.data()}}, {{"G",q_init.data()}});
+                std::chrono::duration<double> time_batch = std::chrono::system_clock::now() - chrono_start;
+                solver_batch->get_total_concentration("A", phi_a.data());
+                solver_batch->get_total_concentration("B", phi_b.data());
+                solver_batch->get_solvent_concentration(0, phi_s.data());
+                solver_batch->get_total_concentration(0, "A", phi_star_a.data());
+                if (!aggregate_propagator_computation)
+                    solver_batch->get_chain_propagator(q.data(), 0, 1, 0, 4);
+
+                std::cout << "Dimension, aggregation, replica groups: " << cb->get_dim() << ", " << aggregate_propagator_computation << ", " << replica_groups[t] << std::endl;
+                std::cout << "Time of independent solvers and batch solver (s): " << time_ref.count() << ", " << time_batch.count() << std::endl;
+
+                double max_diff = 0.0;
+                for(int r=0; r<R; r++)
+                {
+                    for(int p=0; p<P; p++)
+                        max_diff = std::max(max_diff, std::abs(solver_batch->get_total_partition(r,p) - partitions_ref[r*P+p])/partitions_ref[r*P+p]);
+                    max_diff = std::max(max_diff, std::abs(solver_batch->get_solvent_partition(r,0) - solvent_partitions_ref[r])/solvent_partitions_ref[r]);
+                }
+                std::cout << "Maximum relative difference of partition functions: " << max_diff << std::endl;
+                if (!std::isfinite(max_diff) || max_diff > 1e-12)
+                    return -1;
+
+                max_diff = 0.0;
+                for(int i=0; i<R*M; i++)
+                {
+                    max_diff = std::max(max_diff, std::abs(phi_a[i] - phi_a_ref[i]));
+                    max_diff = std::max(max_diff, std::abs(phi_b[i] - phi_b_ref[i]));
+                    max_diff = std::max(max_diff, std::abs(phi_s[i] - phi_s_ref[i]));
+                    max_diff = std::max(max_diff, std::abs(q[i] - q_ref[i]));
+                }
+                // Concentration of one polymer of the last replica
+                solver->get_total_concentration(0, "A", phi_star_a_ref.data());
+                for(int i=0; i<M; i++)
+                    max_diff = std::max(max_diff, std::abs(phi_star_a[(R-1)*M+i] - phi_star_a_ref[i]));
+                std::cout << "Maximum difference of concentrations and propagators: " << max_diff << std::endl;
+                if (!std::isfinite(max_diff) || max_diff > 1e-12)
+                    return -1;
+
+                if (!solver_batch->check_total_partition())
+                    return -1;
+
+                // Invalid replica index
+                try
+                {
+                    solver_batch->get_total_partition(R, 0);
+                    return -1;
+                }
+                catch(std::exception& exc)
+                {
+                    std::cout << exc.what() << std::endl;
+                }
+
+                delete solver_batch;
+                delete solver;
+                delete propagator_analyzer;
+                delete molecules;
+                delete cb;
+                delete factory;
+            }
+        }
+        return 0;
+    }
+    catch(std::exception& exc)
+    {
+        std::cout << exc.what() << std::endl;
+        return -1;
+    }
+}
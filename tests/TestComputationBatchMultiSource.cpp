@@ -0,0 +1,159 @@
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <map>
+#include <random>
+#include <chrono>
+
+#include "Exception.h"
+#include "ComputationBox.h"
+#include "Polymer.h"
+#include "Molecules.h"
+#include "PropagatorAnalyzer.h"
+#include "PropagatorComputation.h"
+#include "PropagatorComputationBatch.h"
+#include "AbstractFactory.h"
+#include "PlatformSelector.h"
+
+int main()
+{
+    try
+    {
+        // The number of sources
+        const int R = 6;
+        double ds = 1.0/20;
+
+        std::map<std::string, double> bond_lengths = {{"A",1.0}, {"B",1.5}};
+        // Grafted diblock (batched source "G"), free star, grafted homopolymer (shared source "H") and solvent
+        std::vector<BlockInput> blocks_grafted = {{"A",0.4,0,1}, {"B",0.6,1,2}};
+        std::vector<BlockInput> blocks_star = {{"A",0.4,0,1}, {"A",0.4,0,2}, {"B",0.4,0,3}};
+        std::vector<BlockInput> blocks_homo = {{"B",0.5,0,1}};
+
+        std::mt19937_64 random_generator(2468);
+        std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+
+        std::vector<std::vector<int>> nx_list = {{8,8,8}, {16}};
+        std::vector<std::vector<double>> lx_list = {{2.0,2.5,3.0}, {4.0}};
+        std::vector<int> replica_groups = {3, 2};
+        for(size_t t=0; t<nx_list.size(); t++)
+        {
+            for(bool aggregate_propagator_computation : {false, true})
+            {
+                AbstractFactory *factory = PlatformSelector::create_factory("cpu-mkl", false);
+                ComputationBox *cb = factory->create_computation_box(nx_list[t], lx_list[t], {});
+                Molecules* molecules = factory->create_molecules_information("Continuous", ds, bond_lengths);
+                molecules->add_polymer(0.3, blocks_grafted, {{0,"G"}});
+                molecules->add_polymer(0.4, blocks_star, {});
+                molecules->add_polymer(0.2, blocks_homo, {{0,"H"}});
+                molecules->add_solvent(0.1, "B");
+                PropagatorAnalyzer* propagator_analyzer = factory->create_propagator_analyzer(molecules, aggregate_propagator_computation);
+
+                const int M = cb->get_n_grid();
+                const int P = molecules->get_n_polymer_types();
+
+                // Random fields shared by all sources, and the batch of initial conditions
+                std::vector<double> w_a(M), w_b(M), q_h(M), q_g(R*M);
+                for(int i=0; i<M; i++)
+                {
+                    w_a[i] = uniform(random_generator);
+                    w_b[i] = uniform(random_generator);
+                    q_h[i] = 1.0 + 0.5*uniform(random_generator);
+                }
+                for(int i=0; i<R*M; i++)
+                    q_g[i] = 1.0 + 0.5*uniform(random_generator);
+
+                //-------------- A loop of the single solver --------------
+                std::vector<double> phi_a_ref(R*M), phi_b_ref(R*M), phi_g_ref(R*M), partitions_ref(R*P);
+                PropagatorComputation *solver = factory->create_pseudospectral_solver(cb, molecules, propagator_analyzer);
+                auto chrono_start = std::chrono::system_clock::now();
+                for(int r=0; r<R; r++)
+                {
+                    solver->compute_statistics({{"A",w_a.data()},{"B",w_b.data()}}, {{"G",&q_g[r*M]},{"H",q_h.data()}});
+                    solver->get_total_concentration("A", &phi_a_ref[r*M]);
+                    solver->get_total_concentration("B", &phi_b_ref[r*M]);
+                    solver->get_total_concentration(0, "B", &phi_g_ref[r*M]);
+                    for(int p=0; p<P; p++)
+                        partitions_ref[r*P+p] = solver->get_total_partition(p);
+                }
+                std::chrono::duration<double> time_ref = std::chrono::system_clock::now() - chrono_start;
+
+                //-------------- Multiple sources --------------
+                std::vector<double> phi_a(R*M), phi_b(R*M), phi_g(R*M);
+                PropagatorComputationBatch *solver_batch = factory->create_pseudospectral_solver_batch(cb, molecules, propagator_analyzer, R, replica_groups[t]);
+                chrono_start = std::chrono::system_clock::now();
+                solver_batch->compute_statistics_multi_source({{"A",w_a.data()},{"B",w_b.data()}}, "G", q_g.data(), {{"H",q_h.data()}});
+                std::chrono::duration<double> time_batch = std::chrono::system_clock::now() - chrono_start;
+                solver_batch->get_total_concentration("A", phi_a.data());
+                solver_batch->get_total_concentration("B", phi_b.data());
+                solver_batch->get_total_concentration(0, "B", phi_g.data());
+
+                std::cout << "Dimension, aggregation, replica groups: " << cb->get_dim() << ", " << aggregate_propagator_computation << ", " << replica_groups[t] << std::endl;
+                std::cout << "Time of a loop of single solver and multiple sources (s): " << time_ref.count() << ", " << time_batch.count() << std::endl;
+
+                double max_diff = 0.0;
+                for(int r=0; r<R; r++)
+                    for(int p=0; p<P; p++)
+                        max_diff = std::max(max_diff, std::abs(solver_batch->get_total_partition(r,p) - partitions_ref[r*P+p])/partitions_ref[r*P+p]);
+                for(int i=0; i<R*M; i++)
+                {
+                    max_diff = std::max(max_diff, std::abs(phi_a[i] - phi_a_ref[i]));
+                    max_diff = std::max(max_diff, std::abs(phi_b[i] - phi_b_ref[i]));
+                    max_diff = std::max(max_diff, std::abs(phi_g[i] - phi_g_ref[i]));
+                }
+                std::cout << "Maximum difference of partition functions and concentrations: " << max_diff << std::endl;
+                if (!std::isfinite(max_diff) || max_diff > 1e-12)
+                    return -1;
+
+                if (!solver_batch->check_total_partition())
+                    return -1;
+
+                // Shared propagators are stored again for each replica by compute_statistics
+                std::vector<double> w_a_batch(R*M), w_b_batch(R*M), q_h_batch(R*M);
+                for(int r=0; r<R; r++)
+                {
+                    for(int i=0; i<M; i++)
+                    {
+                        w_a_batch[r*M+i] = w_a[i];
+                        w_b_batch[r*M+i] = w_b[i];
+                        q_h_batch[r*M+i] = q_h[i];
+                    }
+                }
+                solver_batch->compute_statistics({{"A",w_a_batch.data()},{"B",w_b_batch.data()}}, {{"G",q_g.data()},{"H",q_h_batch.data()}});
+                solver_batch->get_total_concentration("A", phi_a.data());
+                max_diff = 0.0;
+                for(int i=0; i<R*M; i++)
+                    max_diff = std::max(max_diff, std::abs(phi_a[i] - phi_a_ref[i]));
+                std::cout << "Maximum difference of concentrations after compute_statistics: " << max_diff << std::endl;
+                if (!std::isfinite(max_diff) || max_diff > 1e-12)
+                    return -1;
+
+                // The source is not used by any propagator
+                try
+                {
+                    solver_batch->compute_statistics_multi_source({{"A",w_a.data()},{"B",w_b.data()}}, "X", q_g.data(), {{"G",q_h.data()},{"H",q_h.data()}});
+                    return -1;
+                }
+                catch(std::exception& exc)
+                {
+                    std::cout << exc.what() << std::endl;
+                }
+
+                delete solver_batch;
+                delete solver;
+                delete propagator_analyzer;
+                delete molecules;
+                delete cb;
+                delete factory;
+            }
+        }
+        return 0;
+    }
+    catch(std::exception& exc)
+    {
+        std::cout << exc.what() << std::endl;
+        return -1;
+    }
+}
@@ -0,0 +1,128 @@
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <map>
+#include <random>
+#include <chrono>
+
+#include "Exception.h"
+#include "ComputationBox.h"
+#include "Polymer.h"
+#include "Molecules.h"
+#include "PropagatorAnalyzer.h"
+#include "PropagatorComputation.h"
+#include "AbstractFactory.h"
+#include "PlatformSelector.h"
+
+int main()
+{
+    try
+    {
+        // The number of field sets, and the maximum number of field sets computed at once
+        const int K = 5;
+        const int batch_size = 2;
+
+        std::vector<int> nx = {8,8,8};
+        std::vector<double> lx = {2.0,2.5,3.0};
+        double ds = 1.0/20;
+
+        std::mt19937_64 random_generator(4321);
+        std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+
+        for(std::string chain_model : {"Continuous", "Discrete"})
+        {
+            AbstractFactory *factory = PlatformSelector::create_factory("cpu-mkl", false);
+            ComputationBox *cb = factory->create_computation_box(nx, lx, {});
+            Molecules* molecules = factory->create_molecules_information(chain_model, ds, {{"A",1.0}, {"B",1.2}});
+            molecules->add_polymer(0.6, {{"A",0.4,0,1}, {"B",0.6,1,2}}, {});
+            molecules->add_polymer(0.3, {{"A",0.3,0,1}, {"A",0.3,0,2}, {"B",0.3,0,3}}, {});
+            molecules->add_solvent(0.1, "A");
+            PropagatorAnalyzer* propagator_analyzer = factory->create_propagator_analyzer(molecules, true);
+            PropagatorComputation *solver = factory->create_pseudospectral_solver(cb, molecules, propagator_analyzer);
+
+            const int M = cb->get_n_grid();
+            const int P = molecules->get_n_polymer_types();
+            const std::vector<std::string> monomer_types = {"A", "B"};
+            const int S = monomer_types.size();
+
+            // Random field sets
+            std::vector<std::vector<double>> w_a(K, std::vector<double>(M)), w_b(K, std::vector<double>(M));
+            std::vector<std::map<std::string, const double*>> w_inputs;
+            for(int k=0; k<K; k++)
+            {
+                for(int i=0; i<M; i++)
+                {
+                    w_a[k][i] = uniform(random_generator);
+                    w_b[k][i] = uniform(random_generator);
+                }
+                w_inputs.push_back({{"A",w_a[k].data()},{"B",w_b[k].data()}});
+            }
+
+            //-------------- compute_statistics for each field set --------------
+            std::vector<double> partitions_ref(K*P), phi_ref(K*S*M);
+            auto chrono_start = std::chrono::system_clock::now();
+            for(int k=0; k<K; k++)
+            {
+                solver->compute_statistics(w_inputs[k], {});
+                for(int p=0; p<P; p++)
+                    partitions_ref[k*P+p] = solver->get_total_partition(p);
+                for(int s=0; s<S; s++)
+                    solver->get_total_concentration(monomer_types[s], &phi_ref[(k*S+s)*M]);
+            }
+            std::chrono::duration<double> time_ref = std::chrono::system_clock::now() - chrono_start;
+
+            //-------------- compute_statistics_batch --------------
+            std::vector<double> partitions(K*P), phi(K*S*M);
+            chrono_start = std::chrono::system_clock::now();
+            solver->compute_statistics_batch(w_inputs, monomer_types, partitions.data(), phi.data(), batch_size);
+            std::chrono::duration<double> time_batch = std::chrono::system_clock::now() - chrono_start;
+
+            double max_diff = 0.0;
+            for(int i=0; i<K*P; i++)
+                max_diff = std::max(max_diff, std::abs(partitions[i]-partitions_ref[i])/partitions_ref[i]);
+            for(int i=0; i<K*S*M; i++)
+                max_diff = std::max(max_diff, std::abs(phi[i]-phi_ref[i]));
+            std::cout << "Chain model: " << chain_model << std::endl;
+            std::cout << "Time of a loop of compute_statistics and compute_statistics_batch (s): " << time_ref.count() << ", " << time_batch.count() << std::endl;
+            std::cout << "Maximum difference of partition functions and concentrations: " << max_diff << std::endl;
+            if (!std::isfinite(max_diff) || max_diff > 1e-12)
+                return -1;
+
+            // Batch size larger than the number of field sets, after changing the box
+            cb->set_lx({2.2,2.5,2.8});
+            solver->update_laplacian_operator();
+            solver->compute_statistics(w_inputs[K-1], {});
+            solver->compute_statistics_batch(w_inputs, monomer_types, partitions.data(), phi.data(), 2*K);
+            max_diff = std::abs(partitions[(K-1)*P]-solver->get_total_partition(0))/solver->get_total_partition(0);
+            std::cout << "Difference of partition function after changing the box: " << max_diff << std::endl;
+            if (!std::isfinite(max_diff) || max_diff > 1e-12)
+                return -1;
+
+            // Invalid batch size
+            try
+            {
+                solver->compute_statistics_batch(w_inputs, monomer_types, partitions.data(), phi.data(), 0);
+                return -1;
+            }
+            catch(std::exception& exc)
+            {
+                std::cout << exc.what() << std::endl;
+            }
+
+            delete solver;
+            delete propagator_analyzer;
+            delete molecules;
+            delete cb;
+            delete factory;
+        }
+        return 0;
+    }
+    catch(std::exception& exc)
+    {
+        std::cout << exc.what() << std::endl;
+        return -1;
+    }
+}
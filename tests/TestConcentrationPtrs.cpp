@@ -0,0 +1,101 @@
+#include <cstdlib>
+#include <iostream>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <map>
+#include <random>
+
+#include "Exception.h"
+#include "ComputationBox.h"
+#include "Polymer.h"
+#include "Molecules.h"
+#include "PropagatorAnalyzer.h"
+#include "PropagatorComputation.h"
+#include "AbstractFactory.h"
+#include "PlatformSelector.h"
+
+int main()
+{
+    try
+    {
+        std::vector<int> nx = {8,6,4};
+        std::vector<double> lx = {2.0,1.5,1.0};
+        double ds = 1.0/20;
+
+        std::mt19937_64 random_generator(1357);
+        std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+
+        for(std::string chain_model : {"Continuous", "Discrete"})
+        {
+            for(bool reduce_memory_usage : {false, true})
+            {
+                AbstractFactory *factory = PlatformSelector::create_factory("cpu-mkl", reduce_memory_usage);
+                ComputationBox *cb = factory->create_computation_box(nx, lx, {});
+                Molecules* molecules = factory->create_molecules_information(chain_model, ds, {{"A",1.0}, {"B",1.2}});
+                molecules->add_polymer(0.5, {{"A",0.4,0,1}, {"B",0.6,1,2}}, {});
+                molecules->add_polymer(0.4, {{"A",0.3,0,1}, {"A",0.3,0,2}, {"B",0.3,0,3}}, {});
+                molecules->add_solvent(0.1, "A");
+                PropagatorAnalyzer* propagator_analyzer = factory->create_propagator_analyzer(molecules, true);
+                PropagatorComputation *solver = factory->create_pseudospectral_solver(cb, molecules, propagator_analyzer);
+
+                const int M = cb->get_n_grid();
+                std::vector<double> w_a(M), w_b(M);
+                for(int i=0; i<M; i++)
+                {
+                    w_a[i] = uniform(random_generator);
+                    w_b[i] = uniform(random_generator);
+                }
+                solver->compute_statistics({{"A",w_a.data()},{"B",w_b.data()}}, {});
+
+                // Sum of block concentrations in the solver memory for each monomer type
+                std::map<std::string, std::vector<double>> phi_sum = {{"A", std::vector<double>(M, 0.0)}, {"B", std::vector<double>(M, 0.0)}};
+                for(const auto& item: solver->get_block_concentration_ptrs())
+                {
+                    std::string monomer_type = propagator_analyzer->get_computation_block(item.first).monomer_type;
+                    for(int i=0; i<M; i++)
+                        phi_sum[monomer_type][i] += item.second[i];
+                }
+                const double *phi_solvent = solver->get_solvent_concentration_ptr(0);
+                for(int i=0; i<M; i++)
+                    phi_sum["A"][i] += phi_solvent[i];
+
+                double max_diff = 0.0;
+                std::vector<double> phi(M);
+                for(std::string monomer_type : {"A", "B"})
+                {
+                    solver->get_total_concentration(monomer_type, phi.data());
+                    for(int i=0; i<M; i++)
+                        max_diff = std::max(max_diff, std::abs(phi[i] - phi_sum[monomer_type][i]));
+                }
+                std::cout << "Chain model, reduce_memory_usage: " << chain_model << ", " << reduce_memory_usage << std::endl;
+                std::cout << "Maximum difference of concentrations: " << max_diff << std::endl;
+                if (!std::isfinite(max_diff) || max_diff > 1e-12)
+                    return -1;
+
+                // Invalid solvent index
+                try
+                {
+                    solver->get_solvent_concentration_ptr(1);
+                    return -1;
+                }
+                catch(std::exception& exc)
+                {
+                    std::cout << exc.what() << std::endl;
+                }
+
+                delete solver;
+                delete propagator_analyzer;
+                delete molecules;
+                delete cb;
+                delete factory;
+            }
+        }
+        return 0;
+    }
+    catch(std::exception& exc)
+    {
+        std::cout << exc.what() << std::endl;
+        return -1;
+    }
+}
@@ -0,0 +1,107 @@
+#include <iostream>
+#include <cmath>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include "CpuAndersonMixingKernels.h"
+
+int main()
+{
+    try
+    {
+        // The number of variables is not a multiple of the block size
+        const int N_VAR = 1000003;
+        const int N_HIST = 21;
+
+        std::mt19937 gen(1234);
+        std::uniform_real_distribution<double> dist(-1.0, 1.0);
+
+        std::vector<std::vector<double>> x(N_HIST, std::vector<double>(N_VAR));
+        std::vector<std::vector<double>> y(N_HIST, std::vector<double>(N_VAR));
+        std::vector<double*> x_ptr(N_HIST), y_ptr(N_HIST);
+        std::vector<double> a(N_VAR), coeff(N_HIST);
+        for(int k=0; k<N_HIST; k++)
+        {
+            for(int i=0; i<N_VAR; i++)
+            {
+                x[k][i] = dist(gen);
+                y[k][i] = dist(gen);
+            }
+            x_ptr[k] = x[k].data();
+            y_ptr[k] = y[k].data();
+            coeff[k] = dist(gen);
+        }
+        for(int i=0; i<N_VAR; i++)
+            a[i] = dist(gen);
+
+        // Inner products
+        std::vector<double> dots(N_HIST), dots_answer(N_HIST, 0.0);
+        auto chrono_start = std::chrono::system_clock::now();
+        for(int k=0; k<N_HIST; k++)
+        {
+            for(int i=0; i<N_VAR; i++)
+                dots_answer[k] += a[i]*x[k][i];
+        }
+        std::chrono::duration<double> time_naive = std::chrono::system_clock::now() - chrono_start;
+
+        chrono_start = std::chrono::system_clock::now();
+        CpuAndersonMixingKernels::multi_dot_products(N_VAR, N_HIST, a.data(), x_ptr.data(), dots.data());
+        std::chrono::duration<double> time_fused = std::chrono::system_clock::now() - chrono_start;
+        std::cout << "Inner products, time (naive, fused): " << time_naive.count() << ", " << time_fused.count() << std::endl;
+
+        double error = 0.0;
+        for(int k=0; k<N_HIST; k++)
+            error = std::max(error, std::abs(dots[k]-dots_answer[k]));
+        std::cout << "Inner products, max error: " << error << std::endl;
+        if (!std::isfinite(error) || error > 1e-9)
+            return -1;
+
+        // Results do not change for repeated calls
+        std::vector<double> dots_repeat(N_HIST);
+        CpuAndersonMixingKernels::multi_dot_products(N_VAR, N_HIST, a.data(), x_ptr.data(), dots_repeat.data());
+        for(int k=0; k<N_HIST; k++)
+        {
+            if (dots_repeat[k] != dots[k])
+                return -1;
+        }
+
+        // Linear combination
+        std::vector<double> out(N_VAR), out_answer(N_VAR, 0.0);
+        chrono_start = std::chrono::system_clock::now();
+        for(int k=0; k<N_HIST; k++)
+        {
+            for(int i=0; i<N_VAR; i++)
+                out_answer[i] += coeff[k]*(x[k][i] + y[k][i]);
+        }
+        time_naive = std::chrono::system_clock::now() - chrono_start;
+
+        chrono_start = std::chrono::system_clock::now();
+        CpuAndersonMixingKernels::linear_combination(N_VAR, N_HIST, coeff.data(), x_ptr.data(), y_ptr.data(), out.data());
+        time_fused = std::chrono::system_clock::now() - chrono_start;
+        std::cout << "Linear combination, time (naive, fused): " << time_naive.count() << ", " << time_fused.count() << std::endl;
+
+        error = 0.0;
+        for(int i=0; i<N_VAR; i++)
+            error = std::max(error, std::abs(out[i]-out_answer[i]));
+        std::cout << "Linear combination, max error: " << error << std::endl;
+        if (!std::isfinite(error) || error > 1e-12)
+            return -1;
+
+        // Simple mixing
+        CpuAndersonMixingKernels::simple_mixing(N_VAR, 0.1, x_ptr[0], y_ptr[0], out.data());
+        error = 0.0;
+        for(int i=0; i<N_VAR; i++)
+            error = std::max(error, std::abs(out[i]-(x[0][i] + 0.1*y[0][i])));
+        std::cout << "Simple mixing, max error: " << error << std::endl;
+        if (!std::isfinite(error) || error > 1e-15)
+            return -1;
+
+        return 0;
+    }
+    catch(std::exception& exc)
+    {
+        std::cout << exc.what() << std::endl;
+        return -1;
+    }
+}
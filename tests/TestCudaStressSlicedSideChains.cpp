@@ -0,0 +1,141 @@
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+#include "Exception.h"
+#include "ComputationBox.h"
+#include "Polymer.h"
+#include "Molecules.h"
+#include "PropagatorAnalyzer.h"
+#include "PropagatorComputation.h"
+#include "AbstractFactory.h"
+#include "PlatformSelector.h"
+
+// Stress of the discrete chain model with side chains of different lengths.
+// With the sorted merge, blocks of longer side chains are sliced, and the half bond at the
+// start of a sliced block is counted by the slice. The results of CUDA are compared with CPU.
+int main()
+{
+    try
+    {
+        // Math constants
+        const double PI = 3.14159265358979323846;
+
+        std::vector<int> nx = {10,9,8};
+        std::vector<double> lx = {3.2,3.5,3.0};
+        double ds = 0.1;
+
+        std::map<std::string, double> bond_lengths = {{"A",1.0}, {"B",1.3}};
+
+        // Bottlebrush whose side chains have 3, 5, 7 and 9 segments
+        const int N_SIDE_CHAINS = 4;
+        std::vector<BlockInput> blocks;
+        for(int i=0; i<N_SIDE_CHAINS+1; i++)
+            blocks.push_back({"A", 0.2, i, i+1});
+        for(int i=1; i<=N_SIDE_CHAINS; i++)
+            blocks.push_back({"B", 0.1*(2*i+1), i, N_SIDE_CHAINS+1+i});
+
+        const int M = nx[0]*nx[1]*nx[2];
+
+        //-------------- Allocate array ------------
+        std::vector<double> w_a(M), w_b(M);
+        for(int i=0; i<nx[0]; i++)
+        {
+            double xx = (i+1)*2*PI/nx[0];
+            for(int j=0; j<nx[1]; j++)
+            {
+                double yy = (j+1)*2*PI/nx[1];
+                for(int k=0; k<nx[2]; k++)
+                {
+                    double zz = (k+1)*2*PI/nx[2];
+                    int idx = i*nx[1]*nx[2] + j*nx[2] + k;
+                    w_a[idx] = 0.4*cos(xx)*sin(2.0*yy) + 0.3*cos(zz);
+                    w_b[idx] = -w_a[idx] + 0.2*sin(xx+yy);
+                }
+            }
+        }
+
+        std::vector<std::string> avail_platforms = PlatformSelector::avail_platforms();
+        if (std::find(avail_platforms.begin(), avail_platforms.end(), "cuda") == avail_platforms.end())
+        {
+            std::cout << "CUDA platform is not available." << std::endl;
+            return -1;
+        }
+
+        // Blocks of the side chains must be sliced
+        {
+            Molecules molecules("Discrete", ds, bond_lengths);
+            molecules.add_polymer(1.0, blocks, {});
+            PropagatorAnalyzer propagator_analyzer(&molecules, true, true);
+            int n_sliced_blocks = 0;
+            for(const auto& item: propagator_analyzer.get_computation_blocks())
+            {
+                if (item.second.n_segment_right < item.second.n_segment_left)
+                    n_sliced_blocks++;
+            }
+            std::cout << "The number of sliced blocks: " << n_sliced_blocks << std::endl;
+            if (n_sliced_blocks == 0)
+                return -1;
+        }
+
+        // The first result (CPU without aggregation) is the reference
+        std::vector<std::string> labels;
+        std::vector<double> q_list;
+        std::vector<std::vector<double>> stress_list;
+        for(std::string platform : avail_platforms)
+        {
+            for(bool aggregate_propagator_computation : {false, true})
+            {
+                for(bool reduce_memory_usage : {false, true})
+                {
+                    AbstractFactory *factory = PlatformSelector::create_factory(platform, reduce_memory_usage);
+                    ComputationBox *cb = factory->create_computation_box(nx, lx, {});
+                    Molecules* molecules = factory->create_molecules_information("Discrete", ds, bond_lengths);
+                    molecules->add_polymer(1.0, blocks, {});
+                    PropagatorAnalyzer* propagator_analyzer= new PropagatorAnalyzer(molecules, aggregate_propagator_computation, true);
+                    PropagatorComputation *solver = factory->create_pseudospectral_solver(cb, molecules, propagator_analyzer);
+
+                    solver->compute_statistics({{"A",w_a.data()},{"B",w_b.data()}},{});
+                    solver->compute_stress();
+
+                    labels.push_back(platform + ", aggregation: " + std::to_string(aggregate_propagator_computation) +
+                        ", reduce_memory_usage: " + std::to_string(reduce_memory_usage));
+                    q_list.push_back(solver->get_total_partition(0));
+                    stress_list.push_back(solver->get_stress());
+
+                    std::cout << labels.back() << std::endl;
+                    std::cout << std::setprecision(10) << std::scientific;
+                    std::cout << "\tQ: " << q_list.back() << ", stress: " << stress_list.back()[0] << ", " << stress_list.back()[1] << ", " << stress_list.back()[2] << std::endl;
+                    std::cout << std::defaultfloat;
+
+                    delete factory;
+                    delete cb;
+                    delete molecules;
+                    delete propagator_analyzer;
+                    delete solver;
+                }
+            }
+        }
+
+        for(size_t r=1; r<q_list.size(); r++)
+        {
+            double error = std::abs(q_list[r]/q_list[0]-1.0);
+            for(int d=0; d<3; d++)
+                error = std::max(error, std::abs(stress_list[r][d]-stress_list[0][d]));
+            std::cout << labels[r] << ", max error: " << std::scientific << error << std::defaultfloat << std::endl;
+            if (!std::isfinite(error) || error > 1e-7)
+                return -1;
+        }
+        return 0;
+    }
+    catch(std::exception& exc)
+    {
+        std::cout << exc.what() << std::endl;
+        return -1;
+    }
+}
@@ -0,0 +1,256 @@
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <complex>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+
+#include "Exception.h"
+#include "ComputationBox.h"
+#include "Polymer.h"
+#include "Molecules.h"
+#include "PropagatorAnalyzer.h"
+#include "PropagatorComputation.h"
+#include "AndersonMixing.h"
+#include "LangevinFts.h"
+#include "AbstractFactory.h"
+#include "PlatformSelector.h"
+
+int main()
+{
+    try
+    {
+        // Math constants
+        const double PI = 3.14159265358979323846;
+
+        const int saddle_max_iter = 100;
+        const double tolerance = 1e-4;
+        const int n_langevin_steps = 6;
+        const int sf_computing_period = 2;
+
+        double f = 0.4;
+        double chi_n = 15.0;
+        std::vector<int> nx = {8,8,8};
+        std::vector<double> lx = {2.0,2.0,2.0};
+        double ds = 1.0/20;
+        double langevin_dt = 0.8;
+        double langevin_nbar = 10000;
+
+        AbstractFactory *factory = PlatformSelector::create_factory("cpu-mkl", false);
+        ComputationBox *cb = factory->create_computation_box(nx, lx, {});
+        Molecules* molecules = factory->create_molecules_information("Continuous", ds, {{"A",1.0}, {"B",1.0}});
+        molecules->add_polymer(1.0, {{"A",f,0,1}, {"B",1.0-f,1,2}}, {});
+        PropagatorAnalyzer* propagator_analyzer = new PropagatorAnalyzer(molecules, false);
+        PropagatorComputation *solver = factory->create_pseudospectral_solver(cb, molecules, propagator_analyzer);
+
+        const int M = cb->get_n_grid();
+        const double langevin_sigma = std::sqrt(2*langevin_dt*M/(cb->get_volume()*std::sqrt(langevin_nbar)));
+
+        // AB-type melts in 'SymmetricPolymerTheory' of lfts.py, w_A = w_- + w_+, w_B = -w_- + w_+,
+        // H = χN/4 + <w_-^2>/χN - <w_+> - ln Q
+        std::vector<std::vector<double>> matrix_a = {{1.0, 1.0}, {-1.0, 1.0}};
+        std::vector<std::vector<double>> matrix_a_inv = {{0.5, -0.5}, {0.5, 0.5}};
+        std::vector<double> eigenvalues = {-chi_n, 0.0};
+        std::vector<double> h_coef_mu1 = {0.0};
+        std::vector<double> h_coef_mu2 = {1.0/chi_n};
+        std::vector<double> dt_scaling = {1.0, 1.0};
+
+        auto create_langevin_fts = [&](AndersonMixing *compressor, int max_iter, long random_seed) -> LangevinFts*
+        {
+            LangevinFts *lfts = factory->create_langevin_fts(cb, molecules, solver, compressor, {"A","B"},
+                matrix_a, matrix_a_inv, eigenvalues, {0}, {1}, chi_n/4, h_coef_mu1, h_coef_mu2, dt_scaling,
+                langevin_dt, langevin_sigma, max_iter, tolerance, sf_computing_period, 0, {}, random_seed);
+            lfts->add_chi_n_derivative("A,B", 0.25, {0.0}, {-1.0/(chi_n*chi_n)});
+            return lfts;
+        };
+
+        // Initial lamellar fields
+        std::vector<double> w_aux_init(2*M, 0.0);
+        for(int i=0; i<nx[0]; i++)
+            for(int j=0; j<nx[1]; j++)
+                for(int k=0; k<nx[2]; k++)
+                    w_aux_init[(i*nx[1]+j)*nx[2]+k] = 0.5*chi_n*0.3*cos(2.0*PI*i/nx[0]);
+
+        std::vector<double> w_aux(2*M), w_aux_ref(2*M), phi(2*M), noise(M), noise_ref(M);
+
+        //-------------- Langevin steps with Anderson mixing --------------
+        AndersonMixing *am = factory->create_anderson_mixing(M, 20, 5e-1, 0.01, 0.01);
+        LangevinFts *lfts = create_langevin_fts(am, saddle_max_iter, 12345);
+        lfts->set_fields(w_aux_init.data());
+        int n_iter = lfts->find_saddle_point();
+        std::cout << "Iterations of the initial saddle point: " << n_iter << std::endl;
+        if (n_iter >= saddle_max_iter)
+            return -1;
+
+        auto chrono_start = std::chrono::system_clock::now();
+        if (!lfts->run(1, n_langevin_steps))
+            return -1;
+        std::chrono::duration<double> time_duration = std::chrono::system_clock::now() - chrono_start;
+        std::cout << "Saddle point iterations per Langevin step, time per Langevin step (s): "
+            << static_cast<double>(lfts->get_total_saddle_iter())/n_langevin_steps << ", "
+            << time_duration.count()/n_langevin_steps << std::endl;
+        if (lfts->get_saddle_fail_count() != 0)
+            return -1;
+
+        // Incompressibility and fields of the accepted steps
+        lfts->get_fields(w_aux.data());
+        lfts->get_concentrations(phi.data());
+        double max_error = 0.0, mean_w_plus = 0.0, max_dw = 0.0;
+        for(int i=0; i<M; i++)
+        {
+            max_error = std::max(max_error, std::abs(phi[i] + phi[i+M] - 1.0));
+            mean_w_plus += w_aux[i+M]/M;
+            max_dw = std::max(max_dw, std::abs(w_aux[i] - w_aux_init[i]));
+        }
+        std::cout << "Incompressibility error, mean of w_+, change of w_-: " << max_error << ", " << mean_w_plus << ", " << max_dw << std::endl;
+        if (max_error > 10*tolerance || std::abs(mean_w_plus) > 1e-10 || max_dw == 0.0)
+            return -1;
+
+        // H and dH/dχN recorded every sf_computing_period steps
+        std::vector<double> h_history = lfts->get_hamiltonian_history();
+        std::map<std::string, std::vector<double>> dh_history = lfts->get_dh_history();
+        if (h_history.size() != n_langevin_steps/sf_computing_period || dh_history["A,B"].size() != h_history.size())
+            return -1;
+        double mean_w2 = 0.0;
+        for(int i=0; i<M; i++)
+            mean_w2 += w_aux[i]*w_aux[i]/M;
+        std::cout << "H, dH/dχN: " << std::setprecision(10) << h_history.back() << ", " << dh_history["A,B"].back() << std::endl;
+        if (std::abs(dh_history["A,B"].back() - (0.25 - mean_w2/(chi_n*chi_n))) > 1e-10)
+            return -1;
+        lfts->clear_history();
+        if (lfts->get_hamiltonian_history().size() != 0 || lfts->get_dh_history()["A,B"].size() != 0)
+            return -1;
+
+        //-------------- Structure function --------------
+        // Compare the structure function of one step with the discrete Fourier transform
+        {
+            const int nz_c = nx[2]/2+1;
+            const int n_complex_grid = nx[0]*nx[1]*nz_c;
+            std::vector<std::complex<double>> sf(n_complex_grid);
+            lfts->reset_structure_function();
+            if (!lfts->run(n_langevin_steps+1, n_langevin_steps+sf_computing_period))
+                return -1;
+            lfts->get_fields(w_aux.data());
+            lfts->get_concentrations(phi.data());
+
+            double max_diff = 0.0, max_sf = 0.0;
+            for(int a=0; a<2; a++)
+            {
+                for(int b=a; b<2; b++)
+                {
+                    lfts->get_structure_function(a, b, sf.data());
+                    for(int kx=0; kx<nx[0]; kx++)
+                        for(int ky=0; ky<nx[1]; ky++)
+                            for(int kz=0; kz<nz_c; kz++)
+                            {
+                                std::complex<double> w_k = 0.0, phi_k = 0.0;
+                                for(int i=0; i<nx[0]; i++)
+                                    for(int j=0; j<nx[1]; j++)
+                                        for(int k=0; k<nx[2]; k++)
+                                        {
+                                            const int r = (i*nx[1]+j)*nx[2]+k;
+                                            const double theta = -2.0*PI*(static_cast<double>(kx*i)/nx[0] + static_cast<double>(ky*j)/nx[1] + static_cast<double>(kz*k)/nx[2]);
+                                            const std::complex<double> phase(cos(theta), sin(theta));
+                                            w_k   += w_aux[r]*phase;
+                                            phi_k += phi[b*M+r]*phase;
+                                        }
+                                // mu(k) = w_-(k)*A_inv[0][a]/eigenvalue_0/M
+                                const std::complex<double> sf_ref = w_k*matrix_a_inv[0][a]/eigenvalues[0]/static_cast<double>(M)*std::conj(phi_k/static_cast<double>(M));
+                                const int n = (kx*nx[1]+ky)*nz_c+kz;
+                                max_diff = std::max(max_diff, std::abs(sf[n]-sf_ref));
+                                max_sf = std::max(max_sf, std::abs(sf_ref));
+                            }
+                }
+            }
+            std::cout << "Maximum of structure function, and difference from the discrete Fourier transform: " << max_sf << ", " << max_diff << std::endl;
+            if (max_sf == 0.0 || max_diff > 1e-10*max_sf)
+                return -1;
+        }
+
+        //-------------- Restart with the random state --------------
+        // Restoring fields, noise and random state reproduces the same trajectory
+        {
+            lfts->get_fields(w_aux_ref.data());
+            lfts->get_normal_noise_prev(noise_ref.data());
+            std::string random_state = lfts->get_random_state();
+            if (!lfts->run(1, 2))
+                return -1;
+            lfts->get_fields(w_aux.data());
+
+            AndersonMixing *am_restart = factory->create_anderson_mixing(M, 20, 5e-1, 0.01, 0.01);
+            LangevinFts *lfts_restart = create_langevin_fts(am_restart, saddle_max_iter, -1);
+            lfts_restart->set_fields(w_aux_ref.data());
+            lfts_restart->set_normal_noise_prev(noise_ref.data());
+            lfts_restart->set_random_state(random_state);
+            lfts_restart->find_saddle_point();
+            if (!lfts_restart->run(1, 2))
+                return -1;
+            lfts_restart->get_fields(w_aux_ref.data());
+            double max_diff = 0.0;
+            for(int i=0; i<M; i++)
+                max_diff = std::max(max_diff, std::abs(w_aux[i]-w_aux_ref[i]));
+            std::cout << "Difference of w_- after the restart: " << max_diff << std::endl;
+            if (max_diff > 1e-8)
+                return -1;
+            delete lfts_restart;
+            delete am_restart;
+        }
+
+        //-------------- Rollback --------------
+        // The saddle point is never found with a single iteration, so all steps are discarded
+        {
+            AndersonMixing *am_fail = factory->create_anderson_mixing(M, 20, 5e-1, 0.01, 0.01);
+            LangevinFts *lfts_fail = create_langevin_fts(am_fail, 1, 54321);
+            lfts->get_fields(w_aux_ref.data());
+            lfts->get_normal_noise_prev(noise_ref.data());
+            lfts_fail->set_fields(w_aux_ref.data());
+            lfts_fail->set_normal_noise_prev(noise_ref.data());
+            if (lfts_fail->run(1, 10))
+                return -1;
+            lfts_fail->get_fields(w_aux.data());
+            lfts_fail->get_normal_noise_prev(noise.data());
+            std::cout << "Saddle point failures: " << lfts_fail->get_saddle_fail_count() << std::endl;
+            if (lfts_fail->get_saddle_fail_count() != 5)
+                return -1;
+            for(int i=0; i<2*M; i++)
+                if (w_aux[i] != w_aux_ref[i])
+                    return -1;
+            for(int i=0; i<M; i++)
+                if (noise[i] != noise_ref[i])
+                    return -1;
+            delete lfts_fail;
+            delete am_fail;
+        }
+        delete lfts;
+        delete am;
+
+        // Invalid number of variables of the compressor
+        try
+        {
+            AndersonMixing *am_invalid = factory->create_anderson_mixing(2*M, 20, 5e-1, 0.01, 0.01);
+            LangevinFts *lfts_invalid = create_langevin_fts(am_invalid, saddle_max_iter, 0);
+            delete lfts_invalid;
+            delete am_invalid;
+            return -1;
+        }
+        catch(std::exception& exc)
+        {
+            std::cout << exc.what() << std::endl;
+        }
+
+        delete molecules;
+        delete propagator_analyzer;
+        delete cb;
+        delete solver;
+        delete factory;
+        return 0;
+    }
+    catch(std::exception& exc)
+    {
+        std::cout << exc.what() << std::endl;
+        return -1;
+    }
+}
@@ -0,0 +1,198 @@
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+
+#include "Exception.h"
+#include "ComputationBox.h"
+#include "Polymer.h"
+#include "Molecules.h"
+#include "PropagatorAnalyzer.h"
+#include "PropagatorComputation.h"
+#include "AndersonMixing.h"
+#include "LinearResponseCompressor.h"
+#include "AbstractFactory.h"
+#include "PlatformSelector.h"
+
+int main()
+{
+    try
+    {
+        const int max_saddle_iter = 200;
+        const double tolerance = 1e-4;
+        const int n_langevin_steps = 5;
+
+        double f = 0.4;
+        double chi_n = 15.0;
+        std::vector<int> nx = {8,8,8};
+        std::vector<double> lx = {2.0,2.0,2.0};
+        double ds = 1.0/20;
+
+        AbstractFactory *factory = PlatformSelector::create_factory("cpu-mkl", false);
+        ComputationBox *cb = factory->create_computation_box(nx, lx, {});
+        const int M = cb->get_n_grid();
+
+        // Exchange field w_- and pressure field w_+ of AB-type melts, w_A = w_+ + w_-, w_B = w_+ - w_-.
+        // Find w_+ that satisfies the incompressibility, and return the number of iterations.
+        auto find_saddle_point = [&](PropagatorComputation *solver, AndersonMixing *compressor,
+            std::map<std::string, std::map<std::string, double>> random_fractions,
+            std::vector<double>& w_minus, std::vector<double>& w_plus, double& error_level) -> int
+        {
+            std::vector<double> w_a(M), w_b(M), phi_a(M), phi_b(M), phi_r(M), h_deriv(M);
+            compressor->reset_count();
+            error_level = 1.0e20;
+            double old_error_level;
+            int iter;
+            for(iter=0; iter<max_saddle_iter; iter++)
+            {
+                std::map<std::string, const double*> w_input;
+                for(int i=0; i<M; i++)
+                {
+                    w_a[i] = w_plus[i] + w_minus[i];
+                    w_b[i] = w_plus[i] - w_minus[i];
+                }
+                w_input["A"] = w_a.data();
+                w_input["B"] = w_b.data();
+                std::vector<std::vector<double>> w_random;
+                for(const auto& item : random_fractions)
+                {
+                    w_random.push_back(std::vector<double>(M, 0.0));
+                    for(int i=0; i<M; i++)
+                        w_random.back()[i] = item.second.at("A")*w_a[i] + item.second.at("B")*w_b[i];
+                    w_input[item.first] = w_random.back().data();
+                }
+                solver->compute_propagators(w_input, {});
+                solver->compute_concentrations();
+                solver->get_total_concentration("A", phi_a.data());
+                solver->get_total_concentration("B", phi_b.data());
+                for(const auto& item : random_fractions)
+                {
+                    solver->get_total_concentration(item.first, phi_r.data());
+                    for(int i=0; i<M; i++)
+                    {
+                        phi_a[i] += item.second.at("A")*phi_r[i];
+                        phi_b[i] += item.second.at("B")*phi_r[i];
+                    }
+                }
+
+                // dH/dw_+ = phi_A + phi_B - 1
+                double mean = 0.0, variance = 0.0;
+                for(int i=0; i<M; i++)
+                {
+                    h_deriv[i] = phi_a[i] + phi_b[i] - 1.0;
+                    mean += h_deriv[i]/M;
+                }
+                for(int i=0; i<M; i++)
+                    variance += (h_deriv[i]-mean)*(h_deriv[i]-mean)/M;
+                old_error_level = error_level;
+                error_level = sqrt(variance);
+
+                if(error_level < tolerance) break;
+                compressor->calculate_new_fields(w_plus.data(), w_plus.data(), h_deriv.data(), old_error_level, error_level);
+            }
+            cb->zero_mean(w_plus.data());
+            return iter;
+        };
+
+        for(std::string polymers : {"Diblock", "Diblock, random copolymer"})
+        {
+            Molecules* molecules = factory->create_molecules_information("Continuous", ds, {{"A",1.0}, {"B",1.0}, {"R",1.0}});
+            std::map<std::string, std::map<std::string, double>> random_fractions;
+            if (polymers == "Diblock")
+            {
+                molecules->add_polymer(1.0, {{"A",f,0,1}, {"B",1.0-f,1,2}}, {});
+            }
+            else
+            {
+                molecules->add_polymer(0.7, {{"A",f,0,1}, {"B",1.0-f,1,2}}, {});
+                molecules->add_polymer(0.3, {{"R",0.5,0,1}}, {});
+                random_fractions["R"] = {{"A",0.3}, {"B",0.7}};
+            }
+            PropagatorAnalyzer* propagator_analyzer = new PropagatorAnalyzer(molecules, false);
+            PropagatorComputation *solver = factory->create_pseudospectral_solver(cb, molecules, propagator_analyzer);
+
+            std::vector<std::string> methods = {"Anderson mixing", "Linear response", "Linear response, Anderson mixing"};
+            std::vector<double> mean_iterations;
+            for(const std::string& method : methods)
+            {
+                AndersonMixing *compressor;
+                AndersonMixing *anderson_mixing = nullptr;
+                if (method == "Anderson mixing")
+                    compressor = factory->create_anderson_mixing(M, 20, 5e-1, 0.01, 0.01);
+                else if (method == "Linear response")
+                    compressor = factory->create_linear_response_compressor(cb, molecules, {"A","B"}, {{1.0},{1.0}}, {0.0}, nullptr, random_fractions);
+                else
+                {
+                    // The preconditioned residual is mixed with the full step
+                    anderson_mixing = factory->create_anderson_mixing(M, 20, 1e10, 1.0, 1.0);
+                    compressor = factory->create_linear_response_compressor(cb, molecules, {"A","B"}, {{1.0},{1.0}}, {0.0}, anderson_mixing, random_fractions);
+                }
+
+                // Langevin steps are mimicked by adding random noise to w_-
+                std::mt19937 generator(12345);
+                std::normal_distribution<double> normal_dist(0.0, 1.0);
+                std::vector<double> w_minus(M), w_plus(M, 0.0);
+                for(int i=0; i<M; i++)
+                    w_minus[i] = 0.5*chi_n*normal_dist(generator)*0.2;
+
+                int total_iterations = 0;
+                double error_level;
+                auto chrono_start = std::chrono::system_clock::now();
+                for(int step=0; step<n_langevin_steps; step++)
+                {
+                    for(int i=0; i<M; i++)
+                        w_minus[i] += 0.3*normal_dist(generator);
+                    int n_iter = find_saddle_point(solver, compressor, random_fractions, w_minus, w_plus, error_level);
+                    total_iterations += n_iter;
+                    if (!std::isfinite(error_level) || error_level >= tolerance)
+                    {
+                        std::cout << polymers << ", " << method << ": the saddle point is not found at step " << step << std::endl;
+                        return -1;
+                    }
+                }
+                std::chrono::duration<double> time_duration = std::chrono::system_clock::now() - chrono_start;
+                mean_iterations.push_back(static_cast<double>(total_iterations)/n_langevin_steps);
+
+                std::cout << polymers << ", " << method << ": saddle point iterations per Langevin step, time (s): "
+                    << mean_iterations.back() << ", " << time_duration.count() << std::endl;
+
+                delete compressor;
+                delete anderson_mixing;
+            }
+            // The linear-response compressor should take fewer iterations than Anderson mixing
+            if (mean_iterations[1] >= mean_iterations[0] || mean_iterations[2] >= mean_iterations[0])
+                return -1;
+
+            delete molecules;
+            delete propagator_analyzer;
+            delete solver;
+        }
+
+        // Invalid parameters
+        try
+        {
+            Molecules* molecules = factory->create_molecules_information("Continuous", ds, {{"A",1.0}, {"B",1.0}});
+            LinearResponseCompressor *compressor = factory->create_linear_response_compressor(cb, molecules, {"A","B"}, {{1.0},{1.0}}, {0.0, 0.0});
+            delete compressor;
+            delete molecules;
+            return -1;
+        }
+        catch(std::exception& exc)
+        {
+            std::cout << exc.what() << std::endl;
+        }
+
+        delete cb;
+        delete factory;
+        return 0;
+    }
+    catch(std::exception& exc)
+    {
+        std::cout << exc.what() << std::endl;
+        return -1;
+    }
+}
@@ -0,0 +1,193 @@
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "Exception.h"
+#include "ComputationBox.h"
+#include "Polymer.h"
+#include "Molecules.h"
+#include "PropagatorAnalyzer.h"
+#include "PropagatorComputation.h"
+#include "AndersonMixing.h"
+#include "NewtonKrylov.h"
+#include "AbstractFactory.h"
+#include "PlatformSelector.h"
+#include "Pseudo.h"
+
+int main()
+{
+    try
+    {
+        // Math constants
+        const double PI = 3.14159265358979323846;
+
+        const int max_scft_iter = 1000;
+        const double tolerance = 1e-8;
+
+        double f = 0.3;
+        std::vector<int> nx = {32};
+        std::vector<double> lx = {1.6};
+        double ds = 1.0/20;
+
+        int am_max_hist = 20;
+        double am_start_error = 8e-1;
+        double am_mix_min = 0.1;
+        double am_mix_init = 0.1;
+
+        int max_krylov = 20;
+        double newton_start_error = 1e-1;
+
+        std::vector<BlockInput> blocks =
+        {
+            {"A",    f, 0, 1},
+            {"B",1.0-f, 1, 2},
+        };
+
+        AbstractFactory *factory = PlatformSelector::create_factory("cpu-mkl", false);
+        ComputationBox *cb = factory->create_computation_box(nx, lx, {});
+        Molecules* molecules = factory->create_molecules_information("Continuous", ds, {{"A",1.0}, {"B",1.0}});
+        molecules->add_polymer(1.0, blocks, {});
+        PropagatorAnalyzer* propagator_analyzer = new PropagatorAnalyzer(molecules, false);
+        PropagatorComputation *solver = factory->create_pseudospectral_solver(cb, molecules, propagator_analyzer);
+
+        const int M = cb->get_n_grid();
+        const int M_COMPLEX = Pseudo::get_n_complex_grid(nx);
+        std::vector<double> w(2*M), w_out(2*M), w_diff(2*M), phi_a(M), phi_b(M);
+
+        // Run SCFT, and return the number of w_deriv evaluations, the free energy and the error level
+        auto run_scft = [&](AndersonMixing* optimizer, double chi_n, double& energy_total, double& error_level) -> int
+        {
+            for(int i=0; i<M; i++)
+            {
+                phi_a[i] = cos(2.0*PI*i/M)*0.2;
+                phi_b[i] = 1.0 - phi_a[i];
+                w[i]   = chi_n*phi_b[i];
+                w[i+M] = chi_n*phi_a[i];
+            }
+            cb->zero_mean(&w[0]);
+            cb->zero_mean(&w[M]);
+
+            optimizer->reset_count();
+            error_level = 1.0e20;
+            double old_error_level;
+            int iter;
+            for(iter=0; iter<max_scft_iter; iter++)
+            {
+                solver->compute_propagators({{"A",&w[0]},{"B",&w[M]}},{});
+                solver->compute_concentrations();
+                solver->get_total_concentration("A", phi_a.data());
+                solver->get_total_concentration("B", phi_b.data());
+
+                energy_total = -log(solver->get_total_partition(0));
+                for(int i=0; i<M; i++)
+                {
+                    double w_minus = (w[i]-w[i+M])/2;
+                    double w_plus  = (w[i]+w[i+M])/2;
+                    energy_total += (w_minus*w_minus/chi_n - w_plus)/M;
+
+                    double xi = 0.5*(w[i]+w[i+M]-chi_n);
+                    w_out[i]   = chi_n*phi_b[i] + xi;
+                    w_out[i+M] = chi_n*phi_a[i] + xi;
+                }
+                cb->zero_mean(&w_out[0]);
+                cb->zero_mean(&w_out[M]);
+
+                old_error_level = error_level;
+                for(int i=0; i<2*M; i++)
+                    w_diff[i] = w_out[i]- w[i];
+                error_level = sqrt(cb->multi_inner_product(2,w_diff.data(),w_diff.data())/
+                                (cb->multi_inner_product(2,w.data(),w.data())+1.0));
+
+                if(error_level < tolerance) break;
+                optimizer->calculate_new_fields(w.data(), w.data(), w_diff.data(), old_error_level, error_level);
+            }
+            return iter;
+        };
+
+        for(double chi_n : {25.0, 40.0})
+        {
+            std::vector<std::string> methods = {"Anderson mixing", "Newton-Krylov", "Newton-Krylov, preconditioned"};
+            std::vector<int> n_evaluations;
+            std::vector<double> free_energies;
+            for(const std::string& method : methods)
+            {
+                AndersonMixing *optimizer;
+                if (method == "Anderson mixing")
+                    optimizer = factory->create_anderson_mixing(2*M, am_max_hist, am_start_error, am_mix_min, am_mix_init);
+                else
+                {
+                    NewtonKrylov *newton_krylov = factory->create_newton_krylov(2*M, max_krylov, newton_start_error, am_mix_min, am_mix_init, 0.1);
+                    // At large wavenumbers, w_out does not depend on w, and the Jacobian approaches -I.
+                    // The diagonal kernel -(1 + c/(1 + k^2 R_g^2)) slightly enhances the low wavenumber modes.
+                    if (method == "Newton-Krylov, preconditioned")
+                    {
+                        std::vector<double> kernel(2*2*M_COMPLEX, 0.0);
+                        for(int k=0; k<M_COMPLEX; k++)
+                        {
+                            double kk = std::pow(2.0*PI*k/lx[0], 2);
+                            double value = -1.0/(1.0 + 1.0/(1.0 + kk/6.0));
+                            kernel[(0*2+0)*M_COMPLEX + k] = value;
+                            kernel[(1*2+1)*M_COMPLEX + k] = value;
+                        }
+                        newton_krylov->set_fourier_preconditioner(nx, 2, kernel);
+                    }
+                    optimizer = newton_krylov;
+                }
+
+                double energy_total, error_level;
+                auto chrono_start = std::chrono::system_clock::now();
+                int n_eval = run_scft(optimizer, chi_n, energy_total, error_level);
+                std::chrono::duration<double> time_duration = std::chrono::system_clock::now() - chrono_start;
+
+                std::cout << "chi_n: " << chi_n << ", " << method << ": w_deriv evaluations, error level, free energy, time (s): "
+                    << n_eval << ", " << std::scientific << error_level << ", " << std::setprecision(12) << energy_total << ", "
+                    << std::defaultfloat << time_duration.count();
+                NewtonKrylov *newton_krylov = dynamic_cast<NewtonKrylov*>(optimizer);
+                if (newton_krylov != nullptr)
+                    std::cout << ", Newton steps: " << newton_krylov->get_n_newton_steps();
+                std::cout << std::endl;
+
+                n_evaluations.push_back(n_eval);
+                free_energies.push_back(energy_total);
+                delete optimizer;
+
+                if (!std::isfinite(error_level) || error_level >= tolerance)
+                    return -1;
+            }
+            // All methods should converge to the same solution
+            for(size_t m=1; m<methods.size(); m++)
+            {
+                if (std::abs(free_energies[m]-free_energies[0]) > 1e-7)
+                    return -1;
+            }
+        }
+
+        // Invalid parameters
+        try
+        {
+            NewtonKrylov *newton_krylov = factory->create_newton_krylov(2*M, max_krylov, newton_start_error, am_mix_min, am_mix_init, 1.5);
+            delete newton_krylov;
+            return -1;
+        }
+        catch(std::exception& exc)
+        {
+            std::cout << exc.what() << std::endl;
+        }
+
+        delete molecules;
+        delete propagator_analyzer;
+        delete cb;
+        delete solver;
+        delete factory;
+        return 0;
+    }
+    catch(std::exception& exc)
+    {
+        std::cout << exc.what() << std::endl;
+        return -1;
+    }
+}
@@ -110,6 +110,37 @@ int main()
         // if(PropagatorCode::get_monomer_type_from_key(key) != "B")
         //     return -1;
 
+        // Polydisperse polymers. Propagators from the free ends are shared by all chain lengths,
+        // so they are computed once up to the longest chain.
+        for(bool aggregate_propagator_computation: {false, true})
+        {
+            Molecules molecules_disperse("continuous", 0.1, {{"A",1.0}, {"B",1.0}});
+
+            // Homopolymers. 0.8 and 0.81 are merged.
+            int n_added = molecules_disperse.add_polymer_length_distribution(
+                0.4, {{"A", 1.0, 0, 1}}, 0, {0.5, 0.8, 0.81, 1.2}, {1.0, 1.0, 1.0, 1.0});
+            if (n_added != 3 || molecules_disperse.get_n_polymer_types() != 3)
+                return -1;
+            if (std::abs(molecules_disperse.get_polymer(1).get_volume_fraction()-0.2) > 1e-12)
+                return -1;
+
+            // Diblock copolymers whose B blocks are polydisperse
+            molecules_disperse.add_polymer_length_distribution(
+                0.6, {{"A", 0.5, 0, 1}, {"B", 0.5, 1, 2}}, 1, {0.3, 0.5, 0.7}, {0.2, 0.5, 0.3});
+            PropagatorAnalyzer propagator_analyzer_disperse(&molecules_disperse, aggregate_propagator_computation);
+            propagator_analyzer_disperse.display_propagators();
+
+            // A, B, (A5)B, (B3)A, (B5)A, and (B7)A
+            if (propagator_analyzer_disperse.get_n_computation_propagator_codes() != 6)
+                return -1;
+            if (propagator_analyzer_disperse.get_computation_propagator("A").max_n_segment != 12)
+                return -1;
+            if (propagator_analyzer_disperse.get_computation_propagator("(A5)B").max_n_segment != 7)
+                return -1;
+            if (propagator_analyzer_disperse.get_n_segment_steps() != 12+7+7+3*5)
+                return -1;
+        }
+
         return 0;
     }
     catch(std::exception& exc)
@@ -0,0 +1,102 @@
+import sys
+import gc
+import numpy as np
+from langevinfts import *
+
+# Output arrays (out=), read-only views of concentrations, and rejection of inputs
+# that are not C-contiguous float64 NumPy arrays.
+
+nx = [8,8,8]
+lx = [2.0,2.5,3.0]
+M = np.prod(nx)
+
+factory = PlatformSelector.create_factory("cpu-mkl", False)
+cb = factory.create_computation_box(nx, lx)
+molecules = factory.create_molecules_information("continuous", 0.05, {"A":1.0, "B":1.5})
+molecules.add_polymer(0.7, [["A", 0.4, 0, 1], ["B", 0.6, 1, 2]])
+molecules.add_solvent(0.3, "B")
+propagator_analyzer = factory.create_propagator_analyzer(molecules, False)
+solver = factory.create_pseudospectral_solver(cb, molecules, propagator_analyzer)
+
+np.random.seed(1234)
+w = {"A": np.random.normal(0.0, 1.0, M), "B": np.random.normal(0.0, 1.0, M)}
+solver.compute_statistics(w)
+
+#---------------- out= --------------------
+phi_a = solver.get_total_concentration("A")
+out = np.empty(M)
+ret = solver.get_total_concentration("A", out=out)
+if ret is not out or not np.array_equal(out, phi_a):
+    print("get_total_concentration(out=) does not write into 'out'")
+    sys.exit(-1)
+
+phi_block = solver.get_block_concentration(0)
+out_block = np.zeros_like(phi_block)
+solver.get_block_concentration(0, out=out_block)
+if not np.array_equal(out_block, phi_block):
+    print("get_block_concentration(out=) does not write into 'out'")
+    sys.exit(-1)
+
+# Invalid outputs: wrong size, wrong dtype, non-contiguous and read-only arrays
+for bad_out in [np.empty(M+1), np.empty(M, dtype=np.float32), np.empty(2*M)[::2], np.empty(M)]:
+    if bad_out.size == M and bad_out.dtype == np.float64 and bad_out.flags.c_contiguous:
+        bad_out.setflags(write=False)
+    try:
+        solver.get_total_concentration("A", out=bad_out)
+        print("An invalid output array is accepted")
+        sys.exit(-1)
+    except Exception as exc:
+        print(exc)
+
+#---------------- Views --------------------
+phi_solvent = solver.get_solvent_concentration(0)
+view_solvent = solver.get_solvent_concentration_view(0)
+views_block = solver.get_block_concentration_views()
+if not np.array_equal(view_solvent, phi_solvent) or view_solvent.flags.writeable:
+    print("The solvent view is wrong or writeable")
+    sys.exit(-1)
+if len(views_block) != phi_block.shape[0]:
+    print("The number of block views is wrong")
+    sys.exit(-1)
+for key, view in views_block.items():
+    if view.flags.writeable or not any(np.array_equal(view, row) for row in phi_block):
+        print("The block view", key, "is wrong or writeable")
+        sys.exit(-1)
+try:
+    view_solvent[0] = 0.0
+    print("A view is writeable")
+    sys.exit(-1)
+except ValueError as exc:
+    print(exc)
+
+# Views keep the solver alive
+del solver
+gc.collect()
+if not np.array_equal(view_solvent, phi_solvent):
+    print("The view is invalid after the solver is deleted")
+    sys.exit(-1)
+for key, view in views_block.items():
+    if not any(np.array_equal(view, row) for row in phi_block):
+        print("The block view", key, "is invalid after the solver is deleted")
+        sys.exit(-1)
+solver = factory.create_pseudospectral_solver(cb, molecules, propagator_analyzer)
+
+#---------------- Rejected inputs --------------------
+w_strided = np.random.normal(0.0, 1.0, 2*M)[::2]
+for bad_w in [w["A"].astype(np.float32), w_strided, list(w["A"]), w["A"].astype(np.int64)]:
+    try:
+        solver.compute_statistics({"A":bad_w, "B":w["B"]})
+        print("An invalid input array is accepted")
+        sys.exit(-1)
+    except Exception as exc:
+        print(exc)
+try:
+    cb.integral(w_strided)
+    print("An invalid input array is accepted")
+    sys.exit(-1)
+except Exception as exc:
+    print(exc)
+
+# The same values are accepted after conversion
+solver.compute_statistics({"A":np.ascontiguousarray(w["A"].astype(np.float32), dtype=np.float64), "B":w["B"]})
+cb.integral(np.ascontiguousarray(w_strided))
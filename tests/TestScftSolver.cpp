@@ -0,0 +1,184 @@
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "Exception.h"
+#include "ComputationBox.h"
+#include "Polymer.h"
+#include "Molecules.h"
+#include "PropagatorAnalyzer.h"
+#include "PropagatorComputation.h"
+#include "AndersonMixing.h"
+#include "ScftSolver.h"
+#include "AbstractFactory.h"
+#include "PlatformSelector.h"
+
+int main()
+{
+    try
+    {
+        // Math constants
+        const double PI = 3.14159265358979323846;
+
+        const int max_scft_iter = 2000;
+        const double tolerance = 1e-8;
+
+        double f = 0.3;
+        double chi_n = 18.0;
+        std::vector<int> nx = {32};
+        std::vector<double> lx = {1.6};
+        double ds = 1.0/20;
+
+        int am_max_hist = 20;
+        double am_start_error = 8e-1;
+        double am_mix_min = 0.1;
+        double am_mix_init = 0.1;
+
+        std::vector<std::vector<double>> matrix_chi = {{0.0, chi_n}, {chi_n, 0.0}};
+        std::vector<std::vector<double>> matrix_p = {{0.5, -0.5}, {-0.5, 0.5}};
+
+        AbstractFactory *factory = PlatformSelector::create_factory("cpu-mkl", false);
+        ComputationBox *cb = factory->create_computation_box(nx, lx, {});
+        Molecules* molecules = factory->create_molecules_information("Continuous", ds, {{"A",1.0}, {"B",1.0}});
+        molecules->add_polymer(1.0, {{"A",f,0,1}, {"B",1.0-f,1,2}}, {});
+        PropagatorAnalyzer* propagator_analyzer = new PropagatorAnalyzer(molecules, false);
+        PropagatorComputation *solver = factory->create_pseudospectral_solver(cb, molecules, propagator_analyzer);
+
+        const int M = cb->get_n_grid();
+        std::vector<double> w_init(2*M), w(2*M), w_diff(2*M), phi_a(M), phi_b(M);
+        for(int i=0; i<M; i++)
+        {
+            double phi_a_init = cos(2.0*PI*i/M)*0.2;
+            w_init[i]   = chi_n*(1.0-phi_a_init);
+            w_init[i+M] = chi_n*phi_a_init;
+        }
+
+        //-------------- Reference SCFT iterations --------------
+        int n_iter_ref;
+        double energy_ref = 0.0, error_level = 1.0e20, old_error_level;
+        {
+            AndersonMixing *am = factory->create_anderson_mixing(2*M, am_max_hist, am_start_error, am_mix_min, am_mix_init);
+            w = w_init;
+            cb->zero_mean(&w[0]);
+            cb->zero_mean(&w[M]);
+            auto chrono_start = std::chrono::system_clock::now();
+            for(n_iter_ref=1; n_iter_ref<=max_scft_iter; n_iter_ref++)
+            {
+                solver->compute_propagators({{"A",&w[0]},{"B",&w[M]}},{});
+                solver->compute_concentrations();
+                solver->get_total_concentration("A", phi_a.data());
+                solver->get_total_concentration("B", phi_b.data());
+
+                energy_ref = -log(solver->get_total_partition(0));
+                for(int i=0; i<M; i++)
+                {
+                    double w_minus = (w[i]-w[i+M])/2;
+                    double w_plus  = (w[i]+w[i+M])/2;
+                    energy_ref += (w_minus*w_minus/chi_n - w_plus)/M;
+
+                    w_diff[i]   = chi_n*phi_b[i] - w_minus;
+                    w_diff[i+M] = chi_n*phi_a[i] + w_minus;
+                }
+                cb->zero_mean(&w_diff[0]);
+                cb->zero_mean(&w_diff[M]);
+
+                old_error_level = error_level;
+                error_level = sqrt(cb->multi_inner_product(2,w_diff.data(),w_diff.data())/
+                                (cb->multi_inner_product(2,w.data(),w.data())+1.0));
+                if(error_level < tolerance) break;
+
+                am->calculate_new_fields(w.data(), w.data(), w_diff.data(), old_error_level, error_level);
+                cb->zero_mean(&w[0]);
+                cb->zero_mean(&w[M]);
+            }
+            std::chrono::duration<double> time_duration = std::chrono::system_clock::now() - chrono_start;
+            std::cout << "Reference: iterations, error level, free energy, time (s): " << n_iter_ref << ", "
+                << std::scientific << error_level << ", " << std::setprecision(12) << energy_ref << ", "
+                << std::defaultfloat << time_duration.count() << std::endl;
+            delete am;
+        }
+
+        //-------------- ScftSolver --------------
+        {
+            AndersonMixing *am = factory->create_anderson_mixing(2*M, am_max_hist, am_start_error, am_mix_min, am_mix_init);
+            ScftSolver scft(cb, molecules, solver, am, {"A","B"}, matrix_chi, matrix_p, false, max_scft_iter, tolerance, 1.0, 1);
+            scft.set_fields(w_init.data());
+            auto chrono_start = std::chrono::system_clock::now();
+            int n_iter = scft.run();
+            std::chrono::duration<double> time_duration = std::chrono::system_clock::now() - chrono_start;
+            std::cout << "ScftSolver: iterations, error level, free energy, time (s): " << n_iter << ", "
+                << std::scientific << scft.get_error_level() << ", " << std::setprecision(12) << scft.get_free_energy() << ", "
+                << std::defaultfloat << time_duration.count() << std::endl;
+
+            // The same solution as the reference. The numbers of iterations can be slightly different,
+            // since rounding errors of the residuals are amplified by Anderson mixing.
+            if (std::abs(n_iter - n_iter_ref) > 5 || scft.get_error_level() >= tolerance)
+                return -1;
+            if (std::abs(scft.get_free_energy() - energy_ref) > 1e-9)
+                return -1;
+
+            // Fields and concentrations of the converged solution
+            std::vector<double> w_out(2*M), phi_out(2*M);
+            scft.get_fields(w_out.data());
+            scft.get_concentrations(phi_out.data());
+            double max_diff = 0.0;
+            for(int i=0; i<2*M; i++)
+                max_diff = std::max(max_diff, std::abs(w_out[i]-w[i]));
+            for(int i=0; i<M; i++)
+                max_diff = std::max(max_diff, std::abs(phi_out[i]-phi_a[i]) + std::abs(phi_out[i+M]-phi_b[i]));
+            std::cout << "Maximum difference of fields and concentrations: " << max_diff << std::endl;
+            if (max_diff > 1e-6)
+                return -1;
+            delete am;
+        }
+
+        //-------------- ScftSolver with box relaxation --------------
+        {
+            AndersonMixing *am = factory->create_anderson_mixing(2*M+1, am_max_hist, am_start_error, am_mix_min, am_mix_init);
+            ScftSolver scft(cb, molecules, solver, am, {"A","B"}, matrix_chi, matrix_p, true, max_scft_iter, 1e-6, 1.0, 1);
+            scft.set_fields(w_init.data());
+            int n_iter = scft.run();
+            solver->compute_stress();
+            double stress = solver->get_stress()[0];
+            std::cout << "ScftSolver with box relaxation: iterations, error level, free energy, lx, stress: " << n_iter << ", "
+                << std::scientific << scft.get_error_level() << ", " << std::setprecision(12) << scft.get_free_energy() << ", "
+                << cb->get_lx(0) << ", " << std::defaultfloat << stress << std::endl;
+
+            // The box relaxation lowers the free energy
+            if (scft.get_error_level() >= 1e-6 || std::abs(stress) > 1e-6 || std::abs(cb->get_lx(0)-lx[0]) < 1e-3)
+                return -1;
+            if (scft.get_free_energy() >= energy_ref)
+                return -1;
+            delete am;
+        }
+
+        // Invalid number of variables
+        try
+        {
+            AndersonMixing *am = factory->create_anderson_mixing(2*M, am_max_hist, am_start_error, am_mix_min, am_mix_init);
+            ScftSolver scft(cb, molecules, solver, am, {"A","B"}, matrix_chi, matrix_p, true, max_scft_iter, tolerance);
+            delete am;
+            return -1;
+        }
+        catch(std::exception& exc)
+        {
+            std::cout << exc.what() << std::endl;
+        }
+
+        delete molecules;
+        delete propagator_analyzer;
+        delete cb;
+        delete solver;
+        delete factory;
+        return 0;
+    }
+    catch(std::exception& exc)
+    {
+        std::cout << exc.what() << std::endl;
+        return -1;
+    }
+}
@@ -1,5 +1,8 @@
 #include <iostream>
 #include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <unistd.h>
 
 #include "Molecules.h"
 #include "PropagatorAnalyzer.h"
@@ -48,7 +51,193 @@ int main()
 
         Scheduler sc(propagator_analyzer.get_computation_propagators(), 4);
 
-        sc.display(propagator_analyzer.get_computation_propagators());
+        sc.display();
+
+        // Check that every segment is computed once and in order, and dependencies are resolved before each time span.
+        // Blocks must be computed after both propagators are finished.
+        auto is_valid_schedule = [&propagator_analyzer](Scheduler& sc) -> bool
+        {
+            auto& computation_propagators = propagator_analyzer.get_computation_propagators();
+            std::map<std::string, int> computed; // the last computed segment
+            for(const auto& item: computation_propagators)
+                computed[item.first] = -1;
+            auto& schedule = sc.get_schedule();
+            for(size_t i=0; i<schedule.size(); i++)
+            {
+                auto computed_before = computed;
+                for(const auto& job: schedule[i])
+                {
+                    const std::string& key = std::get<0>(job);
+                    if (std::get<1>(job) == 0)
+                    {
+                        if (computed_before[key] != -1)
+                            return false;
+                        for(const auto& dep: computation_propagators[key].deps)
+                        {
+                            if (computed_before[std::get<0>(dep)] < std::get<1>(dep))
+                                return false;
+                        }
+                    }
+                    else if (computed_before[key] != std::get<1>(job))
+                        return false;
+                    computed[key] = std::get<2>(job);
+                }
+                if (i < sc.get_finished_blocks().size())
+                {
+                    for(const auto& block: sc.get_finished_blocks()[i])
+                    {
+                        if (computed[std::get<1>(block)] != computation_propagators[std::get<1>(block)].max_n_segment ||
+                            computed[std::get<2>(block)] != computation_propagators[std::get<2>(block)].max_n_segment)
+                            return false;
+                    }
+                }
+            }
+            for(const auto& item: computation_propagators)
+            {
+                if (computed[item.first] != item.second.max_n_segment)
+                    return false;
+            }
+            return true;
+        };
+        if (!is_valid_schedule(sc))
+            return -1;
+
+        // Coarsening of time spans
+        for(double barrier_cost: {0.0, 1e9})
+        {
+            Scheduler sc_coarse(propagator_analyzer.get_computation_propagators(), 4);
+            sc_coarse.coarsen_schedule(barrier_cost);
+            std::cout << "Barrier cost: " << barrier_cost << ", the number of time spans: " << sc.get_schedule().size() << " -> " << sc_coarse.get_schedule().size() << std::endl;
+            if (!is_valid_schedule(sc_coarse))
+                return -1;
+            if (sc_coarse.get_schedule().size() > sc.get_schedule().size())
+                return -1;
+            if (sc_coarse.get_planned_makespan() != sc.get_planned_makespan())
+                return -1;
+        }
+
+        // Every propagator is assigned to one stream
+        size_t n_queued = 0;
+        for(const auto& job_queue: sc.get_stream_job_queues())
+            n_queued += job_queue.size();
+        if (n_queued != propagator_analyzer.get_computation_propagators().size())
+            return -1;
+
+        // Memory-aware scheduling. A budget must never make the peak larger than no budget.
+        // 170 is a feasible budget. 1 is smaller than every propagator, so it tests the fallback when no propagator fits.
+        Scheduler sc_unbounded(
+            propagator_analyzer.get_computation_propagators(),
+            propagator_analyzer.get_computation_blocks(), 4, 0);
+        std::vector<int> budgets = {0, 170, sc.get_peak_live_segments()/3, 1};
+        for(int max_live_segments: budgets)
+        {
+            Scheduler sc_memory(
+                propagator_analyzer.get_computation_propagators(),
+                propagator_analyzer.get_computation_blocks(), 4, max_live_segments);
+
+            std::cout << "Budget: " << max_live_segments << ", peak number of live segments: " << sc_memory.get_peak_live_segments() << std::endl;
+            if (sc_memory.get_peak_live_segments() > sc.get_peak_live_segments())
+                return -1;
+            if (sc_memory.get_peak_live_segments() > sc_unbounded.get_peak_live_segments())
+                return -1;
+            if (max_live_segments == 170 && sc_memory.get_peak_live_segments() > max_live_segments)
+                return -1;
+
+            // Every segment must be computed exactly once, and every block and propagator must appear once
+            std::map<std::string, int> n_computed;
+            for(const auto& parallel_job: sc_memory.get_schedule())
+            {
+                for(const auto& job: parallel_job)
+                    n_computed[std::get<0>(job)] += std::get<2>(job) - std::get<1>(job);
+            }
+            for(const auto& item: propagator_analyzer.get_computation_propagators())
+            {
+                if (n_computed[item.first] != item.second.max_n_segment)
+                    return -1;
+            }
+            size_t n_blocks = 0, n_released = 0;
+            for(size_t i=0; i<sc_memory.get_schedule().size(); i++)
+            {
+                n_blocks += sc_memory.get_finished_blocks()[i].size();
+                n_released += sc_memory.get_released_propagators()[i].size();
+            }
+            if (n_blocks != propagator_analyzer.get_computation_blocks().size())
+                return -1;
+            if (n_released != propagator_analyzer.get_computation_propagators().size())
+                return -1;
+            if (!is_valid_schedule(sc_memory))
+                return -1;
+
+            // Coarsening must not increase the peak number of live segments
+            int peak_live_segments = sc_memory.get_peak_live_segments();
+            size_t n_spans = sc_memory.get_schedule().size();
+            sc_memory.coarsen_schedule(1e9);
+            std::cout << "\tthe number of time spans after coarsening: " << n_spans << " -> " << sc_memory.get_schedule().size() << std::endl;
+            if (!is_valid_schedule(sc_memory))
+                return -1;
+            if (sc_memory.get_peak_live_segments() != peak_live_segments)
+                return -1;
+            n_blocks = 0; n_released = 0;
+            for(size_t i=0; i<sc_memory.get_schedule().size(); i++)
+            {
+                n_blocks += sc_memory.get_finished_blocks()[i].size();
+                n_released += sc_memory.get_released_propagators()[i].size();
+            }
+            if (n_blocks != propagator_analyzer.get_computation_blocks().size())
+                return -1;
+            if (n_released != propagator_analyzer.get_computation_propagators().size())
+                return -1;
+        }
+
+        // Cache of propagator analysis and schedule
+        char cache_dir[] = "/tmp/lfts_cache_XXXXXX";
+        if (mkdtemp(cache_dir) == nullptr)
+            return -1;
+        setenv("LFTS_CACHE_DIR", cache_dir, 1);
+        {
+            PropagatorAnalyzer analyzer_saved(&molecules, true);
+            PropagatorAnalyzer analyzer_loaded(&molecules, true);
+            if (analyzer_loaded.get_n_computation_propagator_codes() != analyzer_saved.get_n_computation_propagator_codes())
+                return -1;
+            for(const auto& item: analyzer_saved.get_computation_propagators())
+            {
+                const ComputationEdge& edge = analyzer_loaded.get_computation_propagator(item.first);
+                if (edge.max_n_segment != item.second.max_n_segment || edge.deps != item.second.deps ||
+                    edge.junction_ends != item.second.junction_ends || edge.dep_ids != item.second.dep_ids)
+                    return -1;
+            }
+            if (analyzer_loaded.get_computation_blocks().size() != analyzer_saved.get_computation_blocks().size())
+                return -1;
+            for(const auto& item: analyzer_saved.get_computation_blocks())
+            {
+                const ComputationBlock& block = analyzer_loaded.get_computation_block(item.first);
+                if (block.n_segment_left != item.second.n_segment_left || block.n_segment_right != item.second.n_segment_right ||
+                    block.n_repeated != item.second.n_repeated || block.v_u != item.second.v_u)
+                    return -1;
+            }
+
+            Scheduler sc_saved(
+                analyzer_saved.get_computation_propagators(),
+                analyzer_saved.get_computation_blocks(), 4, 0);
+            Scheduler sc_loaded(
+                analyzer_loaded.get_computation_propagators(),
+                analyzer_loaded.get_computation_blocks(), 4, 0);
+            if (sc_loaded.get_schedule() != sc_saved.get_schedule() ||
+                sc_loaded.get_stream_job_queues() != sc_saved.get_stream_job_queues() ||
+                sc_loaded.get_checkpoints() != sc_saved.get_checkpoints() ||
+                sc_loaded.get_finished_blocks() != sc_saved.get_finished_blocks() ||
+                sc_loaded.get_released_propagators() != sc_saved.get_released_propagators() ||
+                sc_loaded.get_peak_live_segments() != sc_saved.get_peak_live_segments() ||
+                sc_loaded.get_planned_makespan() != sc_saved.get_planned_makespan())
+                return -1;
+
+            // A different number of streams must not use the cached schedule
+            Scheduler sc_other(analyzer_loaded.get_computation_propagators(), 3);
+            if (sc_other.get_stream_job_queues().size() != 3)
+                return -1;
+        }
+        unsetenv("LFTS_CACHE_DIR");
+        std::system(("rm -rf " + std::string(cache_dir)).c_str());
 
         return 0;
     }
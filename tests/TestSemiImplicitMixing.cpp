@@ -0,0 +1,289 @@
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "Exception.h"
+#include "ComputationBox.h"
+#include "Polymer.h"
+#include "Molecules.h"
+#include "PropagatorAnalyzer.h"
+#include "PropagatorComputation.h"
+#include "AndersonMixing.h"
+#include "SemiImplicitMixing.h"
+#include "AbstractFactory.h"
+#include "PlatformSelector.h"
+#include "Pseudo.h"
+#include "Rpa.h"
+
+int main()
+{
+    try
+    {
+        // Math constants
+        const double PI = 3.14159265358979323846;
+
+        const int max_scft_iter = 2000;
+        const double tolerance = 1e-8;
+
+        double f = 0.3;
+        std::vector<int> nx = {32};
+        std::vector<double> lx = {1.6};
+        double ds = 1.0/20;
+
+        int am_max_hist = 20;
+        double am_start_error = 8e-1;
+        double am_mix_min = 0.1;
+        double am_mix_init = 0.1;
+
+        double sis_lambda = 2.0;
+
+        std::vector<BlockInput> blocks =
+        {
+            {"A",    f, 0, 1},
+            {"B",1.0-f, 1, 2},
+        };
+
+        AbstractFactory *factory = PlatformSelector::create_factory("cpu-mkl", false);
+
+        //-------------- Correlation functions --------------
+        {
+            const int K = 50;
+            std::vector<double> k_square(K);
+            for(int k=0; k<K; k++)
+                k_square[k] = 0.2*k*k;
+
+            // Debye function of a continuous chain
+            auto debye = [](double k_sq, double length) -> double
+            {
+                double x = k_sq/6.0;
+                if (x*length == 0.0)
+                    return length*length;
+                return 2.0*(exp(-x*length) + x*length - 1.0)/(x*x);
+            };
+
+            // Linear chain with four blocks. The sum of all S_ij is the Debye function of the whole chain.
+            std::vector<std::string> monomer_types = {"A", "B", "C"};
+            for(std::string model : {"Continuous", "Discrete"})
+            {
+                Molecules* molecules = factory->create_molecules_information(model, 1.0/1000, {{"A",1.0}, {"B",1.0}, {"C",1.0}});
+                molecules->add_polymer(0.7, {{"A",0.3,0,1}, {"B",0.2,1,2}, {"C",0.4,2,3}, {"A",0.1,3,4}}, {});
+                molecules->add_polymer(0.3, {{"B",0.5,0,1}}, {});
+                std::vector<double> s_ij(3*3*K);
+                Rpa::get_correlation_functions(molecules, monomer_types, k_square.data(), K, s_ij.data());
+
+                double max_error = 0.0;
+                for(int k=0; k<K; k++)
+                {
+                    double s_total = 0.0;
+                    for(int i=0; i<3*3; i++)
+                        s_total += s_ij[i*K+k];
+                    double s_exact = 0.7*debye(k_square[k], 1.0) + 0.3/0.5*debye(k_square[k], 0.5);
+                    max_error = std::max(max_error, std::abs(s_total-s_exact)/s_exact);
+                    // Symmetry
+                    for(int i=0; i<3; i++)
+                        for(int j=0; j<3; j++)
+                            if (s_ij[(i*3+j)*K+k] != s_ij[(j*3+i)*K+k])
+                                return -1;
+                }
+                // At k=0, sum_ij S_ij = sum_p volume_fraction_p*alpha_p
+                double s_total_zero = 0.0;
+                for(int i=0; i<3*3; i++)
+                    s_total_zero += s_ij[i*K];
+                std::cout << model << ": sum of S_ij(0), maximum relative error of sum of S_ij(k): "
+                    << std::setprecision(12) << s_total_zero << ", " << std::defaultfloat << max_error << std::endl;
+                if (std::abs(s_total_zero - (0.7*1.0 + 0.3*0.5)) > 1e-12)
+                    return -1;
+                // Discrete chains approach continuous chains as ds -> 0
+                if (max_error > (model == "Continuous" ? 1e-12 : 1e-2))
+                    return -1;
+                delete molecules;
+            }
+
+            // Star polymer with a solvent
+            Molecules* molecules = factory->create_molecules_information("Continuous", 1.0/100, {{"A",1.0}, {"B",1.5}});
+            molecules->add_polymer(0.8, {{"A",0.2,0,1}, {"B",0.3,0,2}, {"A",0.5,0,3}}, {});
+            molecules->add_solvent(0.2, "B");
+            std::vector<double> s_ij(2*2*K);
+            Rpa::get_correlation_functions(molecules, {"A","B"}, k_square.data(), K, s_ij.data());
+            double s_total_zero = s_ij[0] + s_ij[K] + s_ij[2*K] + s_ij[3*K];
+            if (std::abs(s_total_zero - (0.8*1.0 + 0.2*0.01)) > 1e-12)
+                return -1;
+            for(int k=1; k<K; k++)
+            {
+                // Arms of A are connected at the center
+                double x = k_square[k]/6.0;
+                double s_aa = 0.8*(debye(k_square[k], 0.2) + debye(k_square[k], 0.5)
+                    + 2.0*(1.0-exp(-x*0.2))/x*(1.0-exp(-x*0.5))/x);
+                if (std::abs(s_ij[k] - s_aa) > 1e-12*s_aa)
+                    return -1;
+            }
+            delete molecules;
+        }
+
+        //-------------- SCFT --------------
+        ComputationBox *cb = factory->create_computation_box(nx, lx, {});
+        Molecules* molecules = factory->create_molecules_information("Continuous", ds, {{"A",1.0}, {"B",1.0}});
+        molecules->add_polymer(1.0, blocks, {});
+        PropagatorAnalyzer* propagator_analyzer = new PropagatorAnalyzer(molecules, false);
+        PropagatorComputation *solver = factory->create_pseudospectral_solver(cb, molecules, propagator_analyzer);
+
+        const int M = cb->get_n_grid();
+        std::vector<double> w(2*M), w_diff(2*M), phi_a(M), phi_b(M);
+
+        // Run SCFT, and return the number of iterations, the free energy and the error level
+        auto run_scft = [&](AndersonMixing* optimizer, double chi_n, double& energy_total, double& error_level) -> int
+        {
+            for(int i=0; i<M; i++)
+            {
+                phi_a[i] = cos(2.0*PI*i/M)*0.2;
+                phi_b[i] = 1.0 - phi_a[i];
+                w[i]   = chi_n*phi_b[i];
+                w[i+M] = chi_n*phi_a[i];
+            }
+            cb->zero_mean(&w[0]);
+            cb->zero_mean(&w[M]);
+
+            optimizer->reset_count();
+            error_level = 1.0e20;
+            double old_error_level;
+            int iter;
+            for(iter=0; iter<max_scft_iter; iter++)
+            {
+                solver->compute_propagators({{"A",&w[0]},{"B",&w[M]}},{});
+                solver->compute_concentrations();
+                solver->get_total_concentration("A", phi_a.data());
+                solver->get_total_concentration("B", phi_b.data());
+
+                // w_diff_i = sum_j chi_ij*phi_j - P_ij*w_j
+                energy_total = -log(solver->get_total_partition(0));
+                for(int i=0; i<M; i++)
+                {
+                    double w_minus = (w[i]-w[i+M])/2;
+                    double w_plus  = (w[i]+w[i+M])/2;
+                    energy_total += (w_minus*w_minus/chi_n - w_plus)/M;
+
+                    w_diff[i]   = chi_n*phi_b[i] - w_minus;
+                    w_diff[i+M] = chi_n*phi_a[i] + w_minus;
+                }
+                cb->zero_mean(&w_diff[0]);
+                cb->zero_mean(&w_diff[M]);
+
+                old_error_level = error_level;
+                error_level = sqrt(cb->multi_inner_product(2,w_diff.data(),w_diff.data())/
+                                (cb->multi_inner_product(2,w.data(),w.data())+1.0));
+
+                if(error_level < tolerance) break;
+                optimizer->calculate_new_fields(w.data(), w.data(), w_diff.data(), old_error_level, error_level);
+            }
+            return iter;
+        };
+
+        for(double chi_n : {14.0, 18.0})
+        {
+            std::vector<std::vector<double>> matrix_chi = {{0.0, chi_n}, {chi_n, 0.0}};
+            std::vector<std::vector<double>> matrix_p = {{0.5, -0.5}, {-0.5, 0.5}};
+
+            std::vector<std::string> methods = {"Simple mixing", "Semi-implicit", "Anderson mixing", "Semi-implicit, Anderson mixing"};
+            std::vector<int> n_iterations;
+            std::vector<double> free_energies;
+            for(const std::string& method : methods)
+            {
+                AndersonMixing *optimizer;
+                AndersonMixing *anderson_mixing = nullptr;
+                if (method == "Simple mixing")
+                    optimizer = factory->create_anderson_mixing(2*M, am_max_hist, 0.0, am_mix_min, am_mix_init);
+                else if (method == "Anderson mixing")
+                    optimizer = factory->create_anderson_mixing(2*M, am_max_hist, am_start_error, am_mix_min, am_mix_init);
+                else if (method == "Semi-implicit")
+                    optimizer = factory->create_semi_implicit_mixing(cb, molecules, {"A","B"}, matrix_chi, matrix_p, 2*M, sis_lambda);
+                else
+                {
+                    anderson_mixing = factory->create_anderson_mixing(2*M, am_max_hist, am_start_error, am_mix_min, am_mix_init);
+                    optimizer = factory->create_semi_implicit_mixing(cb, molecules, {"A","B"}, matrix_chi, matrix_p, 2*M, sis_lambda, anderson_mixing);
+                }
+
+                double energy_total, error_level;
+                auto chrono_start = std::chrono::system_clock::now();
+                int n_iter = run_scft(optimizer, chi_n, energy_total, error_level);
+                std::chrono::duration<double> time_duration = std::chrono::system_clock::now() - chrono_start;
+
+                std::cout << "chi_n: " << chi_n << ", " << method << ": iterations, error level, free energy, time (s): "
+                    << n_iter << ", " << std::scientific << error_level << ", " << std::setprecision(12) << energy_total << ", "
+                    << std::defaultfloat << time_duration.count() << std::endl;
+
+                n_iterations.push_back(n_iter);
+                free_energies.push_back(energy_total);
+                delete optimizer;
+                delete anderson_mixing;
+
+                if (!std::isfinite(error_level) || error_level >= tolerance)
+                    return -1;
+            }
+            // All methods should converge to the same solution
+            for(size_t m=1; m<methods.size(); m++)
+            {
+                if (std::abs(free_energies[m]-free_energies[0]) > 1e-7)
+                    return -1;
+            }
+            // The semi-implicit update should take fewer iterations than simple mixing
+            if (n_iterations[1] >= n_iterations[0])
+                return -1;
+        }
+
+        // The kernels are rebuilt when the box is changed
+        {
+            std::vector<std::vector<double>> matrix_chi = {{0.0, 12.0}, {12.0, 0.0}};
+            std::vector<std::vector<double>> matrix_p = {{0.5, -0.5}, {-0.5, 0.5}};
+            SemiImplicitMixing *optimizer = factory->create_semi_implicit_mixing(cb, molecules, {"A","B"}, matrix_chi, matrix_p, 2*M, 1.0);
+            for(int i=0; i<2*M; i++)
+                w_diff[i] = cos(2.0*PI*(i%M)/M)*(i < M ? 1.0 : -1.0);
+            std::vector<double> w_new_1(2*M), w_new_2(2*M), w_new_3(2*M);
+            std::fill(w.begin(), w.end(), 0.0);
+            optimizer->calculate_new_fields(w_new_1.data(), w.data(), w_diff.data(), 1.0, 1.0);
+            cb->set_lx({2.0*lx[0]});
+            solver->update_laplacian_operator();
+            optimizer->calculate_new_fields(w_new_2.data(), w.data(), w_diff.data(), 1.0, 1.0);
+            cb->set_lx(lx);
+            solver->update_laplacian_operator();
+            optimizer->calculate_new_fields(w_new_3.data(), w.data(), w_diff.data(), 1.0, 1.0);
+            double diff_12 = 0.0, diff_13 = 0.0;
+            for(int i=0; i<2*M; i++)
+            {
+                diff_12 = std::max(diff_12, std::abs(w_new_1[i]-w_new_2[i]));
+                diff_13 = std::max(diff_13, std::abs(w_new_1[i]-w_new_3[i]));
+            }
+            std::cout << "Change of updates after changing box: " << diff_12 << ", after restoring box: " << diff_13 << std::endl;
+            if (diff_12 < 1e-3 || diff_13 > 1e-12)
+                return -1;
+            delete optimizer;
+        }
+
+        // Invalid parameters
+        try
+        {
+            SemiImplicitMixing *optimizer = factory->create_semi_implicit_mixing(cb, molecules, {"A","B"}, {{0.0, 12.0}, {12.0, 0.0}}, {{0.5, -0.5}, {-0.5, 0.5}}, 2*M, -1.0);
+            delete optimizer;
+            return -1;
+        }
+        catch(std::exception& exc)
+        {
+            std::cout << exc.what() << std::endl;
+        }
+
+        delete molecules;
+        delete propagator_analyzer;
+        delete cb;
+        delete solver;
+        delete factory;
+        return 0;
+    }
+    catch(std::exception& exc)
+    {
+        std::cout << exc.what() << std::endl;
+        return -1;
+    }
+}
@@ -0,0 +1,64 @@
+#include <cstdlib>
+#include <cstdio>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+
+#include "Exception.h"
+#include "ComputationBox.h"
+#include "Polymer.h"
+#include "Molecules.h"
+#include "PropagatorAnalyzer.h"
+#include "PropagatorComputation.h"
+#include "AbstractFactory.h"
+#include "PlatformSelector.h"
+
+int main()
+{
+    try
+    {
+        const std::string trace_file = "TestTracer.json";
+        std::remove(trace_file.c_str());
+        setenv("LFTS_TRACE_FILE", trace_file.c_str(), 1);
+        setenv("LFTS_TRACE_MAX_CALLS", "2", 1);
+
+        AbstractFactory *factory = PlatformSelector::create_factory("cpu-mkl", false);
+        ComputationBox *cb = factory->create_computation_box({8,8}, {2.0,2.0}, {});
+        Molecules* molecules = factory->create_molecules_information("Continuous", 1.0/10, {{"A",1.0}, {"B",1.0}});
+        molecules->add_polymer(1.0, {{"A",0.5,0,1}, {"B",0.5,1,2}}, {});
+        PropagatorAnalyzer* propagator_analyzer = factory->create_propagator_analyzer(molecules, false);
+        PropagatorComputation *solver = factory->create_pseudospectral_solver(cb, molecules, propagator_analyzer);
+
+        const int M = cb->get_n_grid();
+        std::vector<double> w_a(M, 0.1), w_b(M, -0.1);
+        for(int i=0; i<3; i++)
+        {
+            solver->compute_statistics({{"A",w_a.data()},{"B",w_b.data()}}, {});
+
+            // The trace is written as soon as the first two calls are finished
+            std::ifstream file(trace_file);
+            bool is_written = file.good();
+            std::cout << "Call " << i << ", trace file is written: " << is_written << std::endl;
+            if (is_written != (i >= 1))
+                return -1;
+        }
+
+        delete solver;
+        delete propagator_analyzer;
+        delete molecules;
+        delete cb;
+        delete factory;
+
+        unsetenv("LFTS_TRACE_FILE");
+        unsetenv("LFTS_TRACE_MAX_CALLS");
+        std::remove(trace_file.c_str());
+        return 0;
+    }
+    catch(std::exception& exc)
+    {
+        std::cout << exc.what() << std::endl;
+        return -1;
+    }
+}